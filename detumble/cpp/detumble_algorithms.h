@@ -2,6 +2,31 @@
 // Created by Paul on 11/5/2019.
 //
 
+/* Streaming B dot estimate, plain C so flight code can keep one in a static. The last window
+   samples sit in a ring buffer of fixed size and every update is a fixed amount of work with no
+   allocation.
+     B_DOT_SAVITZKY_GOLAY  slope at the newest sample of a least squares quadratic over the window
+     B_DOT_REGRESSION      slope of a least squares line over the window, smoother, lags (window-1)/2 steps
+     B_DOT_ALPHA_BETA      alpha-beta tracker of B and B dot, window unused
+   Until the window fills the two newest samples are differenced as in get_B_dot. */
+#define B_DOT_CAPACITY 32
+#define B_DOT_SAVITZKY_GOLAY 0
+#define B_DOT_REGRESSION 1
+#define B_DOT_ALPHA_BETA 2
+
+typedef struct {
+    int mode;
+    int window;
+    double dt;
+    double alpha, beta;
+    double weights[B_DOT_CAPACITY];     /* derivative weight of the sample k steps old */
+    double ring[B_DOT_CAPACITY][3];
+    int head;                           /* newest sample in ring */
+    int count;
+    double B[3];                        /* alpha-beta field estimate */
+    double B_dot[3];
+} B_dot_state;
+
 #ifdef __cplusplus
 
 #include "../../eigen-git-mirror/Eigen/Dense"
@@ -15,10 +40,64 @@ Vector3d detumble_B_dot_bang_bang(Vector3d B_dot, Vector3d max_dipoles);
 Vector3d get_bias_estimate(MatrixXd B_mat);
 Vector3d get_B_dot(Vector3d B1, Vector3d B2, double dt);
 
+// Hard and soft iron correction from the ellipsoid fit, corrected = T*(raw - bias). T is symmetric, it
+// maps the fitted ellipsoid onto a sphere with the geometric mean of its semi-axes as radius.
+struct magnetometer_calibration {
+    Vector3d bias;
+    Matrix3d T;
+    Vector3d radii;     // semi-axes of the fitted ellipsoid along the eigenvectors of T
+};
+
+magnetometer_calibration get_calibration_estimate(MatrixXd B_mat);
+void apply_calibration(const magnetometer_calibration& calibration, double* B, long n);
+
+// Streaming form of the ellipsoid fit in get_bias_estimate. Each sample rotates its row of the
+// 9 parameter least squares problem into an upper triangular factor with Givens rotations, so the
+// memory and the work per sample stay fixed however long the arc. A forgetting factor below 1
+// weighs a sample k steps old by forgetting^k, for a bias that drifts. Samples are divided by the
+// norm of the first one to keep the factor well scaled, the fit is the same.
+class bias_estimator {
+public:
+    explicit bias_estimator(double forgetting = 1.0);
+
+    void add_sample(const Vector3d& B);
+    Vector3d estimate() const;
+    magnetometer_calibration calibration() const;
+    void reset();
+
+    long samples() const { return count; }
+    double forgetting_factor() const { return forgetting; }
+
+private:
+    Matrix<double, 9, 10> R;    // factor and rotated right hand side
+    double scale;
+    double forgetting;
+    long count;
+};
+
+// C++ face of B_dot_state, see above
+class B_dot_estimator {
+public:
+    B_dot_estimator(int mode, int window, double dt, double alpha = 0.5, double beta = 0.1);
+
+    Vector3d update(const Vector3d& B);
+    Vector3d B_dot() const { return Vector3d(s.B_dot[0], s.B_dot[1], s.B_dot[2]); }
+    void reset();
+
+    const B_dot_state& state() const { return s; }
+
+private:
+    B_dot_state s;
+};
+
 extern "C" {
 #endif /* __cplusplus */
 
 void detumble_B_dot_C(double* B_dot, double* max_dipoles, double* commanded_dipole);
+void apply_calibration_C(const double* bias, const double* T, double* B, long n);
+int B_dot_init_C(B_dot_state* state, int mode, int window, double dt, double alpha, double beta);
+void B_dot_reset_C(B_dot_state* state);
+void B_dot_update_C(B_dot_state* state, const double* B, double* B_dot);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -0,0 +1,165 @@
+//
+// Times the magnetometer calibration on a 24 hour 10 Hz log: the streaming
+// ellipsoid fit per sample against get_bias_estimate on a growing history,
+// and apply_calibration against a plain read and write of the same log,
+// which is as fast as memory allows. Then the streaming B dot estimates on a
+// tumble: time per update, error, lag and sign flips against get_B_dot.
+//
+// usage : detumble_benchmark [repeat]   (default 5)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "detumble_algorithms.h"
+
+using namespace std;
+
+// samples in the log, 24 hours at 10 Hz
+#define LOG_SAMPLES 864000
+// samples of the tumble, 10 minutes at 10 Hz
+#define TUMBLE_SAMPLES 6000
+
+int main(int argc, char* argv[]) {
+    const int repeat = (argc > 1) ? atoi(argv[1]) : 5;
+
+    // field of ~45000 nT seen through a bias and a skewed scale, with noise
+    mt19937 random(7);
+    normal_distribution<double> normal(0.0, 1.0);
+    const Vector3d bias_true(4000.0, -2000.0, 1000.0);
+    Matrix3d scale_true;
+    scale_true << 1.05, 0.02, -0.01,
+                  0.02, 0.97, 0.03,
+                  -0.01, 0.03, 1.01;
+    vector<double> log(3 * LOG_SAMPLES);
+    for(int i = 0; i < LOG_SAMPLES; i++){
+        Vector3d d(normal(random), normal(random), normal(random));
+        const Vector3d B = scale_true * (45000.0 * d.normalized()) + bias_true;
+        for(int j = 0; j < 3; j++){
+            log[3*i + j] = B(j) + 20.0 * normal(random);
+        }
+    }
+
+    printf("ellipsoid fit, %d samples\n", LOG_SAMPLES);
+    bias_estimator estimator;
+    auto t0 = chrono::steady_clock::now();
+    for(int i = 0; i < LOG_SAMPLES; i++){
+        estimator.add_sample(Map<Vector3d>(&log[3*i]));
+    }
+    auto t1 = chrono::steady_clock::now();
+    const magnetometer_calibration calibration = estimator.calibration();
+    printf(" bias_estimator::add_sample %.1f ns per sample, bias error %.2f nT, soft iron error %.2e\n",
+           1e9 * chrono::duration<double>(t1 - t0).count() / LOG_SAMPLES, (calibration.bias - bias_true).norm(),
+           (calibration.T * scale_true / (calibration.T * scale_true).diagonal().mean()
+            - Matrix3d::Identity()).norm());
+    printf(" get_bias_estimate on the history so far, every sample:\n");
+    for(int m : {1000, 10000, 100000}){
+        Map<Matrix<double, Dynamic, 3, RowMajor> > history(&log[0], m, 3);
+        t0 = chrono::steady_clock::now();
+        const Vector3d bias = get_bias_estimate(history);
+        t1 = chrono::steady_clock::now();
+        printf("  %7d samples  %10.1f us  bias error %.2f nT\n", m, 1e6 * chrono::duration<double>(t1 - t0).count(),
+               (bias - bias_true).norm());
+    }
+
+    printf("\napply_calibration, %d samples (%.1f MB) in place, best of %d\n", LOG_SAMPLES, 24e-6 * LOG_SAMPLES,
+           repeat);
+    vector<double> B(log);
+    double t_copy = 1e30, t_apply = 1e30;
+    for(int r = 0; r < repeat; r++){
+        copy(log.begin(), log.end(), B.begin());
+        t0 = chrono::steady_clock::now();
+        for(size_t i = 0; i < B.size(); i++){
+            B[i] = 1.000001 * B[i];
+        }
+        t1 = chrono::steady_clock::now();
+        copy(log.begin(), log.end(), B.begin());
+        auto t2 = chrono::steady_clock::now();
+        apply_calibration(calibration, &B[0], LOG_SAMPLES);
+        auto t3 = chrono::steady_clock::now();
+        t_copy = min(t_copy, chrono::duration<double>(t1 - t0).count());
+        t_apply = min(t_apply, chrono::duration<double>(t3 - t2).count());
+    }
+    // the corrected field lies on a sphere of the geometric mean of the semi-axes
+    const double radius = cbrt(calibration.radii.prod());
+    double spread = 0;
+    for(int i = 0; i < LOG_SAMPLES; i++){
+        spread = max(spread, fabs(Map<Vector3d>(&B[3*i]).norm() - radius));
+    }
+    printf(" read and write  %7.2f ms  %6.2f GB/s\n", 1e3 * t_copy, 48e-9 * LOG_SAMPLES / t_copy);
+    printf(" calibration     %7.2f ms  %6.2f GB/s  %.2f ns per sample\n", 1e3 * t_apply, 48e-9 * LOG_SAMPLES / t_apply,
+           1e9 * t_apply / LOG_SAMPLES);
+    printf(" largest departure of the corrected field from the sphere %.1f nT\n", spread);
+
+    // 45000 nT field seen from a body turning at 0.1 rad/s, 100 nT of noise, B dot = -omega x B
+    const double dt = 0.1;
+    const Vector3d omega = 0.1 * Vector3d(0.6, -0.48, 0.64);
+    vector<Vector3d> B_true(TUMBLE_SAMPLES), B_dot_true(TUMBLE_SAMPLES), B_meas(TUMBLE_SAMPLES);
+    for(int i = 0; i < TUMBLE_SAMPLES; i++){
+        const AngleAxisd turn(-omega.norm() * dt * i, omega.normalized());
+        B_true[i] = turn * Vector3d(45000.0, 0.0, 0.0);
+        B_dot_true[i] = -omega.cross(B_true[i]);
+        B_meas[i] = B_true[i] + 100.0 * Vector3d(normal(random), normal(random), normal(random));
+    }
+    printf("\nB dot on a %.2f rad/s tumble at %.0f Hz, %d samples, 100 nT noise, |B dot| %.0f nT/s\n", omega.norm(),
+           1.0 / dt, TUMBLE_SAMPLES, B_dot_true[0].norm());
+    printf(" estimate              update (ns)  rms err (nT/s)  lag (steps)  rms err at lag  sign flips\n");
+    struct { const char* name; int mode, window; double alpha, beta; } estimates[] = {
+        {"get_B_dot", -1, 2, 0, 0},
+        {"savitzky-golay 9", B_DOT_SAVITZKY_GOLAY, 9, 0, 0}, {"savitzky-golay 21", B_DOT_SAVITZKY_GOLAY, 21, 0, 0},
+        {"regression 5", B_DOT_REGRESSION, 5, 0, 0}, {"regression 11", B_DOT_REGRESSION, 11, 0, 0},
+        {"alpha-beta .5 .1", B_DOT_ALPHA_BETA, 0, 0.5, 0.1}, {"alpha-beta .2 .02", B_DOT_ALPHA_BETA, 0, 0.2, 0.02}};
+    vector<Vector3d> B_dot(TUMBLE_SAMPLES);
+    for(const auto& e : estimates){
+        double t_update = 1e30;
+        for(int r = 0; r < repeat; r++){
+            t0 = chrono::steady_clock::now();
+            if(e.mode < 0){
+                B_dot[0].setZero();
+                for(int i = 1; i < TUMBLE_SAMPLES; i++){
+                    B_dot[i] = get_B_dot(B_meas[i - 1], B_meas[i], dt);
+                }
+            }
+            else{
+                B_dot_estimator estimator(e.mode, e.window, dt, e.alpha, e.beta);
+                for(int i = 0; i < TUMBLE_SAMPLES; i++){
+                    B_dot[i] = estimator.update(B_meas[i]);
+                }
+            }
+            t1 = chrono::steady_clock::now();
+            t_update = min(t_update, chrono::duration<double>(t1 - t0).count());
+        }
+        // past the first minute, the lag is the shift of the truth that fits the estimate best
+        const int settle = 600;
+        double rms[8];
+        int lag = 0, flips = 0;
+        for(int shift = 0; shift < 8; shift++){
+            double sum = 0;
+            for(int i = settle; i < TUMBLE_SAMPLES; i++){
+                sum += (B_dot[i] - B_dot_true[i - shift]).squaredNorm();
+            }
+            rms[shift] = sqrt(sum / (TUMBLE_SAMPLES - settle));
+            lag = (rms[shift] < rms[lag]) ? shift : lag;
+        }
+        for(int i = settle + 1; i < TUMBLE_SAMPLES; i++){
+            for(int j = 0; j < 3; j++){
+                flips += (B_dot[i](j) > 0) != (B_dot[i - 1](j) > 0);
+            }
+        }
+        printf(" %-20s  %11.1f  %14.1f  %11d  %14.1f  %10d\n", e.name, 1e9 * t_update / TUMBLE_SAMPLES, rms[0], lag,
+               rms[lag], flips);
+    }
+    // the sign of the true rate turns over twice a period on each axis
+    int flips = 0;
+    for(int i = 601; i < TUMBLE_SAMPLES; i++){
+        for(int j = 0; j < 3; j++){
+            flips += (B_dot_true[i](j) > 0) != (B_dot_true[i - 1](j) > 0);
+        }
+    }
+    printf(" %-20s  %11s  %14s  %11s  %14s  %10d\n", "true", "", "", "", "", flips);
+    return 0;
+}
@@ -51,6 +51,112 @@ def test_bias_estimation():
     np.testing.assert_array_less(rel_error,.1)
 
 
-    
-    
-    
\ No newline at end of file
+def batch_bias_estimate(B_mat):
+    # the batch least squares ellipsoid fit get_bias_estimate used to do with an SVD
+    x, y, z = B_mat[:, 0], B_mat[:, 1], B_mat[:, 2]
+    D = np.column_stack([x*x + y*y - 2*z*z, x*x + z*z - 2*y*y, 2*x*y, 2*x*z, 2*y*z, 2*x, 2*y, 2*z, np.ones(len(x))])
+    u = np.linalg.lstsq(D, x*x + y*y + z*z, rcond=None)[0]
+    v = np.concatenate([[u[0] + u[1] - 1, u[0] - 2*u[1] - 1, u[1] - 2*u[0] - 1], u[2:]])
+    A = np.array([[v[0], v[3], v[4]], [v[3], v[1], v[5]], [v[4], v[5], v[2]]])
+    return -np.linalg.solve(A, v[6:9])
+
+
+def test_bias_estimator():
+    # streaming fit against the batch one on the same noisy, scaled measurements
+    rng = np.random.RandomState(3)
+    bias_true = np.array([4000., -2000., 1000.])
+    directions = rng.normal(size=(500, 3))
+    directions /= np.linalg.norm(directions, axis=1)[:, None]
+    B_mat = bias_true + directions * np.array([45000., 43000., 47000.]) + rng.normal(scale=50., size=(500, 3))
+
+    estimator = dcpp.bias_estimator()
+    assert np.all(np.isnan(estimator.estimate()))
+    for B in B_mat:
+        estimator.add_sample(B)
+    assert estimator.samples == 500
+    batch = batch_bias_estimate(B_mat)
+    np.testing.assert_allclose(estimator.estimate(), batch, rtol=1e-8, atol=1e-6)
+    np.testing.assert_allclose(dcpp.get_bias_estimate(B_mat), batch, rtol=1e-8, atol=1e-6)
+    np.testing.assert_allclose(batch, bias_true, atol=50.)
+
+    # with forgetting the estimate follows a change of bias, without it the old bias stays in
+    bias_new = np.array([-3000., 5000., 0.])
+    forgetting = dcpp.bias_estimator(forgetting=0.95)
+    for B in B_mat:
+        forgetting.add_sample(B)
+    for B in bias_new - bias_true + B_mat[:300]:
+        forgetting.add_sample(B)
+        estimator.add_sample(B)
+    np.testing.assert_allclose(forgetting.estimate(), bias_new, atol=100.)
+    assert np.linalg.norm(estimator.estimate() - bias_new) > 1000.
+
+    estimator.reset()
+    assert estimator.samples == 0
+    with pytest.raises(ValueError):
+        dcpp.bias_estimator(forgetting=0.)
+
+
+def test_calibration_estimate():
+    # hard and soft iron recovered from samples through a known bias and symmetric scale, and applied in place
+    rng = np.random.RandomState(5)
+    bias_true = np.array([4000., -2000., 1000.])
+    S = np.array([[1.05, 0.02, -0.01], [0.02, 0.97, 0.03], [-0.01, 0.03, 1.01]])
+    directions = rng.normal(size=(2000, 3))
+    directions /= np.linalg.norm(directions, axis=1)[:, None]
+    B_mat = bias_true + 45000. * directions.dot(S.T) + rng.normal(scale=10., size=(2000, 3))
+
+    calibration = dcpp.get_calibration_estimate(B_mat)
+    np.testing.assert_allclose(calibration.bias, dcpp.get_bias_estimate(B_mat), rtol=1e-12)
+    np.testing.assert_allclose(calibration.bias, bias_true, atol=5.)
+    np.testing.assert_allclose(calibration.T, calibration.T.T, atol=1e-12)
+    # T undoes S up to the radius of the sphere it maps onto
+    radius = np.prod(calibration.radii) ** (1. / 3.)
+    np.testing.assert_allclose(calibration.T.dot(S) * 45000. / radius, np.eye(3), atol=1e-3)
+    np.testing.assert_allclose(np.sort(calibration.radii), np.sort(45000. * np.linalg.eigvalsh(S)), rtol=1e-3)
+
+    estimator = dcpp.bias_estimator()
+    for B in B_mat:
+        estimator.add_sample(B)
+    np.testing.assert_allclose(estimator.calibration().T, calibration.T, rtol=1e-12)
+
+    corrected = B_mat.copy()
+    dcpp.apply_calibration(calibration, corrected)
+    np.testing.assert_allclose(corrected, (B_mat - calibration.bias).dot(calibration.T.T), rtol=1e-12, atol=1e-8)
+    np.testing.assert_allclose(np.linalg.norm(corrected, axis=1), radius, atol=60.)
+    with pytest.raises(ValueError):
+        dcpp.apply_calibration(calibration, B_mat.T)
+
+
+def test_B_dot_estimator():
+    # the fits are exact on polynomials of their degree, the tracker settles on a ramp
+    dt = 0.1
+    t = dt * np.arange(40)
+    rate = np.array([300., -200., 50.])
+    accel = np.array([40., 10., -25.])
+    line = np.array([45000., -1000., 2000.]) + np.outer(t, rate)
+    quadratic = line + 0.5 * np.outer(t ** 2, accel)
+
+    regression = dcpp.B_dot_estimator(dcpp.B_DOT_REGRESSION, 8, dt)
+    savitzky_golay = dcpp.B_dot_estimator(dcpp.B_DOT_SAVITZKY_GOLAY, 9, dt)
+    assert np.allclose(regression.update(line[0]), 0.)
+    np.testing.assert_allclose(regression.update(line[1]), dcpp.get_B_dot(line[0], line[1], dt), rtol=1e-9)
+    for B in line[2:]:
+        B_dot = regression.update(B)
+    np.testing.assert_allclose(B_dot, rate, rtol=1e-9)
+    np.testing.assert_allclose(regression.B_dot(), rate, rtol=1e-9)
+    for B, tk in zip(quadratic, t):
+        B_dot = savitzky_golay.update(B)
+    np.testing.assert_allclose(B_dot, rate + accel * tk, rtol=1e-9)
+    np.testing.assert_allclose(sum(savitzky_golay.weights), 0., atol=1e-9)
+
+    alpha_beta = dcpp.B_dot_estimator(dcpp.B_DOT_ALPHA_BETA, 0, dt, alpha=0.5, beta=0.1)
+    for B in np.array([45000., -1000., 2000.]) + np.outer(dt * np.arange(400), rate):
+        B_dot = alpha_beta.update(B)
+    np.testing.assert_allclose(B_dot, rate, rtol=1e-6)
+
+    regression.reset()
+    assert np.allclose(regression.update(line[5]), 0.)
+    for args in [(dcpp.B_DOT_SAVITZKY_GOLAY, 2, dt), (dcpp.B_DOT_REGRESSION, 33, dt), (dcpp.B_DOT_REGRESSION, 8, 0.),
+                 (7, 8, dt), (dcpp.B_DOT_ALPHA_BETA, 0, dt, 0.5, 3.5)]:
+        with pytest.raises(ValueError):
+            dcpp.B_dot_estimator(*args)
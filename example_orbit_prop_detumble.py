@@ -8,8 +8,9 @@ from mpl_toolkits.mplot3d import Axes3D
 import math
 import numpy as np
 import scipy.integrate as integrate
-from orbit_propagation import get_orbit_pos, get_B_field_at_point
-# from GNC.cmake_build_debug import SGP4_cpp as SGP4
+from orbit_propagation import get_B_field_at_point
+from orbit_propagation.orbit_prop_py.orbit import parse_epoch
+import SGP4_cpp
 # from util_funcs.py_funcs.frame_conversions import eci2ecef
 import time_functions_cpp as tfcpp
 import frame_conversions_cpp as fccpp
@@ -88,14 +89,16 @@ M_vec = np.zeros((n-1,3))
 # Define function for calculating full state derivative
 t = time.time()
 
-# extract position info at all times (from Python)
+# extract position info at all times (from C++), TLE parsed once and the whole grid propagated in one call
+satellite = SGP4_cpp.Satellite(line1, line2, 84)
+minutes = satellite.minutes_since_epoch(*parse_epoch(epoch)) + times[0:n-1] / 60.0
+positions_ECI[:,:] = satellite.propagate(minutes)[:,0:3]
+
 x = x_0;
 for i in range(len(times)-1):
     # Get GMST at this time
     GMST = tfcpp.MJD2GMST(MJD + times[i] / 60.0 / 60.0 / 24.0)
 
-    positions_ECI[i,:] = get_orbit_pos(TLE, epoch, times[i])
-
     # convert to ECEF
     R_ECI2ECEF = fccpp.eci2ecef(GMST)
 
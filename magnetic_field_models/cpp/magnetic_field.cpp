@@ -3,34 +3,42 @@
 //
 
 #include "magnetic_field.h"
+#include "magnetic_field_grid.h"
+#include "magnetic_field_series.h"
 #include <math.h>
 #include <iostream>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "../../eigen-git-mirror/Eigen/Dense"
+#ifndef MAGNETIC_FIELD_LIBRARY
 #include <../../pybind11/include/pybind11/pybind11.h>
 #include <../../pybind11/include/pybind11/eigen.h>
+#include <../../pybind11/include/pybind11/stl.h>
+#include <../../pybind11/include/pybind11/numpy.h>
+namespace py = pybind11;
+#endif
 
 using namespace std;
 using namespace Eigen;
-namespace py = pybind11;
 
 //function declaration
 //VectorXd get_magnetic_field(double lat, double lon, double alt, int year);
 
 
-VectorXd get_magnetic_field(double lat, double lon, double alt, double year, int order);
-MatrixXd get_P_coefficients(double x, int order);
-MatrixXd get_g_coefficients();
-MatrixXd get_h_coefficients();
-MatrixXd get_g_sv_coefficients();
-MatrixXd get_h_sv_coefficients();
-MatrixXd get_Pd_coefficients(MatrixXd P, double x, int order);
-
-
 const MatrixXd g = get_g_coefficients();
 const MatrixXd h = get_h_coefficients();
 const MatrixXd g_sv = get_g_sv_coefficients();
 const MatrixXd h_sv = get_h_sv_coefficients();
 
+// the magnetic_field library (CMakeLists.txt) links these functions into C++ code, without main or the python module
+#ifndef MAGNETIC_FIELD_LIBRARY
 int main() {
     // double lat = 45; double lon = 45; double alt = 400; double year = 2015;
     // MatrixXd P = get_P_coefficients(cos((90.0 - lat) * M_PI / 180.0));
@@ -42,11 +50,630 @@ int main() {
     return 0;
 
 }
+#endif
 
 
 VectorXd get_magnetic_field(double lat, double lon, double alt, double year, int order){
 
     /*
+    lat is geocentric latitude in degrees
+    lon is longitude in degrees
+    alt is altitude in km
+    year is the fractional year (include months/days essentially)
+    order is 1 to 10, the degree of the built-in coefficients
+
+    outputs B vector in NED
+    */
+    igrf_coefficients gh;
+    get_igrf_coefficients(year, order, gh);
+    return igrf_field(gh, lat, lon, alt, order);
+}
+
+
+void get_igrf_coefficients(double year, int order, igrf_coefficients& gh){
+
+    /*
+    Fills gh with the built-in 2015 coefficients moved to the fractional
+    year by the secular variation, up to degree order
+    */
+    if(order < 1 || order > g.rows() - 1){
+        throw invalid_argument("order must be 1 to 10 with the built-in coefficients");
+    }
+    // year since 2015 for secular variation
+    double dt = year - 2015.0;
+    for(int n = 0; n <= order; n++){
+        for(int m = 0; m <= n; m++){
+            gh.g[n][m] = g(n, m) + dt * g_sv(n, m);
+            gh.h[n][m] = h(n, m) + dt * h_sv(n, m);
+        }
+    }
+}
+
+
+void get_igrf_spectrum(const igrf_coefficients& gh, int order, igrf_spectrum& spectrum){
+
+    /*
+    Lowes-Mauersberger power of each degree 1 to order of gh at the reference radius
+    */
+    spectrum.order = order;
+    spectrum.power[0] = 0;
+    for(int n = 1; n <= order; n++){
+        double sum = 0;
+        for(int m = 0; m <= n; m++){
+            sum += gh.g[n][m] * gh.g[n][m] + gh.h[n][m] * gh.h[n][m];
+        }
+        spectrum.power[n] = (n + 1) * sum;
+    }
+}
+
+
+int igrf_budget_order(const igrf_spectrum& spectrum, double r, double budget){
+
+    /*
+    Lowest degree whose truncation leaves out at most budget nT rms over the sphere of
+    radius r km, against the field to spectrum.order. The rms is over the whole sphere, the
+    error at a given point can be about twice it.
+    */
+    const double q = (IGRF_RADIUS / r) * (IGRF_RADIUS / r);
+    const double budget2 = budget * budget;
+    // attenuation (a / r)^(2n + 4) of each degree, by one product per degree
+    double attenuation[IGRF_MAX_ORDER + 1];
+    attenuation[0] = q * q;
+    for(int n = 1; n <= spectrum.order; n++){
+        attenuation[n] = attenuation[n-1] * q;
+    }
+    double tail = 0;
+    for(int n = spectrum.order; n > 1; n--){
+        tail += spectrum.power[n] * attenuation[n];
+        if(tail > budget2){
+            return n;
+        }
+    }
+    return 1;
+}
+
+
+// Built-in coefficients to degree 10 and their spectrum at a date, one per thread
+struct igrf_builtin_cache {
+    igrf_coefficients gh;
+    igrf_spectrum spectrum;
+    double year;
+    bool cached;
+};
+
+static const igrf_builtin_cache& builtin_coefficients(double year){
+
+    /*
+    The built-in coefficients at the year, recomputed only once the year moves more than a
+    day from the cached one, the default refresh of igrf_model. Per thread, so the budget
+    functions can be called from several threads.
+    */
+    thread_local igrf_builtin_cache cache = {};
+    if(!cache.cached || fabs(year - cache.year) > 1.0 / 365.25){
+        get_igrf_coefficients(year, 10, cache.gh);
+        get_igrf_spectrum(cache.gh, 10, cache.spectrum);
+        cache.year = year;
+        cache.cached = true;
+    }
+    return cache;
+}
+
+
+int get_budget_order(double alt, double year, double budget){
+
+    /*
+    Degree get_magnetic_field_budget picks at alt km for budget nT rms
+    */
+    return igrf_budget_order(builtin_coefficients(year).spectrum, IGRF_RADIUS + alt, budget);
+}
+
+
+VectorXd get_magnetic_field_budget(double lat, double lon, double alt, double year, double budget){
+
+    /*
+    Same as get_magnetic_field with the built-in coefficients, at the lowest degree that
+    stays within budget nT rms of degree 10 over the sphere at the altitude, see
+    igrf_budget_order. At a given point the error can be about twice the budget.
+    The coefficients and spectrum are kept per thread while the year stays within a day.
+    */
+    const igrf_builtin_cache& cache = builtin_coefficients(year);
+    return igrf_field(cache.gh, lat, lon, alt, igrf_budget_order(cache.spectrum, IGRF_RADIUS + alt, budget));
+}
+
+
+Vector3d igrf_field(const igrf_coefficients& gh, double lat, double lon, double alt, int order){
+
+    /*
+    Picks the fixed order evaluator for order, gh must hold degrees 1 to order
+    */
+    switch(order){
+        case 1: return igrf_field<1>(gh, lat, lon, alt);
+        case 2: return igrf_field<2>(gh, lat, lon, alt);
+        case 3: return igrf_field<3>(gh, lat, lon, alt);
+        case 4: return igrf_field<4>(gh, lat, lon, alt);
+        case 5: return igrf_field<5>(gh, lat, lon, alt);
+        case 6: return igrf_field<6>(gh, lat, lon, alt);
+        case 7: return igrf_field<7>(gh, lat, lon, alt);
+        case 8: return igrf_field<8>(gh, lat, lon, alt);
+        case 9: return igrf_field<9>(gh, lat, lon, alt);
+        case 10: return igrf_field<10>(gh, lat, lon, alt);
+        case 11: return igrf_field<11>(gh, lat, lon, alt);
+        case 12: return igrf_field<12>(gh, lat, lon, alt);
+        case 13: return igrf_field<13>(gh, lat, lon, alt);
+        default: throw invalid_argument("order must be 1 to 13");
+    }
+}
+
+
+VectorXd get_magnetic_field_ecef(Vector3d r, double year, int order){
+
+    /*
+    r is the ECEF position in km
+    year is the fractional year
+    order is 1 to 10, the degree of the built-in coefficients
+
+    outputs B vector in ECEF, without going through lat, lon and NED
+    */
+    igrf_coefficients gh;
+    get_igrf_coefficients(year, order, gh);
+    return igrf_field_ecef(gh, r.data(), order);
+}
+
+
+Vector3d igrf_field_ecef(const igrf_coefficients& gh, const double r[3], int order){
+
+    /*
+    Picks the fixed order Cartesian evaluator for order
+    */
+    switch(order){
+        case 1: return igrf_field_ecef<1>(gh, r);
+        case 2: return igrf_field_ecef<2>(gh, r);
+        case 3: return igrf_field_ecef<3>(gh, r);
+        case 4: return igrf_field_ecef<4>(gh, r);
+        case 5: return igrf_field_ecef<5>(gh, r);
+        case 6: return igrf_field_ecef<6>(gh, r);
+        case 7: return igrf_field_ecef<7>(gh, r);
+        case 8: return igrf_field_ecef<8>(gh, r);
+        case 9: return igrf_field_ecef<9>(gh, r);
+        case 10: return igrf_field_ecef<10>(gh, r);
+        case 11: return igrf_field_ecef<11>(gh, r);
+        case 12: return igrf_field_ecef<12>(gh, r);
+        case 13: return igrf_field_ecef<13>(gh, r);
+        default: throw invalid_argument("order must be 1 to 13");
+    }
+}
+
+
+void igrf_field_gradient_ecef(const igrf_coefficients& gh, const double r[3], int order, Vector3d& B, Matrix3d& dB){
+
+    /*
+    Picks the fixed order field and gradient evaluator for order
+    */
+    switch(order){
+        case 1: return igrf_field_gradient_ecef<1>(gh, r, B, dB);
+        case 2: return igrf_field_gradient_ecef<2>(gh, r, B, dB);
+        case 3: return igrf_field_gradient_ecef<3>(gh, r, B, dB);
+        case 4: return igrf_field_gradient_ecef<4>(gh, r, B, dB);
+        case 5: return igrf_field_gradient_ecef<5>(gh, r, B, dB);
+        case 6: return igrf_field_gradient_ecef<6>(gh, r, B, dB);
+        case 7: return igrf_field_gradient_ecef<7>(gh, r, B, dB);
+        case 8: return igrf_field_gradient_ecef<8>(gh, r, B, dB);
+        case 9: return igrf_field_gradient_ecef<9>(gh, r, B, dB);
+        case 10: return igrf_field_gradient_ecef<10>(gh, r, B, dB);
+        case 11: return igrf_field_gradient_ecef<11>(gh, r, B, dB);
+        case 12: return igrf_field_gradient_ecef<12>(gh, r, B, dB);
+        case 13: return igrf_field_gradient_ecef<13>(gh, r, B, dB);
+        default: throw invalid_argument("order must be 1 to 13");
+    }
+}
+
+
+pair<Vector3d, Matrix3d> get_magnetic_field_gradient(double lat, double lon, double alt, double year, int order){
+
+    /*
+    lat is geocentric latitude in degrees
+    lon is longitude in degrees
+    alt is altitude in km
+    year is the fractional year
+    order is 1 to 10, the degree of the built-in coefficients
+
+    outputs B vector in NED and its gradient dB(i, j) = dB_i/dx_j in nT/km, both
+    along the north, east, down axes at the point. The gradient is that of the
+    field in a fixed frame, the turn of the NED axes along the way is not in it.
+    */
+    const double deg2rad = M_PI / 180.0;
+    const double sl = sin(lat * deg2rad), cl = cos(lat * deg2rad);
+    const double so = sin(lon * deg2rad), co = cos(lon * deg2rad);
+    // rows are north, east and down in ECEF
+    Matrix3d R;
+    R << -sl * co, -sl * so,  cl,
+         -so,       co,       0,
+         -cl * co, -cl * so, -sl;
+    const Vector3d r = (IGRF_RADIUS + alt) * Vector3d(cl * co, cl * so, sl);
+    pair<Vector3d, Matrix3d> field = get_magnetic_field_gradient_ecef(r, year, order);
+    field.first = R * field.first;
+    field.second = R * field.second * R.transpose();
+    return field;
+}
+
+
+pair<Vector3d, Matrix3d> get_magnetic_field_gradient_ecef(Vector3d r, double year, int order){
+
+    /*
+    r is the ECEF position in km
+    outputs B vector in ECEF and its gradient dB(i, j) = dB_i/dx_j in nT/km
+    */
+    igrf_coefficients gh;
+    get_igrf_coefficients(year, order, gh);
+    pair<Vector3d, Matrix3d> field;
+    igrf_field_gradient_ecef(gh, r.data(), order, field.first, field.second);
+    return field;
+}
+
+
+igrf_model::igrf_model(const string& filename, double refresh) : max_n(0), refresh(refresh), cache_year(0), cached(false) {
+
+    /*
+    Reads every g and h line of an IGRF coefficient file. Their columns from the 4th on are the
+    epochs and then the secular variation after the last one, the epochs are taken from the
+    g/h n m header line. Older epochs that stop at degree 10 are zero above it in the file.
+    */
+    ifstream file(filename.c_str());
+    if(!file){
+        throw runtime_error("igrf_model: cannot open " + filename);
+    }
+    memset(&sv, 0, sizeof(sv));
+    string line;
+    while(getline(file, line)){
+        istringstream fields(line);
+        string kind;
+        fields >> kind;
+        if(kind == "g/h"){
+            // g/h n m 1900.0 1905.0 ... 2020.0 2020-25
+            string n, m, column;
+            fields >> n >> m;
+            years.clear();
+            while(fields >> column){
+                years.push_back(atof(column.c_str()));
+            }
+            if(!years.empty()){
+                years.pop_back();
+            }
+        }else if(kind == "g" || kind == "h"){
+            int n = -1, m = -1;
+            double value;
+            vector<double> values;
+            fields >> n >> m;
+            while(fields >> value){
+                values.push_back(value);
+            }
+            if(n < 1 || n > IGRF_MAX_ORDER || m < 0 || m > n || values.size() < 2){
+                throw runtime_error("igrf_model: bad coefficient line in " + filename + ": " + line);
+            }
+            if(gh.empty()){
+                igrf_coefficients zero;
+                memset(&zero, 0, sizeof(zero));
+                gh.assign(values.size() - 1, zero);
+            }else if(values.size() != gh.size() + 1){
+                throw runtime_error("igrf_model: coefficient lines of different lengths in " + filename);
+            }
+            for(size_t k = 0; k < gh.size(); k++){
+                (kind == "g" ? gh[k].g : gh[k].h)[n][m] = values[k];
+            }
+            (kind == "g" ? sv.g : sv.h)[n][m] = values.back();
+            max_n = max(max_n, n);
+        }
+    }
+    if(gh.empty()){
+        throw runtime_error("igrf_model: no coefficients in " + filename);
+    }
+    // without a header the epochs are the IGRF ones, every 5 years from 1900
+    if(years.size() != gh.size()){
+        years.resize(gh.size());
+        for(size_t k = 0; k < gh.size(); k++){
+            years[k] = 1900.0 + 5.0 * k;
+        }
+    }
+}
+
+
+const igrf_coefficients& igrf_model::coefficients(double year){
+
+    /*
+    Coefficients at the fractional year, from the cache while it is within refresh years.
+    Between epochs they are interpolated linearly, after the last one the secular variation
+    is added as in pyIGRF/loadCoeffs.py.
+    */
+    if(cached && fabs(year - cache_year) <= refresh){
+        return cache;
+    }
+    if(!(year >= years.front())){
+        throw invalid_argument("igrf_model: year is before the first epoch of the coefficients");
+    }
+    size_t k = upper_bound(years.begin(), years.end(), year) - years.begin() - 1;
+    if(k + 1 < years.size()){
+        const double t = (year - years[k]) / (years[k+1] - years[k]);
+        const double tc = 1.0 - t;
+        for(int n = 0; n <= max_n; n++){
+            for(int m = 0; m <= n; m++){
+                cache.g[n][m] = tc * gh[k].g[n][m] + t * gh[k+1].g[n][m];
+                cache.h[n][m] = tc * gh[k].h[n][m] + t * gh[k+1].h[n][m];
+            }
+        }
+    }else{
+        const double dt = year - years[k];
+        for(int n = 0; n <= max_n; n++){
+            for(int m = 0; m <= n; m++){
+                cache.g[n][m] = gh[k].g[n][m] + dt * sv.g[n][m];
+                cache.h[n][m] = gh[k].h[n][m] + dt * sv.h[n][m];
+            }
+        }
+    }
+    get_igrf_spectrum(cache, max_n, cache_spectrum);
+    cache_year = year;
+    cached = true;
+    return cache;
+}
+
+
+const igrf_spectrum& igrf_model::spectrum(double year){
+
+    /*
+    Lowes-Mauersberger spectrum of the coefficients at the year, cached with them
+    */
+    coefficients(year);
+    return cache_spectrum;
+}
+
+
+Vector3d igrf_model::get_magnetic_field(double lat, double lon, double alt, double year, int order){
+
+    /*
+    Field in NED at geocentric lat, lon in degrees and alt in km, to degree order of the file,
+    order 0 for all of it
+    */
+    if(order == 0){
+        order = max_n;
+    }
+    if(order < 1 || order > max_n){
+        throw invalid_argument("igrf_model: order must be 1 to the degree of the coefficient file");
+    }
+    return igrf_field(coefficients(year), lat, lon, alt, order);
+}
+
+
+Vector3d igrf_model::get_magnetic_field_budget(double lat, double lon, double alt, double year, double budget){
+
+    /*
+    Field in NED at the lowest degree within budget nT rms of the whole file over the sphere
+    at the altitude, at a given point the error can be about twice the budget
+    */
+    const igrf_coefficients& gh = coefficients(year);
+    return igrf_field(gh, lat, lon, alt, igrf_budget_order(cache_spectrum, IGRF_RADIUS + alt, budget));
+}
+
+
+// points the batch evaluator takes together, its inner loops run across them
+#define IGRF_BLOCK 16
+
+// blocks a thread takes from the batch at a time
+#define IGRF_BLOCKS_PER_CHUNK 64
+
+// one block of points as structure of arrays
+struct igrf_block {
+    int count;
+    double x[IGRF_BLOCK];          // cos(colat)
+    double s[IGRF_BLOCK];          // sin(colat)
+    double cos_lon[IGRF_BLOCK];
+    double sin_lon[IGRF_BLOCK];
+    double ratio[IGRF_BLOCK];      // a/r
+};
+
+template <int N>
+static void igrf_field_block(const igrf_coefficients& gh, const igrf_block& p, double* B){
+
+    /*
+    igrf_field<N> for a block of points, written to B as NED rows. The order
+    of the loops is turned around, m outside and n inside, so only the last
+    two P and Pd of the column are kept and every step is one loop over the
+    points.
+    */
+    static const schmidt_recursion<N> k;
+    // every lane is worked on, the ones past p.count hold a copy of the first point
+    const int count = IGRF_BLOCK;
+    double ratio_n[N + 1][IGRF_BLOCK];
+    double cos_m[IGRF_BLOCK], sin_m[IGRF_BLOCK], P_mm[IGRF_BLOCK], Pd_mm[IGRF_BLOCK];
+    double P1[IGRF_BLOCK], P2[IGRF_BLOCK], Pd1[IGRF_BLOCK], Pd2[IGRF_BLOCK];
+    double B_r[IGRF_BLOCK], B_lat[IGRF_BLOCK], B_lon[IGRF_BLOCK];
+    // 1 on the axis, where the east component takes Pd as in igrf_field, kept as a
+    // factor so the term loop has no branch
+    double axis[IGRF_BLOCK];
+
+    for(int i = 0; i < count; i++){
+        axis[i] = (p.s[i] == 0) ? 1.0 : 0.0;
+        ratio_n[0][i] = p.ratio[i] * p.ratio[i];
+        cos_m[i] = 1.0; sin_m[i] = 0.0;
+        P_mm[i] = 1.0; Pd_mm[i] = 0.0;
+        B_r[i] = 0; B_lat[i] = 0; B_lon[i] = 0;
+    }
+    for(int n = 1; n <= N; n++){
+        for(int i = 0; i < count; i++){
+            ratio_n[n][i] = ratio_n[n-1][i] * p.ratio[i];
+        }
+    }
+
+    // adds the degree n, order m term with P and Pd of every point
+    auto add_term = [&](int n, int m, const double* P, const double* Pd) {
+        const double g = gh.g[n][m], h = gh.h[n][m];
+        for(int i = 0; i < count; i++){
+            const double gc = ratio_n[n][i] * (g * cos_m[i] + h * sin_m[i]);
+            const double gs = ratio_n[n][i] * (-g * sin_m[i] + h * cos_m[i]);
+            B_r[i] += (n + 1) * gc * P[i];
+            B_lat[i] -= gc * Pd[i];
+            B_lon[i] += gs * (axis[i] * Pd[i] + (1 - axis[i]) * m * P[i]);
+        }
+    };
+
+    for(int m = 0; m <= N; m++){
+        if(m > 0){
+            // next harmonic and sectoral term
+            for(int i = 0; i < count; i++){
+                const double c = cos_m[i] * p.cos_lon[i] - sin_m[i] * p.sin_lon[i];
+                sin_m[i] = sin_m[i] * p.cos_lon[i] + cos_m[i] * p.sin_lon[i];
+                cos_m[i] = c;
+                Pd_mm[i] = k.c[m] * (p.s[i] * Pd_mm[i] + p.x[i] * P_mm[i]);
+                P_mm[i] = k.c[m] * p.s[i] * P_mm[i];
+            }
+            add_term(m, m, P_mm, Pd_mm);
+        }
+        for(int i = 0; i < count; i++){
+            P1[i] = P_mm[i]; Pd1[i] = Pd_mm[i];
+            P2[i] = 0; Pd2[i] = 0;
+        }
+        for(int n = m + 1; n <= N; n++){
+            // b(m+1, m) is zero
+            const double a = k.a[n][m], b = k.b[n][m];
+            for(int i = 0; i < count; i++){
+                const double P = a * p.x[i] * P1[i] - b * P2[i];
+                const double Pd = a * (p.x[i] * Pd1[i] - p.s[i] * P1[i]) - b * Pd2[i];
+                P2[i] = P1[i]; Pd2[i] = Pd1[i];
+                P1[i] = P; Pd1[i] = Pd;
+            }
+            add_term(n, m, P1, Pd1);
+        }
+    }
+
+    for(int i = 0; i < p.count; i++){
+        B[3*i] = -B_lat[i];
+        B[3*i + 1] = B_lon[i] * ((p.s[i] == 0) ? -p.x[i] : -1 / p.s[i]);
+        B[3*i + 2] = -B_r[i];
+    }
+}
+
+typedef void (*igrf_block_function)(const igrf_coefficients&, const igrf_block&, double*);
+
+static igrf_block_function get_igrf_block_function(int order){
+    switch(order){
+        case 1: return &igrf_field_block<1>;
+        case 2: return &igrf_field_block<2>;
+        case 3: return &igrf_field_block<3>;
+        case 4: return &igrf_field_block<4>;
+        case 5: return &igrf_field_block<5>;
+        case 6: return &igrf_field_block<6>;
+        case 7: return &igrf_field_block<7>;
+        case 8: return &igrf_field_block<8>;
+        case 9: return &igrf_field_block<9>;
+        case 10: return &igrf_field_block<10>;
+        case 11: return &igrf_field_block<11>;
+        case 12: return &igrf_field_block<12>;
+        case 13: return &igrf_field_block<13>;
+        default: throw invalid_argument("order must be 1 to 13");
+    }
+}
+
+template <class Fill>
+static void igrf_batch(const igrf_coefficients& gh, int order, int n, double B[], int nthreads, Fill fill){
+
+    /*
+    Splits n points into chunks of blocks shared out to worker threads, the
+    calling thread being one of them. fill(i0, block) sets up the points from
+    i0 on, each point is written by one thread so the result does not depend
+    on the number of threads.
+    */
+    const igrf_block_function field = get_igrf_block_function(order);
+    const int chunk_size = IGRF_BLOCK * IGRF_BLOCKS_PER_CHUNK;
+    const int nchunks = (n + chunk_size - 1) / chunk_size;
+    atomic<int> next(0);
+
+    auto worker = [&]() {
+        igrf_block block;
+        int chunk;
+        while((chunk = next.fetch_add(1)) < nchunks){
+            const int end = min(n, (chunk + 1) * chunk_size);
+            for(int i0 = chunk * chunk_size; i0 < end; i0 += IGRF_BLOCK){
+                block.count = min(IGRF_BLOCK, end - i0);
+                fill(i0, block);
+                for(int i = block.count; i < IGRF_BLOCK; i++){
+                    block.x[i] = block.x[0]; block.s[i] = block.s[0];
+                    block.cos_lon[i] = block.cos_lon[0]; block.sin_lon[i] = block.sin_lon[0];
+                    block.ratio[i] = block.ratio[0];
+                }
+                field(gh, block, &B[3 * i0]);
+            }
+        }
+    };
+
+    if(nthreads <= 0){
+        nthreads = (int) thread::hardware_concurrency();
+    }
+    nthreads = max(1, min(nthreads, nchunks));
+    vector<thread> pool;
+    for(int t = 1; t < nthreads; t++){
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < pool.size(); t++){
+        pool[t].join();
+    }
+}
+
+
+void get_magnetic_field_batch(const igrf_coefficients& gh, int order, const double lat[], const double lon[],
+                              const double alt[], int n, double B[], int nthreads){
+
+    /*
+    get_magnetic_field at n points at once
+    lat, lon are geocentric in degrees, alt in km above the IGRF radius
+    B is n x 3, row major, NED, the east component at lat -90 is its limit
+    along the meridian of lon as at lat 90, not 0 as from get_magnetic_field
+    nthreads <= 0 for one per core
+    */
+    const double deg2rad = M_PI / 180.0;
+    igrf_batch(gh, order, n, B, nthreads, [&](int i0, igrf_block& block) {
+        for(int i = 0; i < block.count; i++){
+            const double colat = (90 - lat[i0 + i]) * deg2rad;
+            block.x[i] = cos(colat);
+            // zero at both poles, where get_magnetic_field only finds the north one on the axis
+            block.s[i] = sqrt(1 - block.x[i] * block.x[i]);
+            block.cos_lon[i] = cos(lon[i0 + i] * deg2rad);
+            block.sin_lon[i] = sin(lon[i0 + i] * deg2rad);
+            block.ratio[i] = IGRF_RADIUS / (IGRF_RADIUS + alt[i0 + i]);
+        }
+    });
+}
+
+
+void get_magnetic_field_batch_ecef(const igrf_coefficients& gh, int order, const double r[], int n, double B[],
+                                   int nthreads){
+
+    /*
+    get_magnetic_field at n ECEF positions, r is n x 3 row major in km
+    The radius is the geocentric one, where ecef2lla measures the altitude
+    above 6378.1 km rather than the IGRF radius.
+    B is n x 3, row major, NED
+    */
+    igrf_batch(gh, order, n, B, nthreads, [&](int i0, igrf_block& block) {
+        for(int i = 0; i < block.count; i++){
+            const double* ri = &r[3 * (i0 + i)];
+            const double rho = sqrt(ri[0] * ri[0] + ri[1] * ri[1]);
+            const double norm = sqrt(rho * rho + ri[2] * ri[2]);
+            block.x[i] = ri[2] / norm;
+            block.s[i] = rho / norm;
+            // longitude 0 on the axis, as atan2(0, 0)
+            block.cos_lon[i] = (rho > 0) ? ri[0] / rho : 1.0;
+            block.sin_lon[i] = (rho > 0) ? ri[1] / rho : 0.0;
+            block.ratio[i] = IGRF_RADIUS / norm;
+        }
+    });
+}
+
+
+VectorXd get_magnetic_field_direct(double lat, double lon, double alt, double year, int order){
+
+    /*
+    The term by term sum get_magnetic_field used to do, kept as the reference
+    for the fixed order evaluator
+
     lat is geocentric latitude in degrees
     lon is longitude in degrees
     alt is altitude in km
@@ -236,17 +863,260 @@ MatrixXd get_Pd_coefficients(MatrixXd P, double x, int order){
 }
 
 
+#ifndef MAGNETIC_FIELD_LIBRARY
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> double_array;
+
+py::array_t<double> get_magnetic_field_batch_py(const igrf_coefficients& gh, int order, double_array lat,
+                                                double_array lon, double_array alt, int nthreads){
+    /*
+    N x 3 NED field at arrays of geocentric lat, lon in degrees and alt in km. Contiguous float64
+    arrays are read in place, the GIL is released while the points are evaluated.
+    */
+    const int n = (int) lat.size();
+    if((int) lon.size() != n || (int) alt.size() != n){
+        throw invalid_argument("get_magnetic_field_batch: lat, lon and alt must have the same length");
+    }
+    py::array_t<double> B({(size_t) n, (size_t) 3});
+    double* b = B.mutable_data();
+    const double* la = lat.data();
+    const double* lo = lon.data();
+    const double* al = alt.data();
+    {
+        py::gil_scoped_release release;
+        get_magnetic_field_batch(gh, order, la, lo, al, n, b, nthreads);
+    }
+    return B;
+}
+
+py::array_t<double> get_magnetic_field_batch_ecef_py(const igrf_coefficients& gh, int order, double_array r,
+                                                     int nthreads){
+    /*
+    N x 3 NED field at an N x 3 array of ECEF positions in km
+    */
+    if(r.ndim() != 2 || r.shape(1) != 3){
+        throw invalid_argument("get_magnetic_field_batch: r must be N x 3");
+    }
+    const int n = (int) r.shape(0);
+    py::array_t<double> B({(size_t) n, (size_t) 3});
+    double* b = B.mutable_data();
+    const double* p = r.data();
+    {
+        py::gil_scoped_release release;
+        get_magnetic_field_batch_ecef(gh, order, p, n, b, nthreads);
+    }
+    return B;
+}
+
+// a copy of the coefficients of a model at the year, checking order against the degree of its file. The
+// callers release the GIL, and another thread calling the model at another year rewrites its cache.
+static igrf_coefficients model_coefficients(igrf_model& model, double year, int& order){
+    if(order == 0){
+        order = model.order();
+    }
+    if(order < 1 || order > model.order()){
+        throw invalid_argument("igrf_model: order must be 1 to the degree of the coefficient file");
+    }
+    return model.coefficients(year);
+}
+
+// Coefficients of a fitted series with the series that reads them
+struct magnetic_field_series_py {
+    std::vector<float> c;
+    magnetic_field_series series;
+};
+
 PYBIND11_MODULE(magnetic_field_cpp, m) {
     m.doc() = "Magnetic Field"; // optional module docstring
 
     m.def("get_magnetic_field", &get_magnetic_field, "Gives mag field in NED at the given lat lon alt and year, use geocentric");
+    m.def("get_magnetic_field_ecef", &get_magnetic_field_ecef,
+          "Gives mag field in ECEF at the given ECEF position in km and year, singularity free",
+          py::arg("r"), py::arg("year"), py::arg("order"));
+    m.def("get_magnetic_field_gradient", &get_magnetic_field_gradient,
+          "Gives mag field in NED and its 3x3 gradient dB_i/dx_j in nT/km along NED at the given lat lon alt and year",
+          py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("order"));
+    m.def("get_magnetic_field_gradient_ecef", &get_magnetic_field_gradient_ecef,
+          "Gives mag field in ECEF and its 3x3 gradient dB_i/dx_j in nT/km at the given ECEF position in km and year",
+          py::arg("r"), py::arg("year"), py::arg("order"));
+    m.def("get_magnetic_field_budget", &get_magnetic_field_budget,
+          "Gives mag field in NED at the lowest order within budget nT rms of order 10 at the altitude, "
+          "the error at a point can be about twice the budget",
+          py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("budget"));
+    m.def("get_budget_order", &get_budget_order, "Gives the order get_magnetic_field_budget picks at the altitude",
+          py::arg("alt"), py::arg("year"), py::arg("budget"));
+    m.def("get_magnetic_field_direct", &get_magnetic_field_direct, "Same as get_magnetic_field, summed term by term without the precomputed tables");
+    m.def("get_magnetic_field_batch", [](double_array lat, double_array lon, double_array alt, double year, int order,
+                                         int nthreads) {
+              igrf_coefficients gh;
+              get_igrf_coefficients(year, order, gh);
+              return get_magnetic_field_batch_py(gh, order, lat, lon, alt, nthreads);
+          }, "Gives mag field in NED as N x 3 at arrays of lat lon alt, on nthreads threads (0 for one per core)",
+          py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("order"), py::arg("nthreads") = 0);
+    m.def("get_magnetic_field_batch", [](double_array r, double year, int order, int nthreads) {
+              igrf_coefficients gh;
+              get_igrf_coefficients(year, order, gh);
+              return get_magnetic_field_batch_ecef_py(gh, order, r, nthreads);
+          }, "Gives mag field in NED as N x 3 at an N x 3 array of ECEF positions in km",
+          py::arg("r"), py::arg("year"), py::arg("order"), py::arg("nthreads") = 0);
     m.def("get_P_coefficients", &get_P_coefficients);
     m.def("get_Pd_coefficients", &get_Pd_coefficients);
     m.def("get_g_coefficients", &get_g_coefficients);
     m.def("get_h_coefficients", &get_h_coefficients);
     m.def("get_g_sv_coefficients", &get_g_sv_coefficients);
     m.def("get_h_sv_coefficients", &get_h_sv_coefficients);
+
+    py::class_<igrf_model>(m, "igrf_model")
+        .def(py::init<const string&, double>(), py::arg("filename"), py::arg("refresh") = 1.0 / 365.25)
+        .def("get_magnetic_field", &igrf_model::get_magnetic_field,
+             "Gives mag field in NED at the given lat lon alt and year, use geocentric",
+             py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("order") = 0)
+        .def("get_magnetic_field_budget", &igrf_model::get_magnetic_field_budget,
+             "Gives mag field in NED at the lowest order within budget nT rms of the whole file at the altitude, "
+             "the error at a point can be about twice the budget",
+             py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("budget"))
+        .def("get_spectrum", [](igrf_model& model, double year) {
+                 // Lowes-Mauersberger power of degrees 0 to order at the reference radius, nT^2
+                 const igrf_spectrum& spectrum = model.spectrum(year);
+                 return std::vector<double>(spectrum.power, spectrum.power + spectrum.order + 1);
+             }, "Returns the power of each degree at the year", py::arg("year"))
+        .def("get_magnetic_field_ecef", [](igrf_model& model, Vector3d r, double year, int order) {
+                 const igrf_coefficients gh = model_coefficients(model, year, order);
+                 return igrf_field_ecef(gh, r.data(), order);
+             }, "Gives mag field in ECEF at the given ECEF position in km and year, singularity free",
+             py::arg("r"), py::arg("year"), py::arg("order") = 0)
+        .def("get_magnetic_field_batch", [](igrf_model& model, double_array lat, double_array lon, double_array alt,
+                                            double year, int order, int nthreads) {
+                 const igrf_coefficients gh = model_coefficients(model, year, order);
+                 return get_magnetic_field_batch_py(gh, order, lat, lon, alt, nthreads);
+             }, "Gives mag field in NED as N x 3 at arrays of lat lon alt",
+             py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("year"), py::arg("order") = 0,
+             py::arg("nthreads") = 0)
+        .def("get_magnetic_field_batch", [](igrf_model& model, double_array r, double year, int order, int nthreads) {
+                 const igrf_coefficients gh = model_coefficients(model, year, order);
+                 return get_magnetic_field_batch_ecef_py(gh, order, r, nthreads);
+             }, "Gives mag field in NED as N x 3 at an N x 3 array of ECEF positions in km",
+             py::arg("r"), py::arg("year"), py::arg("order") = 0, py::arg("nthreads") = 0)
+        .def("get_coefficients", [](igrf_model& model, double year) {
+                 // g and h at the date as (order+1) x (order+1) matrices indexed [n, m]
+                 const igrf_coefficients& gh = model.coefficients(year);
+                 const int n = model.order() + 1;
+                 MatrixXd g = MatrixXd::Zero(n, n), h = MatrixXd::Zero(n, n);
+                 for(int i = 0; i < n; i++){
+                     for(int j = 0; j <= i; j++){
+                         g(i, j) = gh.g[i][j];
+                         h(i, j) = gh.h[i][j];
+                     }
+                 }
+                 return make_pair(g, h);
+             }, "Returns the g and h coefficients at the year", py::arg("year"))
+        .def("epochs", &igrf_model::epochs)
+        .def("order", &igrf_model::order)
+        .def_property("refresh", &igrf_model::refresh_interval, &igrf_model::set_refresh_interval);
+
+    py::class_<magnetic_field_grid>(m, "magnetic_field_grid")
+        .def(py::init([](double year, int order, double alt_min, double alt_max, double resolution,
+                         double alt_resolution, int nthreads) {
+                 igrf_coefficients gh;
+                 get_igrf_coefficients(year, order, gh);
+                 py::gil_scoped_release release;
+                 return new magnetic_field_grid(gh, order, year, alt_min, alt_max, resolution, alt_resolution,
+                                                nthreads);
+             }), "Field of the built-in coefficients at the year on a lat/lon/alt shell, steps in degrees and km",
+             py::arg("year"), py::arg("order"), py::arg("alt_min"), py::arg("alt_max"), py::arg("resolution") = 1.0,
+             py::arg("alt_resolution") = 25.0, py::arg("nthreads") = 0)
+        .def(py::init([](igrf_model& model, double year, double alt_min, double alt_max, int order,
+                         double resolution, double alt_resolution, int nthreads) {
+                 const igrf_coefficients gh = model_coefficients(model, year, order);
+                 py::gil_scoped_release release;
+                 return new magnetic_field_grid(gh, order, year, alt_min, alt_max, resolution, alt_resolution,
+                                                nthreads);
+             }), "Field of a model at the year on a lat/lon/alt shell, steps in degrees and km",
+             py::arg("model"), py::arg("year"), py::arg("alt_min"), py::arg("alt_max"), py::arg("order") = 0,
+             py::arg("resolution") = 1.0, py::arg("alt_resolution") = 25.0, py::arg("nthreads") = 0)
+        .def(py::init<const string&>(), "Opens a grid file written by save", py::arg("filename"))
+        .def("save", &magnetic_field_grid::save, py::arg("filename"))
+        .def("get_magnetic_field", &magnetic_field_grid::get_magnetic_field,
+             "Interpolated mag field in NED at the given lat lon alt, NaN outside the grid",
+             py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("tricubic") = true)
+        .def("get_magnetic_field_batch", [](const magnetic_field_grid& grid, double_array lat, double_array lon,
+                                            double_array alt, bool tricubic) {
+                 const int n = (int) lat.size();
+                 if((int) lon.size() != n || (int) alt.size() != n){
+                     throw invalid_argument("get_magnetic_field_batch: lat, lon and alt must have the same length");
+                 }
+                 py::array_t<double> B({(size_t) n, (size_t) 3});
+                 double* b = B.mutable_data();
+                 const double* la = lat.data();
+                 const double* lo = lon.data();
+                 const double* al = alt.data();
+                 {
+                     py::gil_scoped_release release;
+                     grid.get_magnetic_field_batch(la, lo, al, n, b, tricubic);
+                 }
+                 return B;
+             }, "Interpolated mag field in NED as N x 3 at arrays of lat lon alt",
+             py::arg("lat"), py::arg("lon"), py::arg("alt"), py::arg("tricubic") = true)
+        .def("max_error", &magnetic_field_grid::max_error,
+             "Largest and rms interpolation error in nT over random points of the shell",
+             py::arg("samples") = 100000, py::arg("tricubic") = true, py::arg("nthreads") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("shape", [](const magnetic_field_grid& grid) {
+                 const magnetic_field_grid_header& head = grid.header();
+                 return std::make_tuple(head.nlat, head.nlon, head.nalt);
+             })
+        .def_property_readonly("year", [](const magnetic_field_grid& grid) { return grid.header().year; })
+        .def_property_readonly("order", [](const magnetic_field_grid& grid) { return grid.header().order; })
+        .def_property_readonly("alt_range", [](const magnetic_field_grid& grid) {
+                 return make_pair(grid.header().alt_min, grid.header().alt_max);
+             })
+        .def_property_readonly("bytes", &magnetic_field_grid::bytes);
+
+    py::class_<circular_orbit>(m, "circular_orbit")
+        .def(py::init([](double alt, double inc, double raan, double u0, double gmst0) {
+                 circular_orbit orbit = {alt, inc, raan, u0, gmst0};
+                 return orbit;
+             }), "Circular orbit at alt km, angles in degrees",
+             py::arg("alt"), py::arg("inc"), py::arg("raan") = 0.0, py::arg("u0") = 0.0, py::arg("gmst0") = 0.0)
+        .def_readwrite("alt", &circular_orbit::alt)
+        .def_readwrite("inc", &circular_orbit::inc)
+        .def_readwrite("raan", &circular_orbit::raan)
+        .def_readwrite("u0", &circular_orbit::u0)
+        .def_readwrite("gmst0", &circular_orbit::gmst0)
+        .def_property_readonly("period", &circular_orbit_period);
+    m.def("get_magnetic_field_circular_orbit", [](const circular_orbit& orbit, double t, double year, int order) {
+              igrf_coefficients gh;
+              get_igrf_coefficients(year, order, gh);
+              return circular_orbit_field_eci(gh, order, orbit, t);
+          }, "Gives mag field in ECI in nT at t seconds along a circular orbit",
+          py::arg("orbit"), py::arg("t"), py::arg("year"), py::arg("order"));
+
+    py::class_<magnetic_field_series_py>(m, "magnetic_field_series")
+        .def(py::init([](const circular_orbit& orbit, double year, int order, double t0, double duration,
+                         int segments, int terms) {
+                 igrf_coefficients gh;
+                 get_igrf_coefficients(year, order, gh);
+                 magnetic_field_series_py* fit = new magnetic_field_series_py;
+                 fit->series = fit_magnetic_field_series([&](double t) {
+                     return circular_orbit_field_eci(gh, order, orbit, t);
+                 }, t0, duration / segments, segments, terms, fit->c);
+                 return fit;
+             }), "Chebyshev series of the ECI field in nT along a circular orbit from t0 for duration seconds",
+             py::arg("orbit"), py::arg("year"), py::arg("order"), py::arg("t0"), py::arg("duration"),
+             py::arg("segments"), py::arg("terms"))
+        .def("get_magnetic_field", [](const magnetic_field_series_py& fit, double t) {
+                 float B[3];
+                 magnetic_field_series_eval(&fit.series, t, B);
+                 return Vector3d(B[0], B[1], B[2]);
+             }, "Gives the series field at t seconds", py::arg("t"))
+        .def_property_readonly("coefficients", [](const magnetic_field_series_py& fit) {
+                 // segments x 3 x terms, a copy
+                 py::array_t<float> c({(size_t) fit.series.segments, (size_t) 3, (size_t) fit.series.terms});
+                 std::copy(fit.c.begin(), fit.c.end(), c.mutable_data());
+                 return c;
+             })
+        .def_property_readonly("span", [](const magnetic_field_series_py& fit) { return fit.series.span; });
 }
+#endif
 
 
 
@@ -5,4 +5,369 @@
 #ifndef CPP_MAGNETIC_FIELD_H
 #define CPP_MAGNETIC_FIELD_H
 
+#include <math.h>
+#include <complex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../eigen-git-mirror/Eigen/Dense"
+
+// highest degree of the spherical harmonic expansion the evaluator takes
+#define IGRF_MAX_ORDER 13
+
+// reference radius of the IGRF in km
+#define IGRF_RADIUS 6371.2
+
+// Schmidt semi-normalized g and h in nT, already adjusted to the date, indexed [n][m]
+struct igrf_coefficients {
+    double g[IGRF_MAX_ORDER + 1][IGRF_MAX_ORDER + 1];
+    double h[IGRF_MAX_ORDER + 1][IGRF_MAX_ORDER + 1];
+};
+
+// Lowes-Mauersberger spectrum of a set of coefficients: power[n] = (n + 1) * sum_m (g(n,m)^2 + h(n,m)^2)
+// in nT^2 is the mean square of the degree n field over the reference sphere. At radius r it is
+// attenuated by (a / r)^(2n + 4), so the rms over that sphere of the degrees a truncation leaves
+// out is the root of the sum of their attenuated powers.
+struct igrf_spectrum {
+    int order;
+    double power[IGRF_MAX_ORDER + 1];
+};
+
+// A full IGRF coefficient file (igrfNNcoeffs.txt, as read by pyIGRF/loadCoeffs.py), every epoch up to
+// degree 13, interpolated linearly between the 5-yearly epochs and extended by the secular variation
+// past the last one. The coefficients at the date are cached and only recomputed once the requested
+// year moves more than refresh years from the cached one. The cache makes a model unsafe to share
+// between threads, give each thread its own or pass coefficients() to igrf_field.
+class igrf_model {
+public:
+    explicit igrf_model(const std::string& filename, double refresh = 1.0 / 365.25);
+
+    const igrf_coefficients& coefficients(double year);
+    const igrf_spectrum& spectrum(double year);
+    Eigen::Vector3d get_magnetic_field(double lat, double lon, double alt, double year, int order = 0);
+    Eigen::Vector3d get_magnetic_field_budget(double lat, double lon, double alt, double year, double budget);
+
+    const std::vector<double>& epochs() const { return years; }
+    int order() const { return max_n; }
+    double refresh_interval() const { return refresh; }
+    void set_refresh_interval(double years_apart) { refresh = years_apart; }
+
+private:
+    std::vector<double> years;
+    std::vector<igrf_coefficients> gh;
+    igrf_coefficients sv;
+    int max_n;
+    double refresh;
+    igrf_coefficients cache;
+    igrf_spectrum cache_spectrum;
+    double cache_year;
+    bool cached;
+};
+
+Eigen::VectorXd get_magnetic_field(double lat, double lon, double alt, double year, int order);
+Eigen::VectorXd get_magnetic_field_direct(double lat, double lon, double alt, double year, int order);
+Eigen::MatrixXd get_P_coefficients(double x, int order);
+Eigen::MatrixXd get_Pd_coefficients(Eigen::MatrixXd P, double x, int order);
+Eigen::MatrixXd get_g_coefficients();
+Eigen::MatrixXd get_h_coefficients();
+Eigen::MatrixXd get_g_sv_coefficients();
+Eigen::MatrixXd get_h_sv_coefficients();
+void get_igrf_coefficients(double year, int order, igrf_coefficients& gh);
+void get_igrf_spectrum(const igrf_coefficients& gh, int order, igrf_spectrum& spectrum);
+int igrf_budget_order(const igrf_spectrum& spectrum, double r, double budget);
+int get_budget_order(double alt, double year, double budget);
+Eigen::VectorXd get_magnetic_field_budget(double lat, double lon, double alt, double year, double budget);
+Eigen::Vector3d igrf_field(const igrf_coefficients& gh, double lat, double lon, double alt, int order);
+Eigen::VectorXd get_magnetic_field_ecef(Eigen::Vector3d r, double year, int order);
+Eigen::Vector3d igrf_field_ecef(const igrf_coefficients& gh, const double r[3], int order);
+void igrf_field_gradient_ecef(const igrf_coefficients& gh, const double r[3], int order, Eigen::Vector3d& B,
+                              Eigen::Matrix3d& dB);
+std::pair<Eigen::Vector3d, Eigen::Matrix3d> get_magnetic_field_gradient(double lat, double lon, double alt, double year,
+                                                                        int order);
+std::pair<Eigen::Vector3d, Eigen::Matrix3d> get_magnetic_field_gradient_ecef(Eigen::Vector3d r, double year, int order);
+void get_magnetic_field_batch(const igrf_coefficients& gh, int order, const double lat[], const double lon[],
+                              const double alt[], int n, double B[], int nthreads = 0);
+void get_magnetic_field_batch_ecef(const igrf_coefficients& gh, int order, const double r[], int n, double B[],
+                                   int nthreads = 0);
+
+
+template <int N>
+struct schmidt_recursion {
+
+    /*
+    Factors of the Schmidt semi-normalized Legendre recursion up to degree N,
+    worked out once instead of at every step:
+      P(n, m) = a(n, m) * x * P(n-1, m) - b(n, m) * P(n-2, m)    m < n
+      P(n, n) = c(n) * sin * P(n-1, n-1)
+    */
+    double a[N + 1][N + 1];
+    double b[N + 1][N + 1];
+    double c[N + 1];
+
+    schmidt_recursion() {
+        c[0] = 1.0;
+        for(int n = 1; n <= N; n++){
+            // P(1, 1) is the sine itself
+            c[n] = (n == 1) ? 1.0 : sqrt(1.0 - 1.0/(2.0*n));
+            for(int m = 0; m < n; m++){
+                a[n][m] = (2 * n - 1) / sqrt(pow(n, 2) - pow(m, 2));
+                b[n][m] = sqrt((pow(n-1, 2) - pow(m, 2)) / (pow(n, 2) - pow(m, 2)));
+            }
+        }
+    }
+};
+
+
+template <int N>
+Eigen::Vector3d igrf_field(const igrf_coefficients& gh, double lat, double lon, double alt){
+
+    /*
+    Same sum as get_magnetic_field_direct truncated at degree N, with
+    fixed size tables: P and Pd for m <= n only, (a/r)^(n+2) by one product
+    per degree and cos(m lon), sin(m lon) by the angle addition formulas.
+
+    lat is geocentric latitude in degrees
+    lon is longitude in degrees
+    alt is altitude in km
+    gh holds the coefficients at the date
+
+    outputs B vector in NED
+    */
+    static const schmidt_recursion<N> k;
+    const double deg2rad = M_PI / 180.0;
+    const double colat = (90 - lat) * deg2rad;
+    lon = lon * deg2rad;
+    const double x = cos(colat);
+    const double s = sqrt(1 - x * x);
+    const double sin_colat = sin(colat);
+    // the east component divides by sin(colat) except on the axis, as in get_magnetic_field_direct
+    const bool on_axis = (sin_colat == 0);
+
+    double P[N + 1][N + 1], Pd[N + 1][N + 1];
+    P[0][0] = 1.0;
+    Pd[0][0] = 0.0;
+    for(int n = 1; n <= N; n++){
+        for(int m = 0; m < n; m++){
+            P[n][m] = k.a[n][m] * x * P[n-1][m];
+            Pd[n][m] = k.a[n][m] * (x * Pd[n-1][m] - s * P[n-1][m]);
+            // P(n-2, n-1) is zero and so is b(n, n-1)
+            if(m < n - 1){
+                P[n][m] -= k.b[n][m] * P[n-2][m];
+                Pd[n][m] -= k.b[n][m] * Pd[n-2][m];
+            }
+        }
+        P[n][n] = k.c[n] * s * P[n-1][n-1];
+        Pd[n][n] = k.c[n] * (s * Pd[n-1][n-1] + x * P[n-1][n-1]);
+    }
+
+    double cos_m[N + 1], sin_m[N + 1];
+    cos_m[0] = 1.0;
+    sin_m[0] = 0.0;
+    const double cos_lon = cos(lon), sin_lon = sin(lon);
+    for(int m = 1; m <= N; m++){
+        cos_m[m] = cos_m[m-1] * cos_lon - sin_m[m-1] * sin_lon;
+        sin_m[m] = sin_m[m-1] * cos_lon + cos_m[m-1] * sin_lon;
+    }
+
+    const double ratio = IGRF_RADIUS / (IGRF_RADIUS + alt);
+    double ratio_n = ratio * ratio;
+    double B_r = 0; double B_lat = 0; double B_lon = 0;
+
+    for(int n = 1; n <= N; n++){
+        ratio_n *= ratio;
+        double sum_r = 0; double sum_lat = 0; double sum_lon = 0;
+        for(int m = 0; m <= n; m++){
+            const double gc = gh.g[n][m] * cos_m[m] + gh.h[n][m] * sin_m[m];
+            const double gs = -gh.g[n][m] * sin_m[m] + gh.h[n][m] * cos_m[m];
+            sum_r += gc * P[n][m];
+            sum_lat += gc * Pd[n][m];
+            sum_lon += on_axis ? gs * Pd[n][m] : m * gs * P[n][m];
+        }
+        B_r += (n + 1) * ratio_n * sum_r;
+        B_lat -= ratio_n * sum_lat;
+        B_lon += ratio_n * sum_lon;
+    }
+    B_lon *= on_axis ? -x : -1 / sin_colat;
+
+    // NED (North, East, Down) coordinate frame
+    return Eigen::Vector3d(-B_lat, B_lon, -B_r);
+}
+
+
+template <int N>
+struct cunningham_recursion {
+
+    /*
+    Factors of the Cunningham recursion of the solid harmonics
+      V(n, m) = (a/r)^(n+1) P(n, m)(sin lat) cos(m lon),  W(n, m) the same with sin(m lon)
+    with P unnormalized, up to degree N+1 for the gradient of degree N:
+      V(m, m) = (2m-1) (x V(m-1, m-1) - y W(m-1, m-1)) a/r^2
+      V(n, m) = (2n-1)/(n-m) z V(n-1, m) a/r^2 - (n+m-1)/(n-m) V(n-2, m) a^2/r^2
+    and the Schmidt factors sqrt(2 (n-m)!/(n+m)!) taking g and h to the unnormalized P.
+    */
+    double a[N + 2][N + 2];
+    double b[N + 2][N + 2];
+    double schmidt[N + 1][N + 1];
+
+    cunningham_recursion() {
+        for(int n = 1; n <= N + 1; n++){
+            for(int m = 0; m < n; m++){
+                a[n][m] = (2.0 * n - 1) / (n - m);
+                b[n][m] = (n + m - 1.0) / (n - m);
+            }
+        }
+        for(int n = 0; n <= N; n++){
+            schmidt[n][0] = 1.0;
+            double ratio = 1.0;
+            for(int m = 1; m <= n; m++){
+                // (n-m)!/(n+m)! from the one of m-1
+                ratio /= (n - m + 1.0) * (n + m);
+                schmidt[n][m] = sqrt(2.0 * ratio);
+            }
+        }
+    }
+};
+
+
+template <int N>
+void solid_harmonics(const cunningham_recursion<N>& k, const double r[3], double V[N + 2][N + 2], double W[N + 2][N + 2]){
+
+    /*
+    V(n, m) and W(n, m) at the ECEF position r in km up to degree N+1
+    */
+    const double a = IGRF_RADIUS;
+    const double r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+    const double x0 = a * r[0] / r2, y0 = a * r[1] / r2, z0 = a * r[2] / r2;
+    const double rho2 = a * a / r2;
+
+    V[0][0] = a / sqrt(r2);
+    W[0][0] = 0.0;
+    // degree by degree, the orders of a degree do not depend on each other
+    for(int n = 1; n <= N + 1; n++){
+        for(int m = 0; m < n - 1; m++){
+            V[n][m] = k.a[n][m] * z0 * V[n-1][m] - k.b[n][m] * rho2 * V[n-2][m];
+            W[n][m] = k.a[n][m] * z0 * W[n-1][m] - k.b[n][m] * rho2 * W[n-2][m];
+        }
+        V[n][n-1] = k.a[n][n-1] * z0 * V[n-1][n-1];
+        W[n][n-1] = k.a[n][n-1] * z0 * W[n-1][n-1];
+        V[n][n] = (2 * n - 1) * (x0 * V[n-1][n-1] - y0 * W[n-1][n-1]);
+        W[n][n] = (2 * n - 1) * (x0 * W[n-1][n-1] + y0 * V[n-1][n-1]);
+    }
+}
+
+
+template <int N>
+Eigen::Vector3d igrf_field_ecef(const igrf_coefficients& gh, const double r[3]){
+
+    /*
+    Field of degree N in ECEF at the ECEF position r in km, as minus the
+    gradient of the potential a sum g V + h W, by the Cunningham recursion
+    in x, y, z (Montenbruck and Gill, Satellite Orbits, 3.2.4). There is no
+    trig and no division by cos(lat), so the poles are like any other point.
+    Agrees with igrf_field rotated from NED, using the geocentric radius.
+    */
+    static const cunningham_recursion<N> k;
+    double V[N + 2][N + 2], W[N + 2][N + 2];
+    solid_harmonics(k, r, V, W);
+
+    // the x and y sums of m > 0 carry a factor 1/2, added at the end
+    double dx = 0, dy = 0, dz = 0, dx0 = 0, dy0 = 0;
+    for(int n = 1; n <= N; n++){
+        const double G = k.schmidt[n][0] * gh.g[n][0];
+        dx0 -= G * V[n+1][1];
+        dy0 -= G * W[n+1][1];
+        dz -= (n + 1) * G * V[n+1][0];
+        for(int m = 1; m <= n; m++){
+            const double G = k.schmidt[n][m] * gh.g[n][m];
+            const double H = k.schmidt[n][m] * gh.h[n][m];
+            // (n-m+2)!/(n-m)!
+            const double f = (n - m + 2.0) * (n - m + 1.0);
+            const double Vp = V[n+1][m+1], Wp = W[n+1][m+1];
+            const double Vm = f * V[n+1][m-1], Wm = f * W[n+1][m-1];
+            dx += G * (Vm - Vp) + H * (Wm - Wp);
+            dy += H * (Vp + Vm) - G * (Wp + Wm);
+            dz -= (n - m + 1) * (G * V[n+1][m] + H * W[n+1][m]);
+        }
+    }
+    dx = dx0 + 0.5 * dx;
+    dy = dy0 + 0.5 * dy;
+
+    // B is minus the gradient of a (g V + h W), whose gradient is the sums above over a
+    return Eigen::Vector3d(-dx, -dy, -dz);
+}
+
+
+template <int N>
+void igrf_field_gradient_ecef(const igrf_coefficients& gh, const double r[3], Eigen::Vector3d& B, Eigen::Matrix3d& dB){
+
+    /*
+    Field of degree N and its gradient dB(i, j) = dB_i/dx_j in ECEF, in nT
+    and nT/km, from one recursion of the solid harmonics to degree N+2.
+    With Z(n, m) = V(n, m) + i W(n, m) the derivatives are ladder steps
+      dZ(n, m)/dx = (-Z(n+1, m+1) + f Z(n+1, m-1)) / 2a
+      dZ(n, m)/dy = i (Z(n+1, m+1) + f Z(n+1, m-1)) / 2a
+      dZ(n, m)/dz = -(n-m+1) Z(n+1, m) / a
+    with f = (n-m+2)(n-m+1), taken twice for the second derivatives. The
+    steps below m = 0 use Z(n, -k) = (-1)^k (n-k)!/(n+k)! conj(Z(n, k)).
+    dB is symmetric and has no trace, the field being a potential one.
+    */
+    typedef std::complex<double> cplx;
+    static const cunningham_recursion<N + 1> k;
+    double V[N + 3][N + 3], W[N + 3][N + 3];
+    solid_harmonics(k, r, V, W);
+
+    // Z(n, m) at [n][m + 2], from m = -2 on
+    cplx Z[N + 3][N + 5];
+    for(int n = 0; n <= N + 2; n++){
+        for(int m = 0; m <= n; m++){
+            Z[n][m + 2] = cplx(V[n][m], W[n][m]);
+        }
+        // (n-1)!/(n+1)! and (n-2)!/(n+2)!
+        const double ratio1 = 1.0 / (n * (n + 1.0));
+        const double ratio2 = ratio1 / ((n - 1.0) * (n + 2.0));
+        Z[n][1] = (n >= 1) ? -ratio1 * conj(Z[n][3]) : cplx(0.0, 0.0);
+        Z[n][0] = (n >= 2) ? ratio2 * conj(Z[n][4]) : cplx(0.0, 0.0);
+    }
+
+    // sums of the derivatives, the factors 1/2 and 1/4 of the ladder steps are left to the end
+    double dx = 0, dy = 0, dz = 0, dxx = 0, dxy = 0, dxz = 0, dyz = 0, dzz = 0;
+    for(int n = 1; n <= N; n++){
+        for(int m = 0; m <= n; m++){
+            const double G = k.schmidt[n][m] * gh.g[n][m];
+            const double H = k.schmidt[n][m] * gh.h[n][m];
+            // real part of (G - i H) w, and of (G - i H) i w
+            auto re = [&](cplx w) { return G * w.real() + H * w.imag(); };
+            auto re_i = [&](cplx w) { return H * w.real() - G * w.imag(); };
+            const double f1 = (n - m + 2.0) * (n - m + 1.0);
+            const double f3 = (n - m + 4.0) * (n - m + 3.0);
+
+            const cplx Z1p = Z[n+1][m+3], Z1m = f1 * Z[n+1][m+1];
+            dx += re(Z1m - Z1p);
+            dy += re_i(Z1p + Z1m);
+            dz -= (n - m + 1.0) * re(Z[n+1][m+2]);
+
+            const cplx Z2p2 = Z[n+2][m+4], Z2m2 = f1 * f3 * Z[n+2][m];
+            const cplx Z2p1 = (n - m + 1.0) * Z[n+2][m+3], Z2m1 = f1 * (n - m + 3.0) * Z[n+2][m+1];
+            const double Z20 = f1 * re(Z[n+2][m+2]);
+            dxx += re(Z2p2 + Z2m2) - 2.0 * Z20;
+            dzz += Z20;
+            dxy += re_i(Z2m2 - Z2p2);
+            dxz += re(Z2p1 - Z2m1);
+            dyz -= re_i(Z2p1 + Z2m1);
+        }
+    }
+    dx *= 0.5; dy *= 0.5;
+    dxx *= 0.25; dxy *= 0.25; dxz *= 0.5; dyz *= 0.5;
+    // the second derivatives of a potential field have no trace
+    const double dd[3][3] = {{dxx, dxy, dxz}, {dxy, -dxx - dzz, dyz}, {dxz, dyz, dzz}};
+
+    // B is minus the gradient of a (g V + h W), dB minus its second derivatives
+    B = Eigen::Vector3d(-dx, -dy, -dz);
+    for(int i = 0; i < 3; i++){
+        for(int j = i; j < 3; j++){
+            dB(i, j) = dB(j, i) = -dd[i][j] / IGRF_RADIUS;
+        }
+    }
+}
+
 #endif //CPP_MAGNETIC_FIELD_H
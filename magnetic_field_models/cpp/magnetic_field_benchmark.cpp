@@ -0,0 +1,255 @@
+//
+// Times get_magnetic_field against the term by term get_magnetic_field_direct
+// at every order of the built-in coefficients, over a lat/lon grid (poles
+// included) at a few altitudes, and reports the largest difference relative
+// to the field magnitude. Then times get_magnetic_field_batch on one thread
+// against igrf_field called point by point, and the ECEF field from
+// igrf_field_ecef against lat/lon from ECEF, igrf_field and the NED to ECEF
+// rotation. Last the field and gradient from igrf_field_gradient_ecef against
+// central and forward differences of igrf_field_ecef. Then
+// get_magnetic_field_budget for a range of error budgets against
+// get_magnetic_field at order 10, with the error it actually leaves.
+//
+// usage : magnetic_field_benchmark [repeat]   (default 20)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "magnetic_field.h"
+
+using namespace std;
+using namespace Eigen;
+
+// position step of the finite differences                                    km
+#define GRADIENT_STEP 0.1
+
+// ECEF field through geocentric lat/lon and NED, the way the callers get it today
+static Vector3d field_ecef_via_ned(const igrf_coefficients& gh, const double r[3], int order){
+    const double norm = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+    const double lat = asin(r[2] / norm), lon = atan2(r[1], r[0]);
+    const Vector3d B = igrf_field(gh, lat * 180.0 / M_PI, lon * 180.0 / M_PI, norm - IGRF_RADIUS, order);
+    const double sl = sin(lat), cl = cos(lat), so = sin(lon), co = cos(lon);
+    return Vector3d(-sl * co * B(0) - so * B(1) - cl * co * B(2),
+                    -sl * so * B(0) + co * B(1) - cl * so * B(2),
+                    cl * B(0) - sl * B(2));
+}
+
+int main(int argc, char* argv[]) {
+    const int repeat = (argc > 1) ? atoi(argv[1]) : 20;
+    const double year = 2019.5;
+    vector<double> lat, lon, alt;
+    for(int i = 0; i <= 36; i++){
+        for(int j = 0; j < 24; j++){
+            for(int k = 0; k < 3; k++){
+                lat.push_back(-90.0 + 5.0 * i);
+                lon.push_back(-180.0 + 15.0 * j);
+                alt.push_back(400.0 + 300.0 * k);
+            }
+        }
+    }
+    const int n = (int)lat.size();
+
+    printf("get_magnetic_field vs get_magnetic_field_direct, %d points, best of %d\n", n, repeat);
+    printf(" order  direct (ns)  tables (ns)  speedup  max rel diff\n");
+    for(int order = 1; order <= 10; order++){
+        double t_direct = 1e30, t_tables = 1e30, diff = 0, check = 0;
+        for(int r = 0; r < repeat; r++){
+            auto t0 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += get_magnetic_field_direct(lat[i], lon[i], alt[i], year, order)(0);
+            }
+            auto t1 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += get_magnetic_field(lat[i], lon[i], alt[i], year, order)(0);
+            }
+            auto t2 = chrono::steady_clock::now();
+            t_direct = min(t_direct, chrono::duration<double>(t1 - t0).count());
+            t_tables = min(t_tables, chrono::duration<double>(t2 - t1).count());
+        }
+        for(int i = 0; i < n; i++){
+            VectorXd B0 = get_magnetic_field_direct(lat[i], lon[i], alt[i], year, order);
+            VectorXd B1 = get_magnetic_field(lat[i], lon[i], alt[i], year, order);
+            diff = max(diff, (B1 - B0).norm() / B0.norm());
+        }
+        printf(" %5d  %11.1f  %11.1f  %7.1f  %12.3e\n", order, 1e9 * t_direct / n, 1e9 * t_tables / n,
+               t_direct / t_tables, diff);
+        // keeps the timed calls from being optimized out
+        if(check != check){
+            printf(" nan in the field\n");
+        }
+    }
+
+    printf("\nget_magnetic_field_batch vs igrf_field, %d points, one thread\n", n);
+    printf(" order  igrf_field (ns)  batch (ns)  speedup  max rel diff\n");
+    vector<double> B(3 * n);
+    for(int order = 1; order <= 10; order++){
+        igrf_coefficients gh;
+        get_igrf_coefficients(year, order, gh);
+        double t_point = 1e30, t_batch = 1e30, diff = 0, check = 0;
+        for(int r = 0; r < repeat; r++){
+            auto t0 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += igrf_field(gh, lat[i], lon[i], alt[i], order)(0);
+            }
+            auto t1 = chrono::steady_clock::now();
+            get_magnetic_field_batch(gh, order, &lat[0], &lon[0], &alt[0], n, &B[0], 1);
+            auto t2 = chrono::steady_clock::now();
+            t_point = min(t_point, chrono::duration<double>(t1 - t0).count());
+            t_batch = min(t_batch, chrono::duration<double>(t2 - t1).count());
+        }
+        for(int i = 0; i < n; i++){
+            // the east component differs at the south pole, see get_magnetic_field_batch
+            Vector3d B0 = igrf_field(gh, lat[i], lon[i], alt[i], order);
+            Vector3d B1(B[3*i], (lat[i] > -90) ? B[3*i + 1] : B0(1), B[3*i + 2]);
+            diff = max(diff, (B1 - B0).norm() / B0.norm());
+        }
+        printf(" %5d  %15.1f  %10.1f  %7.1f  %12.3e\n", order, 1e9 * t_point / n, 1e9 * t_batch / n,
+               t_point / t_batch, diff);
+        if(check != check){
+            printf(" nan in the field\n");
+        }
+    }
+
+    printf("\nigrf_field_ecef vs lat/lon, igrf_field and NED to ECEF, %d points\n", n);
+    printf(" order  via NED (ns)  ecef (ns)  speedup  max rel diff\n");
+    vector<double> r(3 * n);
+    for(int i = 0; i < n; i++){
+        const double cl = cos(lat[i] * M_PI / 180.0), sl = sin(lat[i] * M_PI / 180.0);
+        r[3*i] = (IGRF_RADIUS + alt[i]) * cl * cos(lon[i] * M_PI / 180.0);
+        r[3*i + 1] = (IGRF_RADIUS + alt[i]) * cl * sin(lon[i] * M_PI / 180.0);
+        r[3*i + 2] = (IGRF_RADIUS + alt[i]) * sl;
+    }
+    for(int order = 1; order <= 10; order++){
+        igrf_coefficients gh;
+        get_igrf_coefficients(year, order, gh);
+        double t_ned = 1e30, t_ecef = 1e30, diff = 0, check = 0;
+        for(int rep = 0; rep < repeat; rep++){
+            auto t0 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += field_ecef_via_ned(gh, &r[3*i], order)(0);
+            }
+            auto t1 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += igrf_field_ecef(gh, &r[3*i], order)(0);
+            }
+            auto t2 = chrono::steady_clock::now();
+            t_ned = min(t_ned, chrono::duration<double>(t1 - t0).count());
+            t_ecef = min(t_ecef, chrono::duration<double>(t2 - t1).count());
+        }
+        for(int i = 0; i < n; i++){
+            // the south pole is left out, igrf_field has no east component there
+            if(lat[i] > -90){
+                Vector3d B0 = field_ecef_via_ned(gh, &r[3*i], order);
+                diff = max(diff, (igrf_field_ecef(gh, &r[3*i], order) - B0).norm() / B0.norm());
+            }
+        }
+        printf(" %5d  %12.1f  %9.1f  %7.1f  %12.3e\n", order, 1e9 * t_ned / n, 1e9 * t_ecef / n, t_ned / t_ecef,
+               diff);
+        if(check != check){
+            printf(" nan in the field\n");
+        }
+    }
+
+    printf("\nigrf_field_gradient_ecef vs differences of igrf_field_ecef, step %.1f km, %d points\n", GRADIENT_STEP, n);
+    printf(" order  gradient (ns)  central (ns)  forward (ns)  central err  forward err\n");
+    for(int order = 1; order <= 10; order++){
+        igrf_coefficients gh;
+        get_igrf_coefficients(year, order, gh);
+        double t_grad = 1e30, t_central = 1e30, t_forward = 1e30, err_central = 0, err_forward = 0, check = 0;
+        Vector3d B;
+        Matrix3d dB, central, forward;
+        for(int rep = 0; rep <= repeat; rep++){
+            auto t0 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                igrf_field_gradient_ecef(gh, &r[3*i], order, B, dB);
+                check += dB(0, 0);
+            }
+            auto t1 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                for(int j = 0; j < 3; j++){
+                    double rp[3] = {r[3*i], r[3*i + 1], r[3*i + 2]}, rm[3] = {r[3*i], r[3*i + 1], r[3*i + 2]};
+                    rp[j] += GRADIENT_STEP;
+                    rm[j] -= GRADIENT_STEP;
+                    central.col(j) = (igrf_field_ecef(gh, rp, order) - igrf_field_ecef(gh, rm, order)) / (2 * GRADIENT_STEP);
+                }
+                check += central(0, 0);
+            }
+            auto t2 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                const Vector3d B0 = igrf_field_ecef(gh, &r[3*i], order);
+                for(int j = 0; j < 3; j++){
+                    double rp[3] = {r[3*i], r[3*i + 1], r[3*i + 2]};
+                    rp[j] += GRADIENT_STEP;
+                    forward.col(j) = (igrf_field_ecef(gh, rp, order) - B0) / GRADIENT_STEP;
+                }
+                check += forward(0, 0);
+            }
+            auto t3 = chrono::steady_clock::now();
+            // the last pass checks the differences against the gradient instead of timing
+            if(rep == repeat){
+                break;
+            }
+            t_grad = min(t_grad, chrono::duration<double>(t1 - t0).count());
+            t_central = min(t_central, chrono::duration<double>(t2 - t1).count());
+            t_forward = min(t_forward, chrono::duration<double>(t3 - t2).count());
+        }
+        for(int i = 0; i < n; i++){
+            igrf_field_gradient_ecef(gh, &r[3*i], order, B, dB);
+            const Vector3d B0 = igrf_field_ecef(gh, &r[3*i], order);
+            for(int j = 0; j < 3; j++){
+                double rp[3] = {r[3*i], r[3*i + 1], r[3*i + 2]}, rm[3] = {r[3*i], r[3*i + 1], r[3*i + 2]};
+                rp[j] += GRADIENT_STEP;
+                rm[j] -= GRADIENT_STEP;
+                const Vector3d Bp = igrf_field_ecef(gh, rp, order);
+                central.col(j) = (Bp - igrf_field_ecef(gh, rm, order)) / (2 * GRADIENT_STEP);
+                forward.col(j) = (Bp - B0) / GRADIENT_STEP;
+            }
+            err_central = max(err_central, (central - dB).norm() / dB.norm());
+            err_forward = max(err_forward, (forward - dB).norm() / dB.norm());
+        }
+        printf(" %5d  %13.1f  %12.1f  %12.1f  %11.3e  %11.3e\n", order, 1e9 * t_grad / n, 1e9 * t_central / n,
+               1e9 * t_forward / n, err_central, err_forward);
+        if(check != check){
+            printf(" nan in the field\n");
+        }
+    }
+
+    printf("\nget_magnetic_field_budget vs get_magnetic_field at order 10, %d points at 400, 700 and 1000 km\n", n);
+    printf(" budget (nT)  mean order  time (ns)  speedup  rms err (nT)  max err (nT)\n");
+    const double budgets[] = {3000, 1000, 300, 100, 30, 10, 3, 1, 0};
+    vector<Vector3d> full(n);
+    double t_full = 1e30, check = 0;
+    for(int rep = 0; rep < repeat; rep++){
+        auto t0 = chrono::steady_clock::now();
+        for(int i = 0; i < n; i++){
+            full[i] = get_magnetic_field(lat[i], lon[i], alt[i], year, 10);
+        }
+        t_full = min(t_full, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+    }
+    for(double budget : budgets){
+        double t_budget = 1e30, sum = 0, largest = 0, orders = 0;
+        for(int rep = 0; rep < repeat; rep++){
+            auto t0 = chrono::steady_clock::now();
+            for(int i = 0; i < n; i++){
+                check += get_magnetic_field_budget(lat[i], lon[i], alt[i], year, budget)(0);
+            }
+            t_budget = min(t_budget, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+        }
+        for(int i = 0; i < n; i++){
+            const double d = (Vector3d(get_magnetic_field_budget(lat[i], lon[i], alt[i], year, budget)) - full[i]).norm();
+            orders += get_budget_order(alt[i], year, budget);
+            sum += d * d;
+            largest = max(largest, d);
+        }
+        printf(" %11.0f  %10.2f  %9.1f  %7.2f  %12.2f  %12.2f\n", budget, orders / n, 1e9 * t_budget / n,
+               t_full / t_budget, sqrt(sum / n), largest);
+    }
+    if(check != check){
+        printf(" nan in the field\n");
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+//
+// Precomputed IGRF field over a latitude/longitude/altitude shell, see magnetic_field_grid.h
+//
+
+#include "magnetic_field_grid.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace Eigen;
+
+
+magnetic_field_grid::magnetic_field_grid(const igrf_coefficients& gh, int order, double year, double alt_min,
+                                         double alt_max, double resolution, double alt_resolution, int nthreads)
+        : data(NULL), map(NULL), map_size(0) {
+
+    /*
+    Evaluates the field at every node with get_magnetic_field_batch
+    gh, order are the coefficients at year and the degree to use
+    alt_min, alt_max bound the shell in km
+    resolution is the lat/lon step in degrees, alt_resolution the altitude step in km, both
+    rounded so the steps divide the ranges evenly, with at least 4 nodes along each axis for
+    the cubic stencil
+    */
+    if(!(alt_max > alt_min) || !(resolution > 0) || !(alt_resolution > 0)){
+        throw invalid_argument("magnetic_field_grid: needs alt_max > alt_min and positive resolutions");
+    }
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, MAGNETIC_FIELD_GRID_MAGIC, sizeof(head.magic));
+    head.version = MAGNETIC_FIELD_GRID_VERSION;
+    head.endian = MAGNETIC_FIELD_GRID_ENDIAN;
+    head.header_size = sizeof(head);
+    head.order = order;
+    head.nlat = max(4, (int) lround(180.0 / resolution) + 1);
+    head.nlon = max(4, (int) lround(360.0 / resolution));
+    head.nalt = max(4, (int) ceil((alt_max - alt_min) / alt_resolution - 1e-9) + 1);
+    head.year = year;
+    head.alt_min = alt_min;
+    head.alt_max = alt_max;
+    head.gh = gh;
+    set_steps();
+
+    // one latitude row at a time
+    const int row = head.nlon * head.nalt;
+    nodes.resize((size_t) 3 * head.nlat * row);
+    vector<double> lat(row), lon(row), alt(row), B(3 * row);
+    for(int i = 0; i < head.nlat; i++){
+        for(int j = 0; j < head.nlon; j++){
+            for(int k = 0; k < head.nalt; k++){
+                lat[j * head.nalt + k] = -90.0 + i * dlat;
+                lon[j * head.nalt + k] = -180.0 + j * dlon;
+                alt[j * head.nalt + k] = alt_min + k * dalt;
+            }
+        }
+        ::get_magnetic_field_batch(head.gh, order, &lat[0], &lon[0], &alt[0], row, &B[0], nthreads);
+        copy(B.begin(), B.end(), nodes.begin() + (size_t) 3 * i * row);
+    }
+    data = &nodes[0];
+}
+
+
+magnetic_field_grid::magnetic_field_grid(const string& filename) : data(NULL), map(NULL), map_size(0) {
+
+    /*
+    Opens a grid written by save, mapped into memory where the system can
+    */
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(file == NULL){
+        throw runtime_error("magnetic_field_grid: cannot open " + filename);
+    }
+    const bool read = fread(&head, sizeof(head), 1, file) == 1;
+    fclose(file);
+    if(!read || memcmp(head.magic, MAGNETIC_FIELD_GRID_MAGIC, sizeof(head.magic)) != 0){
+        throw runtime_error("magnetic_field_grid: " + filename + " is not a grid file");
+    }
+    if(head.endian != MAGNETIC_FIELD_GRID_ENDIAN){
+        throw runtime_error("magnetic_field_grid: " + filename + " was written on a machine of the other byte order");
+    }
+    if(head.version != MAGNETIC_FIELD_GRID_VERSION || head.header_size != sizeof(head)){
+        throw runtime_error("magnetic_field_grid: " + filename + " is not a grid file of this version and layout");
+    }
+    if(head.order < 1 || head.order > IGRF_MAX_ORDER || head.nlat < 4 || head.nlon < 4 || head.nalt < 4){
+        throw runtime_error("magnetic_field_grid: bad header in " + filename);
+    }
+    set_steps();
+
+#ifndef _WIN32
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < MAGNETIC_FIELD_GRID_OFFSET + bytes()){
+        if(fd >= 0){
+            close(fd);
+        }
+        throw runtime_error("magnetic_field_grid: " + filename + " is shorter than its header says");
+    }
+    map_size = MAGNETIC_FIELD_GRID_OFFSET + bytes();
+    map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        map = NULL;
+        map_size = 0;
+    }else{
+        data = (const float*) ((const char*) map + MAGNETIC_FIELD_GRID_OFFSET);
+        return;
+    }
+#endif
+    // no mapping, read the nodes instead
+    file = fopen(filename.c_str(), "rb");
+    nodes.resize(bytes() / sizeof(float));
+    const bool ok = file != NULL && fseek(file, MAGNETIC_FIELD_GRID_OFFSET, SEEK_SET) == 0 &&
+                    fread(&nodes[0], sizeof(float), nodes.size(), file) == nodes.size();
+    if(file != NULL){
+        fclose(file);
+    }
+    if(!ok){
+        throw runtime_error("magnetic_field_grid: " + filename + " is shorter than its header says");
+    }
+    data = &nodes[0];
+}
+
+
+magnetic_field_grid::~magnetic_field_grid(){
+#ifndef _WIN32
+    if(map != NULL){
+        munmap(map, map_size);
+    }
+#endif
+}
+
+
+void magnetic_field_grid::set_steps(){
+    dlat = 180.0 / (head.nlat - 1);
+    dlon = 360.0 / head.nlon;
+    dalt = (head.alt_max - head.alt_min) / (head.nalt - 1);
+}
+
+
+void magnetic_field_grid::save(const string& filename) const {
+
+    /*
+    Writes the header, zeros up to MAGNETIC_FIELD_GRID_OFFSET and the nodes, in the byte
+    order of this machine
+    */
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(file == NULL){
+        throw runtime_error("magnetic_field_grid: cannot write " + filename);
+    }
+    vector<char> start(MAGNETIC_FIELD_GRID_OFFSET, 0);
+    memcpy(&start[0], &head, sizeof(head));
+    bool ok = fwrite(&start[0], 1, start.size(), file) == start.size();
+    ok = ok && fwrite(data, 1, bytes(), file) == bytes();
+    ok = (fclose(file) == 0) && ok;
+    if(!ok){
+        throw runtime_error("magnetic_field_grid: cannot write " + filename);
+    }
+}
+
+
+// Catmull-Rom weights of the nodes at i - 1, i, i + 1 and i + 2 for t in [0, 1], with n nodes
+// (0 for an axis that wraps round). A node missing past either end is extrapolated linearly from
+// the two inside it, which keeps the error at the ends second order instead of first. Written
+// without branches so the batch loop below vectorizes it across points.
+static inline void cubic_weights(float t, int i, int n, float w[4]){
+    const float t2 = t * t, t3 = t2 * t;
+    float w0 = 0.5f * (-t3 + 2.0f * t2 - t);
+    float w1 = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+    float w2 = 0.5f * (-3.0f * t3 + 4.0f * t2 + t);
+    float w3 = 0.5f * (t3 - t2);
+    const float low = (float) ((n > 0) & (i == 0)) * w0;
+    const float high = (float) ((n > 0) & (i + 2 == n)) * w3;
+    w1 += 2.0f * low - high;
+    w2 += 2.0f * high - low;
+    w0 -= low;
+    w3 -= high;
+    w[0] = w0; w[1] = w1; w[2] = w2; w[3] = w3;
+}
+
+
+// Sum over a K x K x K stencil of rows (lat), columns (lon) and K altitudes, the altitude
+// column of a node being 3K contiguous floats at offset[a][b]. Each row is summed across
+// vector lanes with the lon weights and added in with its lat weight, and the altitude
+// weights are applied once at the end.
+template<int K>
+static inline void stencil_sum(const float* data, const size_t offset[K][K], const float wi[K], const float wj[K],
+                               const float wk[K], double B[3]){
+    float acc[3 * K] = {0};
+    for(int a = 0; a < K; a++){
+        float row[3 * K] = {0};
+        for(int b = 0; b < K; b++){
+            const float* p = data + offset[a][b];
+            for(int e = 0; e < 3 * K; e++){
+                row[e] += wj[b] * p[e];
+            }
+        }
+        for(int e = 0; e < 3 * K; e++){
+            acc[e] += wi[a] * row[e];
+        }
+    }
+    float b0 = 0, b1 = 0, b2 = 0;
+    for(int c = 0; c < K; c++){
+        b0 += wk[c] * acc[3*c];
+        b1 += wk[c] * acc[3*c + 1];
+        b2 += wk[c] * acc[3*c + 2];
+    }
+    B[0] = b0; B[1] = b1; B[2] = b2;
+}
+
+
+// points the batch lookup sets up together
+#define GRID_BLOCK 16
+
+// Where a block of points falls in the grid, worked out across the block: the lower corner
+// node, the first altitude of the stencil, the weights along each axis (cubic, or linear in the
+// first two) and whether the point lies inside the shell at all
+struct grid_block {
+    int i[GRID_BLOCK], j[GRID_BLOCK], k[GRID_BLOCK];
+    float ti[GRID_BLOCK], tj[GRID_BLOCK], tk[GRID_BLOCK];
+    float wi[4][GRID_BLOCK], wj[4][GRID_BLOCK], wk[4][GRID_BLOCK];
+    // how far the point was moved onto the shell, zero inside, NaN for a NaN or infinite input
+    float outside[GRID_BLOCK];
+};
+
+
+void magnetic_field_grid::locate(const double lat[], const double lon[], const double alt[], int n, bool tricubic,
+                                 grid_block& block) const {
+
+    /*
+    Fills block for n <= GRID_BLOCK points. Points outside the shell are clamped onto it so
+    their stencil stays in the grid and are marked, the caller writes NaN for them, as for a
+    longitude that is not finite. Apart from the one for far off longitudes the loops have no
+    calls or branches so they vectorize across the block.
+    */
+    const int nlat = head.nlat, nlon = head.nlon, nalt = head.nalt;
+    const double to_u = 1.0 / dlat, to_v = 1.0 / dlon, to_w = 1.0 / dalt, to_turns = 1.0 / nlon;
+    // longitudes this many turns from -180 wrap by truncation, the others go through fmod below
+    const double turns_max = 1048576.0 * nlon;
+    const double u_max = nlat - 1.0, w_max = nalt - 1.0, alt_min = head.alt_min;
+    for(int p = 0; p < n; p++){
+        const double u0 = (lat[p] + 90.0) * to_u;
+        const double w0 = (alt[p] - alt_min) * to_w;
+        double u = (u0 > 0) ? u0 : 0.0;
+        u = (u < u_max) ? u : u_max;
+        double w = (w0 > 0) ? w0 : 0.0;
+        w = (w < w_max) ? w : w_max;
+        // lon - lon is NaN for an infinite or NaN longitude and 0 otherwise
+        block.outside[p] = (float) (fabs(u0 - u) + fabs(w0 - w) + (lon[p] - lon[p]));
+        // whole turns of longitude, truncated after an offset of 2^20 turns so it rounds down
+        double v = (lon[p] + 180.0) * to_v;
+        v = (fabs(v) < turns_max) ? v : 0.0;
+        v -= nlon * (double) ((int) (v * to_turns + 1048576.0) - 1048576);
+        int i = (int) u, j = (int) v, k = (int) w;
+        i = (i < nlat - 2) ? i : nlat - 2;
+        j = (j < nlon - 1) ? j : nlon - 1;
+        k = (k < nalt - 2) ? k : nalt - 2;
+        block.ti[p] = (float) (u - i);
+        block.tj[p] = (float) (v - j);
+        block.tk[p] = (float) (w - k);
+        block.i[p] = i;
+        block.j[p] = j;
+        block.k[p] = k;
+    }
+    // a NaN or infinite longitude stays at 0, it is marked outside already
+    for(int p = 0; p < n; p++){
+        const double v0 = (lon[p] + 180.0) * to_v;
+        if(!(fabs(v0) < turns_max) && isfinite(v0)){
+            double v = fmod(v0, (double) nlon);
+            v = (v < 0) ? v + nlon : v;
+            v = (v < nlon) ? v : 0.0;
+            const int j = ((int) v < nlon - 1) ? (int) v : nlon - 1;
+            block.tj[p] = (float) (v - j);
+            block.j[p] = j;
+        }
+    }
+
+    if(!tricubic){
+        for(int p = 0; p < n; p++){
+            block.wi[0][p] = 1.0f - block.ti[p]; block.wi[1][p] = block.ti[p];
+            block.wj[0][p] = 1.0f - block.tj[p]; block.wj[1][p] = block.tj[p];
+            block.wk[0][p] = 1.0f - block.tk[p]; block.wk[1][p] = block.tk[p];
+        }
+        return;
+    }
+    for(int p = 0; p < n; p++){
+        float wi[4], wj[4], wk[4];
+        const int k = block.k[p];
+        cubic_weights(block.ti[p], block.i[p], nlat, wi);
+        cubic_weights(block.tj[p], block.j[p], 0, wj);
+        cubic_weights(block.tk[p], k, nalt, wk);
+        // the altitudes with a weight all lie in the 4 from k - 1, or from k at the bottom
+        // end and k - 2 at the top, where the weight shifted out is the zero one
+        const int bottom = (k == 0), top = (k == nalt - 2);
+        const float b = (float) bottom, t = (float) top, m = 1.0f - b - t;
+        block.k[p] = k - 1 + bottom - top;
+        block.wk[0][p] = b * wk[1] + m * wk[0];
+        block.wk[1][p] = b * wk[2] + t * wk[0] + m * wk[1];
+        block.wk[2][p] = b * wk[3] + t * wk[1] + m * wk[2];
+        block.wk[3][p] = t * wk[2] + m * wk[3];
+        for(int c = 0; c < 4; c++){
+            block.wi[c][p] = wi[c];
+            block.wj[c][p] = wj[c];
+        }
+    }
+}
+
+
+void magnetic_field_grid::interpolate(const grid_block& block, int p, bool tricubic, double B[3]) const {
+
+    /*
+    Interpolated field of point p of block, NaN outside the shell
+    */
+    if(!(block.outside[p] == 0)){
+        B[0] = B[1] = B[2] = NAN;
+        return;
+    }
+    const int nlat = head.nlat, nlon = head.nlon;
+    const int i = block.i[p], j = block.j[p];
+    const size_t row_stride = (size_t) 3 * nlon * head.nalt, col_stride = (size_t) 3 * head.nalt;
+    const size_t base = (size_t) 3 * block.k[p];
+
+    if(!tricubic){
+        const size_t j1 = (j + 1 == nlon) ? 0 : j + 1;
+        const size_t row = base + i * row_stride;
+        const size_t offset[2][2] = {{row + j * col_stride, row + j1 * col_stride},
+                                     {row + row_stride + j * col_stride, row + row_stride + j1 * col_stride}};
+        const float wi[2] = {block.wi[0][p], block.wi[1][p]}, wj[2] = {block.wj[0][p], block.wj[1][p]};
+        const float wk[2] = {block.wk[0][p], block.wk[1][p]};
+        stencil_sum<2>(data, offset, wi, wj, wk, B);
+        return;
+    }
+
+    // a row or column past the poles or the end of the shell has no weight, it is clamped
+    // only to stay inside the grid, longitude wraps round
+    float wi[4], wj[4], wk[4];
+    size_t rows[4], cols[4];
+    for(int a = 0; a < 4; a++){
+        wi[a] = block.wi[a][p];
+        wj[a] = block.wj[a][p];
+        wk[a] = block.wk[a][p];
+        const int ia = min(max(i + a - 1, 0), nlat - 1);
+        const int jb = j + a - 1;
+        rows[a] = base + ia * row_stride;
+        cols[a] = ((jb < 0) ? jb + nlon : (jb >= nlon) ? jb - nlon : jb) * col_stride;
+    }
+    size_t offset[4][4];
+    for(int a = 0; a < 4; a++){
+        for(int b = 0; b < 4; b++){
+            offset[a][b] = rows[a] + cols[b];
+        }
+    }
+    stencil_sum<4>(data, offset, wi, wj, wk, B);
+}
+
+
+Vector3d magnetic_field_grid::get_magnetic_field(double lat, double lon, double alt, bool tricubic) const {
+
+    /*
+    lat is geocentric latitude in degrees, -90 to 90
+    lon is longitude in degrees, any
+    alt is altitude in km, alt_min to alt_max of the grid
+    tricubic picks Catmull-Rom over the 4 x 4 x 4 nodes around the point, else trilinear
+    over the 2 x 2 x 2. Next to the poles and the ends of the shell the cubic stencil
+    extrapolates the missing nodes linearly.
+
+    outputs B vector in NED, NaN outside the grid
+    */
+    grid_block block;
+    locate(&lat, &lon, &alt, 1, tricubic, block);
+    Vector3d B;
+    interpolate(block, 0, tricubic, B.data());
+    return B;
+}
+
+
+void magnetic_field_grid::get_magnetic_field_batch(const double lat[], const double lon[], const double alt[], int n,
+                                                   double B[], bool tricubic) const {
+
+    /*
+    get_magnetic_field at n points, B is n x 3 row major. The points are located and
+    weighted GRID_BLOCK at a time across vector lanes, then summed one by one.
+    */
+    grid_block block;
+    for(int i0 = 0; i0 < n; i0 += GRID_BLOCK){
+        const int count = min(GRID_BLOCK, n - i0);
+        locate(&lat[i0], &lon[i0], &alt[i0], count, tricubic, block);
+        for(int p = 0; p < count; p++){
+            interpolate(block, p, tricubic, &B[3 * (i0 + p)]);
+        }
+    }
+}
+
+
+pair<double, double> magnetic_field_grid::max_error(int samples, bool tricubic, int nthreads) const {
+
+    /*
+    Largest and rms length of the difference between the interpolated field and the
+    harmonic sum the nodes came from, in nT, over samples points drawn evenly in lat,
+    lon and alt over the shell (the same points every call)
+    */
+    mt19937 random(12345);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    vector<double> lat(samples), lon(samples), alt(samples), exact(3 * samples), grid(3 * samples);
+    for(int i = 0; i < samples; i++){
+        lat[i] = -90.0 + 180.0 * uniform(random);
+        lon[i] = -180.0 + 360.0 * uniform(random);
+        alt[i] = head.alt_min + (head.alt_max - head.alt_min) * uniform(random);
+    }
+    ::get_magnetic_field_batch(head.gh, head.order, &lat[0], &lon[0], &alt[0], samples, &exact[0], nthreads);
+    get_magnetic_field_batch(&lat[0], &lon[0], &alt[0], samples, &grid[0], tricubic);
+
+    double largest = 0, sum = 0;
+    for(int i = 0; i < samples; i++){
+        double d2 = 0;
+        for(int j = 0; j < 3; j++){
+            d2 += (grid[3*i + j] - exact[3*i + j]) * (grid[3*i + j] - exact[3*i + j]);
+        }
+        largest = max(largest, sqrt(d2));
+        sum += d2;
+    }
+    return make_pair(largest, sqrt(sum / max(samples, 1)));
+}
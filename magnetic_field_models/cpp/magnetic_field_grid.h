@@ -0,0 +1,80 @@
+//
+// Precomputed IGRF field over a latitude/longitude/altitude shell
+//
+
+#ifndef CPP_MAGNETIC_FIELD_GRID_H
+#define CPP_MAGNETIC_FIELD_GRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "magnetic_field.h"
+
+// first bytes of a grid file and its layout version
+#define MAGNETIC_FIELD_GRID_MAGIC "IGRFGRID"
+#define MAGNETIC_FIELD_GRID_VERSION 2
+
+// written as a native uint32, reads back differently on a machine of the other byte order
+#define MAGNETIC_FIELD_GRID_ENDIAN 0x01020304u
+
+// the nodes start this far into a grid file, so a mapped file keeps them page aligned
+#define MAGNETIC_FIELD_GRID_OFFSET 4096
+
+// Everything in a grid file before the nodes. The coefficients the nodes were evaluated
+// with are kept so a loaded grid can still report its interpolation error. The fields up to
+// header_size sit at the same place on any ABI, so a file from a machine of another byte
+// order or struct layout is recognized and refused rather than misread.
+struct magnetic_field_grid_header {
+    char magic[8];
+    uint32_t version;       // MAGNETIC_FIELD_GRID_VERSION
+    uint32_t endian;        // MAGNETIC_FIELD_GRID_ENDIAN
+    uint32_t header_size;   // sizeof(magnetic_field_grid_header)
+    int order;
+    int nlat, nlon, nalt;
+    double year;
+    double alt_min, alt_max;
+    igrf_coefficients gh;
+};
+
+// NED field at the nodes of a geocentric lat/lon/alt shell, as floats. Latitude runs from -90
+// to 90 and longitude from -180 all the way round, in equal steps, altitude from alt_min to
+// alt_max. The nodes are stored [lat][lon][alt][N, E, D], so the altitude column of a node is
+// one block and a lookup reads 4 (trilinear) or 16 (tricubic) of them, two or four from each
+// of the neighbouring latitude rows. A grid read from a file is memory mapped where the system
+// can, nothing is copied and the pages are shared between processes.
+class magnetic_field_grid {
+public:
+    magnetic_field_grid(const igrf_coefficients& gh, int order, double year, double alt_min, double alt_max,
+                        double resolution, double alt_resolution, int nthreads = 0);
+    explicit magnetic_field_grid(const std::string& filename);
+    ~magnetic_field_grid();
+
+    void save(const std::string& filename) const;
+
+    Eigen::Vector3d get_magnetic_field(double lat, double lon, double alt, bool tricubic = true) const;
+    void get_magnetic_field_batch(const double lat[], const double lon[], const double alt[], int n, double B[],
+                                  bool tricubic = true) const;
+    std::pair<double, double> max_error(int samples, bool tricubic = true, int nthreads = 0) const;
+
+    const magnetic_field_grid_header& header() const { return head; }
+    size_t bytes() const { return (size_t) 3 * head.nlat * head.nlon * head.nalt * sizeof(float); }
+
+private:
+    magnetic_field_grid(const magnetic_field_grid&);
+    magnetic_field_grid& operator=(const magnetic_field_grid&);
+    void set_steps();
+    void locate(const double lat[], const double lon[], const double alt[], int n, bool tricubic,
+                struct grid_block& block) const;
+    void interpolate(const struct grid_block& block, int p, bool tricubic, double B[3]) const;
+
+    magnetic_field_grid_header head;
+    double dlat, dlon, dalt;
+    std::vector<float> nodes;
+    const float* data;
+    void* map;
+    size_t map_size;
+};
+
+#endif //CPP_MAGNETIC_FIELD_GRID_H
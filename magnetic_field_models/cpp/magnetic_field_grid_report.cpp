@@ -0,0 +1,105 @@
+//
+// Builds magnetic_field_grid over a low orbit shell at a few resolutions and
+// reports, for trilinear and tricubic lookups, the largest and rms error
+// against the harmonic sum and the time of a lookup against igrf_field, with
+// the size of the grid. Lookups are timed at random points of the shell, where
+// most of them miss the cache on the larger grids, and at one second steps
+// along an orbit, the way a simulation reads the grid. The grid of the last
+// resolution can be written out for other processes to map.
+//
+// usage : magnetic_field_grid_report [order] [outfile]   (default 10, nothing written)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "magnetic_field_grid.h"
+
+using namespace std;
+using namespace Eigen;
+
+// shell of the report                                                       km
+#define SHELL_ALT_MIN 350.0
+#define SHELL_ALT_MAX 600.0
+#define SHELL_ALT_STEP 25.0
+
+// points timed and checked per grid
+#define SAMPLES 200000
+
+// orbit of the along track points                                   km, deg, s
+#define ORBIT_ALT 450.0
+#define ORBIT_INC 51.6
+#define ORBIT_PERIOD 5580.0
+
+int main(int argc, char* argv[]) {
+    const int order = (argc > 1) ? atoi(argv[1]) : 10;
+    const char* outfile = (argc > 2) ? argv[2] : NULL;
+    const double year = 2019.5;
+    const double resolutions[] = {4.0, 2.0, 1.0, 0.5};
+    igrf_coefficients gh;
+    get_igrf_coefficients(year, order, gh);
+
+    // random points in the first half, along the orbit in the second
+    mt19937 random(1);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    vector<double> lat(2 * SAMPLES), lon(2 * SAMPLES), alt(2 * SAMPLES), B(6 * SAMPLES);
+    for(int i = 0; i < SAMPLES; i++){
+        lat[i] = -90.0 + 180.0 * uniform(random);
+        lon[i] = -180.0 + 360.0 * uniform(random);
+        alt[i] = SHELL_ALT_MIN + (SHELL_ALT_MAX - SHELL_ALT_MIN) * uniform(random);
+        const double u = 2 * M_PI * i / ORBIT_PERIOD, inc = ORBIT_INC * M_PI / 180.0;
+        const double earth = 2 * M_PI * i / 86164.0;
+        lat[SAMPLES + i] = asin(sin(inc) * sin(u)) * 180.0 / M_PI;
+        lon[SAMPLES + i] = remainder(atan2(cos(inc) * sin(u), cos(u)) - earth, 2 * M_PI) * 180.0 / M_PI;
+        alt[SAMPLES + i] = ORBIT_ALT;
+    }
+    double t_igrf = 1e30, check = 0;
+    for(int r = 0; r < 3; r++){
+        auto t0 = chrono::steady_clock::now();
+        for(int i = 0; i < SAMPLES; i++){
+            check += igrf_field(gh, lat[i], lon[i], alt[i], order)(0);
+        }
+        t_igrf = min(t_igrf, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+    }
+
+    printf("magnetic_field_grid, order %d, %.0f to %.0f km every %.0f km, %d points\n", order, SHELL_ALT_MIN,
+           SHELL_ALT_MAX, SHELL_ALT_STEP, SAMPLES);
+    printf("igrf_field %.1f ns per point, lookups timed at random points and along a %.0f km orbit\n",
+           1e9 * t_igrf / SAMPLES, ORBIT_ALT);
+    printf(" step (deg)  size (MB)  lookup     max err (nT)  rms err (nT)  random (ns)  orbit (ns)"
+           "  orbit vs igrf_field\n");
+    for(double resolution : resolutions){
+        magnetic_field_grid grid(gh, order, year, SHELL_ALT_MIN, SHELL_ALT_MAX, resolution, SHELL_ALT_STEP);
+        for(int tricubic = 0; tricubic < 2; tricubic++){
+            double t_random = 1e30, t_orbit = 1e30;
+            for(int r = 0; r < 3; r++){
+                auto t0 = chrono::steady_clock::now();
+                grid.get_magnetic_field_batch(&lat[0], &lon[0], &alt[0], SAMPLES, &B[0], tricubic != 0);
+                auto t1 = chrono::steady_clock::now();
+                grid.get_magnetic_field_batch(&lat[SAMPLES], &lon[SAMPLES], &alt[SAMPLES], SAMPLES, &B[3 * SAMPLES],
+                                              tricubic != 0);
+                auto t2 = chrono::steady_clock::now();
+                t_random = min(t_random, chrono::duration<double>(t1 - t0).count());
+                t_orbit = min(t_orbit, chrono::duration<double>(t2 - t1).count());
+                check += B[0] + B[3 * SAMPLES];
+            }
+            const pair<double, double> err = grid.max_error(SAMPLES, tricubic != 0);
+            printf(" %10.2f  %9.1f  %-9s  %12.3f  %12.3f  %11.1f  %10.1f  %19.3f\n", resolution, grid.bytes() / 1e6,
+                   tricubic ? "tricubic" : "trilinear", err.first, err.second, 1e9 * t_random / SAMPLES,
+                   1e9 * t_orbit / SAMPLES, t_orbit / t_igrf);
+        }
+        if(outfile != NULL && resolution == resolutions[sizeof(resolutions) / sizeof(resolutions[0]) - 1]){
+            grid.save(outfile);
+            printf("wrote %s\n", outfile);
+        }
+    }
+    // keeps the timed calls from being optimized out
+    if(check != check){
+        printf(" nan in the field\n");
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+//
+// Chebyshev series of the ECI magnetic field along an orbit, see magnetic_field_series.h
+//
+
+#include "magnetic_field_series.h"
+#include <math.h>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+using namespace Eigen;
+
+
+double circular_orbit_period(const circular_orbit& orbit){
+    const double a = IGRF_RADIUS + orbit.alt;
+    return 2 * M_PI * sqrt(a * a * a / EARTH_MU);
+}
+
+
+Vector3d circular_orbit_field_eci(const igrf_coefficients& gh, int order, const circular_orbit& orbit, double t){
+
+    /*
+    IGRF field in ECI in nT at t seconds along the orbit. The ECI frame is the ECEF frame
+    turned back by the sidereal angle, no precession or nutation.
+    */
+    const double d2r = M_PI / 180.0;
+    const double a = IGRF_RADIUS + orbit.alt;
+    const double u = orbit.u0 * d2r + 2 * M_PI * t / circular_orbit_period(orbit);
+    const double ci = cos(orbit.inc * d2r), si = sin(orbit.inc * d2r);
+    const double co = cos(orbit.raan * d2r), so = sin(orbit.raan * d2r);
+    const double cu = cos(u), su = sin(u);
+    const double r_eci[3] = {a * (co * cu - so * su * ci), a * (so * cu + co * su * ci), a * su * si};
+
+    const double theta = orbit.gmst0 * d2r + EARTH_ROTATION * t;
+    const double ct = cos(theta), st = sin(theta);
+    const double r_ecef[3] = {ct * r_eci[0] + st * r_eci[1], -st * r_eci[0] + ct * r_eci[1], r_eci[2]};
+    const Vector3d B = igrf_field_ecef(gh, r_ecef, order);
+    return Vector3d(ct * B(0) - st * B(1), st * B(0) + ct * B(1), B(2));
+}
+
+
+magnetic_field_series fit_magnetic_field_series(const function<Vector3d(double)>& B, double t0, double span,
+                                                int segments, int terms, vector<float>& c){
+
+    /*
+    Chebyshev interpolant of B on each segment through its terms Chebyshev nodes, which is
+    within a log(terms) factor of the best fit of that length and needs no solve
+    B is the field as a function of time in s
+    t0 is the start of the first segment and span the length of each in s
+    c is resized to segments x 3 x terms and holds the coefficients, the series points at it
+
+    outputs the series, valid while c is
+    */
+    if(!(span > 0) || segments < 1 || terms < 1){
+        throw invalid_argument("fit_magnetic_field_series: needs span > 0, segments >= 1 and terms >= 1");
+    }
+    c.assign((size_t) segments * 3 * terms, 0.0f);
+    vector<Vector3d> samples(terms);
+    for(int s = 0; s < segments; s++){
+        for(int j = 0; j < terms; j++){
+            const double x = cos(M_PI * (j + 0.5) / terms);
+            samples[j] = B(t0 + (s + 0.5 * (x + 1.0)) * span);
+        }
+        for(int k = 0; k < terms; k++){
+            Vector3d sum(0, 0, 0);
+            for(int j = 0; j < terms; j++){
+                sum += samples[j] * cos(M_PI * k * (j + 0.5) / terms);
+            }
+            sum *= (k == 0 ? 1.0 : 2.0) / terms;
+            for(int axis = 0; axis < 3; axis++){
+                c[((size_t) s * 3 + axis) * terms + k] = (float) sum(axis);
+            }
+        }
+    }
+    magnetic_field_series series = {t0, span, segments, terms, &c[0]};
+    return series;
+}
+
+
+pair<double, double> magnetic_field_series_error(const magnetic_field_series& series,
+                                                 const function<Vector3d(double)>& B, double t0, double t1,
+                                                 double step){
+
+    /*
+    Largest and rms length of the difference between the series and B from t0 to t1
+    every step seconds, in the units of B
+    */
+    double largest = 0, sum = 0;
+    int n = 0;
+    for(double t = t0; t <= t1; t += step, n++){
+        float b[3];
+        magnetic_field_series_eval(&series, t, b);
+        const double d = (Vector3d(b[0], b[1], b[2]) - B(t)).norm();
+        largest = max(largest, d);
+        sum += d * d;
+    }
+    return make_pair(largest, sqrt(sum / max(n, 1)));
+}
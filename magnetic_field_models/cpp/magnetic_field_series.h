@@ -0,0 +1,81 @@
+//
+// Chebyshev series of the ECI magnetic field along an orbit
+//
+// The field is fitted in time (the orbit argument of a circular orbit) over a run of equal
+// segments, each with its own series per axis, so a flight computer can rebuild B_ECI at any
+// time with one Clenshaw sum of K terms instead of keeping a table of it or running the IGRF
+// each step. The evaluator is plain C so the autocoded controllers can include this header
+// and link nothing; the fit is C++ and needs the IGRF.
+//
+
+#ifndef CPP_MAGNETIC_FIELD_SERIES_H
+#define CPP_MAGNETIC_FIELD_SERIES_H
+
+#include <math.h>
+
+/* Coefficients c[segment][axis][k] of segments series of terms Chebyshev polynomials each,
+   segment s covering t0 + s * span to t0 + (s + 1) * span seconds */
+typedef struct {
+    double t0;
+    double span;
+    int segments;
+    int terms;
+    const float* c;
+} magnetic_field_series;
+
+/* B at time t in the units of the coefficients. Times before t0 or past the last segment
+   extrapolate the first or last segment. */
+static inline void magnetic_field_series_eval(const magnetic_field_series* series, double t, float B[3])
+{
+    int s = (int) floor((t - series->t0) / series->span);
+    if (s < 0) {
+        s = 0;
+    }
+    if (s > series->segments - 1) {
+        s = series->segments - 1;
+    }
+    const float x = (float) (2.0 * (t - series->t0 - s * series->span) / series->span - 1.0);
+    for (int axis = 0; axis < 3; axis++) {
+        const float* c = series->c + (s * 3 + axis) * series->terms;
+        float b1 = 0.0f, b2 = 0.0f;
+        for (int k = series->terms - 1; k > 0; k--) {
+            const float b0 = 2.0f * x * b1 - b2 + c[k];
+            b2 = b1;
+            b1 = b0;
+        }
+        B[axis] = x * b1 - b2 + c[0];
+    }
+}
+
+#ifdef __cplusplus
+
+#include <functional>
+#include <vector>
+#include "magnetic_field.h"
+
+// Earth rotation rate in rad/s and gravitational parameter in km^3/s^2
+#define EARTH_ROTATION 7.292115146706979e-5
+#define EARTH_MU 398600.4418
+
+// Circular orbit at alt km above IGRF_RADIUS, angles in degrees: inclination, right ascension of
+// the ascending node, argument of latitude at t = 0 and Greenwich sidereal angle at t = 0
+struct circular_orbit {
+    double alt;
+    double inc;
+    double raan;
+    double u0;
+    double gmst0;
+};
+
+double circular_orbit_period(const circular_orbit& orbit);
+Eigen::Vector3d circular_orbit_field_eci(const igrf_coefficients& gh, int order, const circular_orbit& orbit,
+                                         double t);
+magnetic_field_series fit_magnetic_field_series(const std::function<Eigen::Vector3d(double)>& B, double t0,
+                                                double span, int segments, int terms, std::vector<float>& c);
+std::pair<double, double> magnetic_field_series_error(const magnetic_field_series& series,
+                                                      const std::function<Eigen::Vector3d(double)>& B, double t0,
+                                                      double t1, double step);
+
+#endif /* __cplusplus */
+
+#endif //CPP_MAGNETIC_FIELD_SERIES_H
@@ -0,0 +1,111 @@
+//
+// Fits magnetic_field_series to the order 10 IGRF in ECI along a 450 km, 51.6
+// deg circular orbit over some orbits, for a few segment lengths and series
+// lengths, and reports the coefficient count, the largest and rms error
+// against the field every second and the time of an evaluation against the
+// IGRF it replaces. The fewest coefficients within SERIES_TARGET are written
+// as a C header, in tesla like the B_ECI table of milqr, for a controller to
+// include with magnetic_field_series.h.
+//
+// usage : magnetic_field_series_fit [orbits] [outfile]   (default 1, nothing written)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "magnetic_field_series.h"
+
+using namespace std;
+using namespace Eigen;
+
+// largest error of the written series                                        nT
+#define SERIES_TARGET 1.0
+
+int main(int argc, char* argv[]) {
+    const int orbits = (argc > 1) ? max(1, atoi(argv[1])) : 1;
+    const char* outfile = (argc > 2) ? argv[2] : NULL;
+    const double year = 2019.5;
+    const int order = 10;
+    const circular_orbit orbit = {450.0, 51.6, 30.0, 0.0, 0.0};
+    const int segments_per_orbit[] = {1, 2, 4, 8};
+    const int terms[] = {8, 12, 16, 24, 32, 48};
+    igrf_coefficients gh;
+    get_igrf_coefficients(year, order, gh);
+    const function<Vector3d(double)> B = [&](double t) { return circular_orbit_field_eci(gh, order, orbit, t); };
+    const double period = circular_orbit_period(orbit), duration = orbits * period;
+
+    // the IGRF the series replaces, one evaluation per second
+    const int steps = (int) duration;
+    double t_igrf = 1e30, check = 0;
+    for(int r = 0; r < 3; r++){
+        auto t0 = chrono::steady_clock::now();
+        for(int i = 0; i < steps; i++){
+            check += B(i)(0);
+        }
+        t_igrf = min(t_igrf, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+    }
+
+    printf("magnetic_field_series, order %d IGRF in ECI, %.0f km %.1f deg orbit of %.1f s, %d orbit(s)\n", order,
+           orbit.alt, orbit.inc, period, orbits);
+    printf("IGRF and rotation %.1f ns per point, a float B_ECI table of one point per second is %d bytes\n",
+           1e9 * t_igrf / steps, 12 * steps);
+    printf(" segments  terms  coefficients  bytes  max err (nT)  rms err (nT)  eval (ns)  vs IGRF\n");
+    int best = -1, best_segments = 0, best_terms = 0;
+    for(int per_orbit : segments_per_orbit){
+        for(int k : terms){
+            const int segments = per_orbit * orbits;
+            vector<float> c;
+            const magnetic_field_series series = fit_magnetic_field_series(B, 0.0, duration / segments, segments, k,
+                                                                           c);
+            const pair<double, double> err = magnetic_field_series_error(series, B, 0.0, duration, 1.0);
+            double t_eval = 1e30;
+            for(int r = 0; r < 3; r++){
+                auto t0 = chrono::steady_clock::now();
+                for(int i = 0; i < steps; i++){
+                    float b[3];
+                    magnetic_field_series_eval(&series, i, b);
+                    check += b[0];
+                }
+                t_eval = min(t_eval, chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+            }
+            printf(" %8d  %5d  %12d  %5d  %12.3f  %12.3f  %9.1f  %7.3f\n", segments, k, (int) c.size(),
+                   (int) (c.size() * sizeof(float)), err.first, err.second, 1e9 * t_eval / steps, t_eval / t_igrf);
+            if(err.first < SERIES_TARGET && (best < 0 || (int) c.size() < best)){
+                best = (int) c.size();
+                best_segments = segments;
+                best_terms = k;
+            }
+        }
+    }
+
+    if(outfile != NULL && best > 0){
+        vector<float> c;
+        fit_magnetic_field_series(B, 0.0, duration / best_segments, best_segments, best_terms, c);
+        FILE* file = fopen(outfile, "w");
+        if(file == NULL){
+            printf("cannot write %s\n", outfile);
+            return 1;
+        }
+        fprintf(file, "/* B_ECI in tesla along a %.0f km %.1f deg circular orbit, order %d IGRF %.1f,\n"
+                      "   %d segments of %d terms, written by magnetic_field_series_fit */\n\n",
+                orbit.alt, orbit.inc, order, year, best_segments, best_terms);
+        fprintf(file, "#include \"magnetic_field_series.h\"\n\n");
+        fprintf(file, "static const float B_ECI_series_c[%d] = {\n", best);
+        for(int i = 0; i < best; i++){
+            fprintf(file, "%s%.9ef%s", (i % 4 == 0) ? "    " : "", 1e-9 * c[i],
+                    (i == best - 1) ? "\n" : (i % 4 == 3) ? ",\n" : ", ");
+        }
+        fprintf(file, "};\n\nstatic const magnetic_field_series B_ECI_series = {0.0, %.17g, %d, %d, B_ECI_series_c};\n",
+                duration / best_segments, best_segments, best_terms);
+        fclose(file);
+        printf("wrote %d segments of %d terms to %s\n", best_segments, best_terms, outfile);
+    }
+    // keeps the timed calls from being optimized out
+    if(check != check){
+        printf(" nan in the field\n");
+    }
+    return 0;
+}
@@ -43,3 +43,221 @@ def test_mag_field_2():
 
 
 
+
+def test_mag_field_tables():
+	# The precomputed table evaluator against the term by term sum, poles included
+	year = 2019.5
+	for order in [1, 5, 10]:
+		for lat in np.linspace(-90, 90, 13):
+			for lon in np.linspace(-180, 165, 8):
+				for alt in [400, 1000]:
+					np.testing.assert_allclose(mfcpp.get_magnetic_field(lat, lon, alt, year, order),
+						mfcpp.get_magnetic_field_direct(lat, lon, alt, year, order), rtol=1e-12, atol=1e-9)
+
+def test_mag_field_order_range():
+	with pytest.raises(ValueError):
+		mfcpp.get_magnetic_field(45, 30, 400, 2019, 11)
+
+def write_coeff_file(path):
+	# IGRF file layout with the built-in coefficients as the 2015 epoch and half of them as 2010
+	g, h = mfcpp.get_g_coefficients(), mfcpp.get_h_coefficients()
+	g_sv, h_sv = mfcpp.get_g_sv_coefficients(), mfcpp.get_h_sv_coefficients()
+	lines = ['# test coefficients', 'c/s deg ord IGRF IGRF SV', 'g/h n m 2010.0 2015.0 2015-20']
+	for n in range(1, 11):
+		for m in range(n + 1):
+			lines.append('g %d %d %r %r %r' % (n, m, 0.5 * g[n, m], g[n, m], g_sv[n, m]))
+			if m > 0:
+				lines.append('h %d %d %r %r %r' % (n, m, 0.5 * h[n, m], h[n, m], h_sv[n, m]))
+	path.write_text('\n'.join(lines) + '\n')
+	return str(path)
+
+def test_igrf_model_file(tmp_path):
+	model = mfcpp.igrf_model(write_coeff_file(tmp_path / 'coeffs.txt'), refresh=0.0)
+	assert model.epochs() == [2010.0, 2015.0]
+	assert model.order() == 10
+	# past the last epoch the secular variation is added, as in the built-in model
+	np.testing.assert_array_equal(model.get_magnetic_field(45, 30, 400, 2019, 10),
+		mfcpp.get_magnetic_field(45, 30, 400, 2019, 10))
+	# linear between epochs
+	g, h = model.get_coefficients(2012.5)
+	np.testing.assert_allclose(g, 0.75 * mfcpp.get_g_coefficients(), rtol=1e-15)
+	np.testing.assert_allclose(h, 0.75 * mfcpp.get_h_coefficients(), rtol=1e-15)
+	with pytest.raises(ValueError):
+		model.get_coefficients(2005)
+	with pytest.raises(RuntimeError):
+		mfcpp.igrf_model(str(tmp_path / 'missing.txt'))
+
+def test_igrf_model_cache(tmp_path):
+	# the coefficients are only recomputed once the year moves more than refresh
+	model = mfcpp.igrf_model(write_coeff_file(tmp_path / 'coeffs.txt'), refresh=1.0)
+	B = model.get_magnetic_field(45, 30, 400, 2019)
+	np.testing.assert_array_equal(model.get_magnetic_field(45, 30, 400, 2019.5), B)
+	np.testing.assert_array_equal(model.get_magnetic_field(45, 30, 400, 2020.5),
+		mfcpp.get_magnetic_field(45, 30, 400, 2020.5, 10))
+
+def test_mag_field_batch():
+	# The blocked evaluator against get_magnetic_field, from lat/lon/alt and from ECEF, over several threads
+	lat, lon = np.meshgrid(np.linspace(-90, 90, 37), np.linspace(-180, 175, 72))
+	lat, lon = lat.ravel(), lon.ravel()
+	alt = np.linspace(300, 1500, lat.size)
+	year = 2019.5
+	B = mfcpp.get_magnetic_field_batch(lat, lon, alt, year, 10, nthreads=3)
+	assert B.shape == (lat.size, 3)
+	for i in range(0, lat.size, 7):
+		# get_magnetic_field gives no east component at the south pole
+		east = slice(0, 3) if lat[i] > -90 else slice(0, 3, 2)
+		np.testing.assert_allclose(B[i, east], mfcpp.get_magnetic_field(lat[i], lon[i], alt[i], year, 10)[east], rtol=1e-12, atol=1e-8)
+	np.testing.assert_array_equal(mfcpp.get_magnetic_field_batch(lat, lon, alt, year, 10, nthreads=1), B)
+
+	r = (6371.2 + alt)[:, None] * np.column_stack([np.cos(np.radians(lat)) * np.cos(np.radians(lon)),
+		np.cos(np.radians(lat)) * np.sin(np.radians(lon)), np.sin(np.radians(lat))])
+	away = np.abs(lat) < 90
+	np.testing.assert_allclose(mfcpp.get_magnetic_field_batch(r, year, 10)[away], B[away], rtol=1e-9, atol=1e-6)
+
+def ned2ecef(lat, lon, B):
+	lat, lon = math.radians(lat), math.radians(lon)
+	north = np.array([-math.sin(lat) * math.cos(lon), -math.sin(lat) * math.sin(lon), math.cos(lat)])
+	east = np.array([-math.sin(lon), math.cos(lon), 0])
+	down = np.array([-math.cos(lat) * math.cos(lon), -math.cos(lat) * math.sin(lon), -math.sin(lat)])
+	return B[0] * north + B[1] * east + B[2] * down
+
+def test_mag_field_ecef():
+	# The Cartesian recursion against get_magnetic_field rotated from NED
+	year = 2019.5
+	for order in [1, 5, 10]:
+		for lat in np.linspace(-90, 90, 13):
+			for lon in np.linspace(-180, 165, 8):
+				r = 6771.2 * np.array([math.cos(math.radians(lat)) * math.cos(math.radians(lon)),
+					math.cos(math.radians(lat)) * math.sin(math.radians(lon)), math.sin(math.radians(lat))])
+				# get_magnetic_field has no east component at the south pole, the batch has
+				B = mfcpp.get_magnetic_field_batch(np.array([lat]), np.array([lon]), np.array([400.0]), year, order)[0]
+				np.testing.assert_allclose(mfcpp.get_magnetic_field_ecef(r, year, order), ned2ecef(lat, lon, B),
+					rtol=1e-10, atol=1e-7)
+
+def test_mag_field_gradient():
+	# The gradient from the recursion against central differences of the ECEF field, poles included
+	year, h = 2019.5, 1e-3
+	for r in [np.array([4000.0, 3000.0, 4500.0]), np.array([-2000.0, 6000.0, -1000.0]), np.array([0.0, 0.0, -6771.2])]:
+		B, dB = mfcpp.get_magnetic_field_gradient_ecef(r, year, 10)
+		np.testing.assert_allclose(B, mfcpp.get_magnetic_field_ecef(r, year, 10), rtol=1e-13)
+		fd = np.column_stack([(mfcpp.get_magnetic_field_ecef(r + h * e, year, 10) -
+			mfcpp.get_magnetic_field_ecef(r - h * e, year, 10)) / (2 * h) for e in np.eye(3)])
+		np.testing.assert_allclose(dB, fd, atol=1e-6)
+		np.testing.assert_allclose(dB, dB.T, atol=1e-12)
+		assert abs(np.trace(dB)) < 1e-12
+
+	# NED is the same field and gradient along the local axes
+	B, dB = mfcpp.get_magnetic_field_gradient(45, 30, 400, year, 10)
+	np.testing.assert_allclose(B, mfcpp.get_magnetic_field(45, 30, 400, year, 10), rtol=1e-12)
+	lat, lon = math.radians(45), math.radians(30)
+	r = 6771.2 * np.array([math.cos(lat) * math.cos(lon), math.cos(lat) * math.sin(lon), math.sin(lat)])
+	R = np.array([ned2ecef(45, 30, e) for e in np.eye(3)])
+	np.testing.assert_allclose(dB, R @ mfcpp.get_magnetic_field_gradient_ecef(r, year, 10)[1] @ R.T, atol=1e-12)
+
+def test_mag_field_grid(tmp_path):
+	# The interpolated grid against the harmonic sum, at the nodes and between them, and after a save and load
+	year = 2019.5
+	grid = mfcpp.magnetic_field_grid(year, 10, 350, 600, resolution=5.0, alt_resolution=50.0, nthreads=2)
+	assert grid.shape == (37, 72, 6)
+	assert grid.bytes == 4 * 3 * 37 * 72 * 6
+	for lat, lon, alt in [(45, 30, 400), (-85, -180, 350), (90, 175, 600), (0, 0, 500)]:
+		B = mfcpp.get_magnetic_field_batch(np.array([lat]), np.array([lon]), np.array([alt], dtype=float), year, 10)[0]
+		np.testing.assert_allclose(grid.get_magnetic_field(lat, lon, alt), B, rtol=1e-6, atol=1e-2)
+		np.testing.assert_allclose(grid.get_magnetic_field(lat, lon, alt, tricubic=False), B, rtol=1e-6, atol=1e-2)
+	# longitude wraps round
+	np.testing.assert_allclose(grid.get_magnetic_field(10, 181, 420), grid.get_magnetic_field(10, -179, 420), atol=1e-6)
+	assert np.all(np.isnan(grid.get_magnetic_field(10, 20, 700)))
+	assert np.all(np.isnan(grid.get_magnetic_field(float('nan'), 20, 400)))
+	np.testing.assert_allclose(grid.get_magnetic_field(10, -900, 420), grid.get_magnetic_field(10, 180, 420), atol=1e-6)
+	# any finite longitude wraps, one that is not finite gives NaN like a point off the shell
+	np.testing.assert_allclose(grid.get_magnetic_field(10, 1e12, 420), grid.get_magnetic_field(10, -80, 420), atol=1e-3)
+	for lon in [float('nan'), float('inf'), -float('inf')]:
+		assert np.all(np.isnan(grid.get_magnetic_field(10, lon, 420)))
+	B = grid.get_magnetic_field_batch(np.full(4, 10.0), np.array([float('nan'), 1e12, -1e300, 20.0]), np.full(4, 420.0))
+	assert np.all(np.isnan(B[0])) and np.all(np.isfinite(B[1:]))
+	np.testing.assert_allclose(B[3], grid.get_magnetic_field(10, 20, 420), atol=1e-6)
+
+	cubic, rms_cubic = grid.max_error(20000)
+	linear, rms_linear = grid.max_error(20000, tricubic=False)
+	assert rms_cubic < rms_linear and cubic < linear
+	lat = np.linspace(-89, 89, 500)
+	lon = np.linspace(-180, 180, 500)
+	alt = np.linspace(350, 600, 500)
+	B = grid.get_magnetic_field_batch(lat, lon, alt)
+	err = np.linalg.norm(B - mfcpp.get_magnetic_field_batch(lat, lon, alt, year, 10), axis=1)
+	assert np.max(err) <= cubic * 1.5
+
+	path = str(tmp_path / "grid.bin")
+	grid.save(path)
+	loaded = mfcpp.magnetic_field_grid(path)
+	assert loaded.shape == grid.shape and loaded.order == 10 and loaded.year == year
+	np.testing.assert_array_equal(loaded.get_magnetic_field_batch(lat, lon, alt), B)
+	assert loaded.max_error(20000) == (cubic, rms_cubic)
+	with pytest.raises(RuntimeError):
+		mfcpp.magnetic_field_grid(str(tmp_path / "missing.bin"))
+	# a file from a machine of the other byte order, or with another header layout, is refused
+	data = bytearray(open(path, 'rb').read())
+	for offset, field in [(12, data[12:16][::-1]), (16, (int.from_bytes(data[16:20], sys.byteorder) + 8).to_bytes(4, sys.byteorder))]:
+		changed = bytearray(data)
+		changed[offset:offset + 4] = field
+		open(path, 'wb').write(changed)
+		with pytest.raises(RuntimeError):
+			mfcpp.magnetic_field_grid(path)
+
+def test_mag_field_grid_model(tmp_path):
+	# a grid of the coefficient file, which holds the built-in coefficients, is the grid of the built-in model
+	model = mfcpp.igrf_model(write_coeff_file(tmp_path / 'coeffs.txt'))
+	grid = mfcpp.magnetic_field_grid(model, 2017.0, 350.0, 600.0, resolution=10.0, alt_resolution=125.0)
+	assert grid.order == 10 and grid.alt_range == (350.0, 600.0)
+	builtin = mfcpp.magnetic_field_grid(2017.0, 10, 350.0, 600.0, resolution=10.0, alt_resolution=125.0)
+	assert grid.shape == builtin.shape
+	np.testing.assert_array_equal(grid.get_magnetic_field(45, 30, 400), builtin.get_magnetic_field(45, 30, 400))
+	grid = mfcpp.magnetic_field_grid(model=model, year=2017.0, alt_min=350.0, alt_max=600.0, order=6, resolution=10.0,
+		alt_resolution=125.0)
+	assert grid.order == 6
+
+def test_mag_field_series():
+	# The Chebyshev series along an orbit against the field it was fitted to, at and between the sample times
+	year = 2019.5
+	orbit = mfcpp.circular_orbit(450, 51.6, raan=30)
+	r = (6371.2 + 450) * np.array([math.cos(math.radians(30)), math.sin(math.radians(30)), 0])
+	# at t = 0 the orbit is at its ascending node and ECI is ECEF
+	np.testing.assert_allclose(mfcpp.get_magnetic_field_circular_orbit(orbit, 0, year, 10),
+		mfcpp.get_magnetic_field_ecef(r, year, 10), rtol=1e-12)
+
+	errors = []
+	for terms in [12, 16, 24]:
+		series = mfcpp.magnetic_field_series(orbit, year, 10, 0, 2 * orbit.period, 4, terms)
+		assert series.coefficients.shape == (4, 3, terms)
+		err = max(np.linalg.norm(series.get_magnetic_field(t) - mfcpp.get_magnetic_field_circular_orbit(orbit, t, year, 10))
+			for t in np.linspace(0, 2 * orbit.period, 401))
+		errors.append(err)
+	assert errors[0] > errors[1] > errors[2]
+	assert errors[2] < 0.1
+
+def test_mag_field_budget(tmp_path):
+	# The order picked for an error budget against the truncation error it leaves over a sphere
+	year = 2019.5
+	assert mfcpp.get_budget_order(400, year, 0) == 10
+	orders = [mfcpp.get_budget_order(400, year, budget) for budget in [3000, 300, 30, 3]]
+	assert orders == sorted(orders) and orders[0] < orders[-1]
+	# higher up the small scales fade, so the same budget takes fewer degrees
+	assert mfcpp.get_budget_order(2000, year, 100) < mfcpp.get_budget_order(400, year, 100)
+
+	# rms over the sphere, area weighted, within the budget
+	lat, lon = np.meshgrid(np.linspace(-87.5, 87.5, 36), np.linspace(-180, 175, 72))
+	lat, lon = lat.ravel(), lon.ravel()
+	weights = np.cos(np.radians(lat))
+	full = mfcpp.get_magnetic_field_batch(lat, lon, np.full(lat.size, 400.0), year, 10)
+	for budget in [1000, 100, 10]:
+		B = np.array([mfcpp.get_magnetic_field_budget(lat[i], lon[i], 400, year, budget) for i in range(lat.size)])
+		np.testing.assert_array_equal(B[0], mfcpp.get_magnetic_field(lat[0], lon[0], 400, year,
+			mfcpp.get_budget_order(400, year, budget)))
+		rms = math.sqrt(np.sum(weights * np.sum((B - full) ** 2, axis=1)) / np.sum(weights))
+		assert rms <= budget
+
+	model = mfcpp.igrf_model(write_coeff_file(tmp_path / 'coeffs.txt'))
+	power = model.get_spectrum(2020.5)
+	assert len(power) == 11 and power[0] == 0
+	np.testing.assert_array_equal(model.get_magnetic_field_budget(45, 30, 400, 2020.5, 0),
+		model.get_magnetic_field(45, 30, 400, 2020.5))
@@ -0,0 +1,365 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_batch.cpp
+*
+*    this file contains the batch (time grid) version of the sgp4 propagator.
+*    the near earth equations are the same as in sgp4 (SGP4.cpp), evaluated in
+*    the same order so the results match the scalar routine, but every term
+*    that only depends on the element set is computed once per call and the
+*    per-epoch work is split into short straight-line loops over a block of
+*    epochs that the compiler can vectorize.
+*
+*       ----------------------------------------------------------------      */
+
+#include <limits>
+
+#include "SGP4_batch.h"
+
+#define pi 3.14159265358979323846
+
+// number of epochs processed per pass through the three stages below. small
+// enough that the scratch arrays stay in l1 cache.
+#define SGP4_BATCH_BLOCK 64
+
+namespace SGP4Funcs
+{
+
+	// fmod(x, 2 pi) written with trunc so the loops that use it can vectorize.
+	// differs from fmod only in the last bits of the reduced angle.
+	template <typename T>
+	static inline T fmod2p(T x)
+	{
+		const T twopi = T(2.0) * T(pi);
+		return x - twopi * trunc(x / twopi);
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure sgp4_block
+	*
+	*  this procedure propagates one block of at most SGP4_BATCH_BLOCK epochs of a
+	*    near earth satellite. it is templated on isimp so the simplified drag
+	*    branch is resolved at compile time instead of once per epoch, and on
+	*    the scalar type, so a float block fills twice the simd lanes.
+	*
+	*  inputs        :
+	*    satrec      - initialised structure from sgp4init() call, method 'n'
+	*    tsince      - times since epoch                    min
+	*    n           - number of epochs in the block
+	*
+	*  outputs       :
+	*    x, y, z     - position components                  km
+	*    vx, vy, vz  - velocity components                  km/sec
+	*    err         - per epoch error code (see sgp4)
+	*
+	*  coupling      :
+	*    none. the equations are copied from sgp4 with method == 'n'.
+	----------------------------------------------------------------------------*/
+
+	template <typename T, bool simple, typename rec>
+	static int sgp4_block
+		(
+		const rec& satrec, const T tsince[], int n,
+		T x[], T y[], T z[],
+		T vx[], T vy[], T vz[],
+		int err[]
+		)
+	{
+		const T x2o3 = T(2.0) / T(3.0);
+
+		/* ------------- element set invariants, hoisted out of the loops ------------- */
+		const T vkmpersec = satrec.radiusearthkm * satrec.xke / T(60.0);
+		const T xke = satrec.xke;
+		const T radiusearthkm = satrec.radiusearthkm;
+		const T mo = satrec.mo, mdot = satrec.mdot;
+		const T argpo = satrec.argpo, argpdot = satrec.argpdot;
+		const T nodeo = satrec.nodeo, nodedot = satrec.nodedot, nodecf = satrec.nodecf;
+		const T cc1 = satrec.cc1, bcc4 = satrec.bstar * satrec.cc4, bcc5 = satrec.bstar * satrec.cc5;
+		const T t2cof = satrec.t2cof, t3cof = satrec.t3cof, t4cof = satrec.t4cof, t5cof = satrec.t5cof;
+		const T omgcof = satrec.omgcof, eta = satrec.eta, xmcof = satrec.xmcof, delmo = satrec.delmo;
+		const T d2 = satrec.d2, d3 = satrec.d3, d4 = satrec.d4, sinmao = satrec.sinmao;
+		const T no_unkozai = satrec.no_unkozai, ecco = satrec.ecco, inclo = satrec.inclo;
+		const T aycof = satrec.aycof, xlcof = satrec.xlcof, j2 = satrec.j2;
+		const T con41 = satrec.con41, x1mth2 = satrec.x1mth2, x7thm1 = satrec.x7thm1;
+		// am = (xke / nm)^(2/3) * tempa^2, and nm is the unkozai'd mean motion for near earth
+		const T amcof = pow((xke / no_unkozai), x2o3);
+		// no lunar-solar periodics, so the inclination is fixed at its epoch value
+		const T sinip = sin(inclo);
+		const T cosip = cos(inclo);
+
+		/* ---------------- scratch arrays carried between the stages ---------------- */
+		T am[SGP4_BATCH_BLOCK], nm[SGP4_BATCH_BLOCK], axnl[SGP4_BATCH_BLOCK],
+			aynl[SGP4_BATCH_BLOCK], nodep[SGP4_BATCH_BLOCK], u[SGP4_BATCH_BLOCK],
+			sineo1[SGP4_BATCH_BLOCK], coseo1[SGP4_BATCH_BLOCK];
+		int i, nerr = 0;
+
+		/* ---------- stage 1 : secular gravity and drag, long period terms ---------- */
+		for (i = 0; i < n; i++)
+		{
+			T t, t2, t3, t4, xmdf, argpdf, nodedf, argpm, mm, nodem, tempa, tempe,
+				templ, delomg, delmtemp, delm, temp, em, xlm, xl;
+			t = tsince[i];
+			xmdf = mo + mdot * t;
+			argpdf = argpo + argpdot * t;
+			nodedf = nodeo + nodedot * t;
+			argpm = argpdf;
+			mm = xmdf;
+			t2 = t * t;
+			nodem = nodedf + nodecf * t2;
+			tempa = T(1.0) - cc1 * t;
+			tempe = bcc4 * t;
+			templ = t2cof * t2;
+
+			if (!simple)
+			{
+				delomg = omgcof * t;
+				delmtemp = T(1.0) + eta * cos(xmdf);
+				delm = xmcof * (delmtemp * delmtemp * delmtemp - delmo);
+				temp = delomg + delm;
+				mm = xmdf + temp;
+				argpm = argpdf - temp;
+				t3 = t2 * t;
+				t4 = t3 * t;
+				tempa = tempa - d2 * t2 - d3 * t3 - d4 * t4;
+				tempe = tempe + bcc5 * (sin(mm) - sinmao);
+				templ = templ + t3cof * t3 + t4 * (t4cof + t * t5cof);
+			}
+
+			am[i] = amcof * tempa * tempa;
+			nm[i] = xke / (am[i] * sqrt(am[i]));
+			em = ecco - tempe;
+			err[i] = ((em >= T(1.0)) || (em < -T(0.001))) ? 1 : 0;
+			em = (em < T(1.0e-6)) ? T(1.0e-6) : em;
+			mm = mm + no_unkozai * templ;
+			xlm = mm + argpm + nodem;
+
+			nodem = fmod2p(nodem);
+			argpm = fmod2p(argpm);
+			xlm = fmod2p(xlm);
+			mm = fmod2p(xlm - argpm - nodem);
+
+			axnl[i] = em * cos(argpm);
+			temp = T(1.0) / (am[i] * (T(1.0) - em * em));
+			aynl[i] = em * sin(argpm) + temp * aycof;
+			xl = mm + argpm + nodem + temp * xlcof * axnl[i];
+			nodep[i] = nodem;
+			u[i] = fmod2p(xl - nodem);
+		}
+
+		/* ----------------------- stage 2 : kepler's equation ----------------------- */
+		// kept identical to sgp4 (same tolerance and iteration cap) so the converged
+		// eccentric anomaly is bit for bit the one the scalar routine finds
+		for (i = 0; i < n; i++)
+		{
+			T eo1, tem5, se, ce;
+			int ktr;
+			eo1 = u[i];
+			tem5 = T(9999.9);
+			ktr = 1;
+			se = ce = T(0.0);
+			while ((fabs(tem5) >= T(1.0e-12)) && (ktr <= 10))
+			{
+				se = sin(eo1);
+				ce = cos(eo1);
+				tem5 = T(1.0) - ce * axnl[i] - se * aynl[i];
+				tem5 = (u[i] - aynl[i] * ce + axnl[i] * se - eo1) / tem5;
+				if (fabs(tem5) >= T(0.95))
+					tem5 = tem5 > T(0.0) ? T(0.95) : -T(0.95);
+				eo1 = eo1 + tem5;
+				ktr = ktr + 1;
+			}
+			sineo1[i] = se;
+			coseo1[i] = ce;
+		}
+
+		/* ---------------- stage 3 : short period periodics and r, v ---------------- */
+		for (i = 0; i < n; i++)
+		{
+			T ecose, esine, el2, pl, rl, rdotl, rvdotl, betal, temp, temp1, temp2,
+				sinu, cosu, su, sin2u, cos2u, mrt, xnode, xinc, mvt, rvdot,
+				sinsu, cossu, snod, cnod, sini, cosi, xmx, xmy, ux, uy, uz, wx, wy, wz;
+			ecose = axnl[i] * coseo1[i] + aynl[i] * sineo1[i];
+			esine = axnl[i] * sineo1[i] - aynl[i] * coseo1[i];
+			el2 = axnl[i] * axnl[i] + aynl[i] * aynl[i];
+			pl = am[i] * (T(1.0) - el2);
+
+			rl = am[i] * (T(1.0) - ecose);
+			rdotl = sqrt(am[i]) * esine / rl;
+			rvdotl = sqrt(pl) / rl;
+			betal = sqrt(T(1.0) - el2);
+			temp = esine / (T(1.0) + betal);
+			sinu = am[i] / rl * (sineo1[i] - aynl[i] - axnl[i] * temp);
+			cosu = am[i] / rl * (coseo1[i] - axnl[i] + aynl[i] * temp);
+			su = atan2(sinu, cosu);
+			sin2u = (cosu + cosu) * sinu;
+			cos2u = T(1.0) - T(2.0) * sinu * sinu;
+			temp = T(1.0) / pl;
+			temp1 = T(0.5) * j2 * temp;
+			temp2 = temp1 * temp;
+
+			mrt = rl * (T(1.0) - T(1.5) * temp2 * betal * con41) +
+				T(0.5) * temp1 * x1mth2 * cos2u;
+			su = su - T(0.25) * temp2 * x7thm1 * sin2u;
+			xnode = nodep[i] + T(1.5) * temp2 * cosip * sin2u;
+			xinc = inclo + T(1.5) * temp2 * cosip * sinip * cos2u;
+			mvt = rdotl - nm[i] * temp1 * x1mth2 * sin2u / xke;
+			rvdot = rvdotl + nm[i] * temp1 * (x1mth2 * cos2u +
+				T(1.5) * con41) / xke;
+
+			sinsu = sin(su);
+			cossu = cos(su);
+			snod = sin(xnode);
+			cnod = cos(xnode);
+			sini = sin(xinc);
+			cosi = cos(xinc);
+			xmx = -snod * cosi;
+			xmy = cnod * cosi;
+			ux = xmx * sinsu + cnod * cossu;
+			uy = xmy * sinsu + snod * cossu;
+			uz = sini * sinsu;
+			wx = xmx * cossu - cnod * sinsu;
+			wy = xmy * cossu - snod * sinsu;
+			wz = sini * cossu;
+
+			x[i] = (mrt * ux) * radiusearthkm;
+			y[i] = (mrt * uy) * radiusearthkm;
+			z[i] = (mrt * uz) * radiusearthkm;
+			vx[i] = (mvt * ux + rvdot * wx) * vkmpersec;
+			vy[i] = (mvt * uy + rvdot * wy) * vkmpersec;
+			vz[i] = (mvt * uz + rvdot * wz) * vkmpersec;
+
+			// same precedence as the early returns in sgp4
+			if (err[i] == 0)
+				err[i] = (pl < T(0.0)) ? 4 : ((mrt < T(1.0)) ? 6 : 0);
+			nerr += (err[i] != 0);
+		}
+
+		return nerr;
+	}  // sgp4_block
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure sgp4_batch
+	*
+	*  this procedure propagates one satellite to an array of times since epoch,
+	*    in double, or in float for a record set up by sgp4init_from. near
+	*    earth satellites go through sgp4_block. deep space satellites
+	*    (method 'd') fall back to sgp4, because the resonance integration in
+	*    dspace carries state from one epoch to the next.
+	*
+	*  inputs        :
+	*    satrec      - initialised structure from sgp4init() call.
+	*    tsince      - array of times since epoch           min
+	*    n           - number of epochs
+	*
+	*  outputs       :
+	*    x, y, z     - position components                  km
+	*    vx, vy, vz  - velocity components                  km/sec
+	*    err         - per epoch error code, may be NULL. the state of an epoch
+	*                  with a non-zero code is not meaningful, for a deep space
+	*                  satellite it is NaN.
+	*                   1 - mean elements, ecc >= 1.0 or ecc < -0.001 or a < 0.95 er
+	*                   2 - mean motion less than 0.0
+	*                   3 - pert elements, ecc < 0.0  or  ecc > 1.0
+	*                   4 - semi-latus rectum < 0.0
+	*                   6 - satellite has decayed
+	*    return code - false if any epoch had an error. satrec.error holds the
+	*                  first error code found and satrec.t the last epoch.
+	*
+	*  coupling      :
+	*    sgp4_block  - near earth propagation of one block
+	*    sgp4_t      - deep space propagation, one epoch at a time
+	----------------------------------------------------------------------------*/
+
+	template <typename T, typename rec>
+	static bool sgp4_batch_t
+		(
+		rec& satrec, const T tsince[], int n,
+		T x[], T y[], T z[],
+		T vx[], T vy[], T vz[],
+		int err[]
+		)
+	{
+		int i, j, nb, nerr = 0;
+		int errblock[SGP4_BATCH_BLOCK];
+		T r[3], v[3];
+
+		satrec.error = 0;
+		if (n <= 0)
+			return true;
+
+		if (satrec.method == 'd')
+		{
+			int first = 0;
+			for (i = 0; i < n; i++)
+			{
+				if (!sgp4_t(satrec, tsince[i], r, v))
+					r[0] = r[1] = r[2] = v[0] = v[1] = v[2] = std::numeric_limits<T>::quiet_NaN();
+				x[i] = r[0]; y[i] = r[1]; z[i] = r[2];
+				vx[i] = v[0]; vy[i] = v[1]; vz[i] = v[2];
+				if (err != NULL)
+					err[i] = satrec.error;
+				if ((satrec.error != 0) && (first == 0))
+					first = satrec.error;
+			}
+			satrec.error = first;
+			return first == 0;
+		}
+
+		// nm is never updated for near earth, so a bad mean motion fails every epoch
+		if (satrec.no_unkozai <= T(0.0))
+		{
+			if (err != NULL)
+				for (i = 0; i < n; i++)
+					err[i] = 2;
+			satrec.t = tsince[n - 1];
+			satrec.error = 2;
+			return false;
+		}
+
+		for (i = 0; i < n; i += SGP4_BATCH_BLOCK)
+		{
+			nb = (n - i < SGP4_BATCH_BLOCK) ? n - i : SGP4_BATCH_BLOCK;
+			int *e = (err != NULL) ? &err[i] : errblock;
+			int bad;
+			if (satrec.isimp == 1)
+				bad = sgp4_block<T, true>(satrec, &tsince[i], nb, &x[i], &y[i], &z[i], &vx[i], &vy[i], &vz[i], e);
+			else
+				bad = sgp4_block<T, false>(satrec, &tsince[i], nb, &x[i], &y[i], &z[i], &vx[i], &vy[i], &vz[i], e);
+			if ((bad > 0) && (nerr == 0))
+				for (j = 0; j < nb; j++)
+					if (e[j] != 0)
+					{
+						satrec.error = e[j];
+						break;
+					}
+			nerr += bad;
+		}
+
+		satrec.t = tsince[n - 1];
+		return nerr == 0;
+	}  // sgp4_batch_t
+
+	bool sgp4_batch
+		(
+		elsetrec& satrec, const double tsince[], int n,
+		double x[], double y[], double z[],
+		double vx[], double vy[], double vz[],
+		int err[]
+		)
+	{
+		return sgp4_batch_t(satrec, tsince, n, x, y, z, vx, vy, vz, err);
+	}  // sgp4_batch
+
+	bool sgp4_batch
+		(
+		elsetrec_t<float>& satrec, const float tsince[], int n,
+		float x[], float y[], float z[],
+		float vx[], float vy[], float vz[],
+		int err[]
+		)
+	{
+		return sgp4_batch_t(satrec, tsince, n, x, y, z, vx, vy, vz, err);
+	}  // sgp4_batch
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,38 @@
+#ifndef _SGP4_batch_h_
+#define _SGP4_batch_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_batch.h
+*
+*    this file contains the batch (time grid) entry point for the sgp4
+*    propagator. one initialized elsetrec is propagated to many times since
+*    epoch and the states are written as a structure of arrays, so tight
+*    simulation loops do not pay the scalar call overhead per epoch. the
+*    float version runs the same code on an elsetrec_t<float> record.
+*
+*       ----------------------------------------------------------------      */
+
+#include "SGP4_core.h"
+
+namespace SGP4Funcs
+{
+
+	bool sgp4_batch
+		(
+		elsetrec& satrec, const double tsince[], int n,
+		double x[], double y[], double z[],
+		double vx[], double vy[], double vz[],
+		int err[]
+		);
+
+	bool sgp4_batch
+		(
+		elsetrec_t<float>& satrec, const float tsince[], int n,
+		float x[], float y[], float z[],
+		float vx[], float vy[], float vz[],
+		int err[]
+		);
+
+}  // namespace
+
+#endif
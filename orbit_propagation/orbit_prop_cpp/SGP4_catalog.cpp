@@ -0,0 +1,525 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_catalog.cpp
+*
+*    this file contains the catalog propagator. the near earth equations are
+*    the ones in sgp4 (SGP4.cpp) and sgp4_block (SGP4_batch.cpp), written as
+*    loops over the SGP4_LANES satellites of a lane group so each statement
+*    becomes one vector instruction. deep space satellites go through sgp4,
+*    since dspace and dpper branch on the resonance type of every satellite.
+*    groups are handed out to a set of worker threads that the catalog keeps
+*    between calls.
+*
+*       ----------------------------------------------------------------      */
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "SGP4_catalog.h"
+
+#define pi 3.14159265358979323846
+
+// lane groups (or deep space satellites) a worker takes per visit to the
+// shared counter. keeps the counter off the hot path without starving threads.
+#define SGP4_CATALOG_CHUNK 16
+
+namespace SGP4Funcs
+{
+
+	// worker threads kept by a catalog between calls to propagate. run hands a
+	// job to the first helpers threads, runs it on the calling thread as well
+	// and returns once every one of them is done with it. threads are added
+	// when a call asks for more than there are, and are only stopped with the
+	// pool. the catalog holds its calls mutex around run, so one job at a time.
+	struct sgp4catalogpool
+	{
+		std::vector<std::thread> threads;
+		std::mutex mutex;              // guards the fields below
+		std::condition_variable wake, done;
+		std::function<void()> job;
+		long generation = 0;           // counts the jobs handed out
+		int active = 0;                // threads taking part in the job
+		int running = 0;               // of those, the ones not done yet
+		bool stop = false;
+
+		void wait_for_jobs(int t, long seen)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;)
+			{
+				wake.wait(lock, [&]() { return stop || (generation != seen); });
+				if (stop)
+					return;
+				seen = generation;
+				if (t >= active)
+					continue;
+				lock.unlock();
+				job();
+				lock.lock();
+				if (--running == 0)
+					done.notify_one();
+			}
+		}
+
+		void run(int helpers, const std::function<void()>& f)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				while ((int)threads.size() < helpers)
+					threads.push_back(std::thread(&sgp4catalogpool::wait_for_jobs, this, (int)threads.size(), generation));
+				job = f;
+				active = running = helpers;
+				generation++;
+			}
+			wake.notify_all();
+			f();
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [&]() { return running == 0; });
+		}
+
+		~sgp4catalogpool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			wake.notify_all();
+			for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+		}
+	};
+
+	// same reduction as in SGP4_batch.cpp
+	static inline double fmod2p(double x)
+	{
+		const double twopi = 2.0 * pi;
+		return x - twopi * trunc(x / twopi);
+	}
+
+	// sin and cos of a lane group in separate loops. if both are taken of the
+	// same angle in one loop gcc merges them into a sincos call, which has no
+	// vector version and stops the whole loop from vectorizing.
+	static inline void sin_lanes(const double a[], double s[])
+	{
+		for (int l = 0; l < SGP4_LANES; l++)
+			s[l] = sin(a[l]);
+	}
+
+	static inline void cos_lanes(const double a[], double c[])
+	{
+		for (int l = 0; l < SGP4_LANES; l++)
+			c[l] = cos(a[l]);
+	}
+
+	// output of one lane group. kept in a single struct so the compiler can
+	// tell the output arrays apart without runtime alias checks.
+	struct sgp4lanestate
+	{
+		double x[SGP4_LANES], y[SGP4_LANES], z[SGP4_LANES];
+		double vx[SGP4_LANES], vy[SGP4_LANES], vz[SGP4_LANES];
+		int err[SGP4_LANES];
+	};
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure sgp4_lanes
+	*
+	*  this procedure propagates one lane group of near earth satellites to the
+	*    julian date jd + jdF. templated on isimp like sgp4_block.
+	*
+	*  inputs        :
+	*    g           - lane group built by the sgp4catalog constructor
+	*    jd, jdF     - julian date, whole and fractional part
+	*
+	*  outputs       :
+	*    s           - per lane position (km), velocity (km/sec) and error code
+	*
+	*  coupling      :
+	*    none. the equations are copied from sgp4 with method == 'n'.
+	----------------------------------------------------------------------------*/
+
+	template <bool simple>
+	static void sgp4_lanes
+		(
+		const sgp4lanes& g, double jd, double jdF, sgp4lanestate& s
+		)
+	{
+		const int L = SGP4_LANES;
+		double am[L], nm[L], em[L], mm[L], argpm[L], nodep[L], axnl[L], aynl[L], u[L];
+		double eo1[L], tem5[L], se[L], ce[L], sineo1[L], coseo1[L];
+		double sinarg[L], cosarg[L], su[L], xnode[L], xinc[L], mrt[L], mvt[L], rvdot[L];
+		double sinsu[L], cossu[L], snod[L], cnod[L], sini[L], cosi[L];
+		int l, ktr, nact;
+
+		/* ---------- stage 1 : secular gravity and drag, long period terms ---------- */
+		for (l = 0; l < L; l++)
+		{
+			double t, t2, t3, t4, xmdf, argpdf, nodedf, nodem, tempa, tempe,
+				templ, delomg, delmtemp, delm, temp, xlm;
+			t = (jd - g.jdsatepoch[l]) * 1440.0 + (jdF - g.jdsatepochF[l]) * 1440.0;
+			xmdf = g.mo[l] + g.mdot[l] * t;
+			argpdf = g.argpo[l] + g.argpdot[l] * t;
+			nodedf = g.nodeo[l] + g.nodedot[l] * t;
+			argpm[l] = argpdf;
+			mm[l] = xmdf;
+			t2 = t * t;
+			nodem = nodedf + g.nodecf[l] * t2;
+			tempa = 1.0 - g.cc1[l] * t;
+			tempe = g.bcc4[l] * t;
+			templ = g.t2cof[l] * t2;
+
+			if (!simple)
+			{
+				delomg = g.omgcof[l] * t;
+				delmtemp = 1.0 + g.eta[l] * cos(xmdf);
+				delm = g.xmcof[l] * (delmtemp * delmtemp * delmtemp - g.delmo[l]);
+				temp = delomg + delm;
+				mm[l] = xmdf + temp;
+				argpm[l] = argpdf - temp;
+				t3 = t2 * t;
+				t4 = t3 * t;
+				tempa = tempa - g.d2[l] * t2 - g.d3[l] * t3 - g.d4[l] * t4;
+				tempe = tempe + g.bcc5[l] * (sin(mm[l]) - g.sinmao[l]);
+				templ = templ + g.t3cof[l] * t3 + t4 * (g.t4cof[l] + t * g.t5cof[l]);
+			}
+
+			am[l] = g.amcof[l] * tempa * tempa;
+			nm[l] = g.xke[l] / (am[l] * sqrt(am[l]));
+			em[l] = g.ecco[l] - tempe;
+			s.err[l] = (g.no_unkozai[l] <= 0.0) ? 2 : (((em[l] >= 1.0) || (em[l] < -0.001)) ? 1 : 0);
+			em[l] = (em[l] < 1.0e-6) ? 1.0e-6 : em[l];
+			mm[l] = mm[l] + g.no_unkozai[l] * templ;
+			xlm = mm[l] + argpm[l] + nodem;
+
+			nodep[l] = fmod2p(nodem);
+			argpm[l] = fmod2p(argpm[l]);
+			xlm = fmod2p(xlm);
+			mm[l] = fmod2p(xlm - argpm[l] - nodep[l]);
+		}
+
+		sin_lanes(argpm, sinarg);
+		cos_lanes(argpm, cosarg);
+		for (l = 0; l < L; l++)
+		{
+			double temp, xl;
+			axnl[l] = em[l] * cosarg[l];
+			temp = 1.0 / (am[l] * (1.0 - em[l] * em[l]));
+			aynl[l] = em[l] * sinarg[l] + temp * g.aycof[l];
+			xl = mm[l] + argpm[l] + nodep[l] + temp * g.xlcof[l] * axnl[l];
+			u[l] = fmod2p(xl - nodep[l]);
+		}
+
+		/* ----------------------- stage 2 : kepler's equation ----------------------- */
+		// every lane iterates until the slowest one converges, but a lane stops
+		// updating once it meets the sgp4 tolerance, so each lane ends on the
+		// same eccentric anomaly the scalar loop would
+		for (l = 0; l < L; l++)
+		{
+			eo1[l] = u[l];
+			tem5[l] = 9999.9;
+			sineo1[l] = coseo1[l] = 0.0;
+		}
+		for (ktr = 1; ktr <= 10; ktr++)
+		{
+			sin_lanes(eo1, se);
+			cos_lanes(eo1, ce);
+			nact = 0;
+			for (l = 0; l < L; l++)
+			{
+				const bool active = fabs(tem5[l]) >= 1.0e-12;
+				double dt;
+				dt = 1.0 - ce[l] * axnl[l] - se[l] * aynl[l];
+				dt = (u[l] - aynl[l] * ce[l] + axnl[l] * se[l] - eo1[l]) / dt;
+				dt = (dt > 0.95) ? 0.95 : ((dt < -0.95) ? -0.95 : dt);
+				sineo1[l] = active ? se[l] : sineo1[l];
+				coseo1[l] = active ? ce[l] : coseo1[l];
+				eo1[l] = active ? eo1[l] + dt : eo1[l];
+				tem5[l] = active ? dt : tem5[l];
+				nact += active;
+			}
+			if (nact == 0)
+				break;
+		}
+
+		/* ---------------- stage 3 : short period periodics and r, v ---------------- */
+		for (l = 0; l < L; l++)
+		{
+			double ecose, esine, el2, pl, rl, rdotl, rvdotl, betal, temp, temp1, temp2,
+				sinu, cosu, sin2u, cos2u;
+			ecose = axnl[l] * coseo1[l] + aynl[l] * sineo1[l];
+			esine = axnl[l] * sineo1[l] - aynl[l] * coseo1[l];
+			el2 = axnl[l] * axnl[l] + aynl[l] * aynl[l];
+			pl = am[l] * (1.0 - el2);
+
+			rl = am[l] * (1.0 - ecose);
+			rdotl = sqrt(am[l]) * esine / rl;
+			rvdotl = sqrt(pl) / rl;
+			betal = sqrt(1.0 - el2);
+			temp = esine / (1.0 + betal);
+			sinu = am[l] / rl * (sineo1[l] - aynl[l] - axnl[l] * temp);
+			cosu = am[l] / rl * (coseo1[l] - axnl[l] + aynl[l] * temp);
+			su[l] = atan2(sinu, cosu);
+			sin2u = (cosu + cosu) * sinu;
+			cos2u = 1.0 - 2.0 * sinu * sinu;
+			temp = 1.0 / pl;
+			temp1 = 0.5 * g.j2[l] * temp;
+			temp2 = temp1 * temp;
+
+			mrt[l] = rl * (1.0 - 1.5 * temp2 * betal * g.con41[l]) +
+				0.5 * temp1 * g.x1mth2[l] * cos2u;
+			su[l] = su[l] - 0.25 * temp2 * g.x7thm1[l] * sin2u;
+			xnode[l] = nodep[l] + 1.5 * temp2 * g.cosip[l] * sin2u;
+			xinc[l] = g.inclo[l] + 1.5 * temp2 * g.cosip[l] * g.sinip[l] * cos2u;
+			mvt[l] = rdotl - nm[l] * temp1 * g.x1mth2[l] * sin2u / g.xke[l];
+			rvdot[l] = rvdotl + nm[l] * temp1 * (g.x1mth2[l] * cos2u +
+				1.5 * g.con41[l]) / g.xke[l];
+
+			// same precedence as the early returns in sgp4
+			s.err[l] = (s.err[l] != 0) ? s.err[l] : ((pl < 0.0) ? 4 : ((mrt[l] < 1.0) ? 6 : 0));
+		}
+
+		sin_lanes(su, sinsu);
+		cos_lanes(su, cossu);
+		sin_lanes(xnode, snod);
+		cos_lanes(xnode, cnod);
+		sin_lanes(xinc, sini);
+		cos_lanes(xinc, cosi);
+		for (l = 0; l < L; l++)
+		{
+			double xmx, xmy, ux, uy, uz, wx, wy, wz, vkmpersec;
+			xmx = -snod[l] * cosi[l];
+			xmy = cnod[l] * cosi[l];
+			ux = xmx * sinsu[l] + cnod[l] * cossu[l];
+			uy = xmy * sinsu[l] + snod[l] * cossu[l];
+			uz = sini[l] * sinsu[l];
+			wx = xmx * cossu[l] - cnod[l] * sinsu[l];
+			wy = xmy * cossu[l] - snod[l] * sinsu[l];
+			wz = sini[l] * cossu[l];
+
+			vkmpersec = g.radiusearthkm[l] * g.xke[l] / 60.0;
+			s.x[l] = (mrt[l] * ux) * g.radiusearthkm[l];
+			s.y[l] = (mrt[l] * uy) * g.radiusearthkm[l];
+			s.z[l] = (mrt[l] * uz) * g.radiusearthkm[l];
+			s.vx[l] = (mvt[l] * ux + rvdot[l] * wx) * vkmpersec;
+			s.vy[l] = (mvt[l] * uy + rvdot[l] * wy) * vkmpersec;
+			s.vz[l] = (mvt[l] * uz + rvdot[l] * wz) * vkmpersec;
+		}
+	}  // sgp4_lanes
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure sgp4catalog
+	*
+	*  this procedure builds the catalog. near earth records are sorted by isimp
+	*    and copied field by field into lane groups, the last group of each kind
+	*    is padded with copies of its last satellite. deep space records are
+	*    kept as they are.
+	*
+	*  inputs        :
+	*    satrecs, n  - records initialised by sgp4init (or twoline2rv)
+	----------------------------------------------------------------------------*/
+
+	sgp4catalog::sgp4catalog(const std::vector<elsetrec>& satrecs)
+		: sgp4catalog(satrecs.data(), (int)satrecs.size())
+	{
+	}
+
+	sgp4catalog::sgp4catalog(const elsetrec* satrecs, int n)
+	{
+		const double x2o3 = 2.0 / 3.0;
+		int i, k, simp;
+
+		nsat = n;
+		for (simp = 0; simp <= 1; simp++)
+		{
+			std::vector<int> members;
+			for (i = 0; i < nsat; i++)
+				if ((satrecs[i].method != 'd') && (satrecs[i].isimp == simp))
+					members.push_back(i);
+
+			for (k = 0; k < (int)members.size(); k += SGP4_LANES)
+			{
+				sgp4lanes g;
+				g.isimp = simp;
+				for (int l = 0; l < SGP4_LANES; l++)
+				{
+					const bool pad = (k + l >= (int)members.size());
+					const elsetrec& s = satrecs[members[pad ? members.size() - 1 : k + l]];
+					g.index[l] = pad ? -1 : members[k + l];
+					g.jdsatepoch[l] = s.jdsatepoch;
+					g.jdsatepochF[l] = s.jdsatepochF;
+					g.mo[l] = s.mo;
+					g.mdot[l] = s.mdot;
+					g.argpo[l] = s.argpo;
+					g.argpdot[l] = s.argpdot;
+					g.nodeo[l] = s.nodeo;
+					g.nodedot[l] = s.nodedot;
+					g.nodecf[l] = s.nodecf;
+					g.cc1[l] = s.cc1;
+					g.bcc4[l] = s.bstar * s.cc4;
+					g.bcc5[l] = s.bstar * s.cc5;
+					g.t2cof[l] = s.t2cof;
+					g.t3cof[l] = s.t3cof;
+					g.t4cof[l] = s.t4cof;
+					g.t5cof[l] = s.t5cof;
+					g.omgcof[l] = s.omgcof;
+					g.eta[l] = s.eta;
+					g.xmcof[l] = s.xmcof;
+					g.delmo[l] = s.delmo;
+					g.d2[l] = s.d2;
+					g.d3[l] = s.d3;
+					g.d4[l] = s.d4;
+					g.sinmao[l] = s.sinmao;
+					g.no_unkozai[l] = s.no_unkozai;
+					g.ecco[l] = s.ecco;
+					g.inclo[l] = s.inclo;
+					g.aycof[l] = s.aycof;
+					g.xlcof[l] = s.xlcof;
+					g.con41[l] = s.con41;
+					g.x1mth2[l] = s.x1mth2;
+					g.x7thm1[l] = s.x7thm1;
+					g.xke[l] = s.xke;
+					g.j2[l] = s.j2;
+					g.radiusearthkm[l] = s.radiusearthkm;
+					g.amcof[l] = pow((s.xke / s.no_unkozai), x2o3);
+					g.sinip[l] = sin(s.inclo);
+					g.cosip[l] = cos(s.inclo);
+				}
+				groups.push_back(g);
+			}
+		}
+
+		for (i = 0; i < nsat; i++)
+			if (satrecs[i].method == 'd')
+			{
+				deep.push_back(satrecs[i]);
+				deepindex.push_back(i);
+			}
+	}  // sgp4catalog
+
+	sgp4catalog::sgp4catalog(const sgp4catalog& other)
+		: nsat(other.nsat), groups(other.groups), deep(other.deep), deepindex(other.deepindex)
+	{
+	}
+
+	sgp4catalog& sgp4catalog::operator=(const sgp4catalog& other)
+	{
+		nsat = other.nsat;
+		groups = other.groups;
+		deep = other.deep;
+		deepindex = other.deepindex;
+		return *this;
+	}
+
+	sgp4catalog::~sgp4catalog()
+	{
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure propagate
+	*
+	*  this procedure propagates the whole catalog to the julian date jd + jdF.
+	*    the lane groups and the deep space satellites form one list of work
+	*    items that the worker threads take from in chunks. the calling thread
+	*    works too, the other threads come from the pool of the catalog.
+	*
+	*  inputs        :
+	*    jd, jdF     - julian date, whole and fractional part
+	*    nthreads    - number of worker threads, <= 0 for one per core
+	*
+	*  outputs       :
+	*    x, y, z     - position components, input order    km
+	*    vx, vy, vz  - velocity components, input order    km/sec
+	*    err         - per satellite error code (see sgp4), may be NULL
+	*    return code - false if any satellite had an error
+	*
+	*  coupling      :
+	*    sgp4_lanes  - near earth propagation of one lane group
+	*    sgp4        - deep space propagation
+	----------------------------------------------------------------------------*/
+
+	bool sgp4catalog::propagate
+		(
+		double jd, double jdF,
+		double x[], double y[], double z[],
+		double vx[], double vy[], double vz[],
+		int err[], int nthreads
+		)
+	{
+		const int ngroups = (int)groups.size();
+		const int nwork = ngroups + (int)deep.size();
+		std::atomic<int> next(0), nerr(0);
+
+		auto worker = [&]()
+		{
+			sgp4lanestate ls;
+			double r[3], v[3];
+			int start, w, l, bad = 0;
+
+			while ((start = next.fetch_add(SGP4_CATALOG_CHUNK)) < nwork)
+			{
+				const int stop = (start + SGP4_CATALOG_CHUNK < nwork) ? start + SGP4_CATALOG_CHUNK : nwork;
+				for (w = start; w < stop; w++)
+				{
+					if (w < ngroups)
+					{
+						const sgp4lanes& g = groups[w];
+						if (g.isimp == 1)
+							sgp4_lanes<true>(g, jd, jdF, ls);
+						else
+							sgp4_lanes<false>(g, jd, jdF, ls);
+						for (l = 0; l < SGP4_LANES; l++)
+						{
+							const int i = g.index[l];
+							if (i < 0)
+								break;
+							x[i] = ls.x[l]; y[i] = ls.y[l]; z[i] = ls.z[l];
+							vx[i] = ls.vx[l]; vy[i] = ls.vy[l]; vz[i] = ls.vz[l];
+							if (err != NULL)
+								err[i] = ls.err[l];
+							bad += (ls.err[l] != 0);
+						}
+					}
+					else
+					{
+						elsetrec& s = deep[w - ngroups];
+						const int i = deepindex[w - ngroups];
+						double tsince = (jd - s.jdsatepoch) * 1440.0 + (jdF - s.jdsatepochF) * 1440.0;
+						sgp4(s, tsince, r, v);
+						x[i] = r[0]; y[i] = r[1]; z[i] = r[2];
+						vx[i] = v[0]; vy[i] = v[1]; vz[i] = v[2];
+						if (err != NULL)
+							err[i] = s.error;
+						bad += (s.error != 0);
+					}
+				}
+			}
+			nerr += bad;
+		};
+
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads > (nwork + SGP4_CATALOG_CHUNK - 1) / SGP4_CATALOG_CHUNK)
+			nthreads = (nwork + SGP4_CATALOG_CHUNK - 1) / SGP4_CATALOG_CHUNK;
+		if (nthreads < 1)
+			nthreads = 1;
+
+		// sgp4 writes to the deep space records, so calls on one catalog take
+		// turns, also when they run on the calling thread alone
+		std::lock_guard<std::mutex> lock(calls);
+		if (nthreads == 1)
+			worker();
+		else
+		{
+			if (!pool)
+				pool.reset(new sgp4catalogpool);
+			pool->run(nthreads - 1, worker);
+		}
+
+		return nerr == 0;
+	}  // propagate
+
+}  // namespace SGP4Funcs
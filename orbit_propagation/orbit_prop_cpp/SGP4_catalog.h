@@ -0,0 +1,96 @@
+#ifndef _SGP4_catalog_h_
+#define _SGP4_catalog_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_catalog.h
+*
+*    this file contains the catalog propagator. a set of initialized elsetrec
+*    records is transposed once into a structure of arrays layout, grouped in
+*    lane groups of SGP4_LANES satellites, and every satellite is propagated
+*    to a common julian date. near earth and deep space satellites are kept in
+*    separate groups so the lanes of a group never take different branches.
+*
+*       ----------------------------------------------------------------      */
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SGP4.h"
+
+// satellites per lane group. matches the number of doubles in one simd
+// register on the target (8 for avx-512, 4 for avx / avx2), so the loops over
+// a group map onto whole vector instructions.
+#ifndef SGP4_LANES
+#if defined(__AVX512F__)
+#define SGP4_LANES 8
+#else
+#define SGP4_LANES 4
+#endif
+#endif
+
+namespace SGP4Funcs
+{
+
+	// one lane group of near earth satellites, every field holds the value of
+	// the elsetrec field with the same name (bcc4, bcc5, amcof, sinip and cosip
+	// are the per satellite invariants hoisted out of sgp4)
+	struct sgp4lanes
+	{
+		double jdsatepoch[SGP4_LANES], jdsatepochF[SGP4_LANES];
+		double mo[SGP4_LANES], mdot[SGP4_LANES], argpo[SGP4_LANES], argpdot[SGP4_LANES];
+		double nodeo[SGP4_LANES], nodedot[SGP4_LANES], nodecf[SGP4_LANES];
+		double cc1[SGP4_LANES], bcc4[SGP4_LANES], bcc5[SGP4_LANES];
+		double t2cof[SGP4_LANES], t3cof[SGP4_LANES], t4cof[SGP4_LANES], t5cof[SGP4_LANES];
+		double omgcof[SGP4_LANES], eta[SGP4_LANES], xmcof[SGP4_LANES], delmo[SGP4_LANES];
+		double d2[SGP4_LANES], d3[SGP4_LANES], d4[SGP4_LANES], sinmao[SGP4_LANES];
+		double no_unkozai[SGP4_LANES], ecco[SGP4_LANES], inclo[SGP4_LANES];
+		double aycof[SGP4_LANES], xlcof[SGP4_LANES], con41[SGP4_LANES];
+		double x1mth2[SGP4_LANES], x7thm1[SGP4_LANES];
+		double xke[SGP4_LANES], j2[SGP4_LANES], radiusearthkm[SGP4_LANES];
+		double amcof[SGP4_LANES], sinip[SGP4_LANES], cosip[SGP4_LANES];
+		int index[SGP4_LANES];  // position of the satellite in the input, -1 for padding
+		int isimp;              // same for every lane of the group
+	};
+
+	// worker threads of a catalog, see SGP4_catalog.cpp
+	struct sgp4catalogpool;
+
+	class sgp4catalog
+	{
+	public:
+		sgp4catalog(const std::vector<elsetrec>& satrecs);
+		sgp4catalog(const elsetrec* satrecs, int n);
+		// a copy gets the satellites but not the worker threads, it starts its own
+		sgp4catalog(const sgp4catalog& other);
+		sgp4catalog& operator=(const sgp4catalog& other);
+		~sgp4catalog();
+
+		int size() const { return nsat; }
+
+		/* propagate every satellite to the julian date jd + jdF. outputs are in
+		   the order of the records given to the constructor. returns false if
+		   any satellite reported an error (see err, codes as in sgp4). nthreads
+		   <= 0 uses one thread per hardware core. the calling thread is one of
+		   them, the others are started by the first call that needs them and
+		   wait for the next call, so no threads are started per call. calls
+		   on one catalog from several threads take turns. */
+		bool propagate
+			(
+			double jd, double jdF,
+			double x[], double y[], double z[],
+			double vx[], double vy[], double vz[],
+			int err[], int nthreads = 0
+			);
+
+	private:
+		int nsat;
+		std::vector<sgp4lanes> groups;   // near earth, method 'n'
+		std::vector<elsetrec> deep;      // deep space, method 'd', propagated with sgp4
+		std::vector<int> deepindex;
+		std::unique_ptr<sgp4catalogpool> pool;
+		std::mutex calls;                // held by propagate, one call at a time
+	};
+
+}  // namespace
+
+#endif
@@ -0,0 +1,141 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_checkpoint.cpp
+*
+*    this file contains the checkpoint table of the deep space resonance
+*    integrator, see SGP4_checkpoint.h.
+*
+*    a checkpoint is filled in by seeding the record with the one before it
+*    and calling sgp4 right at the new checkpoint time, where dspace ends on
+*    an integrator step with nothing left over. each checkpoint costs one
+*    sgp4 call the first time it is reached, after that a query costs one
+*    sgp4 call with at most interval integrator steps.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+#include "SGP4_checkpoint.h"
+
+// integrator step of dspace                                               min
+#define SGP4_CHECKPOINT_STEP 720.0
+
+// most checkpoints kept on either side of epoch, beyond them dspace
+// integrates on from the last one
+#define SGP4_CHECKPOINT_MAX 1048576
+
+namespace SGP4Funcs
+{
+
+	sgp4checkpoints::sgp4checkpoints()
+		: every(1), span(SGP4_CHECKPOINT_STEP)
+	{
+		rec = elsetrec();
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4checkpoints::init
+	*
+	*  this function sets up an empty table for a record.
+	*
+	*  inputs        :
+	*    satrec      - record initialised by sgp4init (or twoline2rv)
+	*    interval    - integrator steps of 720 minutes between checkpoints
+	*
+	*  outputs       :
+	*    return code - false if interval is less than 1
+	----------------------------------------------------------------------------*/
+
+	bool sgp4checkpoints::init(const elsetrec& satrec, int interval)
+	{
+		ahead.clear();
+		behind.clear();
+		if (interval < 1)
+			return false;
+		rec = satrec;
+		every = interval;
+		span = every * SGP4_CHECKPOINT_STEP;
+		return true;
+	}  // init
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure sgp4checkpoints::seed
+	*
+	*  this procedure puts the integrator state at checkpoint k on one side of
+	*    epoch into the record, filling the table up to it first. checkpoint 0
+	*    is epoch itself, where atime = 0 makes dspace restart.
+	*
+	*  inputs        :
+	*    sign        - +1 after epoch, -1 before
+	*    k           - checkpoint, at sign * k * span minutes
+	*
+	*  coupling      :
+	*    sgp4
+	----------------------------------------------------------------------------*/
+
+	void sgp4checkpoints::seed(double sign, long k)
+	{
+		std::vector<double>& table = (sign > 0.0) ? ahead : behind;
+		double r[3], v[3];
+
+		while ((long)table.size() / 2 < k)
+		{
+			const long j = (long)table.size() / 2;
+			rec.atime = sign * j * span;
+			if (j > 0)
+			{
+				rec.xli = table[2 * j - 2];
+				rec.xni = table[2 * j - 1];
+			}
+			// the return code does not matter here, dspace has run before any check
+			sgp4(rec, sign * (j + 1) * span, r, v);
+			table.push_back(rec.xli);
+			table.push_back(rec.xni);
+		}
+
+		rec.atime = sign * k * span;
+		if (k > 0)
+		{
+			rec.xli = table[2 * k - 2];
+			rec.xni = table[2 * k - 1];
+		}
+	}  // seed
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4checkpoints::propagate
+	*
+	*  this function runs sgp4 from the nearest checkpoint at or before tsince.
+	*
+	*  inputs        :
+	*    tsince      - time since epoch                             min
+	*
+	*  outputs       :
+	*    r, v        - teme position and velocity                   km, km/s
+	*    return code - as sgp4, the error code is in satrec().error
+	*
+	*  coupling      :
+	*    sgp4
+	----------------------------------------------------------------------------*/
+
+	bool sgp4checkpoints::propagate(double tsince, double r[3], double v[3])
+	{
+		if ((rec.method != 'd') || (rec.irez == 0))
+			return sgp4(rec, tsince, r, v);
+
+		const double sign = (tsince < 0.0) ? -1.0 : 1.0;
+		double k = floor(fabs(tsince) / span);
+		// the division can round up onto the next checkpoint
+		if (k * span > fabs(tsince))
+			k = k - 1.0;
+		if (!(k >= 0.0))
+			k = 0.0;
+		if (k > SGP4_CHECKPOINT_MAX)
+			k = SGP4_CHECKPOINT_MAX;
+
+		seed(sign, (long)k);
+		return sgp4(rec, tsince, r, v);
+	}  // propagate
+
+}  // namespace SGP4Funcs
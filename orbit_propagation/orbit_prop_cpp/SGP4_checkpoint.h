@@ -0,0 +1,55 @@
+#ifndef _SGP4_checkpoint_h_
+#define _SGP4_checkpoint_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_checkpoint.h
+*
+*    this file contains the checkpoint table of the deep space resonance
+*    integrator. dspace integrates xli and xni in fixed 720 minute steps
+*    from epoch, and only carries on from the state left in the record
+*    (atime, xli, xni) when the new time lies further out on the same side
+*    of epoch, so queries in random order, or going back in time, pay for
+*    the whole integration from epoch on every call.
+*
+*    the table keeps the integrator state at every interval * 720 minutes on
+*    both sides of epoch, filled in as far as the queries have reached. a
+*    query starts dspace from the checkpoint at or before it (towards epoch),
+*    which is a state the integration from epoch passes through, so the
+*    results are bit for bit those of sgp4 on a record fresh from sgp4init.
+*
+*    only records with method 'd' and irez != 0 use the table, all others go
+*    straight to sgp4.
+*
+*       ----------------------------------------------------------------      */
+
+#include <vector>
+#include "SGP4.h"
+
+namespace SGP4Funcs
+{
+
+	class sgp4checkpoints
+	{
+	public:
+		sgp4checkpoints();
+
+		bool init(const elsetrec& satrec, int interval = 1);
+		bool propagate(double tsince, double r[3], double v[3]);
+
+		int checkpoints() const { return (int)(ahead.size() + behind.size()) / 2; }
+		int interval() const { return every; }
+		const elsetrec& satrec() const { return rec; }
+
+	private:
+		elsetrec rec;
+		int every;                    // integrator steps between checkpoints
+		double span;                  // every * 720                          min
+		std::vector<double> ahead;    // xli, xni at +k * span for k = 1, 2, ...
+		std::vector<double> behind;   // xli, xni at -k * span for k = 1, 2, ...
+
+		void seed(double sign, long k);
+	};
+
+}  // namespace
+
+#endif
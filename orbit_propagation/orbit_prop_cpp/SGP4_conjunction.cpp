@@ -0,0 +1,461 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_conjunction.cpp
+*
+*    this file contains the close approach screening. the coarse grid is
+*    propagated with sgp4catalog, the refinement uses sgp4 on copies of the
+*    two records of a pair.
+*
+*    every grid step k stands for the window of half a step on either side
+*    of it. within the window the relative motion of a pair is taken as
+*    linear, and a pair is a candidate when the closest approach of that
+*    line is within the threshold plus the largest error of the linear
+*    model, half the relative gravitational acceleration (at most 2 mu/re^2)
+*    times the half step squared. the steps where a candidate's linear miss
+*    distance has a local minimum bracket the closest approach to within one
+*    step on either side.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "SGP4_conjunction.h"
+#include "SGP4_catalog.h"
+#include "SGP4_search.h"
+
+// grid steps a worker takes per visit to the shared counter. consecutive steps
+// keep the deep space integrator of each worker moving forward.
+#define SGP4_CONJUNCTION_CHUNK 32
+
+// head room on the speed bound, for the change of speed within half a step
+#define SGP4_CONJUNCTION_MARGIN 1.05
+
+// upper bound on the relative acceleration of two objects above the surface,
+// 2 mu / re^2 with the wgs-72 values                                  km/s^2
+#define SGP4_CONJUNCTION_MAXACCEL 0.0196
+
+// bits per axis of a spatial hash key
+#define SGP4_HASH_BITS 21
+
+namespace SGP4Funcs
+{
+
+	// a pair that may pass within the threshold in the window of grid step k,
+	// d is the miss distance of the linear relative motion in the window
+	struct candidate
+	{
+		int i, j, k;
+		double d;
+	};
+
+	// the states of one grid step
+	struct gridstep
+	{
+		const double *x, *y, *z, *vx, *vy, *vz;
+		const double* speed;     // negative for objects to skip
+		int k;
+		bool primary;            // keep p, q in the order given instead of i < j
+		double threshold;        // km
+		double halfstep;         // s
+		double pad;              // error of the linear model over the half step, km
+	};
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure check_pair
+	*
+	*  this procedure tests one pair at a grid step. pairs farther apart than
+	*    their speeds can close in half a step are dropped on distance alone,
+	*    the rest by the closest approach of their linear relative motion over
+	*    the window of the step.
+	*
+	*  inputs        :
+	*    g           - states of the grid step
+	*    p, q        - the pair
+	*
+	*  outputs       :
+	*    cands       - the pair is appended if it is a candidate
+	----------------------------------------------------------------------------*/
+
+	static inline void check_pair(const gridstep& g, int p, int q, std::vector<candidate>& cands)
+	{
+		const double dx = g.x[q] - g.x[p], dy = g.y[q] - g.y[p], dz = g.z[q] - g.z[p];
+		const double reach = g.threshold + g.pad + g.halfstep * (g.speed[p] + g.speed[q]) * SGP4_CONJUNCTION_MARGIN;
+		const double d2 = dx * dx + dy * dy + dz * dz;
+		if (d2 > reach * reach)
+			return;
+
+		const double dvx = g.vx[q] - g.vx[p], dvy = g.vy[q] - g.vy[p], dvz = g.vz[q] - g.vz[p];
+		const double v2 = dvx * dvx + dvy * dvy + dvz * dvz;
+		double tau = (v2 > 0.0) ? -(dx * dvx + dy * dvy + dz * dvz) / v2 : 0.0;
+		if (tau > g.halfstep)
+			tau = g.halfstep;
+		if (tau < -g.halfstep)
+			tau = -g.halfstep;
+		const double mx = dx + dvx * tau, my = dy + dvy * tau, mz = dz + dvz * tau;
+		const double m2 = mx * mx + my * my + mz * mz;
+		const double dmax = g.threshold + g.pad;
+		if (m2 > dmax * dmax)
+			return;
+
+		candidate c;
+		c.i = g.primary ? p : std::min(p, q);
+		c.j = g.primary ? q : std::max(p, q);
+		c.k = g.k;
+		c.d = sqrt(m2);
+		cands.push_back(c);
+	}  // check_pair
+
+	static bool candidate_order(const candidate& a, const candidate& b)
+	{
+		if (a.i != b.i)
+			return a.i < b.i;
+		if (a.j != b.j)
+			return a.j < b.j;
+		return a.k < b.k;
+	}
+
+	static bool event_order(const conjunction& a, const conjunction& b)
+	{
+		if (a.tca != b.tca)
+			return a.tca < b.tca;
+		if (a.i != b.i)
+			return a.i < b.i;
+		return a.j < b.j;
+	}
+
+	// cell of one coordinate, clamped so far away objects share the edge cells
+	static inline int64_t hash_cell(double x, double h)
+	{
+		const int64_t half = (int64_t)1 << (SGP4_HASH_BITS - 1);
+		double c = floor(x / h);
+		if (c < (double)-half)
+			return 0;
+		if (c > (double)(half - 1))
+			return 2 * half - 1;
+		return (int64_t)c + half;
+	}
+
+	static inline uint64_t hash_key(int64_t cx, int64_t cy, int64_t cz)
+	{
+		return ((uint64_t)cx << (2 * SGP4_HASH_BITS)) | ((uint64_t)cy << SGP4_HASH_BITS) | (uint64_t)cz;
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function pair_state
+	*
+	*  this function propagates both records of a pair to a common time and
+	*    returns their relative position and velocity.
+	*
+	*  inputs        :
+	*    a, b        - copies of the two records
+	*    jd0, jd0F   - start of the screening, julian date
+	*    t           - minutes past jd0 + jd0F
+	*
+	*  outputs       :
+	*    dr, dv      - position and velocity of b relative to a     km, km/s
+	*    return code - false if sgp4 failed for either record
+	----------------------------------------------------------------------------*/
+
+	static bool pair_state
+		(
+		elsetrec& a, elsetrec& b, double jd0, double jd0F, double t,
+		double dr[3], double dv[3]
+		)
+	{
+		double ra[3], va[3], rb[3], vb[3];
+		bool oka = sgp4(a, (jd0 - a.jdsatepoch) * 1440.0 + (jd0F - a.jdsatepochF) * 1440.0 + t, ra, va);
+		bool okb = sgp4(b, (jd0 - b.jdsatepoch) * 1440.0 + (jd0F - b.jdsatepochF) * 1440.0 + t, rb, vb);
+		for (int c = 0; c < 3; c++)
+		{
+			dr[c] = rb[c] - ra[c];
+			dv[c] = vb[c] - va[c];
+		}
+		return oka && okb && (a.error == 0) && (b.error == 0);
+	}  // pair_state
+
+	// squared range of a pair, the function brent_min works on
+	struct pairrange
+	{
+		elsetrec a, b;
+		double jd0, jd0F;
+
+		double operator()(double t)
+		{
+			double dr[3], dv[3];
+			if (!pair_state(a, b, jd0, jd0F, t, dr, dv))
+				return 1.0e300;
+			return dr[0] * dr[0] + dr[1] * dr[1] + dr[2] * dr[2];
+		}
+	};
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure hash_candidates
+	*
+	*  this procedure finds the candidate pairs of one grid step. positions are
+	*    binned into cubic cells as large as the largest distance check_pair
+	*    looks at, so both members of a candidate pair are in the same or in
+	*    neighbouring cells. the objects are sorted by cell key (x, y, z), which
+	*    puts the three neighbouring cells of a row next to each other, so
+	*    each cell is compared with itself, the next cell of its own row and
+	*    three cells of each of the four rows after it with one cursor per row
+	*    that only moves forward. that visits every pair of neighbouring cells
+	*    once without a hash table.
+	*
+	*  inputs        :
+	*    g           - states of the grid step
+	*    n           - number of objects
+	*    keys        - work space, reused between steps
+	*
+	*  outputs       :
+	*    cands       - candidates are appended
+	----------------------------------------------------------------------------*/
+
+	static void hash_candidates
+		(
+		const gridstep& g, int n,
+		std::vector<std::pair<uint64_t, int> >& keys,
+		std::vector<candidate>& cands
+		)
+	{
+		const int64_t ncell = (int64_t)1 << SGP4_HASH_BITS;
+		const int rowdx[4] = { 0, 1, 1, 1 };
+		const int rowdy[4] = { 1, -1, 0, 1 };
+		int cursor[4] = { 0, 0, 0, 0 };
+		double smax = 0.0;
+		int i, r;
+
+		keys.clear();
+		for (i = 0; i < n; i++)
+			smax = std::max(smax, g.speed[i]);
+		const double h = g.threshold + g.pad + g.halfstep * 2.0 * smax * SGP4_CONJUNCTION_MARGIN;
+		for (i = 0; i < n; i++)
+			if (g.speed[i] >= 0.0)
+				keys.push_back(std::make_pair(hash_key(hash_cell(g.x[i], h), hash_cell(g.y[i], h), hash_cell(g.z[i], h)), i));
+		std::sort(keys.begin(), keys.end());
+
+		const int nkeys = (int)keys.size();
+		for (int start = 0; start < nkeys; )
+		{
+			const uint64_t key = keys[start].first;
+			int stop = start + 1;
+			while ((stop < nkeys) && (keys[stop].first == key))
+				stop++;
+
+			const int64_t cx = (int64_t)(key >> (2 * SGP4_HASH_BITS));
+			const int64_t cy = (int64_t)((key >> SGP4_HASH_BITS) & (ncell - 1));
+			const int64_t cz = (int64_t)(key & (ncell - 1));
+
+			// own cell, and the next cell of the row, which follows it directly
+			for (int a = start; a < stop; a++)
+			{
+				for (int b = a + 1; b < stop; b++)
+					check_pair(g, keys[a].second, keys[b].second, cands);
+				if (cz + 1 < ncell)
+					for (int b = stop; (b < nkeys) && (keys[b].first == key + 1); b++)
+						check_pair(g, keys[a].second, keys[b].second, cands);
+			}
+
+			// cells z - 1 to z + 1 of the rows (x, y + 1), (x + 1, y - 1), (x + 1, y), (x + 1, y + 1)
+			for (r = 0; r < 4; r++)
+			{
+				const int64_t nx = cx + rowdx[r], ny = cy + rowdy[r];
+				if ((nx >= ncell) || (ny < 0) || (ny >= ncell))
+					continue;
+				const uint64_t lo = hash_key(nx, ny, (cz > 0) ? cz - 1 : 0);
+				const uint64_t hi = hash_key(nx, ny, (cz + 1 < ncell) ? cz + 1 : cz);
+				while ((cursor[r] < nkeys) && (keys[cursor[r]].first < lo))
+					cursor[r]++;
+				for (int a = start; a < stop; a++)
+					for (int b = cursor[r]; (b < nkeys) && (keys[b].first <= hi); b++)
+						check_pair(g, keys[a].second, keys[b].second, cands);
+			}
+			start = stop;
+		}
+	}  // hash_candidates
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function screen_conjunctions
+	*
+	*  this function screens a set of satellites for close approaches over a
+	*    time span. the grid steps are shared out to worker threads, each with
+	*    its own copy of the catalog, then the local minima of every candidate
+	*    pair are refined on the same threads.
+	*
+	*  inputs        :
+	*    satrecs, n  - records initialised by sgp4init (or twoline2rv)
+	*    jd0, jd0F   - start of the screening, julian date
+	*    span        - length of the screening                  min
+	*    step        - coarse grid step                         min
+	*    threshold   - report approaches closer than this       km
+	*    primary     - index of the one satellite to screen against all others,
+	*                  -1 to screen all pairs
+	*    nthreads    - number of worker threads, <= 0 for one per core
+	*
+	*  outputs       :
+	*    events      - close approaches sorted by tca
+	*    return code - false if an argument is out of range
+	*
+	*  coupling      :
+	*    sgp4catalog, hash_candidates, check_pair, brent_min
+	*
+	*  the grid step trades propagations for work per step. the hash cells
+	*    grow with the step by the fastest speed in the catalog, the slack of
+	*    the linear model with its square (0.25 km at 10 s, 9 km at 1 min),
+	*    and the brackets assume a pair does not pass twice within two steps,
+	*    so steps of a few seconds to a minute work best.
+	----------------------------------------------------------------------------*/
+
+	bool screen_conjunctions
+		(
+		const elsetrec* satrecs, int n, double jd0, double jd0F,
+		double span, double step, double threshold,
+		std::vector<conjunction>& events, int primary, int nthreads
+		)
+	{
+		events.clear();
+		if ((n < 0) || (span < 0.0) || !(step > 0.0) || !(threshold >= 0.0) || (primary < -1) || (primary >= n))
+			return false;
+		if (n < 2)
+			return true;
+
+		const sgp4catalog catalog(satrecs, n);
+		const int nsteps = (int)floor(span / step) + 1;
+		const double halfstep = 0.5 * step * 60.0;
+
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads > (nsteps + SGP4_CONJUNCTION_CHUNK - 1) / SGP4_CONJUNCTION_CHUNK)
+			nthreads = (nsteps + SGP4_CONJUNCTION_CHUNK - 1) / SGP4_CONJUNCTION_CHUNK;
+		if (nthreads < 1)
+			nthreads = 1;
+
+		// coarse grid
+		std::vector<std::vector<candidate> > found(nthreads);
+		std::atomic<int> next(0);
+
+		auto grid_worker = [&](int id)
+		{
+			sgp4catalog cat(catalog);
+			std::vector<double> x(n), y(n), z(n), vx(n), vy(n), vz(n), speed(n);
+			std::vector<int> err(n);
+			std::vector<std::pair<uint64_t, int> > keys;
+			std::vector<candidate>& cands = found[id];
+			gridstep g;
+			int start, k, i;
+
+			g.x = x.data(); g.y = y.data(); g.z = z.data();
+			g.vx = vx.data(); g.vy = vy.data(); g.vz = vz.data();
+			g.speed = speed.data();
+			g.primary = (primary >= 0);
+			g.threshold = threshold;
+			g.halfstep = halfstep;
+			g.pad = 0.5 * SGP4_CONJUNCTION_MAXACCEL * halfstep * halfstep;
+
+			while ((start = next.fetch_add(SGP4_CONJUNCTION_CHUNK)) < nsteps)
+			{
+				const int stop = std::min(start + SGP4_CONJUNCTION_CHUNK, nsteps);
+				for (k = start; k < stop; k++)
+				{
+					cat.propagate(jd0, jd0F + k * step / 1440.0, x.data(), y.data(), z.data(),
+						vx.data(), vy.data(), vz.data(), err.data(), 1);
+					for (i = 0; i < n; i++)
+						speed[i] = (err[i] == 0) ? sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]) : -1.0;
+
+					g.k = k;
+					if (primary < 0)
+						hash_candidates(g, n, keys, cands);
+					else if (speed[primary] >= 0.0)
+						for (i = 0; i < n; i++)
+							if ((i != primary) && (speed[i] >= 0.0))
+								check_pair(g, primary, i, cands);
+				}
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (int t = 1; t < nthreads; t++)
+			pool.push_back(std::thread(grid_worker, t));
+		grid_worker(0);
+		for (size_t t = 0; t < pool.size(); t++)
+			pool[t].join();
+		pool.clear();
+
+		std::vector<candidate> cands;
+		for (int t = 0; t < nthreads; t++)
+		{
+			cands.insert(cands.end(), found[t].begin(), found[t].end());
+			std::vector<candidate>().swap(found[t]);
+		}
+		std::sort(cands.begin(), cands.end(), candidate_order);
+
+		// local minima of the miss distance of each pair over consecutive
+		// steps. a step without the pair counts as farther than any with it.
+		std::vector<candidate> minima;
+		for (size_t c = 0; c < cands.size(); c++)
+		{
+			const candidate& a = cands[c];
+			bool prev = (c > 0) && (cands[c - 1].i == a.i) && (cands[c - 1].j == a.j) && (cands[c - 1].k == a.k - 1);
+			bool succ = (c + 1 < cands.size()) && (cands[c + 1].i == a.i) && (cands[c + 1].j == a.j) &&
+				(cands[c + 1].k == a.k + 1);
+			if ((!prev || (a.d <= cands[c - 1].d)) && (!succ || (a.d < cands[c + 1].d)))
+				minima.push_back(a);
+		}
+		std::vector<candidate>().swap(cands);
+
+		// refinement
+		const int nmin = (int)minima.size();
+		std::vector<std::vector<conjunction> > refined(nthreads);
+		next = 0;
+
+		auto refine_worker = [&](int id)
+		{
+			pairrange f;
+			double dr[3], dv[3], f2;
+			int start, m;
+
+			f.jd0 = jd0;
+			f.jd0F = jd0F;
+			while ((start = next.fetch_add(SGP4_CONJUNCTION_CHUNK)) < nmin)
+			{
+				const int stop = std::min(start + SGP4_CONJUNCTION_CHUNK, nmin);
+				for (m = start; m < stop; m++)
+				{
+					const candidate& c = minima[m];
+					f.a = satrecs[c.i];
+					f.b = satrecs[c.j];
+					const double a = std::max(0.0, (c.k - 1) * step);
+					const double b = std::min(span, (c.k + 1) * step);
+					const double tca = brent_min(f, a, b, 1.0e-6, f2);
+					if ((f2 > threshold * threshold) || !pair_state(f.a, f.b, jd0, jd0F, tca, dr, dv))
+						continue;
+					conjunction e;
+					e.i = c.i;
+					e.j = c.j;
+					e.tca = tca;
+					e.dmin = sqrt(f2);
+					e.vrel = sqrt(dv[0] * dv[0] + dv[1] * dv[1] + dv[2] * dv[2]);
+					refined[id].push_back(e);
+				}
+			}
+		};
+
+		for (int t = 1; t < nthreads; t++)
+			pool.push_back(std::thread(refine_worker, t));
+		refine_worker(0);
+		for (size_t t = 0; t < pool.size(); t++)
+			pool[t].join();
+
+		for (int t = 0; t < nthreads; t++)
+			events.insert(events.end(), refined[t].begin(), refined[t].end());
+		std::sort(events.begin(), events.end(), event_order);
+		return true;
+	}  // screen_conjunctions
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,39 @@
+#ifndef _SGP4_conjunction_h_
+#define _SGP4_conjunction_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_conjunction.h
+*
+*    this file contains the close approach screening. the catalog is
+*    propagated on a coarse time grid, every grid step the positions are
+*    binned into a uniform spatial hash and only objects in neighbouring cells
+*    are compared. pairs that come close enough are refined with a brent
+*    search on their range to give the time and distance of closest approach.
+*
+*       ----------------------------------------------------------------      */
+
+#include <vector>
+#include "SGP4.h"
+
+namespace SGP4Funcs
+{
+
+	// one close approach
+	struct conjunction
+	{
+		int i, j;       // record indices, i < j (i is the primary when one is given)
+		double tca;     // time of closest approach, minutes past jd0 + jd0F
+		double dmin;    // miss distance                                       km
+		double vrel;    // relative speed at tca                               km/s
+	};
+
+	bool screen_conjunctions
+		(
+		const elsetrec* satrecs, int n, double jd0, double jd0F,
+		double span, double step, double threshold,
+		std::vector<conjunction>& events, int primary = -1, int nthreads = 0
+		);
+
+}  // namespace
+
+#endif
@@ -0,0 +1,2060 @@
+#ifndef _SGP4_core_h_
+#define _SGP4_core_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_core.h
+*
+*    this file contains the sgp4 core (initl, dscom, dpper, dsinit, dspace,
+*    sgp4init and sgp4) templated on the scalar type T of the element set
+*    and of the propagated state. sgp4init and sgp4 in SGP4.cpp are the
+*    double instantiation on elsetrec. elsetrec_t<float> gives a single
+*    precision propagator for flight code that has no double precision fpu,
+*    elsetrec_t<dual<N> > (SGP4_dual.h) propagates partials with the state.
+*
+*    the epoch (days from jan 0, 1950) and the sidereal time computed from
+*    it are always double, single precision would put them out by minutes.
+*    every constant is written T(...), so the float instantiation does not
+*    promote to double anywhere else.
+*
+*    the functions need sin, cos, sqrt, pow, fabs, fmod, atan2 and floor
+*    for T, the comparison operators, and conversions from double and int.
+*
+*       ----------------------------------------------------------------      */
+
+#include <cmath>
+#include "SGP4.h"
+
+// pi is taken back out at the end, so it does not leak into later headers
+#ifndef pi
+#define pi 3.14159265358979323846
+#define SGP4_CORE_PI
+#endif
+
+namespace SGP4Funcs
+{
+
+	using std::sin;
+	using std::cos;
+	using std::sqrt;
+	using std::pow;
+	using std::fabs;
+	using std::fmod;
+	using std::atan2;
+	using std::floor;
+
+	// the fields of elsetrec that sgp4init and sgp4 use, in T. the epoch
+	// julian date stays double, as in elsetrec.
+	template <typename T>
+	struct elsetrec_t
+	{
+		long int  satnum;
+		int       error;
+		char      operationmode;
+		char      init, method;
+
+		/* Near Earth */
+		int    isimp;
+		T      aycof  , con41  , cc1    , cc4      , cc5    , d2      , d3   , d4    ,
+		       delmo  , eta    , argpdot, omgcof   , sinmao , t       , t2cof, t3cof ,
+		       t4cof  , t5cof  , x1mth2 , x7thm1   , mdot   , nodedot, xlcof , xmcof ,
+		       nodecf;
+
+		/* Deep Space */
+		int    irez;
+		T      d2201  , d2211  , d3210  , d3222    , d4410  , d4422   , d5220 , d5232 ,
+		       d5421  , d5433  , dedt   , del1     , del2   , del3    , didt  , dmdt  ,
+		       dnodt  , domdt  , e3     , ee2      , peo    , pgho    , pho   , pinco ,
+		       plo    , se2    , se3    , sgh2     , sgh3   , sgh4    , sh2   , sh3   ,
+		       si2    , si3    , sl2    , sl3      , sl4    , gsto    , xfact , xgh2  ,
+		       xgh3   , xgh4   , xh2    , xh3      , xi2    , xi3     , xl2   , xl3   ,
+		       xl4    , xlamo  , zmol   , zmos     , atime  , xli     , xni;
+
+		T      a, altp, alta, nddot, ndot, bstar, inclo, nodeo, ecco, argpo, mo, no_kozai;
+		double jdsatepoch, jdsatepochF;
+		T      no_unkozai;
+		T      am     , em     , im     , Om       , om     , mm      , nm;
+		T      tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+	};
+
+	template <typename T, typename rec>
+	bool sgp4_t
+		(
+		rec& satrec, T tsince,
+		T r[3], T v[3]
+		);
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure dpper
+	*
+	*  this procedure provides deep space long period periodic contributions
+	*    to the mean elements.  by design, these periodics are zero at epoch.
+	*    this used to be dscom which included initialization, but it's really a
+	*    recurring function.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    e3          -
+	*    ee2         -
+	*    peo         -
+	*    pgho        -
+	*    pho         -
+	*    pinco       -
+	*    plo         -
+	*    se2 , se3 , sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2, sl3, sl4 -
+	*    t           -
+	*    xh2, xh3, xi2, xi3, xl2, xl3, xl4 -
+	*    zmol        -
+	*    zmos        -
+	*    ep          - eccentricity                           0.0 - 1.0
+	*    inclo       - inclination - needed for lyddane modification
+	*    nodep       - right ascension of ascending node
+	*    argpp       - argument of perigee
+	*    mp          - mean anomaly
+	*
+	*  outputs       :
+	*    ep          - eccentricity                           0.0 - 1.0
+	*    inclp       - inclination
+	*    nodep        - right ascension of ascending node
+	*    argpp       - argument of perigee
+	*    mp          - mean anomaly
+	*
+	*  locals        :
+	*    alfdp       -
+	*    betdp       -
+	*    cosip  , sinip  , cosop  , sinop  ,
+	*    dalf        -
+	*    dbet        -
+	*    dls         -
+	*    f2, f3      -
+	*    pe          -
+	*    pgh         -
+	*    ph          -
+	*    pinc        -
+	*    pl          -
+	*    sel   , ses   , sghl  , sghs  , shl   , shs   , sil   , sinzf , sis   ,
+	*    sll   , sls
+	*    xls         -
+	*    xnoh        -
+	*    zf          -
+	*    zm          -
+	*
+	*  coupling      :
+	*    none.
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	void dpper
+		(
+		T e3, T ee2, T peo, T pgho, T pho,
+		T pinco, T plo, T se2, T se3, T sgh2,
+		T sgh3, T sgh4, T sh2, T sh3, T si2,
+		T si3, T sl2, T sl3, T sl4, T t,
+		T xgh2, T xgh3, T xgh4, T xh2, T xh3,
+		T xi2, T xi3, T xl2, T xl3, T xl4,
+		T zmol, T zmos, T inclo,
+		char init,
+		T& ep, T& inclp, T& nodep, T& argpp, T& mp,
+		char opsmode
+		)
+	{
+		/* --------------------- local variables ------------------------ */
+		const T twopi = T(2.0) * T(pi);
+		T alfdp, betdp, cosip, cosop, dalf, dbet, dls,
+			f2, f3, pe, pgh, ph, pinc, pl,
+			sel, ses, sghl, sghs, shll, shs, sil,
+			sinip, sinop, sinzf, sis, sll, sls, xls,
+			xnoh, zf, zm, zel, zes, znl, zns;
+
+		/* ---------------------- constants ----------------------------- */
+		zns = T(1.19459e-5);
+		zes = T(0.01675);
+		znl = T(1.5835218e-4);
+		zel = T(0.05490);
+
+		/* --------------- calculate time varying periodics ----------- */
+		zm = zmos + zns * t;
+		// be sure that the initial call has time set to zero
+		if (init == 'y')
+			zm = zmos;
+		zf = zm + T(2.0) * zes * sin(zm);
+		sinzf = sin(zf);
+		f2 = T(0.5) * sinzf * sinzf - T(0.25);
+		f3 = -T(0.5) * sinzf * cos(zf);
+		ses = se2* f2 + se3 * f3;
+		sis = si2 * f2 + si3 * f3;
+		sls = sl2 * f2 + sl3 * f3 + sl4 * sinzf;
+		sghs = sgh2 * f2 + sgh3 * f3 + sgh4 * sinzf;
+		shs = sh2 * f2 + sh3 * f3;
+		zm = zmol + znl * t;
+		if (init == 'y')
+			zm = zmol;
+		zf = zm + T(2.0) * zel * sin(zm);
+		sinzf = sin(zf);
+		f2 = T(0.5) * sinzf * sinzf - T(0.25);
+		f3 = -T(0.5) * sinzf * cos(zf);
+		sel = ee2 * f2 + e3 * f3;
+		sil = xi2 * f2 + xi3 * f3;
+		sll = xl2 * f2 + xl3 * f3 + xl4 * sinzf;
+		sghl = xgh2 * f2 + xgh3 * f3 + xgh4 * sinzf;
+		shll = xh2 * f2 + xh3 * f3;
+		pe = ses + sel;
+		pinc = sis + sil;
+		pl = sls + sll;
+		pgh = sghs + sghl;
+		ph = shs + shll;
+
+		if (init == 'n')
+		{
+			pe = pe - peo;
+			pinc = pinc - pinco;
+			pl = pl - plo;
+			pgh = pgh - pgho;
+			ph = ph - pho;
+			inclp = inclp + pinc;
+			ep = ep + pe;
+			sinip = sin(inclp);
+			cosip = cos(inclp);
+
+			/* ----------------- apply periodics directly ------------ */
+			//  sgp4fix for lyddane choice
+			//  strn3 used original inclination - this is technically feasible
+			//  gsfc used perturbed inclination - also technically feasible
+			//  probably best to readjust the 0.2 limit value and limit discontinuity
+			//  0.2 rad = 11.45916 deg
+			//  use next line for original strn3 approach and original inclination
+			//  if (inclo >= 0.2)
+			//  use next line for gsfc version and perturbed inclination
+			if (inclp >= T(0.2))
+			{
+				ph = ph / sinip;
+				pgh = pgh - cosip * ph;
+				argpp = argpp + pgh;
+				nodep = nodep + ph;
+				mp = mp + pl;
+			}
+			else
+			{
+				/* ---- apply periodics with lyddane modification ---- */
+				sinop = sin(nodep);
+				cosop = cos(nodep);
+				alfdp = sinip * sinop;
+				betdp = sinip * cosop;
+				dalf = ph * cosop + pinc * cosip * sinop;
+				dbet = -ph * sinop + pinc * cosip * cosop;
+				alfdp = alfdp + dalf;
+				betdp = betdp + dbet;
+				nodep = fmod(nodep, twopi);
+				//  sgp4fix for afspc written intrinsic functions
+				// nodep used without a trigonometric function ahead
+				if ((nodep < T(0.0)) && (opsmode == 'a'))
+					nodep = nodep + twopi;
+				xls = mp + argpp + cosip * nodep;
+				dls = pl + pgh - pinc * nodep * sinip;
+				xls = xls + dls;
+				xnoh = nodep;
+				nodep = atan2(alfdp, betdp);
+				//  sgp4fix for afspc written intrinsic functions
+				// nodep used without a trigonometric function ahead
+				if ((nodep < T(0.0)) && (opsmode == 'a'))
+					nodep = nodep + twopi;
+				if (fabs(xnoh - nodep) > T(pi))
+					if (nodep < xnoh)
+						nodep = nodep + twopi;
+					else
+						nodep = nodep - twopi;
+				mp = mp + pl;
+				argpp = xls - mp - cosip * nodep;
+			}
+		}   // if init == 'n'
+
+		//#include "debug1.cpp"
+	}  // dpper
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                           procedure dscom
+	*
+	*  this procedure provides deep space common items used by both the secular
+	*    and periodics subroutines.  input is provided as shown. this routine
+	*    used to be called dpper, but the functions inside weren't well organized.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    epoch       -
+	*    ep          - eccentricity
+	*    argpp       - argument of perigee
+	*    tc          -
+	*    inclp       - inclination
+	*    nodep       - right ascension of ascending node
+	*    np          - mean motion
+	*
+	*  outputs       :
+	*    sinim  , cosim  , sinomm , cosomm , snodm  , cnodm
+	*    day         -
+	*    e3          -
+	*    ee2         -
+	*    em          - eccentricity
+	*    emsq        - eccentricity squared
+	*    gam         -
+	*    peo         -
+	*    pgho        -
+	*    pho         -
+	*    pinco       -
+	*    plo         -
+	*    rtemsq      -
+	*    se2, se3         -
+	*    sgh2, sgh3, sgh4        -
+	*    sh2, sh3, si2, si3, sl2, sl3, sl4         -
+	*    s1, s2, s3, s4, s5, s6, s7          -
+	*    ss1, ss2, ss3, ss4, ss5, ss6, ss7, sz1, sz2, sz3         -
+	*    sz11, sz12, sz13, sz21, sz22, sz23, sz31, sz32, sz33        -
+	*    xgh2, xgh3, xgh4, xh2, xh3, xi2, xi3, xl2, xl3, xl4         -
+	*    nm          - mean motion
+	*    z1, z2, z3, z11, z12, z13, z21, z22, z23, z31, z32, z33         -
+	*    zmol        -
+	*    zmos        -
+	*
+	*  locals        :
+	*    a1, a2, a3, a4, a5, a6, a7, a8, a9, a10         -
+	*    betasq      -
+	*    cc          -
+	*    ctem, stem        -
+	*    x1, x2, x3, x4, x5, x6, x7, x8          -
+	*    xnodce      -
+	*    xnoi        -
+	*    zcosg  , zsing  , zcosgl , zsingl , zcosh  , zsinh  , zcoshl , zsinhl ,
+	*    zcosi  , zsini  , zcosil , zsinil ,
+	*    zx          -
+	*    zy          -
+	*
+	*  coupling      :
+	*    none.
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	void dscom
+		(
+		double epoch, T ep, T argpp, T tc, T inclp,
+		T nodep, T np,
+		T& snodm, T& cnodm, T& sinim, T& cosim, T& sinomm,
+		T& cosomm, T& day, T& e3, T& ee2, T& em,
+		T& emsq, T& gam, T& peo, T& pgho, T& pho,
+		T& pinco, T& plo, T& rtemsq, T& se2, T& se3,
+		T& sgh2, T& sgh3, T& sgh4, T& sh2, T& sh3,
+		T& si2, T& si3, T& sl2, T& sl3, T& sl4,
+		T& s1, T& s2, T& s3, T& s4, T& s5,
+		T& s6, T& s7, T& ss1, T& ss2, T& ss3,
+		T& ss4, T& ss5, T& ss6, T& ss7, T& sz1,
+		T& sz2, T& sz3, T& sz11, T& sz12, T& sz13,
+		T& sz21, T& sz22, T& sz23, T& sz31, T& sz32,
+		T& sz33, T& xgh2, T& xgh3, T& xgh4, T& xh2,
+		T& xh3, T& xi2, T& xi3, T& xl2, T& xl3,
+		T& xl4, T& nm, T& z1, T& z2, T& z3,
+		T& z11, T& z12, T& z13, T& z21, T& z22,
+		T& z23, T& z31, T& z32, T& z33, T& zmol,
+		T& zmos
+		)
+	{
+		/* -------------------------- constants ------------------------- */
+		const T zes = T(0.01675);
+		const T zel = T(0.05490);
+		const T c1ss = T(2.9864797e-6);
+		const T c1l = T(4.7968065e-7);
+		const T zsinis = T(0.39785416);
+		const T zcosis = T(0.91744867);
+		const T zcosgs = T(0.1945905);
+		const T zsings = -T(0.98088458);
+		const T twopi = T(2.0) * T(pi);
+
+		/* --------------------- local variables ------------------------ */
+		int lsflg;
+		T a1, a2, a3, a4, a5, a6, a7,
+			a8, a9, a10, betasq, cc, ctem, stem,
+			x1, x2, x3, x4, x5, x6, x7,
+			x8, xnodce, xnoi, zcosg, zcosgl, zcosh, zcoshl,
+			zcosi, zcosil, zsing, zsingl, zsinh, zsinhl, zsini,
+			zsinil, zx, zy;
+
+		nm = np;
+		em = ep;
+		snodm = sin(nodep);
+		cnodm = cos(nodep);
+		sinomm = sin(argpp);
+		cosomm = cos(argpp);
+		sinim = sin(inclp);
+		cosim = cos(inclp);
+		emsq = em * em;
+		betasq = T(1.0) - emsq;
+		rtemsq = sqrt(betasq);
+
+		/* ----------------- initialize lunar solar terms --------------- */
+		peo = T(0.0);
+		pinco = T(0.0);
+		plo = T(0.0);
+		pgho = T(0.0);
+		pho = T(0.0);
+		day = T(epoch + 18261.5) + tc / T(1440.0);
+		xnodce = fmod(T(4.5236020) - T(9.2422029e-4) * day, twopi);
+		stem = sin(xnodce);
+		ctem = cos(xnodce);
+		zcosil = T(0.91375164) - T(0.03568096) * ctem;
+		zsinil = sqrt(T(1.0) - zcosil * zcosil);
+		zsinhl = T(0.089683511) * stem / zsinil;
+		zcoshl = sqrt(T(1.0) - zsinhl * zsinhl);
+		gam = T(5.8351514) + T(0.0019443680) * day;
+		zx = T(0.39785416) * stem / zsinil;
+		zy = zcoshl * ctem + T(0.91744867) * zsinhl * stem;
+		zx = atan2(zx, zy);
+		zx = gam + zx - xnodce;
+		zcosgl = cos(zx);
+		zsingl = sin(zx);
+
+		/* ------------------------- do solar terms --------------------- */
+		zcosg = zcosgs;
+		zsing = zsings;
+		zcosi = zcosis;
+		zsini = zsinis;
+		zcosh = cnodm;
+		zsinh = snodm;
+		cc = c1ss;
+		xnoi = T(1.0) / nm;
+
+		for (lsflg = 1; lsflg <= 2; lsflg++)
+		{
+			a1 = zcosg * zcosh + zsing * zcosi * zsinh;
+			a3 = -zsing * zcosh + zcosg * zcosi * zsinh;
+			a7 = -zcosg * zsinh + zsing * zcosi * zcosh;
+			a8 = zsing * zsini;
+			a9 = zsing * zsinh + zcosg * zcosi * zcosh;
+			a10 = zcosg * zsini;
+			a2 = cosim * a7 + sinim * a8;
+			a4 = cosim * a9 + sinim * a10;
+			a5 = -sinim * a7 + cosim * a8;
+			a6 = -sinim * a9 + cosim * a10;
+
+			x1 = a1 * cosomm + a2 * sinomm;
+			x2 = a3 * cosomm + a4 * sinomm;
+			x3 = -a1 * sinomm + a2 * cosomm;
+			x4 = -a3 * sinomm + a4 * cosomm;
+			x5 = a5 * sinomm;
+			x6 = a6 * sinomm;
+			x7 = a5 * cosomm;
+			x8 = a6 * cosomm;
+
+			z31 = T(12.0) * x1 * x1 - T(3.0) * x3 * x3;
+			z32 = T(24.0) * x1 * x2 - T(6.0) * x3 * x4;
+			z33 = T(12.0) * x2 * x2 - T(3.0) * x4 * x4;
+			z1 = T(3.0) *  (a1 * a1 + a2 * a2) + z31 * emsq;
+			z2 = T(6.0) *  (a1 * a3 + a2 * a4) + z32 * emsq;
+			z3 = T(3.0) *  (a3 * a3 + a4 * a4) + z33 * emsq;
+			z11 = -T(6.0) * a1 * a5 + emsq *  (-T(24.0) * x1 * x7 - T(6.0) * x3 * x5);
+			z12 = -T(6.0) *  (a1 * a6 + a3 * a5) + emsq *
+				(-T(24.0) * (x2 * x7 + x1 * x8) - T(6.0) * (x3 * x6 + x4 * x5));
+			z13 = -T(6.0) * a3 * a6 + emsq * (-T(24.0) * x2 * x8 - T(6.0) * x4 * x6);
+			z21 = T(6.0) * a2 * a5 + emsq * (T(24.0) * x1 * x5 - T(6.0) * x3 * x7);
+			z22 = T(6.0) *  (a4 * a5 + a2 * a6) + emsq *
+				(T(24.0) * (x2 * x5 + x1 * x6) - T(6.0) * (x4 * x7 + x3 * x8));
+			z23 = T(6.0) * a4 * a6 + emsq * (T(24.0) * x2 * x6 - T(6.0) * x4 * x8);
+			z1 = z1 + z1 + betasq * z31;
+			z2 = z2 + z2 + betasq * z32;
+			z3 = z3 + z3 + betasq * z33;
+			s3 = cc * xnoi;
+			s2 = -T(0.5) * s3 / rtemsq;
+			s4 = s3 * rtemsq;
+			s1 = -T(15.0) * em * s4;
+			s5 = x1 * x3 + x2 * x4;
+			s6 = x2 * x3 + x1 * x4;
+			s7 = x2 * x4 - x1 * x3;
+
+			/* ----------------------- do lunar terms ------------------- */
+			if (lsflg == 1)
+			{
+				ss1 = s1;
+				ss2 = s2;
+				ss3 = s3;
+				ss4 = s4;
+				ss5 = s5;
+				ss6 = s6;
+				ss7 = s7;
+				sz1 = z1;
+				sz2 = z2;
+				sz3 = z3;
+				sz11 = z11;
+				sz12 = z12;
+				sz13 = z13;
+				sz21 = z21;
+				sz22 = z22;
+				sz23 = z23;
+				sz31 = z31;
+				sz32 = z32;
+				sz33 = z33;
+				zcosg = zcosgl;
+				zsing = zsingl;
+				zcosi = zcosil;
+				zsini = zsinil;
+				zcosh = zcoshl * cnodm + zsinhl * snodm;
+				zsinh = snodm * zcoshl - cnodm * zsinhl;
+				cc = c1l;
+			}
+		}
+
+		zmol = fmod(T(4.7199672) + T(0.22997150)  * day - gam, twopi);
+		zmos = fmod(T(6.2565837) + T(0.017201977) * day, twopi);
+
+		/* ------------------------ do solar terms ---------------------- */
+		se2 = T(2.0) * ss1 * ss6;
+		se3 = T(2.0) * ss1 * ss7;
+		si2 = T(2.0) * ss2 * sz12;
+		si3 = T(2.0) * ss2 * (sz13 - sz11);
+		sl2 = -T(2.0) * ss3 * sz2;
+		sl3 = -T(2.0) * ss3 * (sz3 - sz1);
+		sl4 = -T(2.0) * ss3 * (-T(21.0) - T(9.0) * emsq) * zes;
+		sgh2 = T(2.0) * ss4 * sz32;
+		sgh3 = T(2.0) * ss4 * (sz33 - sz31);
+		sgh4 = -T(18.0) * ss4 * zes;
+		sh2 = -T(2.0) * ss2 * sz22;
+		sh3 = -T(2.0) * ss2 * (sz23 - sz21);
+
+		/* ------------------------ do lunar terms ---------------------- */
+		ee2 = T(2.0) * s1 * s6;
+		e3 = T(2.0) * s1 * s7;
+		xi2 = T(2.0) * s2 * z12;
+		xi3 = T(2.0) * s2 * (z13 - z11);
+		xl2 = -T(2.0) * s3 * z2;
+		xl3 = -T(2.0) * s3 * (z3 - z1);
+		xl4 = -T(2.0) * s3 * (-T(21.0) - T(9.0) * emsq) * zel;
+		xgh2 = T(2.0) * s4 * z32;
+		xgh3 = T(2.0) * s4 * (z33 - z31);
+		xgh4 = -T(18.0) * s4 * zel;
+		xh2 = -T(2.0) * s2 * z22;
+		xh3 = -T(2.0) * s2 * (z23 - z21);
+
+		//#include "debug2.cpp"
+	}  // dscom
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                           procedure dsinit
+	*
+	*  this procedure provides deep space contributions to mean motion dot due
+	*    to geopotential resonance with half day and one day orbits.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    xke         - reciprocal of tumin
+	*    cosim, sinim-
+	*    emsq        - eccentricity squared
+	*    argpo       - argument of perigee
+	*    s1, s2, s3, s4, s5      -
+	*    ss1, ss2, ss3, ss4, ss5 -
+	*    sz1, sz3, sz11, sz13, sz21, sz23, sz31, sz33 -
+	*    t           - time
+	*    tc          -
+	*    gsto        - greenwich sidereal time                   rad
+	*    mo          - mean anomaly
+	*    mdot        - mean anomaly dot (rate)
+	*    no          - mean motion
+	*    nodeo       - right ascension of ascending node
+	*    nodedot     - right ascension of ascending node dot (rate)
+	*    xpidot      -
+	*    z1, z3, z11, z13, z21, z23, z31, z33 -
+	*    eccm        - eccentricity
+	*    argpm       - argument of perigee
+	*    inclm       - inclination
+	*    mm          - mean anomaly
+	*    xn          - mean motion
+	*    nodem       - right ascension of ascending node
+	*
+	*  outputs       :
+	*    em          - eccentricity
+	*    argpm       - argument of perigee
+	*    inclm       - inclination
+	*    mm          - mean anomaly
+	*    nm          - mean motion
+	*    nodem       - right ascension of ascending node
+	*    irez        - flag for resonance           0-none, 1-one day, 2-half day
+	*    atime       -
+	*    d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433    -
+	*    dedt        -
+	*    didt        -
+	*    dmdt        -
+	*    dndt        -
+	*    dnodt       -
+	*    domdt       -
+	*    del1, del2, del3        -
+	*    ses  , sghl , sghs , sgs  , shl  , shs  , sis  , sls
+	*    theta       -
+	*    xfact       -
+	*    xlamo       -
+	*    xli         -
+	*    xni
+	*
+	*  locals        :
+	*    ainv2       -
+	*    aonv        -
+	*    cosisq      -
+	*    eoc         -
+	*    f220, f221, f311, f321, f322, f330, f441, f442, f522, f523, f542, f543  -
+	*    g200, g201, g211, g300, g310, g322, g410, g422, g520, g521, g532, g533  -
+	*    sini2       -
+	*    temp        -
+	*    temp1       -
+	*    theta       -
+	*    xno2        -
+	*
+	*  coupling      :
+	*    getgravconst- no longer used
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	void dsinit
+		(
+		// sgp4fix just send in xke as a constant and eliminate getgravconst call
+		// gravconsttype whichconst, 
+		T xke,
+		T cosim, T emsq, T argpo, T s1, T s2,
+		T s3, T s4, T s5, T sinim, T ss1,
+		T ss2, T ss3, T ss4, T ss5, T sz1,
+		T sz3, T sz11, T sz13, T sz21, T sz23,
+		T sz31, T sz33, T t, T tc, T gsto,
+		T mo, T mdot, T no, T nodeo, T nodedot,
+		T xpidot, T z1, T z3, T z11, T z13,
+		T z21, T z23, T z31, T z33, T ecco,
+		T eccsq, T& em, T& argpm, T& inclm, T& mm,
+		T& nm, T& nodem,
+		int& irez,
+		T& atime, T& d2201, T& d2211, T& d3210, T& d3222,
+		T& d4410, T& d4422, T& d5220, T& d5232, T& d5421,
+		T& d5433, T& dedt, T& didt, T& dmdt, T& dndt,
+		T& dnodt, T& domdt, T& del1, T& del2, T& del3,
+		T& xfact, T& xlamo, T& xli, T& xni
+		)
+	{
+		/* --------------------- local variables ------------------------ */
+		const T twopi = T(2.0) * T(pi);
+
+		T ainv2, aonv = T(0.0), cosisq, eoc, f220, f221, f311,
+			f321, f322, f330, f441, f442, f522, f523,
+			f542, f543, g200, g201, g211, g300, g310,
+			g322, g410, g422, g520, g521, g532, g533,
+			ses, sgs, sghl, sghs, shs, shll, sis,
+			sini2, sls, temp, temp1, theta, xno2, q22,
+			q31, q33, root22, root44, root54, rptim, root32,
+			root52, x2o3, znl, emo, zns, emsqo;
+
+		q22 = T(1.7891679e-6);
+		q31 = T(2.1460748e-6);
+		q33 = T(2.2123015e-7);
+		root22 = T(1.7891679e-6);
+		root44 = T(7.3636953e-9);
+		root54 = T(2.1765803e-9);
+		rptim = T(4.37526908801129966e-3); // this equates to 7.29211514668855e-5 rad/sec
+		root32 = T(3.7393792e-7);
+		root52 = T(1.1428639e-7);
+		x2o3 = T(2.0) / T(3.0);
+		znl = T(1.5835218e-4);
+		zns = T(1.19459e-5);
+
+		// sgp4fix identify constants and allow alternate values
+		// just xke is used here so pass it in rather than have multiple calls
+		// getgravconst( whichconst, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
+
+		/* -------------------- deep space initialization ------------ */
+		irez = 0;
+		if ((nm < T(0.0052359877)) && (nm > T(0.0034906585)))
+			irez = 1;
+		if ((nm >= T(8.26e-3)) && (nm <= T(9.24e-3)) && (em >= T(0.5)))
+			irez = 2;
+
+		/* ------------------------ do solar terms ------------------- */
+		ses = ss1 * zns * ss5;
+		sis = ss2 * zns * (sz11 + sz13);
+		sls = -zns * ss3 * (sz1 + sz3 - T(14.0) - T(6.0) * emsq);
+		sghs = ss4 * zns * (sz31 + sz33 - T(6.0));
+		shs = -zns * ss2 * (sz21 + sz23);
+		// sgp4fix for 180 deg incl
+		if ((inclm < T(5.2359877e-2)) || (inclm > T(pi) - T(5.2359877e-2)))
+			shs = T(0.0);
+		if (sinim != T(0.0))
+			shs = shs / sinim;
+		sgs = sghs - cosim * shs;
+
+		/* ------------------------- do lunar terms ------------------ */
+		dedt = ses + s1 * znl * s5;
+		didt = sis + s2 * znl * (z11 + z13);
+		dmdt = sls - znl * s3 * (z1 + z3 - T(14.0) - T(6.0) * emsq);
+		sghl = s4 * znl * (z31 + z33 - T(6.0));
+		shll = -znl * s2 * (z21 + z23);
+		// sgp4fix for 180 deg incl
+		if ((inclm < T(5.2359877e-2)) || (inclm > T(pi) - T(5.2359877e-2)))
+			shll = T(0.0);
+		domdt = sgs + sghl;
+		dnodt = shs;
+		if (sinim != T(0.0))
+		{
+			domdt = domdt - cosim / sinim * shll;
+			dnodt = dnodt + shll / sinim;
+		}
+
+		/* ----------- calculate deep space resonance effects -------- */
+		dndt = T(0.0);
+		theta = fmod(gsto + tc * rptim, twopi);
+		em = em + dedt * t;
+		inclm = inclm + didt * t;
+		argpm = argpm + domdt * t;
+		nodem = nodem + dnodt * t;
+		mm = mm + dmdt * t;
+		//   sgp4fix for negative inclinations
+		//   the following if statement should be commented out
+		//if (inclm < 0.0)
+		//  {
+		//    inclm  = -inclm;
+		//    argpm  = argpm - pi;
+		//    nodem = nodem + pi;
+		//  }
+
+		/* -------------- initialize the resonance terms ------------- */
+		if (irez != 0)
+		{
+			aonv = pow(nm / xke, x2o3);
+
+			/* ---------- geopotential resonance for 12 hour orbits ------ */
+			if (irez == 2)
+			{
+				cosisq = cosim * cosim;
+				emo = em;
+				em = ecco;
+				emsqo = emsq;
+				emsq = eccsq;
+				eoc = em * emsq;
+				g201 = -T(0.306) - (em - T(0.64)) * T(0.440);
+
+				if (em <= T(0.65))
+				{
+					g211 = T(3.616) - T(13.2470) * em + T(16.2900) * emsq;
+					g310 = -T(19.302) + T(117.3900) * em - T(228.4190) * emsq + T(156.5910) * eoc;
+					g322 = -T(18.9068) + T(109.7927) * em - T(214.6334) * emsq + T(146.5816) * eoc;
+					g410 = -T(41.122) + T(242.6940) * em - T(471.0940) * emsq + T(313.9530) * eoc;
+					g422 = -T(146.407) + T(841.8800) * em - T(1629.014) * emsq + T(1083.4350) * eoc;
+					g520 = -T(532.114) + T(3017.977) * em - T(5740.032) * emsq + T(3708.2760) * eoc;
+				}
+				else
+				{
+					g211 = -T(72.099) + T(331.819) * em - T(508.738) * emsq + T(266.724) * eoc;
+					g310 = -T(346.844) + T(1582.851) * em - T(2415.925) * emsq + T(1246.113) * eoc;
+					g322 = -T(342.585) + T(1554.908) * em - T(2366.899) * emsq + T(1215.972) * eoc;
+					g410 = -T(1052.797) + T(4758.686) * em - T(7193.992) * emsq + T(3651.957) * eoc;
+					g422 = -T(3581.690) + T(16178.110) * em - T(24462.770) * emsq + T(12422.520) * eoc;
+					if (em > T(0.715))
+						g520 = -T(5149.66) + T(29936.92) * em - T(54087.36) * emsq + T(31324.56) * eoc;
+					else
+						g520 = T(1464.74) - T(4664.75) * em + T(3763.64) * emsq;
+				}
+				if (em < T(0.7))
+				{
+					g533 = -T(919.22770) + T(4988.6100) * em - T(9064.7700) * emsq + T(5542.21)  * eoc;
+					g521 = -T(822.71072) + T(4568.6173) * em - T(8491.4146) * emsq + T(5337.524) * eoc;
+					g532 = -T(853.66600) + T(4690.2500) * em - T(8624.7700) * emsq + T(5341.4)  * eoc;
+				}
+				else
+				{
+					g533 = -T(37995.780) + T(161616.52) * em - T(229838.20) * emsq + T(109377.94) * eoc;
+					g521 = -T(51752.104) + T(218913.95) * em - T(309468.16) * emsq + T(146349.42) * eoc;
+					g532 = -T(40023.880) + T(170470.89) * em - T(242699.48) * emsq + T(115605.82) * eoc;
+				}
+
+				sini2 = sinim * sinim;
+				f220 = T(0.75) * (T(1.0) + T(2.0) * cosim + cosisq);
+				f221 = T(1.5) * sini2;
+				f321 = T(1.875) * sinim  *  (T(1.0) - T(2.0) * cosim - T(3.0) * cosisq);
+				f322 = -T(1.875) * sinim  *  (T(1.0) + T(2.0) * cosim - T(3.0) * cosisq);
+				f441 = T(35.0) * sini2 * f220;
+				f442 = T(39.3750) * sini2 * sini2;
+				f522 = T(9.84375) * sinim * (sini2 * (T(1.0) - T(2.0) * cosim - T(5.0) * cosisq) +
+					T(0.33333333) * (-T(2.0) + T(4.0) * cosim + T(6.0) * cosisq));
+				f523 = sinim * (T(4.92187512) * sini2 * (-T(2.0) - T(4.0) * cosim +
+					T(10.0) * cosisq) + T(6.56250012) * (T(1.0) + T(2.0) * cosim - T(3.0) * cosisq));
+				f542 = T(29.53125) * sinim * (T(2.0) - T(8.0) * cosim + cosisq *
+					(-T(12.0) + T(8.0) * cosim + T(10.0) * cosisq));
+				f543 = T(29.53125) * sinim * (-T(2.0) - T(8.0) * cosim + cosisq *
+					(T(12.0) + T(8.0) * cosim - T(10.0) * cosisq));
+				xno2 = nm * nm;
+				ainv2 = aonv * aonv;
+				temp1 = T(3.0) * xno2 * ainv2;
+				temp = temp1 * root22;
+				d2201 = temp * f220 * g201;
+				d2211 = temp * f221 * g211;
+				temp1 = temp1 * aonv;
+				temp = temp1 * root32;
+				d3210 = temp * f321 * g310;
+				d3222 = temp * f322 * g322;
+				temp1 = temp1 * aonv;
+				temp = T(2.0) * temp1 * root44;
+				d4410 = temp * f441 * g410;
+				d4422 = temp * f442 * g422;
+				temp1 = temp1 * aonv;
+				temp = temp1 * root52;
+				d5220 = temp * f522 * g520;
+				d5232 = temp * f523 * g532;
+				temp = T(2.0) * temp1 * root54;
+				d5421 = temp * f542 * g521;
+				d5433 = temp * f543 * g533;
+				xlamo = fmod(mo + nodeo + nodeo - theta - theta, twopi);
+				xfact = mdot + dmdt + T(2.0) * (nodedot + dnodt - rptim) - no;
+				em = emo;
+				emsq = emsqo;
+			}
+
+			/* ---------------- synchronous resonance terms -------------- */
+			if (irez == 1)
+			{
+				g200 = T(1.0) + emsq * (-T(2.5) + T(0.8125) * emsq);
+				g310 = T(1.0) + T(2.0) * emsq;
+				g300 = T(1.0) + emsq * (-T(6.0) + T(6.60937) * emsq);
+				f220 = T(0.75) * (T(1.0) + cosim) * (T(1.0) + cosim);
+				f311 = T(0.9375) * sinim * sinim * (T(1.0) + T(3.0) * cosim) - T(0.75) * (T(1.0) + cosim);
+				f330 = T(1.0) + cosim;
+				f330 = T(1.875) * f330 * f330 * f330;
+				del1 = T(3.0) * nm * nm * aonv * aonv;
+				del2 = T(2.0) * del1 * f220 * g200 * q22;
+				del3 = T(3.0) * del1 * f330 * g300 * q33 * aonv;
+				del1 = del1 * f311 * g310 * q31 * aonv;
+				xlamo = fmod(mo + nodeo + argpo - theta, twopi);
+				xfact = mdot + xpidot - rptim + dmdt + domdt + dnodt - no;
+			}
+
+			/* ------------ for sgp4, initialize the integrator ---------- */
+			xli = xlamo;
+			xni = no;
+			atime = T(0.0);
+			nm = no + dndt;
+		}
+
+		//#include "debug3.cpp"
+	}  // dsinit
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                           procedure dspace
+	*
+	*  this procedure provides deep space contributions to mean elements for
+	*    perturbing third body.  these effects have been averaged over one
+	*    revolution of the sun and moon.  for earth resonance effects, the
+	*    effects have been averaged over no revolutions of the satellite.
+	*    (mean motion)
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433 -
+	*    dedt        -
+	*    del1, del2, del3  -
+	*    didt        -
+	*    dmdt        -
+	*    dnodt       -
+	*    domdt       -
+	*    irez        - flag for resonance           0-none, 1-one day, 2-half day
+	*    argpo       - argument of perigee
+	*    argpdot     - argument of perigee dot (rate)
+	*    t           - time
+	*    tc          -
+	*    gsto        - gst
+	*    xfact       -
+	*    xlamo       -
+	*    no          - mean motion
+	*    atime       -
+	*    em          - eccentricity
+	*    ft          -
+	*    argpm       - argument of perigee
+	*    inclm       - inclination
+	*    xli         -
+	*    mm          - mean anomaly
+	*    xni         - mean motion
+	*    nodem       - right ascension of ascending node
+	*
+	*  outputs       :
+	*    atime       -
+	*    em          - eccentricity
+	*    argpm       - argument of perigee
+	*    inclm       - inclination
+	*    xli         -
+	*    mm          - mean anomaly
+	*    xni         -
+	*    nodem       - right ascension of ascending node
+	*    dndt        -
+	*    nm          - mean motion
+	*
+	*  locals        :
+	*    delt        -
+	*    ft          -
+	*    theta       -
+	*    x2li        -
+	*    x2omi       -
+	*    xl          -
+	*    xldot       -
+	*    xnddt       -
+	*    xndt        -
+	*    xomi        -
+	*
+	*  coupling      :
+	*    none        -
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	void dspace
+		(
+		int irez,
+		T d2201, T d2211, T d3210, T d3222, T d4410,
+		T d4422, T d5220, T d5232, T d5421, T d5433,
+		T dedt, T del1, T del2, T del3, T didt,
+		T dmdt, T dnodt, T domdt, T argpo, T argpdot,
+		T t, T tc, T gsto, T xfact, T xlamo,
+		T no,
+		T& atime, T& em, T& argpm, T& inclm, T& xli,
+		T& mm, T& xni, T& nodem, T& dndt, T& nm
+		)
+	{
+		const T twopi = T(2.0) * T(pi);
+		int iretn, iret;
+		T delt, ft, theta, x2li, x2omi, xl, xldot, xnddt, xndt, xomi, g22, g32,
+			g44, g52, g54, fasx2, fasx4, fasx6, rptim, step2, stepn, stepp;
+
+		fasx2 = T(0.13130908);
+		fasx4 = T(2.8843198);
+		fasx6 = T(0.37448087);
+		g22 = T(5.7686396);
+		g32 = T(0.95240898);
+		g44 = T(1.8014998);
+		g52 = T(1.0508330);
+		g54 = T(4.4108898);
+		rptim = T(4.37526908801129966e-3); // this equates to 7.29211514668855e-5 rad/sec
+		stepp = T(720.0);
+		stepn = -T(720.0);
+		step2 = T(259200.0);
+
+		/* ----------- calculate deep space resonance effects ----------- */
+		dndt = T(0.0);
+		theta = fmod(gsto + tc * rptim, twopi);
+		em = em + dedt * t;
+
+		inclm = inclm + didt * t;
+		argpm = argpm + domdt * t;
+		nodem = nodem + dnodt * t;
+		mm = mm + dmdt * t;
+
+		//   sgp4fix for negative inclinations
+		//   the following if statement should be commented out
+		//  if (inclm < 0.0)
+		// {
+		//    inclm = -inclm;
+		//    argpm = argpm - pi;
+		//    nodem = nodem + pi;
+		//  }
+
+		/* - update resonances : numerical (euler-maclaurin) integration - */
+		/* ------------------------- epoch restart ----------------------  */
+		//   sgp4fix for propagator problems
+		//   the following integration works for negative time steps and periods
+		//   the specific changes are unknown because the original code was so convoluted
+
+		// sgp4fix take out atime = 0.0 and fix for faster operation
+		ft = T(0.0);
+		if (irez != 0)
+		{
+			// sgp4fix streamline check
+			if ((atime == T(0.0)) || (t * atime <= T(0.0)) || (fabs(t) < fabs(atime)))
+			{
+				atime = T(0.0);
+				xni = no;
+				xli = xlamo;
+			}
+			// sgp4fix move check outside loop
+			if (t > T(0.0))
+				delt = stepp;
+			else
+				delt = stepn;
+
+			iretn = 381; // added for do loop
+			iret = 0; // added for loop
+			while (iretn == 381)
+			{
+				/* ------------------- dot terms calculated ------------- */
+				/* ----------- near - synchronous resonance terms ------- */
+				if (irez != 2)
+				{
+					xndt = del1 * sin(xli - fasx2) + del2 * sin(T(2.0) * (xli - fasx4)) +
+						del3 * sin(T(3.0) * (xli - fasx6));
+					xldot = xni + xfact;
+					xnddt = del1 * cos(xli - fasx2) +
+						T(2.0) * del2 * cos(T(2.0) * (xli - fasx4)) +
+						T(3.0) * del3 * cos(T(3.0) * (xli - fasx6));
+					xnddt = xnddt * xldot;
+				}
+				else
+				{
+					/* --------- near - half-day resonance terms -------- */
+					xomi = argpo + argpdot * atime;
+					x2omi = xomi + xomi;
+					x2li = xli + xli;
+					xndt = d2201 * sin(x2omi + xli - g22) + d2211 * sin(xli - g22) +
+						d3210 * sin(xomi + xli - g32) + d3222 * sin(-xomi + xli - g32) +
+						d4410 * sin(x2omi + x2li - g44) + d4422 * sin(x2li - g44) +
+						d5220 * sin(xomi + xli - g52) + d5232 * sin(-xomi + xli - g52) +
+						d5421 * sin(xomi + x2li - g54) + d5433 * sin(-xomi + x2li - g54);
+					xldot = xni + xfact;
+					xnddt = d2201 * cos(x2omi + xli - g22) + d2211 * cos(xli - g22) +
+						d3210 * cos(xomi + xli - g32) + d3222 * cos(-xomi + xli - g32) +
+						d5220 * cos(xomi + xli - g52) + d5232 * cos(-xomi + xli - g52) +
+						T(2.0) * (d4410 * cos(x2omi + x2li - g44) +
+						d4422 * cos(x2li - g44) + d5421 * cos(xomi + x2li - g54) +
+						d5433 * cos(-xomi + x2li - g54));
+					xnddt = xnddt * xldot;
+				}
+
+				/* ----------------------- integrator ------------------- */
+				// sgp4fix move end checks to end of routine
+				if (fabs(t - atime) >= stepp)
+				{
+					iret = 0;
+					iretn = 381;
+				}
+				else // exit here
+				{
+					ft = t - atime;
+					iretn = 0;
+				}
+
+				if (iretn == 381)
+				{
+					xli = xli + xldot * delt + xndt * step2;
+					xni = xni + xndt * delt + xnddt * step2;
+					atime = atime + delt;
+				}
+			}  // while iretn = 381
+
+			nm = xni + xndt * ft + xnddt * ft * ft * T(0.5);
+			xl = xli + xldot * ft + xndt * ft * ft * T(0.5);
+			if (irez != 1)
+			{
+				mm = xl - T(2.0) * nodem + T(2.0) * theta;
+				dndt = nm - no;
+			}
+			else
+			{
+				mm = xl - nodem - argpm + theta;
+				dndt = nm - no;
+			}
+			nm = no + dndt;
+		}
+
+		//#include "debug4.cpp"
+	}  // dsspace
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                           procedure initl
+	*
+	*  this procedure initializes the spg4 propagator. all the initialization is
+	*    consolidated here instead of having multiple loops inside other routines.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    satn        - satellite number - not needed, placed in satrec
+	*    xke         - reciprocal of tumin
+	*    j2          - j2 zonal harmonic
+	*    ecco        - eccentricity                           0.0 - 1.0
+	*    epoch       - epoch time in days from jan 0, 1950. 0 hr
+	*    inclo       - inclination of satellite
+	*    no          - mean motion of satellite
+	*
+	*  outputs       :
+	*    ainv        - 1.0 / a
+	*    ao          - semi major axis
+	*    con41       -
+	*    con42       - 1.0 - 5.0 cos(i)
+	*    cosio       - cosine of inclination
+	*    cosio2      - cosio squared
+	*    eccsq       - eccentricity squared
+	*    method      - flag for deep space                    'd', 'n'
+	*    omeosq      - 1.0 - ecco * ecco
+	*    posq        - semi-parameter squared
+	*    rp          - radius of perigee
+	*    rteosq      - square root of (1.0 - ecco*ecco)
+	*    sinio       - sine of inclination
+	*    gsto        - gst at time of observation               rad
+	*    no          - mean motion of satellite
+	*
+	*  locals        :
+	*    ak          -
+	*    d1          -
+	*    del         -
+	*    adel        -
+	*    po          -
+	*
+	*  coupling      :
+	*    getgravconst- no longer used
+	*    gstime      - find greenwich sidereal time from the julian date
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	void initl
+		(
+		// sgp4fix satn not needed. include in satrec in case needed later  
+		// int satn,      
+		// sgp4fix just pass in xke and j2
+		// gravconsttype whichconst, 
+		T xke, T j2,
+		T ecco, double epoch, T inclo, T no_kozai, char opsmode,
+		char& method, T& ainv, T& ao, T& con41, T& con42, T& cosio,
+		T& cosio2, T& eccsq, T& omeosq, T& posq,
+		T& rp, T& rteosq, T& sinio, T& gsto, T& no_unkozai
+		)
+	{
+		/* --------------------- local variables ------------------------ */
+		T ak, d1, del, adel, po, x2o3;
+
+		// sgp4fix use old way of finding gst
+		// the epoch and the sidereal time from it stay in double, whatever T is
+		double ds70;
+		double ts70, tfrac, c1, thgr70, fk5r, c1p2p;
+		const double twopi = 2.0 * pi;
+
+		/* ----------------------- earth constants ---------------------- */
+		// sgp4fix identify constants and allow alternate values
+		// only xke and j2 are used here so pass them in directly
+		// getgravconst( whichconst, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
+		x2o3 = T(2.0) / T(3.0);
+
+		/* ------------- calculate auxillary epoch quantities ---------- */
+		eccsq = ecco * ecco;
+		omeosq = T(1.0) - eccsq;
+		rteosq = sqrt(omeosq);
+		cosio = cos(inclo);
+		cosio2 = cosio * cosio;
+
+		/* ------------------ un-kozai the mean motion ----------------- */
+		ak = pow(xke / no_kozai, x2o3);
+		d1 = T(0.75) * j2 * (T(3.0) * cosio2 - T(1.0)) / (rteosq * omeosq);
+		del = d1 / (ak * ak);
+		adel = ak * (T(1.0) - del * del - del *
+			(T(1.0) / T(3.0) + T(134.0) * del * del / T(81.0)));
+		del = d1 / (adel * adel);
+		no_unkozai = no_kozai / (T(1.0) + del);
+
+		ao = pow(xke / (no_unkozai), x2o3);
+		sinio = sin(inclo);
+		po = ao * omeosq;
+		con42 = T(1.0) - T(5.0) * cosio2;
+		con41 = -con42 - cosio2 - cosio2;
+		ainv = T(1.0) / ao;
+		posq = po * po;
+		rp = ao * (T(1.0) - ecco);
+		method = 'n';
+
+		// sgp4fix modern approach to finding sidereal time
+		//   if (opsmode == 'a')
+		//      {
+		// sgp4fix use old way of finding gst
+		// count integer number of days from 0 jan 1970
+		ts70 = epoch - 7305.0;
+		ds70 = floor(ts70 + 1.0e-8);
+		tfrac = ts70 - ds70;
+		// find greenwich location at epoch
+		c1 = 1.72027916940703639e-2;
+		thgr70 = 1.7321343856509374;
+		fk5r = 5.07551419432269442e-15;
+		c1p2p = c1 + twopi;
+		double gsto1 = fmod(thgr70 + c1*ds70 + c1p2p*tfrac + ts70*ts70*fk5r, twopi);
+		if (gsto1 < 0.0)
+			gsto1 = gsto1 + twopi;
+		//    }
+		//    else
+		gsto = T(gstime(epoch + 2433281.5));
+
+		//#include "debug5.cpp"
+	}  // initl
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                             procedure sgp4init_t
+	*
+	*  this procedure initializes variables for sgp4. the elements are in T, the
+	*    record is elsetrec for double or elsetrec_t<T>.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    opsmode     - mode of operation afspc or improved 'a', 'i'
+	*    whichconst  - which set of constants to use  72, 84
+	*    satn        - satellite number
+	*    bstar       - sgp4 type drag coefficient              kg/m2er
+	*    ecco        - eccentricity
+	*    epoch       - epoch time in days from jan 0, 1950. 0 hr
+	*    argpo       - argument of perigee (output if ds)
+	*    inclo       - inclination
+	*    mo          - mean anomaly (output if ds)
+	*    no          - mean motion
+	*    nodeo       - right ascension of ascending node
+	*
+	*  outputs       :
+	*    satrec      - common values for subsequent calls
+	*    return code - non-zero on error.
+	*                   1 - mean elements, ecc >= 1.0 or ecc < -0.001 or a < 0.95 er
+	*                   2 - mean motion less than 0.0
+	*                   3 - pert elements, ecc < 0.0  or  ecc > 1.0
+	*                   4 - semi-latus rectum < 0.0
+	*                   5 - epoch elements are sub-orbital
+	*                   6 - satellite has decayed
+	*
+	*  locals        :
+	*    cnodm  , snodm  , cosim  , sinim  , cosomm , sinomm
+	*    cc1sq  , cc2    , cc3
+	*    coef   , coef1
+	*    cosio4      -
+	*    day         -
+	*    dndt        -
+	*    em          - eccentricity
+	*    emsq        - eccentricity squared
+	*    eeta        -
+	*    etasq       -
+	*    gam         -
+	*    argpm       - argument of perigee
+	*    nodem       -
+	*    inclm       - inclination
+	*    mm          - mean anomaly
+	*    nm          - mean motion
+	*    perige      - perigee
+	*    pinvsq      -
+	*    psisq       -
+	*    qzms24      -
+	*    rtemsq      -
+	*    s1, s2, s3, s4, s5, s6, s7          -
+	*    sfour       -
+	*    ss1, ss2, ss3, ss4, ss5, ss6, ss7         -
+	*    sz1, sz2, sz3
+	*    sz11, sz12, sz13, sz21, sz22, sz23, sz31, sz32, sz33        -
+	*    tc          -
+	*    temp        -
+	*    temp1, temp2, temp3       -
+	*    tsi         -
+	*    xpidot      -
+	*    xhdot1      -
+	*    z1, z2, z3          -
+	*    z11, z12, z13, z21, z22, z23, z31, z32, z33         -
+	*
+	*  coupling      :
+	*    getgravconst-
+	*    initl       -
+	*    dscom       -
+	*    dpper       -
+	*    dsinit      -
+	*    sgp4        -
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T, typename rec>
+	bool sgp4init_t
+		(
+		gravconsttype whichconst, char opsmode, const int satn, const double epoch,
+		const T xbstar, const T xndot, const T xnddot, const T xecco, const T xargpo,
+		const T xinclo, const T xmo, const T xno_kozai,
+		const T xnodeo, rec& satrec
+		)
+	{
+		/* --------------------- local variables ------------------------ */
+		T ao, ainv, con42, cosio, sinio, cosio2, eccsq,
+			omeosq, posq, rp, rteosq,
+			cnodm, snodm, cosim, sinim, cosomm, sinomm, cc1sq,
+			cc2, cc3, coef, coef1, cosio4, day, dndt,
+			em, emsq, eeta, etasq, gam, argpm, nodem,
+			inclm, mm, nm, perige, pinvsq, psisq, qzms24,
+			rtemsq, s1, s2, s3, s4, s5, s6,
+			s7, sfour, ss1, ss2, ss3, ss4, ss5,
+			ss6, ss7, sz1, sz2, sz3, sz11, sz12,
+			sz13, sz21, sz22, sz23, sz31, sz32, sz33,
+			tc, temp, temp1, temp2, temp3, tsi, xpidot,
+			xhdot1, z1, z2, z3, z11, z12, z13,
+			z21, z22, z23, z31, z32, z33,
+			qzms2t, ss, x2o3, r[3], v[3],
+			delmotemp, qzms2ttemp, qzms24temp;
+
+		/* ------------------------ initialization --------------------- */
+		// sgp4fix divisor for divide by zero check on inclination
+		// the old check used 1.0 + cos(pi-1.0e-9), but then compared it to
+		// 1.5 e-12, so the threshold was changed to 1.5e-12 for consistency
+		const T temp4 = T(1.5e-12);
+
+		/* ----------- set all near earth variables to zero ------------ */
+		satrec.isimp = 0;   satrec.method = 'n'; satrec.aycof = T(0.0);
+		satrec.con41 = T(0.0); satrec.cc1 = T(0.0); satrec.cc4 = T(0.0);
+		satrec.cc5 = T(0.0); satrec.d2 = T(0.0); satrec.d3 = T(0.0);
+		satrec.d4 = T(0.0); satrec.delmo = T(0.0); satrec.eta = T(0.0);
+		satrec.argpdot = T(0.0); satrec.omgcof = T(0.0); satrec.sinmao = T(0.0);
+		satrec.t = T(0.0); satrec.t2cof = T(0.0); satrec.t3cof = T(0.0);
+		satrec.t4cof = T(0.0); satrec.t5cof = T(0.0); satrec.x1mth2 = T(0.0);
+		satrec.x7thm1 = T(0.0); satrec.mdot = T(0.0); satrec.nodedot = T(0.0);
+		satrec.xlcof = T(0.0); satrec.xmcof = T(0.0); satrec.nodecf = T(0.0);
+
+		/* ----------- set all deep space variables to zero ------------ */
+		satrec.irez = 0;   satrec.d2201 = T(0.0); satrec.d2211 = T(0.0);
+		satrec.d3210 = T(0.0); satrec.d3222 = T(0.0); satrec.d4410 = T(0.0);
+		satrec.d4422 = T(0.0); satrec.d5220 = T(0.0); satrec.d5232 = T(0.0);
+		satrec.d5421 = T(0.0); satrec.d5433 = T(0.0); satrec.dedt = T(0.0);
+		satrec.del1 = T(0.0); satrec.del2 = T(0.0); satrec.del3 = T(0.0);
+		satrec.didt = T(0.0); satrec.dmdt = T(0.0); satrec.dnodt = T(0.0);
+		satrec.domdt = T(0.0); satrec.e3 = T(0.0); satrec.ee2 = T(0.0);
+		satrec.peo = T(0.0); satrec.pgho = T(0.0); satrec.pho = T(0.0);
+		satrec.pinco = T(0.0); satrec.plo = T(0.0); satrec.se2 = T(0.0);
+		satrec.se3 = T(0.0); satrec.sgh2 = T(0.0); satrec.sgh3 = T(0.0);
+		satrec.sgh4 = T(0.0); satrec.sh2 = T(0.0); satrec.sh3 = T(0.0);
+		satrec.si2 = T(0.0); satrec.si3 = T(0.0); satrec.sl2 = T(0.0);
+		satrec.sl3 = T(0.0); satrec.sl4 = T(0.0); satrec.gsto = T(0.0);
+		satrec.xfact = T(0.0); satrec.xgh2 = T(0.0); satrec.xgh3 = T(0.0);
+		satrec.xgh4 = T(0.0); satrec.xh2 = T(0.0); satrec.xh3 = T(0.0);
+		satrec.xi2 = T(0.0); satrec.xi3 = T(0.0); satrec.xl2 = T(0.0);
+		satrec.xl3 = T(0.0); satrec.xl4 = T(0.0); satrec.xlamo = T(0.0);
+		satrec.zmol = T(0.0); satrec.zmos = T(0.0); satrec.atime = T(0.0);
+		satrec.xli = T(0.0); satrec.xni = T(0.0);
+
+		/* ------------------------ earth constants ----------------------- */
+		// sgp4fix identify constants and allow alternate values
+		// this is now the only call for the constants
+		double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+		getgravconst(whichconst, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+		satrec.tumin = T(tumin); satrec.mu = T(mu); satrec.radiusearthkm = T(radiusearthkm);
+		satrec.xke = T(xke); satrec.j2 = T(j2); satrec.j3 = T(j3);
+		satrec.j4 = T(j4); satrec.j3oj2 = T(j3oj2);
+
+		//-------------------------------------------------------------------------
+
+		satrec.error = 0;
+		satrec.operationmode = opsmode;
+		satrec.satnum = satn;
+
+		// sgp4fix - note the following variables are also passed directly via satrec.
+		// it is possible to streamline the sgp4init call by deleting the "x"
+		// variables, but the user would need to set the satrec.* values first. we
+		// include the additional assignments in case twoline2rv is not used.
+		satrec.bstar = xbstar;
+		// sgp4fix allow additional parameters in the struct
+		satrec.ndot = xndot;
+		satrec.nddot = xnddot;
+		satrec.ecco = xecco;
+		satrec.argpo = xargpo;
+		satrec.inclo = xinclo;
+		satrec.mo = xmo;
+		// sgp4fix rename variables to clarify which mean motion is intended
+		satrec.no_kozai = xno_kozai;
+		satrec.nodeo = xnodeo;
+
+		// single averaged mean elements
+		satrec.am = satrec.em = satrec.im = satrec.Om = satrec.mm = satrec.nm = T(0.0);
+
+		/* ------------------------ earth constants ----------------------- */
+		// sgp4fix identify constants and allow alternate values no longer needed
+		// getgravconst( whichconst, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
+		ss = T(78.0) / satrec.radiusearthkm + T(1.0);
+		// sgp4fix use multiply for speed instead of pow
+		qzms2ttemp = (T(120.0) - T(78.0)) / satrec.radiusearthkm;
+		qzms2t = qzms2ttemp * qzms2ttemp * qzms2ttemp * qzms2ttemp;
+		x2o3 = T(2.0) / T(3.0);
+
+		satrec.init = 'y';
+		satrec.t = T(0.0);
+
+		// sgp4fix remove satn as it is not needed in initl
+		initl
+			(satrec.xke, satrec.j2, satrec.ecco, epoch, satrec.inclo, satrec.no_kozai, satrec.operationmode,
+			satrec.method, ainv, ao, satrec.con41, con42, cosio, cosio2, eccsq, omeosq,
+			posq, rp, rteosq, sinio, satrec.gsto, satrec.no_unkozai);
+		satrec.a = pow(satrec.no_unkozai * satrec.tumin, (-T(2.0) / T(3.0)));
+		satrec.alta = satrec.a * (T(1.0) + satrec.ecco) - T(1.0);
+		satrec.altp = satrec.a * (T(1.0) - satrec.ecco) - T(1.0);
+		satrec.error = 0;
+
+		// sgp4fix remove this check as it is unnecessary
+		// the mrt check in sgp4 handles decaying satellite cases even if the starting
+		// condition is below the surface of te earth
+		//     if (rp < 1.0)
+		//       {
+		//         printf("# *** satn%d epoch elts sub-orbital ***\n", satn);
+		//         satrec.error = 5;
+		//       }
+
+		if ((omeosq >= T(0.0)) || (satrec.no_unkozai >= T(0.0)))
+		{
+			satrec.isimp = 0;
+			if (rp < (T(220.0) / satrec.radiusearthkm + T(1.0)))
+				satrec.isimp = 1;
+			sfour = ss;
+			qzms24 = qzms2t;
+			perige = (rp - T(1.0)) * satrec.radiusearthkm;
+
+			/* - for perigees below 156 km, s and qoms2t are altered - */
+			if (perige < T(156.0))
+			{
+				sfour = perige - T(78.0);
+				if (perige < T(98.0))
+					sfour = T(20.0);
+				// sgp4fix use multiply for speed instead of pow
+				qzms24temp = (T(120.0) - sfour) / satrec.radiusearthkm;
+				qzms24 = qzms24temp * qzms24temp * qzms24temp * qzms24temp;
+				sfour = sfour / satrec.radiusearthkm + T(1.0);
+			}
+			pinvsq = T(1.0) / posq;
+
+			tsi = T(1.0) / (ao - sfour);
+			satrec.eta = ao * satrec.ecco * tsi;
+			etasq = satrec.eta * satrec.eta;
+			eeta = satrec.ecco * satrec.eta;
+			psisq = fabs(T(1.0) - etasq);
+			coef = qzms24 * pow(tsi, T(4.0));
+			coef1 = coef / pow(psisq, T(3.5));
+			cc2 = coef1 * satrec.no_unkozai * (ao * (T(1.0) + T(1.5) * etasq + eeta *
+				(T(4.0) + etasq)) + T(0.375) * satrec.j2 * tsi / psisq * satrec.con41 *
+				(T(8.0) + T(3.0) * etasq * (T(8.0) + etasq)));
+			satrec.cc1 = satrec.bstar * cc2;
+			cc3 = T(0.0);
+			if (satrec.ecco > T(1.0e-4))
+				cc3 = -T(2.0) * coef * tsi * satrec.j3oj2 * satrec.no_unkozai * sinio / satrec.ecco;
+			satrec.x1mth2 = T(1.0) - cosio2;
+			satrec.cc4 = T(2.0)* satrec.no_unkozai * coef1 * ao * omeosq *
+				(satrec.eta * (T(2.0) + T(0.5) * etasq) + satrec.ecco *
+				(T(0.5) + T(2.0) * etasq) - satrec.j2 * tsi / (ao * psisq) *
+				(-T(3.0) * satrec.con41 * (T(1.0) - T(2.0) * eeta + etasq *
+				(T(1.5) - T(0.5) * eeta)) + T(0.75) * satrec.x1mth2 *
+				(T(2.0) * etasq - eeta * (T(1.0) + etasq)) * cos(T(2.0) * satrec.argpo)));
+			satrec.cc5 = T(2.0) * coef1 * ao * omeosq * (T(1.0) + T(2.75) *
+				(etasq + eeta) + eeta * etasq);
+			cosio4 = cosio2 * cosio2;
+			temp1 = T(1.5) * satrec.j2 * pinvsq * satrec.no_unkozai;
+			temp2 = T(0.5) * temp1 * satrec.j2 * pinvsq;
+			temp3 = -T(0.46875) * satrec.j4 * pinvsq * pinvsq * satrec.no_unkozai;
+			satrec.mdot = satrec.no_unkozai + T(0.5) * temp1 * rteosq * satrec.con41 + T(0.0625) *
+				temp2 * rteosq * (T(13.0) - T(78.0) * cosio2 + T(137.0) * cosio4);
+			satrec.argpdot = -T(0.5) * temp1 * con42 + T(0.0625) * temp2 *
+				(T(7.0) - T(114.0) * cosio2 + T(395.0) * cosio4) +
+				temp3 * (T(3.0) - T(36.0) * cosio2 + T(49.0) * cosio4);
+			xhdot1 = -temp1 * cosio;
+			satrec.nodedot = xhdot1 + (T(0.5) * temp2 * (T(4.0) - T(19.0) * cosio2) +
+				T(2.0) * temp3 * (T(3.0) - T(7.0) * cosio2)) * cosio;
+			xpidot = satrec.argpdot + satrec.nodedot;
+			satrec.omgcof = satrec.bstar * cc3 * cos(satrec.argpo);
+			satrec.xmcof = T(0.0);
+			if (satrec.ecco > T(1.0e-4))
+				satrec.xmcof = -x2o3 * coef * satrec.bstar / eeta;
+			satrec.nodecf = T(3.5) * omeosq * xhdot1 * satrec.cc1;
+			satrec.t2cof = T(1.5) * satrec.cc1;
+			// sgp4fix for divide by zero with xinco = 180 deg
+			if (fabs(cosio + T(1.0)) > T(1.5e-12))
+				satrec.xlcof = -T(0.25) * satrec.j3oj2 * sinio * (T(3.0) + T(5.0) * cosio) / (T(1.0) + cosio);
+			else
+				satrec.xlcof = -T(0.25) * satrec.j3oj2 * sinio * (T(3.0) + T(5.0) * cosio) / temp4;
+			satrec.aycof = -T(0.5) * satrec.j3oj2 * sinio;
+			// sgp4fix use multiply for speed instead of pow
+			delmotemp = T(1.0) + satrec.eta * cos(satrec.mo);
+			satrec.delmo = delmotemp * delmotemp * delmotemp;
+			satrec.sinmao = sin(satrec.mo);
+			satrec.x7thm1 = T(7.0) * cosio2 - T(1.0);
+
+			/* --------------- deep space initialization ------------- */
+			if ((T(2.0) * T(pi) / satrec.no_unkozai) >= T(225.0))
+			{
+				satrec.method = 'd';
+				satrec.isimp = 1;
+				tc = T(0.0);
+				inclm = satrec.inclo;
+
+				dscom
+					(
+					epoch, satrec.ecco, satrec.argpo, tc, satrec.inclo, satrec.nodeo,
+					satrec.no_unkozai, snodm, cnodm, sinim, cosim, sinomm, cosomm,
+					day, satrec.e3, satrec.ee2, em, emsq, gam,
+					satrec.peo, satrec.pgho, satrec.pho, satrec.pinco,
+					satrec.plo, rtemsq, satrec.se2, satrec.se3,
+					satrec.sgh2, satrec.sgh3, satrec.sgh4,
+					satrec.sh2, satrec.sh3, satrec.si2, satrec.si3,
+					satrec.sl2, satrec.sl3, satrec.sl4, s1, s2, s3, s4, s5,
+					s6, s7, ss1, ss2, ss3, ss4, ss5, ss6, ss7, sz1, sz2, sz3,
+					sz11, sz12, sz13, sz21, sz22, sz23, sz31, sz32, sz33,
+					satrec.xgh2, satrec.xgh3, satrec.xgh4, satrec.xh2,
+					satrec.xh3, satrec.xi2, satrec.xi3, satrec.xl2,
+					satrec.xl3, satrec.xl4, nm, z1, z2, z3, z11,
+					z12, z13, z21, z22, z23, z31, z32, z33,
+					satrec.zmol, satrec.zmos
+					);
+				dpper
+					(
+					satrec.e3, satrec.ee2, satrec.peo, satrec.pgho,
+					satrec.pho, satrec.pinco, satrec.plo, satrec.se2,
+					satrec.se3, satrec.sgh2, satrec.sgh3, satrec.sgh4,
+					satrec.sh2, satrec.sh3, satrec.si2, satrec.si3,
+					satrec.sl2, satrec.sl3, satrec.sl4, satrec.t,
+					satrec.xgh2, satrec.xgh3, satrec.xgh4, satrec.xh2,
+					satrec.xh3, satrec.xi2, satrec.xi3, satrec.xl2,
+					satrec.xl3, satrec.xl4, satrec.zmol, satrec.zmos, inclm, satrec.init,
+					satrec.ecco, satrec.inclo, satrec.nodeo, satrec.argpo, satrec.mo,
+					satrec.operationmode
+					);
+
+				argpm = T(0.0);
+				nodem = T(0.0);
+				mm = T(0.0);
+
+				dsinit
+					(
+					satrec.xke,
+					cosim, emsq, satrec.argpo, s1, s2, s3, s4, s5, sinim, ss1, ss2, ss3, ss4,
+					ss5, sz1, sz3, sz11, sz13, sz21, sz23, sz31, sz33, satrec.t, tc,
+					satrec.gsto, satrec.mo, satrec.mdot, satrec.no_unkozai, satrec.nodeo,
+					satrec.nodedot, xpidot, z1, z3, z11, z13, z21, z23, z31, z33,
+					satrec.ecco, eccsq, em, argpm, inclm, mm, nm, nodem,
+					satrec.irez, satrec.atime,
+					satrec.d2201, satrec.d2211, satrec.d3210, satrec.d3222,
+					satrec.d4410, satrec.d4422, satrec.d5220, satrec.d5232,
+					satrec.d5421, satrec.d5433, satrec.dedt, satrec.didt,
+					satrec.dmdt, dndt, satrec.dnodt, satrec.domdt,
+					satrec.del1, satrec.del2, satrec.del3, satrec.xfact,
+					satrec.xlamo, satrec.xli, satrec.xni
+					);
+			}
+
+			/* ----------- set variables if not deep space ----------- */
+			if (satrec.isimp != 1)
+			{
+				cc1sq = satrec.cc1 * satrec.cc1;
+				satrec.d2 = T(4.0) * ao * tsi * cc1sq;
+				temp = satrec.d2 * tsi * satrec.cc1 / T(3.0);
+				satrec.d3 = (T(17.0) * ao + sfour) * temp;
+				satrec.d4 = T(0.5) * temp * ao * tsi * (T(221.0) * ao + T(31.0) * sfour) *
+					satrec.cc1;
+				satrec.t3cof = satrec.d2 + T(2.0) * cc1sq;
+				satrec.t4cof = T(0.25) * (T(3.0) * satrec.d3 + satrec.cc1 *
+					(T(12.0) * satrec.d2 + T(10.0) * cc1sq));
+				satrec.t5cof = T(0.2) * (T(3.0) * satrec.d4 +
+					T(12.0) * satrec.cc1 * satrec.d3 +
+					T(6.0) * satrec.d2 * satrec.d2 +
+					T(15.0) * cc1sq * (T(2.0) * satrec.d2 + cc1sq));
+			}
+		} // if omeosq = 0 ...
+
+		/* finally propogate to zero epoch to initialize all others. */
+		// sgp4fix take out check to let satellites process until they are actually below earth surface
+		//       if(satrec.error == 0)
+		sgp4_t(satrec, T(0.0), r, v);
+
+		satrec.init = 'n';
+
+		//#include "debug6.cpp"
+		//sgp4fix return boolean. satrec.error contains any error codes
+		return true;
+	}  // sgp4init_t
+
+	/*-----------------------------------------------------------------------------
+	*
+	*                             procedure sgp4_t
+	*
+	*  this procedure is the sgp4 prediction model from space command. this is an
+	*    updated and combined version of sgp4 and sdp4, which were originally
+	*    published separately in spacetrack report #3. this version follows the
+	*    methodology from the aiaa paper (2006) describing the history and
+	*    development of the code.
+	*
+	*  author        : david vallado                  719-573-2600   28 jun 2005
+	*
+	*  inputs        :
+	*    satrec	 - initialised structure from sgp4init() call.
+	*    tsince	 - time since epoch (minutes)
+	*
+	*  outputs       :
+	*    r           - position vector                     km
+	*    v           - velocity                            km/sec
+	*  return code - non-zero on error.
+	*                   1 - mean elements, ecc >= 1.0 or ecc < -0.001 or a < 0.95 er
+	*                   2 - mean motion less than 0.0
+	*                   3 - pert elements, ecc < 0.0  or  ecc > 1.0
+	*                   4 - semi-latus rectum < 0.0
+	*                   5 - epoch elements are sub-orbital
+	*                   6 - satellite has decayed
+	*
+	*  locals        :
+	*    am          -
+	*    axnl, aynl        -
+	*    betal       -
+	*    cosim   , sinim   , cosomm  , sinomm  , cnod    , snod    , cos2u   ,
+	*    sin2u   , coseo1  , sineo1  , cosi    , sini    , cosip   , sinip   ,
+	*    cosisq  , cossu   , sinsu   , cosu    , sinu
+	*    delm        -
+	*    delomg      -
+	*    dndt        -
+	*    eccm        -
+	*    emsq        -
+	*    ecose       -
+	*    el2         -
+	*    eo1         -
+	*    eccp        -
+	*    esine       -
+	*    argpm       -
+	*    argpp       -
+	*    omgadf      -c
+	*    pl          -
+	*    r           -
+	*    rtemsq      -
+	*    rdotl       -
+	*    rl          -
+	*    rvdot       -
+	*    rvdotl      -
+	*    su          -
+	*    t2  , t3   , t4    , tc
+	*    tem5, temp , temp1 , temp2  , tempa  , tempe  , templ
+	*    u   , ux   , uy    , uz     , vx     , vy     , vz
+	*    inclm       - inclination
+	*    mm          - mean anomaly
+	*    nm          - mean motion
+	*    nodem       - right asc of ascending node
+	*    xinc        -
+	*    xincp       -
+	*    xl          -
+	*    xlm         -
+	*    mp          -
+	*    xmdf        -
+	*    xmx         -
+	*    xmy         -
+	*    nodedf      -
+	*    xnode       -
+	*    nodep       -
+	*    np          -
+	*
+	*  coupling      :
+	*    getgravconst- no longer used. Variables are conatined within satrec
+	*    dpper
+	*    dpspace
+	*
+	*  references    :
+	*    hoots, roehrich, norad spacetrack report #3 1980
+	*    hoots, norad spacetrack report #6 1986
+	*    hoots, schumacher and glover 2004
+	*    vallado, crawford, hujsak, kelso  2006
+	----------------------------------------------------------------------------*/
+
+	template <typename T, typename rec>
+	bool sgp4_t
+		(
+		rec& satrec, T tsince,
+		T r[3], T v[3]
+		)
+	{
+		T am, axnl, aynl, betal, cosim, cnod,
+			cos2u, coseo1, cosi, cosip, cosisq, cossu, cosu,
+			delm, delomg, em, emsq, ecose, el2, eo1,
+			ep, esine, argpm, argpp, argpdf, pl, mrt = T(0.0),
+			mvt, rdotl, rl, rvdot, rvdotl, sinim,
+			sin2u, sineo1, sini, sinip, sinsu, sinu,
+			snod, su, t2, t3, t4, tem5, temp,
+			temp1, temp2, tempa, tempe, templ, u, ux,
+			uy, uz, vx, vy, vz, inclm, mm,
+			nm, nodem, xinc, xincp, xl, xlm, mp,
+			xmdf, xmx, xmy, nodedf, xnode, nodep, tc, dndt,
+			twopi, x2o3, vkmpersec, delmtemp;
+		int ktr;
+
+		/* ------------------ set mathematical constants --------------- */
+		// sgp4fix divisor for divide by zero check on inclination
+		// the old check used 1.0 + cos(pi-1.0e-9), but then compared it to
+		// 1.5 e-12, so the threshold was changed to 1.5e-12 for consistency
+		const T temp4 = T(1.5e-12);
+		twopi = T(2.0) * T(pi);
+		x2o3 = T(2.0) / T(3.0);
+		// sgp4fix identify constants and allow alternate values
+		// getgravconst( whichconst, tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2 );
+		vkmpersec = satrec.radiusearthkm * satrec.xke / T(60.0);
+
+		/* --------------------- clear sgp4 error flag ----------------- */
+		satrec.t = tsince;
+		satrec.error = 0;
+
+		/* ------- update for secular gravity and atmospheric drag ----- */
+		xmdf = satrec.mo + satrec.mdot * satrec.t;
+		argpdf = satrec.argpo + satrec.argpdot * satrec.t;
+		nodedf = satrec.nodeo + satrec.nodedot * satrec.t;
+		argpm = argpdf;
+		mm = xmdf;
+		t2 = satrec.t * satrec.t;
+		nodem = nodedf + satrec.nodecf * t2;
+		tempa = T(1.0) - satrec.cc1 * satrec.t;
+		tempe = satrec.bstar * satrec.cc4 * satrec.t;
+		templ = satrec.t2cof * t2;
+
+		if (satrec.isimp != 1)
+		{
+			delomg = satrec.omgcof * satrec.t;
+			// sgp4fix use mutliply for speed instead of pow
+			delmtemp = T(1.0) + satrec.eta * cos(xmdf);
+			delm = satrec.xmcof *
+				(delmtemp * delmtemp * delmtemp -
+				satrec.delmo);
+			temp = delomg + delm;
+			mm = xmdf + temp;
+			argpm = argpdf - temp;
+			t3 = t2 * satrec.t;
+			t4 = t3 * satrec.t;
+			tempa = tempa - satrec.d2 * t2 - satrec.d3 * t3 -
+				satrec.d4 * t4;
+			tempe = tempe + satrec.bstar * satrec.cc5 * (sin(mm) -
+				satrec.sinmao);
+			templ = templ + satrec.t3cof * t3 + t4 * (satrec.t4cof +
+				satrec.t * satrec.t5cof);
+		}
+
+		nm = satrec.no_unkozai;
+		em = satrec.ecco;
+		inclm = satrec.inclo;
+		if (satrec.method == 'd')
+		{
+			tc = satrec.t;
+			dspace
+				(
+				satrec.irez,
+				satrec.d2201, satrec.d2211, satrec.d3210,
+				satrec.d3222, satrec.d4410, satrec.d4422,
+				satrec.d5220, satrec.d5232, satrec.d5421,
+				satrec.d5433, satrec.dedt, satrec.del1,
+				satrec.del2, satrec.del3, satrec.didt,
+				satrec.dmdt, satrec.dnodt, satrec.domdt,
+				satrec.argpo, satrec.argpdot, satrec.t, tc,
+				satrec.gsto, satrec.xfact, satrec.xlamo,
+				satrec.no_unkozai, satrec.atime,
+				em, argpm, inclm, satrec.xli, mm, satrec.xni,
+				nodem, dndt, nm
+				);
+		} // if method = d
+
+		if (nm <= T(0.0))
+		{
+			//         printf("# error nm %f\n", nm);
+			satrec.error = 2;
+			// sgp4fix add return
+			return false;
+		}
+		am = pow((satrec.xke / nm), x2o3) * tempa * tempa;
+		nm = satrec.xke / pow(am, T(1.5));
+		em = em - tempe;
+
+		// fix tolerance for error recognition
+		// sgp4fix am is fixed from the previous nm check
+		if ((em >= T(1.0)) || (em < -T(0.001))/* || (am < 0.95)*/)
+		{
+			//         printf("# error em %f\n", em);
+			satrec.error = 1;
+			// sgp4fix to return if there is an error in eccentricity
+			return false;
+		}
+		// sgp4fix fix tolerance to avoid a divide by zero
+		if (em < T(1.0e-6))
+			em = T(1.0e-6);
+		mm = mm + satrec.no_unkozai * templ;
+		xlm = mm + argpm + nodem;
+		emsq = em * em;
+		temp = T(1.0) - emsq;
+
+		nodem = fmod(nodem, twopi);
+		argpm = fmod(argpm, twopi);
+		xlm = fmod(xlm, twopi);
+		mm = fmod(xlm - argpm - nodem, twopi);
+
+		// sgp4fix recover singly averaged mean elements
+		satrec.am = am;
+		satrec.em = em;
+		satrec.im = inclm;
+		satrec.Om = nodem;
+		satrec.om = argpm;
+		satrec.mm = mm;
+		satrec.nm = nm;
+
+		/* ----------------- compute extra mean quantities ------------- */
+		sinim = sin(inclm);
+		cosim = cos(inclm);
+
+		/* -------------------- add lunar-solar periodics -------------- */
+		ep = em;
+		xincp = inclm;
+		argpp = argpm;
+		nodep = nodem;
+		mp = mm;
+		sinip = sinim;
+		cosip = cosim;
+		if (satrec.method == 'd')
+		{
+			dpper
+				(
+				satrec.e3, satrec.ee2, satrec.peo,
+				satrec.pgho, satrec.pho, satrec.pinco,
+				satrec.plo, satrec.se2, satrec.se3,
+				satrec.sgh2, satrec.sgh3, satrec.sgh4,
+				satrec.sh2, satrec.sh3, satrec.si2,
+				satrec.si3, satrec.sl2, satrec.sl3,
+				satrec.sl4, satrec.t, satrec.xgh2,
+				satrec.xgh3, satrec.xgh4, satrec.xh2,
+				satrec.xh3, satrec.xi2, satrec.xi3,
+				satrec.xl2, satrec.xl3, satrec.xl4,
+				satrec.zmol, satrec.zmos, satrec.inclo,
+				'n', ep, xincp, nodep, argpp, mp, satrec.operationmode
+				);
+			if (xincp < T(0.0))
+			{
+				xincp = -xincp;
+				nodep = nodep + T(pi);
+				argpp = argpp - T(pi);
+			}
+			if ((ep < T(0.0)) || (ep > T(1.0)))
+			{
+				//            printf("# error ep %f\n", ep);
+				satrec.error = 3;
+				// sgp4fix add return
+				return false;
+			}
+		} // if method = d
+
+		/* -------------------- long period periodics ------------------ */
+		if (satrec.method == 'd')
+		{
+			sinip = sin(xincp);
+			cosip = cos(xincp);
+			satrec.aycof = -T(0.5)*satrec.j3oj2*sinip;
+			// sgp4fix for divide by zero for xincp = 180 deg
+			if (fabs(cosip + T(1.0)) > T(1.5e-12))
+				satrec.xlcof = -T(0.25) * satrec.j3oj2 * sinip * (T(3.0) + T(5.0) * cosip) / (T(1.0) + cosip);
+			else
+				satrec.xlcof = -T(0.25) * satrec.j3oj2 * sinip * (T(3.0) + T(5.0) * cosip) / temp4;
+		}
+		axnl = ep * cos(argpp);
+		temp = T(1.0) / (am * (T(1.0) - ep * ep));
+		aynl = ep* sin(argpp) + temp * satrec.aycof;
+		xl = mp + argpp + nodep + temp * satrec.xlcof * axnl;
+
+		/* --------------------- solve kepler's equation --------------- */
+		u = fmod(xl - nodep, twopi);
+		eo1 = u;
+		tem5 = T(9999.9);
+		ktr = 1;
+		//   sgp4fix for kepler iteration
+		//   the following iteration needs better limits on corrections
+		while ((fabs(tem5) >= T(1.0e-12)) && (ktr <= 10))
+		{
+			sineo1 = sin(eo1);
+			coseo1 = cos(eo1);
+			tem5 = T(1.0) - coseo1 * axnl - sineo1 * aynl;
+			tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+			if (fabs(tem5) >= T(0.95))
+				tem5 = tem5 > T(0.0) ? T(0.95) : -T(0.95);
+			eo1 = eo1 + tem5;
+			ktr = ktr + 1;
+		}
+
+		/* ------------- short period preliminary quantities ----------- */
+		ecose = axnl*coseo1 + aynl*sineo1;
+		esine = axnl*sineo1 - aynl*coseo1;
+		el2 = axnl*axnl + aynl*aynl;
+		pl = am*(T(1.0) - el2);
+		if (pl < T(0.0))
+		{
+			//         printf("# error pl %f\n", pl);
+			satrec.error = 4;
+			// sgp4fix add return
+			return false;
+		}
+		else
+		{
+			rl = am * (T(1.0) - ecose);
+			rdotl = sqrt(am) * esine / rl;
+			rvdotl = sqrt(pl) / rl;
+			betal = sqrt(T(1.0) - el2);
+			temp = esine / (T(1.0) + betal);
+			sinu = am / rl * (sineo1 - aynl - axnl * temp);
+			cosu = am / rl * (coseo1 - axnl + aynl * temp);
+			su = atan2(sinu, cosu);
+			sin2u = (cosu + cosu) * sinu;
+			cos2u = T(1.0) - T(2.0) * sinu * sinu;
+			temp = T(1.0) / pl;
+			temp1 = T(0.5) * satrec.j2 * temp;
+			temp2 = temp1 * temp;
+
+			/* -------------- update for short period periodics ------------ */
+			if (satrec.method == 'd')
+			{
+				cosisq = cosip * cosip;
+				satrec.con41 = T(3.0)*cosisq - T(1.0);
+				satrec.x1mth2 = T(1.0) - cosisq;
+				satrec.x7thm1 = T(7.0)*cosisq - T(1.0);
+			}
+			mrt = rl * (T(1.0) - T(1.5) * temp2 * betal * satrec.con41) +
+				T(0.5) * temp1 * satrec.x1mth2 * cos2u;
+			su = su - T(0.25) * temp2 * satrec.x7thm1 * sin2u;
+			xnode = nodep + T(1.5) * temp2 * cosip * sin2u;
+			xinc = xincp + T(1.5) * temp2 * cosip * sinip * cos2u;
+			mvt = rdotl - nm * temp1 * satrec.x1mth2 * sin2u / satrec.xke;
+			rvdot = rvdotl + nm * temp1 * (satrec.x1mth2 * cos2u +
+				T(1.5) * satrec.con41) / satrec.xke;
+
+			/* --------------------- orientation vectors ------------------- */
+			sinsu = sin(su);
+			cossu = cos(su);
+			snod = sin(xnode);
+			cnod = cos(xnode);
+			sini = sin(xinc);
+			cosi = cos(xinc);
+			xmx = -snod * cosi;
+			xmy = cnod * cosi;
+			ux = xmx * sinsu + cnod * cossu;
+			uy = xmy * sinsu + snod * cossu;
+			uz = sini * sinsu;
+			vx = xmx * cossu - cnod * sinsu;
+			vy = xmy * cossu - snod * sinsu;
+			vz = sini * cossu;
+
+			/* --------- position and velocity (in km and km/sec) ---------- */
+			r[0] = (mrt * ux)* satrec.radiusearthkm;
+			r[1] = (mrt * uy)* satrec.radiusearthkm;
+			r[2] = (mrt * uz)* satrec.radiusearthkm;
+			v[0] = (mvt * ux + rvdot * vx) * vkmpersec;
+			v[1] = (mvt * uy + rvdot * vy) * vkmpersec;
+			v[2] = (mvt * uz + rvdot * vz) * vkmpersec;
+		}  // if pl > 0
+
+		// sgp4fix for decaying satellites
+		if (mrt < T(1.0))
+		{
+			//         printf("# decay condition %11.6f \n",mrt);
+			satrec.error = 6;
+			return false;
+		}
+
+		//#include "debug7.cpp"
+		return true;
+	}  // sgp4_t
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function findgravconst
+	*
+	*  this function finds which set of gravity constants a record initialised
+	*    by twoline2rv or sgp4init was set up with.
+	*
+	*  inputs        :
+	*    satrec      - initialised structure from sgp4init() call.
+	*
+	*  outputs       :
+	*    whichconst  - wgs72old, wgs72 or wgs84
+	*    return code - false if the constants of satrec are none of them
+	*
+	*  coupling      :
+	*    getgravconst
+	----------------------------------------------------------------------------*/
+
+	inline bool findgravconst
+		(
+		const elsetrec& satrec, gravconsttype& whichconst
+		)
+	{
+		const gravconsttype consts[3] = { wgs72old, wgs72, wgs84 };
+		double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+
+		for (int i = 0; i < 3; i++)
+		{
+			getgravconst(consts[i], tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+			if ((xke == satrec.xke) && (mu == satrec.mu) && (j2 == satrec.j2))
+			{
+				whichconst = consts[i];
+				return true;
+			}
+		}
+		return false;
+	}  // findgravconst
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4init_from
+	*
+	*  this function initializes a record in T from the elements of a double
+	*    record that twoline2rv or sgp4init has set up, with the same gravity
+	*    constants and operation mode.
+	*
+	*  inputs        :
+	*    satrec      - initialised structure from sgp4init() call.
+	*
+	*  outputs       :
+	*    satrecT     - the same satellite initialised in T
+	*    return code - false if the gravity constants of satrec are not one of
+	*                  wgs72old, wgs72 or wgs84
+	*
+	*  coupling      :
+	*    findgravconst, sgp4init_t
+	----------------------------------------------------------------------------*/
+
+	template <typename T>
+	bool sgp4init_from
+		(
+		const elsetrec& satrec, elsetrec_t<T>& satrecT
+		)
+	{
+		gravconsttype whichconst;
+
+		if (!findgravconst(satrec, whichconst))
+			return false;
+
+		satrecT.jdsatepoch = satrec.jdsatepoch;
+		satrecT.jdsatepochF = satrec.jdsatepochF;
+		sgp4init_t(whichconst, satrec.operationmode, (int)satrec.satnum,
+			satrec.jdsatepoch + satrec.jdsatepochF - 2433281.5, T(satrec.bstar),
+			T(satrec.ndot), T(satrec.nddot), T(satrec.ecco), T(satrec.argpo),
+			T(satrec.inclo), T(satrec.mo), T(satrec.no_kozai), T(satrec.nodeo), satrecT);
+		return true;
+	}  // sgp4init_from
+
+}  // namespace SGP4Funcs
+
+#ifdef SGP4_CORE_PI
+#undef pi
+#undef SGP4_CORE_PI
+#endif
+
+#endif
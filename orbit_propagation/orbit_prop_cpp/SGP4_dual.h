@@ -0,0 +1,153 @@
+#ifndef _SGP4_dual_h_
+#define _SGP4_dual_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_dual.h
+*
+*    this file contains a forward mode dual number for the templated sgp4
+*    core (SGP4_core.h). a dual<N> carries a value and its partials with
+*    respect to N inputs, every operation applies the chain rule, so one
+*    pass of sgp4init_t and sgp4_t on elsetrec_t<dual<N> > gives the state
+*    and its partials with respect to the seeded elements.
+*
+*    comparisons only look at the value, so the branches the core takes are
+*    those of the double propagator and the partials are those of the branch
+*    taken. floor has zero partials, fmod the partials of x - k y for the k
+*    of the value.
+*
+*       ----------------------------------------------------------------      */
+
+#include <cmath>
+
+namespace SGP4Funcs
+{
+
+	template <int N>
+	struct dual
+	{
+		double v;        // value
+		double d[N];     // partials
+
+		dual() : v(0.0)
+		{
+			for (int k = 0; k < N; k++)
+				d[k] = 0.0;
+		}
+
+		// constants, also used for the implicit conversion of literals
+		dual(double x) : v(x)
+		{
+			for (int k = 0; k < N; k++)
+				d[k] = 0.0;
+		}
+
+		// input k of the derivative
+		dual(double x, int k) : v(x)
+		{
+			for (int j = 0; j < N; j++)
+				d[j] = 0.0;
+			d[k] = 1.0;
+		}
+
+		// f(v) with derivative df
+		static dual chain(const dual& a, double f, double df)
+		{
+			dual c(f);
+			for (int k = 0; k < N; k++)
+				c.d[k] = df * a.d[k];
+			return c;
+		}
+
+		dual operator+() const { return *this; }
+		dual operator-() const { return chain(*this, -v, -1.0); }
+
+		dual& operator+=(const dual& b)
+		{
+			v += b.v;
+			for (int k = 0; k < N; k++)
+				d[k] += b.d[k];
+			return *this;
+		}
+
+		dual& operator-=(const dual& b)
+		{
+			v -= b.v;
+			for (int k = 0; k < N; k++)
+				d[k] -= b.d[k];
+			return *this;
+		}
+
+		dual& operator*=(const dual& b)
+		{
+			for (int k = 0; k < N; k++)
+				d[k] = d[k] * b.v + v * b.d[k];
+			v *= b.v;
+			return *this;
+		}
+
+		dual& operator/=(const dual& b)
+		{
+			const double inv = 1.0 / b.v;
+			// the value divides, so it is the same as in the double propagator
+			v /= b.v;
+			for (int k = 0; k < N; k++)
+				d[k] = (d[k] - v * b.d[k]) * inv;
+			return *this;
+		}
+
+		// defined in the class so they are found by adl and convert doubles
+		friend dual operator+(dual a, const dual& b) { return a += b; }
+		friend dual operator-(dual a, const dual& b) { return a -= b; }
+		friend dual operator*(dual a, const dual& b) { return a *= b; }
+		friend dual operator/(dual a, const dual& b) { return a /= b; }
+
+		friend bool operator==(const dual& a, const dual& b) { return a.v == b.v; }
+		friend bool operator!=(const dual& a, const dual& b) { return a.v != b.v; }
+		friend bool operator< (const dual& a, const dual& b) { return a.v <  b.v; }
+		friend bool operator<=(const dual& a, const dual& b) { return a.v <= b.v; }
+		friend bool operator> (const dual& a, const dual& b) { return a.v >  b.v; }
+		friend bool operator>=(const dual& a, const dual& b) { return a.v >= b.v; }
+
+		friend dual sin(const dual& a) { return chain(a, std::sin(a.v), std::cos(a.v)); }
+		friend dual cos(const dual& a) { return chain(a, std::cos(a.v), -std::sin(a.v)); }
+		friend dual fabs(const dual& a) { return chain(a, std::fabs(a.v), (a.v < 0.0) ? -1.0 : 1.0); }
+		friend dual floor(const dual& a) { return chain(a, std::floor(a.v), 0.0); }
+
+		friend dual sqrt(const dual& a)
+		{
+			const double s = std::sqrt(a.v);
+			return chain(a, s, 0.5 / s);
+		}
+
+		friend dual pow(const dual& a, const dual& b)
+		{
+			const double p = std::pow(a.v, b.v);
+			dual c = chain(a, p, (a.v != 0.0) ? b.v * p / a.v : b.v * std::pow(a.v, b.v - 1.0));
+			// the exponent is a constant everywhere in sgp4, only take the log when it is not
+			for (int k = 0; k < N; k++)
+				if (b.d[k] != 0.0)
+					c.d[k] += p * std::log(a.v) * b.d[k];
+			return c;
+		}
+
+		friend dual fmod(const dual& a, const dual& b)
+		{
+			const double q = std::trunc(a.v / b.v);
+			dual c = a - q * b;
+			c.v = std::fmod(a.v, b.v);
+			return c;
+		}
+
+		friend dual atan2(const dual& y, const dual& x)
+		{
+			const double inv = 1.0 / (x.v * x.v + y.v * y.v);
+			dual c(std::atan2(y.v, x.v));
+			for (int k = 0; k < N; k++)
+				c.d[k] = (x.v * y.d[k] - y.v * x.d[k]) * inv;
+			return c;
+		}
+	};
+
+}  // namespace
+
+#endif
@@ -0,0 +1,361 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_ephemeris.cpp
+*
+*    this file contains the chebyshev ephemeris cache. see SGP4_ephemeris.h
+*    for the file layout.
+*
+*    each segment interpolates sgp4 at the chebyshev-lobatto points of the
+*    segment, which include both ends, so neighbouring segments agree at
+*    their common boundary and the position has no jumps. the error of a fit
+*    is checked against sgp4 halfway between the interpolation points, and
+*    the segment length is adapted from it to the tolerance.
+*
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include "SGP4_ephemeris.h"
+
+#define pi 3.14159265358979323846
+
+// written as a native uint32, reads back differently on a machine of the other byte order
+#define SGP4_EPHEMERIS_ENDIAN 0x01020304u
+
+// highest polynomial degree build accepts
+#define SGP4_EPHEMERIS_MAXDEG 32
+
+// shortest segment build tries before giving up                         min
+#define SGP4_EPHEMERIS_MINSEG 1.0e-4
+
+namespace SGP4Funcs
+{
+
+	struct ephemerisheader
+	{
+		char magic[8];          // "SGP4EPHM"
+		uint32_t version;       // SGP4_EPHEMERIS_VERSION
+		uint32_t endian;        // SGP4_EPHEMERIS_ENDIAN
+		uint32_t degree;
+		uint32_t pad;
+		int64_t satnum;
+		uint64_t nseg;
+		double tol;             // km
+		char reserved[16];
+	};
+
+	static const char ephemerismagic[8] = { 'S', 'G', 'P', '4', 'E', 'P', 'H', 'M' };
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure chebyshev_sum
+	*
+	*  this procedure sums a chebyshev series and its derivative with the
+	*    clenshaw recurrence.
+	*
+	*  inputs        :
+	*    c           - coefficients c[0] .. c[deg]
+	*    deg         - degree
+	*    x           - argument, -1 to 1
+	*
+	*  outputs       :
+	*    f           - sum of c[k] T_k(x)
+	*    df          - derivative with respect to x
+	----------------------------------------------------------------------------*/
+
+	static inline void chebyshev_sum(const double c[], int deg, double x, double& f, double& df)
+	{
+		double b1 = 0.0, b2 = 0.0, d1 = 0.0, d2 = 0.0;
+		for (int k = deg; k >= 1; k--)
+		{
+			const double b0 = c[k] + 2.0 * x * b1 - b2;
+			const double d0 = 2.0 * b1 + 2.0 * x * d1 - d2;
+			b2 = b1;
+			b1 = b0;
+			d2 = d1;
+			d1 = d0;
+		}
+		f = c[0] + x * b1 - b2;
+		df = b1 + x * d1 - d2;
+	}  // chebyshev_sum
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function fit_segment
+	*
+	*  this function fits one segment and measures its error.
+	*
+	*  inputs        :
+	*    satrec      - record, propagated in place
+	*    a, b        - segment                                  min
+	*    deg         - degree
+	*
+	*  outputs       :
+	*    c           - 6 * (deg + 1) coefficients, x y z vx vy vz
+	*    err         - largest position error at the check points   km
+	*    return code - false if sgp4 failed inside the segment
+	----------------------------------------------------------------------------*/
+
+	static bool fit_segment(elsetrec& satrec, double a, double b, int deg, double c[], double& err)
+	{
+		double f[6][SGP4_EPHEMERIS_MAXDEG + 1];
+		double r[3], v[3], p, dp;
+		const double mid = 0.5 * (a + b), half = 0.5 * (b - a);
+		int j, k, m;
+
+		// sgp4 at the lobatto points x_j = cos(pi j / deg), in time order
+		for (j = deg; j >= 0; j--)
+		{
+			if (!sgp4(satrec, mid + half * cos(pi * j / deg), r, v) || (satrec.error != 0))
+				return false;
+			for (m = 0; m < 3; m++)
+			{
+				f[m][j] = r[m];
+				f[m + 3][j] = v[m];
+			}
+		}
+
+		// c_k = 2/deg sum'' f_j cos(pi j k / deg), first and last terms halved,
+		// and c_0, c_deg halved again
+		for (m = 0; m < 6; m++)
+			for (k = 0; k <= deg; k++)
+			{
+				double s = 0.5 * (f[m][0] + ((k % 2 == 0) ? f[m][deg] : -f[m][deg]));
+				for (j = 1; j < deg; j++)
+					s += f[m][j] * cos(pi * j * k / deg);
+				s *= 2.0 / deg;
+				if ((k == 0) || (k == deg))
+					s *= 0.5;
+				c[m * (deg + 1) + k] = s;
+			}
+
+		// check halfway between the interpolation points
+		err = 0.0;
+		for (j = deg - 1; j >= 0; j--)
+		{
+			const double x = cos(pi * (j + 0.5) / deg);
+			if (!sgp4(satrec, mid + half * x, r, v) || (satrec.error != 0))
+				return false;
+			double e2 = 0.0;
+			for (m = 0; m < 3; m++)
+			{
+				chebyshev_sum(c + m * (deg + 1), deg, x, p, dp);
+				e2 += (p - r[m]) * (p - r[m]);
+			}
+			err = std::max(err, sqrt(e2));
+		}
+		return true;
+	}  // fit_segment
+
+	sgp4ephemeris::sgp4ephemeris()
+		: deg(0), tol(0.0), satno(0)
+	{
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4ephemeris::build
+	*
+	*  this function fits the ephemeris. segments are laid down from tstart to
+	*    tstop. the first is an eighth of an orbit long, and after every fit
+	*    the length is scaled by 0.9 (tol / err)^(1 / (degree + 1)), capped at
+	*    a doubling, which is how the interpolation error of a smooth function
+	*    scales with the interval. a fit over the tolerance is redone shorter.
+	*
+	*  inputs        :
+	*    satrec      - record initialised by sgp4init (or twoline2rv)
+	*    tstart, tstop - span to cover, minutes since epoch
+	*    tol         - position tolerance                       km
+	*    degree      - polynomial degree, 3 to 32
+	*
+	*  outputs       :
+	*    return code - false if an argument is out of range or sgp4 fails in
+	*                  the span. the ephemeris is left empty then.
+	----------------------------------------------------------------------------*/
+
+	bool sgp4ephemeris::build
+		(
+		const elsetrec& satrec, double tstart, double tstop, double tol,
+		int degree
+		)
+	{
+		elsetrec rec = satrec;
+		std::vector<double> c(6 * (degree + 1));
+		double err;
+
+		bounds.clear();
+		coeffs.clear();
+		deg = degree;
+		this->tol = tol;
+		satno = satrec.satnum;
+		if ((degree < 3) || (degree > SGP4_EPHEMERIS_MAXDEG) || !(tol > 0.0) || !(tstop > tstart))
+			return false;
+
+		double h = std::min(2.0 * pi / rec.no_unkozai / 8.0, tstop - tstart);
+		double t = tstart;
+		bounds.push_back(t);
+		while (t < tstop)
+		{
+			// stretch the segment to the end rather than leave a sliver
+			double b = t + h;
+			if (b + 0.25 * h >= tstop)
+				b = tstop;
+
+			if (!fit_segment(rec, t, b, deg, c.data(), err))
+			{
+				bounds.clear();
+				coeffs.clear();
+				return false;
+			}
+			const double scale = (err > 0.0) ? 0.9 * pow(tol / err, 1.0 / (deg + 1)) : 2.0;
+			if (err > tol)
+			{
+				h = (b - t) * std::max(0.25, std::min(scale, 0.9));
+				if (h < SGP4_EPHEMERIS_MINSEG)
+				{
+					bounds.clear();
+					coeffs.clear();
+					return false;
+				}
+				continue;
+			}
+			coeffs.insert(coeffs.end(), c.begin(), c.end());
+			bounds.push_back(b);
+			h = (b - t) * std::min(scale, 2.0);
+			t = b;
+		}
+		return true;
+	}  // sgp4ephemeris::build
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4ephemeris::evaluate
+	*
+	*  this function evaluates the ephemeris. the segment is found by binary
+	*    search, then each component is one clenshaw sum of degree + 1 terms.
+	*
+	*  inputs        :
+	*    tsince      - minutes since epoch
+	*
+	*  outputs       :
+	*    r           - position                                 km
+	*    v           - velocity                                 km/s
+	*    a           - acceleration, derivative of the velocity km/s2, may be NULL
+	*    return code - false if tsince is outside the span
+	----------------------------------------------------------------------------*/
+
+	bool sgp4ephemeris::evaluate(double tsince, double r[3], double v[3], double a[3]) const
+	{
+		if (bounds.size() < 2 || !(tsince >= bounds.front()) || !(tsince <= bounds.back()))
+			return false;
+
+		int k = (int)(std::upper_bound(bounds.begin(), bounds.end(), tsince) - bounds.begin()) - 1;
+		if (k > (int)bounds.size() - 2)
+			k = (int)bounds.size() - 2;
+		const double mid = 0.5 * (bounds[k] + bounds[k + 1]);
+		const double half = 0.5 * (bounds[k + 1] - bounds[k]);
+		const double x = (tsince - mid) / half;
+		const double* c = coeffs.data() + (size_t)k * 6 * (deg + 1);
+		double dp;
+
+		for (int m = 0; m < 3; m++)
+		{
+			chebyshev_sum(c + m * (deg + 1), deg, x, r[m], dp);
+			chebyshev_sum(c + (m + 3) * (deg + 1), deg, x, v[m], dp);
+			if (a != NULL)
+				a[m] = dp / (half * 60.0);
+		}
+		return true;
+	}  // sgp4ephemeris::evaluate
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4ephemeris::save
+	*
+	*  this function writes the ephemeris to a file.
+	*
+	*  outputs       :
+	*    return code - false if the ephemeris is empty or the file could not
+	*                  be written
+	----------------------------------------------------------------------------*/
+
+	bool sgp4ephemeris::save(const char* filename) const
+	{
+		ephemerisheader hdr;
+		const uint64_t nseg = (uint64_t)segments();
+		bool ok;
+
+		if (nseg == 0)
+			return false;
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, ephemerismagic, 8);
+		hdr.version = SGP4_EPHEMERIS_VERSION;
+		hdr.endian = SGP4_EPHEMERIS_ENDIAN;
+		hdr.degree = (uint32_t)deg;
+		hdr.satnum = (int64_t)satno;
+		hdr.nseg = nseg;
+		hdr.tol = tol;
+
+		FILE* f = fopen(filename, "wb");
+		if (f == NULL)
+			return false;
+		ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1) &&
+			(fwrite(bounds.data(), sizeof(double), bounds.size(), f) == bounds.size()) &&
+			(fwrite(coeffs.data(), sizeof(double), coeffs.size(), f) == coeffs.size());
+		ok = (fclose(f) == 0) && ok;
+		if (!ok)
+			remove(filename);
+		return ok;
+	}  // sgp4ephemeris::save
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4ephemeris::load
+	*
+	*  this function reads an ephemeris written by save.
+	*
+	*  outputs       :
+	*    return code - false if the file is missing, truncated, or from another
+	*                  version or byte order. the ephemeris is left empty then.
+	----------------------------------------------------------------------------*/
+
+	bool sgp4ephemeris::load(const char* filename)
+	{
+		ephemerisheader hdr;
+		bool ok;
+
+		bounds.clear();
+		coeffs.clear();
+		FILE* f = fopen(filename, "rb");
+		if (f == NULL)
+			return false;
+		ok = (fread(&hdr, sizeof(hdr), 1, f) == 1) &&
+			(memcmp(hdr.magic, ephemerismagic, 8) == 0) &&
+			(hdr.version == SGP4_EPHEMERIS_VERSION) &&
+			(hdr.endian == SGP4_EPHEMERIS_ENDIAN) &&
+			(hdr.degree >= 3) && (hdr.degree <= SGP4_EPHEMERIS_MAXDEG) &&
+			(hdr.nseg > 0) && (hdr.nseg < ((uint64_t)1 << 32));
+		if (ok)
+		{
+			bounds.resize((size_t)hdr.nseg + 1);
+			coeffs.resize((size_t)hdr.nseg * 6 * (hdr.degree + 1));
+			ok = (fread(bounds.data(), sizeof(double), bounds.size(), f) == bounds.size()) &&
+				(fread(coeffs.data(), sizeof(double), coeffs.size(), f) == coeffs.size());
+		}
+		fclose(f);
+		if (!ok)
+		{
+			bounds.clear();
+			coeffs.clear();
+			return false;
+		}
+		deg = (int)hdr.degree;
+		satno = (long)hdr.satnum;
+		tol = hdr.tol;
+		return true;
+	}  // sgp4ephemeris::load
+
+}  // namespace SGP4Funcs
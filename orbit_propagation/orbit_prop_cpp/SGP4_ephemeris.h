@@ -0,0 +1,64 @@
+#ifndef _SGP4_ephemeris_h_
+#define _SGP4_ephemeris_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_ephemeris.h
+*
+*    this file contains the chebyshev ephemeris cache. the position from
+*    sgp4 is interpolated over a span with piecewise chebyshev polynomials,
+*    each segment as long as the position tolerance allows, so a dense run of
+*    queries costs a clenshaw sum per query instead of a call to sgp4.
+*    the sgp4 velocity gets its own polynomials on the same segments, since
+*    it is not exactly the derivative of the sgp4 position (the short period
+*    and deep space terms differ by up to a few m/s), and their derivative
+*    gives the acceleration.
+*
+*    file layout (save / load), in the byte order of the machine that wrote it
+*      header      - 64 bytes, see ephemerisheader in SGP4_ephemeris.cpp
+*      bounds      - nseg + 1 segment boundaries, minutes since epoch
+*      coeffs      - nseg * 6 * (degree + 1) chebyshev coefficients, km and km/s
+*
+*       ----------------------------------------------------------------      */
+
+#include <stddef.h>
+#include <vector>
+#include "SGP4.h"
+
+#define SGP4_EPHEMERIS_VERSION 1
+
+namespace SGP4Funcs
+{
+
+	class sgp4ephemeris
+	{
+	public:
+		sgp4ephemeris();
+
+		bool build
+			(
+			const elsetrec& satrec, double tstart, double tstop, double tol,
+			int degree = 12
+			);
+		bool evaluate(double tsince, double r[3], double v[3], double a[3] = NULL) const;
+
+		bool save(const char* filename) const;
+		bool load(const char* filename);
+
+		int segments() const { return bounds.empty() ? 0 : (int)bounds.size() - 1; }
+		int degree() const { return deg; }
+		double start() const { return bounds.empty() ? 0.0 : bounds.front(); }
+		double stop() const { return bounds.empty() ? 0.0 : bounds.back(); }
+		double tolerance() const { return tol; }
+		long satnum() const { return satno; }
+
+	private:
+		int deg;
+		double tol;
+		long satno;
+		std::vector<double> bounds;   // segment k covers bounds[k] to bounds[k + 1]
+		std::vector<double> coeffs;   // segment k, component c (x y z vx vy vz) at ((k * 6) + c) * (deg + 1)
+	};
+
+}  // namespace
+
+#endif
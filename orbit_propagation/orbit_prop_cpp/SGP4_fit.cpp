@@ -0,0 +1,333 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_fit.cpp
+*
+*    this file contains the differential correction of mean elements to
+*    position fixes, see SGP4_fit.h.
+*
+*    every pass runs sgp4_jacobian on chunks of the fixes, shared out to
+*    worker threads. each chunk sums its rows into its own normal equations,
+*    and the chunks are added in order afterwards so the result does not
+*    depend on the number of threads. the 7 x 7 system is solved by cholesky
+*    after scaling it to a unit diagonal. a step that does not lower the rms
+*    is halved.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "SGP4_fit.h"
+#include "SGP4_jacobian.h"
+#include "SGP4_core.h"
+
+#define NX SGP4_JACOBIAN_NX
+
+// fixes per chunk of a pass
+#define SGP4_FIT_CHUNK 256
+
+// relative change of the rms at which the fit has converged
+#define SGP4_FIT_TOL 1.0e-6
+
+// rms at which the fit has converged whatever the change, the roundoff of
+// sgp4 itself is about 1e-10 km                                             km
+#define SGP4_FIT_FLOOR 1.0e-9
+
+// halvings of a step before the fit stops at the best elements so far
+#define SGP4_FIT_HALVINGS 8
+
+namespace SGP4Funcs
+{
+
+	// normal equations of one chunk, lower triangle of a, rhs b, sum of squares
+	struct normaleq
+	{
+		double a[NX][NX], b[NX], rss;
+	};
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function fit_pass
+	*
+	*  this function sums the normal equations of the position residuals over
+	*    all fixes for an initialised record.
+	*
+	*  inputs        :
+	*    satrec      - record at the current elements
+	*    tsince, pos, n - fixes, see sgp4_fit
+	*    nx          - number of elements fitted, 6 leaves out bstar
+	*    nthreads    - worker threads
+	*
+	*  outputs       :
+	*    eq          - normal equations, full matrix
+	*    return code - false if sgp4 reports an error at any fix
+	*
+	*  coupling      :
+	*    sgp4_jacobian
+	----------------------------------------------------------------------------*/
+
+	static bool fit_pass
+		(
+		const elsetrec& satrec, const double tsince[], const double pos[], int n,
+		int nx, int nthreads, normaleq& eq
+		)
+	{
+		const int nchunks = (n + SGP4_FIT_CHUNK - 1) / SGP4_FIT_CHUNK;
+		std::vector<normaleq> part(nchunks);
+		std::atomic<int> next(0);
+		std::atomic<bool> ok(true);
+		int i, j, k, c;
+
+		auto worker = [&]()
+		{
+			std::vector<double> rv(6 * SGP4_FIT_CHUNK), jac(6 * NX * SGP4_FIT_CHUNK);
+			int chunk;
+
+			while ((chunk = next.fetch_add(1)) < nchunks)
+			{
+				const int i0 = chunk * SGP4_FIT_CHUNK;
+				const int m = std::min(SGP4_FIT_CHUNK, n - i0);
+				normaleq& p = part[chunk];
+				int i, j, k, l;
+
+				for (k = 0; k < nx; k++)
+				{
+					p.b[k] = 0.0;
+					for (l = 0; l <= k; l++)
+						p.a[k][l] = 0.0;
+				}
+				p.rss = 0.0;
+				if (!sgp4_jacobian(satrec, &tsince[i0], m, rv.data(), jac.data(), NULL, NULL))
+				{
+					ok = false;
+					continue;
+				}
+
+				for (i = 0; i < m; i++)
+					for (j = 0; j < 3; j++)
+					{
+						const double res = pos[3 * (i0 + i) + j] - rv[6 * i + j];
+						const double* row = &jac[(6 * i + j) * NX];
+						for (k = 0; k < nx; k++)
+						{
+							p.b[k] += row[k] * res;
+							for (l = 0; l <= k; l++)
+								p.a[k][l] += row[k] * row[l];
+						}
+						p.rss += res * res;
+					}
+			}
+		};
+
+		if (nthreads > nchunks)
+			nthreads = nchunks;
+		std::vector<std::thread> pool;
+		for (int t = 1; t < nthreads; t++)
+			pool.push_back(std::thread(worker));
+		worker();
+		for (size_t t = 0; t < pool.size(); t++)
+			pool[t].join();
+		if (!ok)
+			return false;
+
+		for (k = 0; k < nx; k++)
+		{
+			eq.b[k] = 0.0;
+			for (j = 0; j <= k; j++)
+				eq.a[k][j] = 0.0;
+		}
+		eq.rss = 0.0;
+		for (c = 0; c < nchunks; c++)
+		{
+			for (k = 0; k < nx; k++)
+			{
+				eq.b[k] += part[c].b[k];
+				for (j = 0; j <= k; j++)
+					eq.a[k][j] += part[c].a[k][j];
+			}
+			eq.rss += part[c].rss;
+		}
+		for (k = 0; k < nx; k++)
+			for (i = k + 1; i < nx; i++)
+				eq.a[k][i] = eq.a[i][k];
+		return true;
+	}  // fit_pass
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function cholesky_solve
+	*
+	*  this function solves the normal equations for the correction. the
+	*    elements differ by orders of magnitude in scale (no_kozai in rad/min,
+	*    bstar), so the system is first scaled to a unit diagonal.
+	*
+	*  outputs       :
+	*    dx          - correction to the elements
+	*    return code - false if the system is not positive definite
+	----------------------------------------------------------------------------*/
+
+	static bool cholesky_solve(const normaleq& eq, int nx, double dx[NX])
+	{
+		double l[NX][NX], s[NX], y[NX];
+		int i, j, k;
+
+		for (i = 0; i < nx; i++)
+		{
+			if (!(eq.a[i][i] > 0.0))
+				return false;
+			s[i] = 1.0 / sqrt(eq.a[i][i]);
+		}
+
+		for (i = 0; i < nx; i++)
+			for (j = 0; j <= i; j++)
+			{
+				double sum = eq.a[i][j] * s[i] * s[j];
+				for (k = 0; k < j; k++)
+					sum -= l[i][k] * l[j][k];
+				if (i == j)
+				{
+					if (!(sum > 0.0))
+						return false;
+					l[i][i] = sqrt(sum);
+				}
+				else
+					l[i][j] = sum / l[j][j];
+			}
+
+		for (i = 0; i < nx; i++)
+		{
+			double sum = eq.b[i] * s[i];
+			for (k = 0; k < i; k++)
+				sum -= l[i][k] * y[k];
+			y[i] = sum / l[i][i];
+		}
+		for (i = nx - 1; i >= 0; i--)
+		{
+			double sum = y[i];
+			for (k = i + 1; k < nx; k++)
+				sum -= l[k][i] * y[k];
+			y[i] = sum / l[i][i];
+		}
+		for (i = 0; i < nx; i++)
+			dx[i] = y[i] * s[i];
+		return true;
+	}  // cholesky_solve
+
+	// wraps an angle into 0 to 2 pi
+	static double wrap2p(double x)
+	{
+		const double twopi = 2.0 * 3.14159265358979323846;
+		x = fmod(x, twopi);
+		return (x < 0.0) ? x + twopi : x;
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4_fit
+	*
+	*  this function fits the mean elements of a record to position fixes by
+	*    differential correction, starting from the elements in the record.
+	*
+	*  inputs        :
+	*    satrec      - record initialised by sgp4init (or twoline2rv), gives
+	*                  the first guess, epoch, gravity constants and opsmode
+	*    tsince      - times of the fixes since epoch, ascending     min
+	*    pos         - n x 3 positions, row major, teme              km
+	*    n           - number of fixes
+	*    fitbstar    - fit bstar as well, else it is kept
+	*    maxiter     - most passes over the fixes
+	*    nthreads    - number of worker threads, <= 0 for one per core
+	*
+	*  outputs       :
+	*    satrec      - record initialised at the fitted elements
+	*    rms         - rms position residual                         km
+	*    iterations  - passes over the fixes
+	*    return code - false if there are too few fixes, the gravity constants
+	*                  are not wgs72old, wgs72 or wgs84, sgp4 fails at the
+	*                  first guess, the normal equations are singular, or the
+	*                  fit has not converged in maxiter passes or before the
+	*                  step halvings ran out. satrec then holds the best
+	*                  elements found.
+	*
+	*  coupling      :
+	*    findgravconst, sgp4init, fit_pass, cholesky_solve
+	----------------------------------------------------------------------------*/
+
+	bool sgp4_fit
+		(
+		elsetrec& satrec, const double tsince[], const double pos[], int n,
+		double& rms, int& iterations, bool fitbstar, int maxiter,
+		int nthreads
+		)
+	{
+		const int nx = fitbstar ? NX : NX - 1;
+		const double epoch = satrec.jdsatepoch + satrec.jdsatepochF - 2433281.5;
+		const double floorrss = n * SGP4_FIT_FLOOR * SGP4_FIT_FLOOR;
+		gravconsttype whichconst;
+		elsetrec rec = satrec;
+		normaleq eq = normaleq();
+		double x[NX], best[NX], dx[NX], bestrss = HUGE_VAL, scale = 1.0;
+		bool converged = false;
+		int k, halvings = 0;
+
+		rms = 0.0;
+		iterations = 0;
+		if ((3 * n < nx) || (maxiter < 1) || !findgravconst(satrec, whichconst))
+			return false;
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads < 1)
+			nthreads = 1;
+
+		x[0] = satrec.ecco;  x[1] = satrec.argpo;    x[2] = satrec.inclo; x[3] = satrec.mo;
+		x[4] = satrec.no_kozai; x[5] = satrec.nodeo; x[6] = satrec.bstar;
+
+		while (iterations < maxiter)
+		{
+			sgp4init(whichconst, satrec.operationmode, (int)satrec.satnum, epoch, x[6], satrec.ndot,
+				satrec.nddot, x[0], x[1], x[2], x[3], x[4], x[5], rec);
+			const bool ok = (rec.error == 0) && fit_pass(rec, tsince, pos, n, nx, nthreads, eq);
+			iterations++;
+
+			if (ok && ((iterations == 1) || (eq.rss < bestrss)))
+			{
+				converged = (eq.rss <= floorrss) ||
+					((iterations > 1) && (bestrss - eq.rss <= SGP4_FIT_TOL * bestrss));
+				std::copy(x, x + NX, best);
+				bestrss = eq.rss;
+				if (converged)
+					break;
+				if (!cholesky_solve(eq, nx, dx))
+					break;
+				scale = 1.0;
+				halvings = 0;
+			}
+			else
+			{
+				if (iterations == 1)
+					return false;
+				// no better than the best, at the noise floor or halve the step. once
+				// the halvings run out the best elements are kept, but not converged
+				converged = ok && (eq.rss - bestrss <= SGP4_FIT_TOL * bestrss);
+				if (converged || (++halvings > SGP4_FIT_HALVINGS))
+					break;
+				scale = 0.5 * scale;
+			}
+
+			for (k = 0; k < nx; k++)
+				x[k] = best[k] + scale * dx[k];
+			x[0] = std::max(x[0], 0.0);
+			x[1] = wrap2p(x[1]);
+			x[3] = wrap2p(x[3]);
+			x[5] = wrap2p(x[5]);
+		}
+
+		sgp4init(whichconst, satrec.operationmode, (int)satrec.satnum, epoch, best[6], satrec.ndot,
+			satrec.nddot, best[0], best[1], best[2], best[3], best[4], best[5], satrec);
+		rms = sqrt(bestrss / n);
+		return converged;
+	}  // sgp4_fit
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,30 @@
+#ifndef _SGP4_fit_h_
+#define _SGP4_fit_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_fit.h
+*
+*    this file contains the differential correction of a set of mean
+*    elements to timed position fixes (gnss), so a new tle can be made from
+*    tracking data. the elements of the jacobian (SGP4_jacobian.h) are
+*    corrected by gauss newton steps on the position residuals, with the
+*    epoch kept. the fixes are in teme, which the rest of the repo takes as
+*    eci.
+*
+*       ----------------------------------------------------------------      */
+
+#include "SGP4.h"
+
+namespace SGP4Funcs
+{
+
+	bool sgp4_fit
+		(
+		elsetrec& satrec, const double tsince[], const double pos[], int n,
+		double& rms, int& iterations, bool fitbstar = true, int maxiter = 20,
+		int nthreads = 0
+		);
+
+}  // namespace
+
+#endif
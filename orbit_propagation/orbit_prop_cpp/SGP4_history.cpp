@@ -0,0 +1,175 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_history.cpp
+*
+*    this file contains the tle history store, see SGP4_history.h.
+*
+*    epochs are compared as (jd1 - jd2) + (jdF1 - jdF2), so two records a
+*    few seconds apart keep their order at any julian date.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+#include <algorithm>
+#include "SGP4_history.h"
+
+namespace SGP4Funcs
+{
+
+	// days from jd + jdF to the epoch of a record
+	static inline double epoch_offset(const elsetrec& rec, double jd, double jdF)
+	{
+		return (rec.jdsatepoch - jd) + (rec.jdsatepochF - jdF);
+	}
+
+	sgp4history::sgp4history()
+		: nrec(0)
+	{
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4history::add
+	*
+	*  this function puts a record into the history of its satellite, after
+	*    the records with earlier epochs. adding in epoch order appends.
+	*
+	*  inputs        :
+	*    satrec      - record initialised by sgp4init (or twoline2rv)
+	*
+	*  outputs       :
+	*    return code - false if sgp4init reported an error for the record, or
+	*                  the satellite already has a record at the same epoch
+	*                  (the one stored is kept)
+	----------------------------------------------------------------------------*/
+
+	bool sgp4history::add(const elsetrec& satrec)
+	{
+		if (satrec.error != 0)
+			return false;
+
+		std::vector<elsetrec>& recs = sats[satrec.satnum];
+		std::vector<elsetrec>::iterator pos = recs.end();
+		if (!recs.empty() && (epoch_offset(recs.back(), satrec.jdsatepoch, satrec.jdsatepochF) >= 0.0))
+			pos = std::upper_bound(recs.begin(), recs.end(), satrec,
+				[](const elsetrec& a, const elsetrec& b) { return epoch_offset(a, b.jdsatepoch, b.jdsatepochF) < 0.0; });
+		if ((pos != recs.begin()) && (epoch_offset(*(pos - 1), satrec.jdsatepoch, satrec.jdsatepochF) == 0.0))
+			return false;
+
+		recs.insert(pos, satrec);
+		nrec++;
+		return true;
+	}  // add
+
+	int sgp4history::add(const std::vector<elsetrec>& satrecs)
+	{
+		int added = 0;
+		for (size_t i = 0; i < satrecs.size(); i++)
+			added += add(satrecs[i]);
+		return added;
+	}  // add
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4history::nearest
+	*
+	*  this function finds the record of a satellite nearest a time by binary
+	*    search. halfway between two epochs the later record is taken.
+	*
+	*  inputs        :
+	*    recs        - epoch sorted records, not empty
+	*    jd, jdF     - time, julian date
+	*
+	*  outputs       :
+	*    return code - index of the record
+	----------------------------------------------------------------------------*/
+
+	int sgp4history::nearest(const std::vector<elsetrec>& recs, double jd, double jdF)
+	{
+		int lo = 0, hi = (int)recs.size();
+
+		// first record with an epoch after the time
+		while (lo < hi)
+		{
+			const int mid = (lo + hi) / 2;
+			if (epoch_offset(recs[mid], jd, jdF) > 0.0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		if (lo == (int)recs.size())
+			return lo - 1;
+		if (lo == 0)
+			return 0;
+		return (epoch_offset(recs[lo], jd, jdF) <= -epoch_offset(recs[lo - 1], jd, jdF)) ? lo : lo - 1;
+	}  // nearest
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4history::find
+	*
+	*  this function returns the record of a satellite whose epoch is nearest
+	*    a time.
+	*
+	*  inputs        :
+	*    satnum      - satellite number
+	*    jd, jdF     - time, julian date
+	*
+	*  outputs       :
+	*    return code - the record, NULL if the satellite has none
+	----------------------------------------------------------------------------*/
+
+	const elsetrec* sgp4history::find(long satnum, double jd, double jdF) const
+	{
+		std::map<long, std::vector<elsetrec> >::const_iterator it = sats.find(satnum);
+		if ((it == sats.end()) || it->second.empty())
+			return NULL;
+		return &it->second[nearest(it->second, jd, jdF)];
+	}  // find
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4history::propagate
+	*
+	*  this function propagates the record of a satellite nearest a time to
+	*    that time.
+	*
+	*  inputs        :
+	*    satnum      - satellite number
+	*    jd, jdF     - time, julian date
+	*
+	*  outputs       :
+	*    r, v        - teme position and velocity                   km, km/s
+	*    return code - false if the satellite has no record or sgp4 reports
+	*                  an error
+	*
+	*  coupling      :
+	*    sgp4
+	----------------------------------------------------------------------------*/
+
+	bool sgp4history::propagate(long satnum, double jd, double jdF, double r[3], double v[3])
+	{
+		std::map<long, std::vector<elsetrec> >::iterator it = sats.find(satnum);
+		if ((it == sats.end()) || it->second.empty())
+			return false;
+
+		elsetrec& rec = it->second[nearest(it->second, jd, jdF)];
+		return sgp4(rec, -epoch_offset(rec, jd, jdF) * 1440.0, r, v) && (rec.error == 0);
+	}  // propagate
+
+	int sgp4history::records(long satnum) const
+	{
+		std::map<long, std::vector<elsetrec> >::const_iterator it = sats.find(satnum);
+		return (it == sats.end()) ? 0 : (int)it->second.size();
+	}  // records
+
+	std::vector<long> sgp4history::satnums() const
+	{
+		std::vector<long> nums;
+		for (std::map<long, std::vector<elsetrec> >::const_iterator it = sats.begin(); it != sats.end(); ++it)
+			if (!it->second.empty())
+				nums.push_back(it->first);
+		return nums;
+	}  // satnums
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,48 @@
+#ifndef _SGP4_history_h_
+#define _SGP4_history_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_history.h
+*
+*    this file contains the tle history store. every satellite number keeps
+*    its initialised records sorted by epoch, a query takes the record whose
+*    epoch is nearest the query time by binary search, and new records are
+*    put in place without rebuilding the rest. records are kept as added, so
+*    sgp4init is never run again for them, and propagation goes through the
+*    stored record, carrying the deep space integrator state from one query
+*    to the next as a single record would.
+*
+*       ----------------------------------------------------------------      */
+
+#include <map>
+#include <vector>
+#include "SGP4.h"
+
+namespace SGP4Funcs
+{
+
+	class sgp4history
+	{
+	public:
+		sgp4history();
+
+		bool add(const elsetrec& satrec);
+		int add(const std::vector<elsetrec>& satrecs);
+
+		const elsetrec* find(long satnum, double jd, double jdF) const;
+		bool propagate(long satnum, double jd, double jdF, double r[3], double v[3]);
+
+		int size() const { return nrec; }
+		int records(long satnum) const;
+		std::vector<long> satnums() const;
+
+	private:
+		std::map<long, std::vector<elsetrec> > sats;   // epoch sorted records of each satellite
+		int nrec;
+
+		static int nearest(const std::vector<elsetrec>& recs, double jd, double jdF);
+	};
+
+}  // namespace
+
+#endif
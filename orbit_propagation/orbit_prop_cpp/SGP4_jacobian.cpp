@@ -0,0 +1,93 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_jacobian.cpp
+*
+*    this file contains the forward mode partials of sgp4, see
+*    SGP4_jacobian.h. the record is initialised once in dual numbers seeded
+*    with the seven elements and tsince, and then propagated like a double
+*    record, so deep space records carry the integrator state from one time
+*    to the next the same way.
+*
+*       ----------------------------------------------------------------      */
+
+#include "SGP4_jacobian.h"
+#include "SGP4_dual.h"
+#include "SGP4_core.h"
+
+namespace SGP4Funcs
+{
+
+	// the elements, then tsince for rvdot
+	typedef dual<SGP4_JACOBIAN_NX + 1> sgp4dual;
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4_jacobian
+	*
+	*  this function propagates a record to many times and returns the state
+	*    and its partials with respect to the mean elements and bstar.
+	*
+	*  inputs        :
+	*    satrec      - record initialised by sgp4init (or twoline2rv)
+	*    tsince      - times since epoch                            min
+	*    n           - number of times
+	*
+	*  outputs       :
+	*    rv          - n x 6 state, row major                       km, km/s
+	*    jac         - n x 6 x 7 partials, row major, see SGP4_jacobian.h
+	*    rvdot       - n x 6 partials of the state with respect to tsince,
+	*                  per minute, may be NULL
+	*    err         - n error codes of sgp4, may be NULL
+	*    return code - false if any time has an error, or if the gravity
+	*                  constants of satrec are not wgs72old, wgs72 or wgs84, in
+	*                  which case nothing is written
+	*
+	*  coupling      :
+	*    findgravconst, sgp4init_t, sgp4_t
+	----------------------------------------------------------------------------*/
+
+	bool sgp4_jacobian
+		(
+		const elsetrec& satrec, const double tsince[], int n,
+		double rv[], double jac[], double rvdot[], int err[]
+		)
+	{
+		gravconsttype whichconst;
+		elsetrec_t<sgp4dual> rec;
+		sgp4dual r[3], v[3];
+		bool ok = true;
+		int i, j, k;
+
+		if (!findgravconst(satrec, whichconst))
+			return false;
+
+		rec.jdsatepoch = satrec.jdsatepoch;
+		rec.jdsatepochF = satrec.jdsatepochF;
+		sgp4init_t(whichconst, satrec.operationmode, (int)satrec.satnum,
+			satrec.jdsatepoch + satrec.jdsatepochF - 2433281.5, sgp4dual(satrec.bstar, 6),
+			sgp4dual(satrec.ndot), sgp4dual(satrec.nddot), sgp4dual(satrec.ecco, 0),
+			sgp4dual(satrec.argpo, 1), sgp4dual(satrec.inclo, 2), sgp4dual(satrec.mo, 3),
+			sgp4dual(satrec.no_kozai, 4), sgp4dual(satrec.nodeo, 5), rec);
+
+		for (i = 0; i < n; i++)
+		{
+			sgp4_t(rec, sgp4dual(tsince[i], SGP4_JACOBIAN_NX), r, v);
+			if (rec.error != 0)
+				ok = false;
+			if (err != NULL)
+				err[i] = rec.error;
+
+			for (j = 0; j < 6; j++)
+			{
+				const sgp4dual& s = (j < 3) ? r[j] : v[j - 3];
+				rv[6 * i + j] = s.v;
+				for (k = 0; k < SGP4_JACOBIAN_NX; k++)
+					jac[(6 * i + j) * SGP4_JACOBIAN_NX + k] = s.d[k];
+				if (rvdot != NULL)
+					rvdot[6 * i + j] = s.d[SGP4_JACOBIAN_NX];
+			}
+		}
+		return ok;
+	}  // sgp4_jacobian
+
+}  // namespace SGP4Funcs
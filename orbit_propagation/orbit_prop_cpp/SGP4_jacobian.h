@@ -0,0 +1,34 @@
+#ifndef _SGP4_jacobian_h_
+#define _SGP4_jacobian_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_jacobian.h
+*
+*    this file contains the partials of the sgp4 state with respect to the
+*    mean elements and bstar, from one pass of the templated core on dual
+*    numbers (SGP4_dual.h) instead of two propagations per element.
+*
+*    the columns of the jacobian are, in this order
+*      ecco, argpo, inclo, mo, no_kozai, nodeo, bstar
+*    in the units of elsetrec (rad, rad/min, 1/er), the rows are x, y, z in
+*    km and vx, vy, vz in km/s, teme.
+*
+*       ----------------------------------------------------------------      */
+
+#include "SGP4.h"
+
+// elements in the jacobian
+#define SGP4_JACOBIAN_NX 7
+
+namespace SGP4Funcs
+{
+
+	bool sgp4_jacobian
+		(
+		const elsetrec& satrec, const double tsince[], int n,
+		double rv[], double jac[], double rvdot[], int err[]
+		);
+
+}  // namespace
+
+#endif
@@ -0,0 +1,270 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_passes.cpp
+*
+*    this file contains the ground station pass prediction.
+*
+*    from any sample the elevation can change by at most the largest angular
+*    rate the satellite can have as seen from the station, its perigee speed
+*    plus the station speed over its perigee height. the next sample is put
+*    as far out as the elevation could take to reach the mask at that rate,
+*    so no crossing falls between two samples unless the elevation stays
+*    within SGP4_PASS_MINSTEP of time from the mask.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "SGP4_passes.h"
+#include "SGP4_search.h"
+#include "time_functions.h"
+#include "frame_conversions.h"
+
+#define pi 3.14159265358979323846
+
+// radius of the sphere ecef2lla measures altitude from                    km
+#define SGP4_PASS_REARTH 6378.1
+
+// earth rotation rate                                                     rad/s
+#define SGP4_PASS_OMEGA 7.292115e-5
+
+// head room on the elevation rate bound, for the difference between the
+// mean elements it is computed from and the osculating orbit
+#define SGP4_PASS_MARGIN 1.25
+
+// shortest coarse step, bounds the work on passes that graze the mask     s
+#define SGP4_PASS_MINSTEP 1.0
+
+// tolerance of the aos / los / tca refinement                             min
+#define SGP4_PASS_TOL 1.0e-6
+
+// satellite and station pairs a worker takes per visit to the shared counter
+#define SGP4_PASS_CHUNK 4
+
+namespace SGP4Funcs
+{
+
+	// look angles of one satellite from one station
+	struct stationlook
+	{
+		elsetrec rec;
+		double jd0, jd0F;
+		Eigen::Vector3d site;     // station position, ecef          km
+		Eigen::Matrix3d enu;      // ecef to enu at the station
+		double minel;
+		bool ok;                  // false once sgp4 has failed
+		double el, az, range;
+
+		/* elevation above the mask at t minutes past jd0 + jd0F, the look
+		   angles are left in el, az and range */
+		double operator()(double t)
+		{
+			double r[3], v[3];
+			const double tsince = (jd0 - rec.jdsatepoch) * 1440.0 + (jd0F - rec.jdsatepochF) * 1440.0 + t;
+			ok = sgp4(rec, tsince, r, v) && (rec.error == 0);
+			if (!ok)
+				return -pi;
+
+			const double mjd = (jd0 - 2400000.5) + jd0F + t / 1440.0;
+			const Eigen::Vector3d ecef = eci2ecef(MJD2GMST(mjd)) * Eigen::Vector3d(r[0], r[1], r[2]);
+			const Eigen::Vector3d rho = enu * (ecef - site);
+			range = rho.norm();
+			el = asin(rho(2) / range);
+			az = atan2(rho(0), rho(1));
+			if (az < 0.0)
+				az += 2.0 * pi;
+			return el - minel;
+		}
+	};
+
+	// negated elevation, for brent_min
+	struct stationdepression
+	{
+		stationlook& look;
+		double operator()(double t)
+		{
+			return -look(t);
+		}
+	};
+
+	static void add_event(stationlook& look, double t, int sat, int station, int type, std::vector<passevent>& events)
+	{
+		passevent e;
+		look(t);
+		e.t = t;
+		e.sat = sat;
+		e.station = station;
+		e.type = type;
+		e.el = look.el;
+		e.az = look.az;
+		e.range = look.range;
+		events.push_back(e);
+	}
+
+	static bool event_order(const passevent& a, const passevent& b)
+	{
+		if (a.t != b.t)
+			return a.t < b.t;
+		if (a.sat != b.sat)
+			return a.sat < b.sat;
+		if (a.station != b.station)
+			return a.station < b.station;
+		return a.type < b.type;
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure station_passes
+	*
+	*  this procedure finds the passes of one satellite over one station. a
+	*    sign change of the elevation above the mask between two samples is
+	*    refined into an aos or los with illinois_root, and the highest point
+	*    between an aos and its los into a tca with brent_min. a pass that is
+	*    under way at the start has no aos, one still under way at the end no
+	*    los, and the tca is only given when it lies inside the pass.
+	*
+	*  inputs        :
+	*    look        - satellite and station
+	*    span        - minutes to cover
+	*    rate        - bound on the elevation rate                  rad/s
+	*    sat, station - indices for the events
+	*
+	*  outputs       :
+	*    events      - events of the pair are appended in time order
+	----------------------------------------------------------------------------*/
+
+	static void station_passes
+		(
+		stationlook& look, double span, double rate, int sat, int station,
+		std::vector<passevent>& events
+		)
+	{
+		stationdepression depression = { look };
+		double t = 0.0, tn, f, fn, rise = 0.0;
+
+		f = look(t);
+		if (!look.ok)
+			return;
+		while (t < span)
+		{
+			const double dt = std::max(SGP4_PASS_MINSTEP, fabs(f) / rate) / 60.0;
+			tn = std::min(t + dt, span);
+			fn = look(tn);
+			if (!look.ok)
+				return;
+
+			if ((fn >= 0.0) != (f >= 0.0))
+			{
+				const double tr = illinois_root(look, t, tn, f, fn, SGP4_PASS_TOL);
+				if (fn >= 0.0)
+				{
+					add_event(look, tr, sat, station, SGP4_PASS_AOS, events);
+					rise = tr;
+				}
+				else
+				{
+					double fmax;
+					const double tca = brent_min(depression, rise, tr, SGP4_PASS_TOL, fmax);
+					if ((tca - rise > 10.0 * SGP4_PASS_TOL) && (tr - tca > 10.0 * SGP4_PASS_TOL))
+						add_event(look, tca, sat, station, SGP4_PASS_TCA, events);
+					add_event(look, tr, sat, station, SGP4_PASS_LOS, events);
+				}
+			}
+			t = tn;
+			f = fn;
+		}
+	}  // station_passes
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function predict_passes
+	*
+	*  this function predicts the passes of a set of satellites over a set of
+	*    ground stations. the satellite and station pairs are shared out to
+	*    worker threads.
+	*
+	*  inputs        :
+	*    satrecs, nsat - records initialised by sgp4init (or twoline2rv)
+	*    stations, nstation - ground stations
+	*    jd0, jd0F   - start of the prediction, julian date
+	*    span        - length of the prediction                 min
+	*    nthreads    - number of worker threads, <= 0 for one per core
+	*
+	*  outputs       :
+	*    events      - aos, tca and los events of all pairs, sorted by time
+	*    return code - false if an argument is out of range
+	*
+	*  coupling      :
+	*    station_passes, MJD2GMST, eci2ecef, ecef2enu
+	----------------------------------------------------------------------------*/
+
+	bool predict_passes
+		(
+		const elsetrec* satrecs, int nsat, const groundstation* stations, int nstation,
+		double jd0, double jd0F, double span, std::vector<passevent>& events, int nthreads
+		)
+	{
+		events.clear();
+		if ((nsat < 0) || (nstation < 0) || !(span >= 0.0))
+			return false;
+
+		const int nwork = nsat * nstation;
+		std::atomic<int> next(0);
+
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads > (nwork + SGP4_PASS_CHUNK - 1) / SGP4_PASS_CHUNK)
+			nthreads = (nwork + SGP4_PASS_CHUNK - 1) / SGP4_PASS_CHUNK;
+		if (nthreads < 1)
+			nthreads = 1;
+		std::vector<std::vector<passevent> > found(nthreads);
+
+		auto worker = [&](int id)
+		{
+			stationlook look;
+			int start, w;
+
+			look.jd0 = jd0;
+			look.jd0F = jd0F;
+			while ((start = next.fetch_add(SGP4_PASS_CHUNK)) < nwork)
+			{
+				const int stop = std::min(start + SGP4_PASS_CHUNK, nwork);
+				for (w = start; w < stop; w++)
+				{
+					const int s = w / nstation, k = w % nstation;
+					const groundstation& gs = stations[k];
+					const double rs = SGP4_PASS_REARTH + gs.alt;
+
+					look.rec = satrecs[s];
+					look.site = Eigen::Vector3d(rs * cos(gs.lat) * cos(gs.lon), rs * cos(gs.lat) * sin(gs.lon), rs * sin(gs.lat));
+					look.enu = ecef2enu(gs.lat, gs.lon);
+					look.minel = gs.minel;
+
+					// largest angular rate seen from the station, at perigee straight overhead
+					const elsetrec& rec = look.rec;
+					const double rp = rec.a * rec.radiusearthkm * (1.0 - rec.ecco);
+					const double vp = sqrt(rec.mu * (1.0 + rec.ecco) / rp);
+					const double hp = std::max(rp - rs, 100.0);
+					const double rate = SGP4_PASS_MARGIN * (vp + SGP4_PASS_OMEGA * rs) / hp;
+
+					station_passes(look, span, rate, s, k, found[id]);
+				}
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (int t = 1; t < nthreads; t++)
+			pool.push_back(std::thread(worker, t));
+		worker(0);
+		for (size_t t = 0; t < pool.size(); t++)
+			pool[t].join();
+
+		for (int t = 0; t < nthreads; t++)
+			events.insert(events.end(), found[t].begin(), found[t].end());
+		std::sort(events.begin(), events.end(), event_order);
+		return true;
+	}  // predict_passes
+
+}  // namespace SGP4Funcs
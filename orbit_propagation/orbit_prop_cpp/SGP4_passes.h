@@ -0,0 +1,54 @@
+#ifndef _SGP4_passes_h_
+#define _SGP4_passes_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_passes.h
+*
+*    this file contains the ground station pass prediction. every satellite
+*    and station pair is stepped through the time span with a step as long
+*    as the elevation can not reach the mask in it, and the crossings of the
+*    mask (aos, los) and the highest point of each pass (tca) are refined by
+*    root finding and brent's method.
+*
+*    the look angles follow the rest of the gnc code: teme is taken as eci
+*    and turned to ecef with eci2ecef(MJD2GMST), and stations sit on the
+*    6378.1 km sphere of ecef2lla, oriented with ecef2enu.
+*
+*       ----------------------------------------------------------------      */
+
+#include <vector>
+#include "SGP4.h"
+
+#define SGP4_PASS_AOS 0
+#define SGP4_PASS_TCA 1
+#define SGP4_PASS_LOS 2
+
+namespace SGP4Funcs
+{
+
+	struct groundstation
+	{
+		double lat, lon;    // geocentric latitude and longitude               rad
+		double alt;         // height above the 6378.1 km sphere               km
+		double minel;       // elevation mask                                  rad
+	};
+
+	// one event of a pass
+	struct passevent
+	{
+		double t;           // minutes past jd0 + jd0F
+		int sat, station;   // indices into the satellites and stations
+		int type;           // SGP4_PASS_AOS, SGP4_PASS_TCA or SGP4_PASS_LOS
+		double el, az;      // elevation and azimuth (from north, east positive)   rad
+		double range;       //                                                 km
+	};
+
+	bool predict_passes
+		(
+		const elsetrec* satrecs, int nsat, const groundstation* stations, int nstation,
+		double jd0, double jd0F, double span, std::vector<passevent>& events, int nthreads = 0
+		);
+
+}  // namespace
+
+#endif
@@ -0,0 +1,621 @@
+//
+// Python bindings for the SGP4 C++ implementation (SGP4.cpp, SGP4_batch.cpp, ...).
+// Kept apart from SGP4.cpp so the propagator can also be linked into plain C++ executables.
+//
+
+#include "SGP4.h"
+#include "SGP4_batch.h"
+#include "SGP4_catalog.h"
+#include "SGP4_tlefile.h"
+#include "SGP4_snapshot.h"
+#include "SGP4_conjunction.h"
+#include "SGP4_passes.h"
+#include "SGP4_ephemeris.h"
+#include "SGP4_checkpoint.h"
+#include "SGP4_jacobian.h"
+#include "SGP4_fit.h"
+#include "SGP4_history.h"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <stdexcept>
+#include <../../pybind11/include/pybind11/pybind11.h>
+#include <../../pybind11/include/pybind11/stl.h>
+#include <../../pybind11/include/pybind11/numpy.h>
+
+namespace py = pybind11;
+
+static void copy_tle_line(const std::string& line, char longstr[130]){
+    // twoline2rv edits the buffer in place and reads up to column 69, so hand it a zero padded copy
+    memset(longstr, 0, 130);
+    strncpy(longstr, line.c_str(), 129);
+}
+
+elsetrec twoline2rv_py(std::string line1, std::string line2, int whichcon){
+    /*
+    Parses a TLE and initializes SGP4 for it (improved mode).
+    Inputs:
+    line1, line2 - the two lines of the TLE
+    whichcon - gravity constants to use, 721, 72 or 84
+    Outputs:
+    satrec - initialized satellite record
+    */
+    char longstr1[130], longstr2[130];
+    double startmfe, stopmfe, deltamin;
+    elsetrec satrec;
+
+    copy_tle_line(line1, longstr1);
+    copy_tle_line(line2, longstr2);
+    // catalog run type so twoline2rv doesn't prompt for start/stop times on stdin
+    SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', 'i', SGP4Funcs::get_gravconsttype(whichcon),
+                          startmfe, stopmfe, deltamin, satrec);
+    return satrec;
+}
+
+std::tuple<std::vector<double>, std::vector<double>> sgp4_py(elsetrec& satrec, double tsince){
+    /*
+    Propagates the satellite to tsince minutes past epoch.
+    Outputs:
+    r - position in TEME [km]
+    v - velocity in TEME [km/s]
+    satrec.error holds the SGP4 error code
+    */
+    double r[3], v[3];
+    SGP4Funcs::sgp4(satrec, tsince, r, v);
+    return std::make_tuple(std::vector<double>(r, r + 3), std::vector<double>(v, v + 3));
+}
+
+py::array_t<double> sgp4_batch_py(elsetrec& satrec, py::array_t<double, py::array::c_style | py::array::forcecast> tsince){
+    /*
+    Propagates the satellite to every time in tsince (minutes past epoch).
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s]. Each column is contiguous
+             (structure of arrays), and rows where SGP4 reported an error are NaN.
+    */
+    const int n = (int) tsince.size();
+    py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+    std::vector<int> err(n);
+    double* s = states.mutable_data();
+
+    SGP4Funcs::sgp4_batch(satrec, tsince.data(), n, s, s + n, s + 2 * n, s + 3 * n, s + 4 * n, s + 5 * n, err.data());
+
+    for (int i = 0; i < n; i++) {
+        if (err[i] != 0) {
+            for (int j = 0; j < 6; j++) {
+                s[i + j * n] = NAN;
+            }
+        }
+    }
+    return states;
+}
+
+py::array_t<float> sgp4_batch_float_py(const elsetrec& satrec,
+                                       py::array_t<float, py::array::c_style | py::array::forcecast> tsince){
+    /*
+    Re-initializes the satellite in single precision and propagates it to every time in tsince
+    (minutes past epoch) in float, as flight code without a double precision FPU would.
+    Outputs:
+    states - N x 6 float32 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], NaN rows where SGP4 reported an error
+    */
+    SGP4Funcs::elsetrec_t<float> rec;
+    if (!SGP4Funcs::sgp4init_from(satrec, rec)) {
+        throw std::runtime_error("sgp4_batch_float: satrec does not use wgs72old, wgs72 or wgs84 constants");
+    }
+    const int n = (int) tsince.size();
+    py::array_t<float> states({(size_t) n, (size_t) 6}, {sizeof(float), n * sizeof(float)});
+    std::vector<int> err(n);
+    float* s = states.mutable_data();
+
+    SGP4Funcs::sgp4_batch(rec, tsince.data(), n, s, s + n, s + 2 * n, s + 3 * n, s + 4 * n, s + 5 * n, err.data());
+
+    for (int i = 0; i < n; i++) {
+        if (err[i] != 0) {
+            for (int j = 0; j < 6; j++) {
+                s[i + j * n] = NAN;
+            }
+        }
+    }
+    return states;
+}
+
+std::tuple<py::array_t<double>, py::array_t<double>, py::array_t<double>> sgp4_jacobian_py(
+        const elsetrec& satrec, py::array_t<double, py::array::c_style | py::array::forcecast> tsince){
+    /*
+    Propagates to every time in tsince (minutes past epoch) in dual numbers, giving the partials of the
+    state with respect to the mean elements and bstar in the same pass.
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s]
+    jacobian - N x 6 x 7 partials with respect to [ecco, argpo, inclo, mo, no_kozai, nodeo, bstar]
+               in the units of elsetrec [rad, rad/min, 1/earth radii]
+    rates - N x 6 partials with respect to tsince [per minute]
+    Rows where SGP4 reported an error are NaN in all three.
+    */
+    gravconsttype whichconst;
+    if (!SGP4Funcs::findgravconst(satrec, whichconst)) {
+        throw std::runtime_error("sgp4_jacobian: satrec does not use wgs72old, wgs72 or wgs84 constants");
+    }
+    const int n = (int) tsince.size();
+    py::array_t<double> states({(size_t) n, (size_t) 6});
+    py::array_t<double> jac({(size_t) n, (size_t) 6, (size_t) SGP4_JACOBIAN_NX});
+    py::array_t<double> rates({(size_t) n, (size_t) 6});
+    std::vector<int> err(n);
+    double* s = states.mutable_data();
+    double* J = jac.mutable_data();
+    double* d = rates.mutable_data();
+    const double* t = tsince.data();
+    {
+        py::gil_scoped_release release;
+        SGP4Funcs::sgp4_jacobian(satrec, t, n, s, J, d, err.data());
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (err[i] != 0) {
+            for (int j = 0; j < 6; j++) {
+                s[6 * i + j] = d[6 * i + j] = NAN;
+            }
+            for (int j = 0; j < 6 * SGP4_JACOBIAN_NX; j++) {
+                J[6 * SGP4_JACOBIAN_NX * i + j] = NAN;
+            }
+        }
+    }
+    return std::make_tuple(states, jac, rates);
+}
+
+std::tuple<elsetrec, double, int> sgp4_fit_py(const elsetrec& satrec,
+                                              py::array_t<double, py::array::c_style | py::array::forcecast> tsince,
+                                              py::array_t<double, py::array::c_style | py::array::forcecast> positions,
+                                              bool fit_bstar, int maxiter, int nthreads){
+    /*
+    Fits the mean elements to position fixes by differential correction, starting from satrec.
+    Inputs:
+    satrec - first guess, also gives the epoch and the gravity constants
+    tsince - N times of the fixes (minutes past epoch), ascending
+    positions - N x 3 positions in TEME [km]
+    Outputs:
+    satrec - record initialized at the fitted elements
+    rms - rms position residual [km]
+    iterations - passes over the fixes
+    */
+    const int n = (int) tsince.size();
+    if (positions.ndim() != 2 || positions.shape(0) != n || positions.shape(1) != 3) {
+        throw std::invalid_argument("sgp4_fit: positions must be N x 3, with N the length of tsince");
+    }
+    elsetrec rec = satrec;
+    double rms;
+    int iterations;
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = SGP4Funcs::sgp4_fit(rec, tsince.data(), positions.data(), n, rms, iterations, fit_bstar, maxiter,
+                                 nthreads);
+    }
+    if (!ok) {
+        throw std::runtime_error("sgp4_fit: no fit, too few fixes, sgp4 failed, singular normal equations or "
+                                 "no convergence");
+    }
+    return std::make_tuple(rec, rms, iterations);
+}
+
+std::tuple<std::vector<elsetrec>, std::vector<std::tuple<long, long, int>>> load_tle_file_py(std::string filename,
+                                                                                          int whichcon, bool checksum,
+                                                                                          int nthreads){
+    /*
+    Loads every TLE of a 2LE or 3LE file and initializes SGP4 for it (improved mode).
+    Outputs:
+    satrecs - initialized satellite records, in file order
+    errors - (line, satnum, code) of every rejected record, see SGP4_tlefile.h for the codes
+    */
+    std::vector<elsetrec> satrecs;
+    std::vector<SGP4Funcs::tleerror> errors;
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = SGP4Funcs::load_tle_file(filename.c_str(), SGP4Funcs::get_gravconsttype(whichcon), 'i',
+                                      satrecs, errors, checksum, nthreads);
+    }
+    if (!ok) {
+        throw std::runtime_error("could not read " + filename);
+    }
+    std::vector<std::tuple<long, long, int>> errs;
+    for (size_t i = 0; i < errors.size(); i++) {
+        errs.push_back(std::make_tuple(errors[i].line, errors[i].satnum, errors[i].code));
+    }
+    return std::make_tuple(satrecs, errs);
+}
+
+std::tuple<std::vector<elsetrec>, std::vector<std::tuple<long, long, int>>> load_tle_cached_py(std::string tlefile,
+                                                                                            std::string cachefile,
+                                                                                            int whichcon, bool checksum,
+                                                                                            int nthreads){
+    /*
+    Same as load_tle_file, but reuses the snapshot in cachefile when it was made from the same TLE text and
+    constants, and (re)writes it otherwise.
+    */
+    SGP4Funcs::sgp4snapshot snap;
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = SGP4Funcs::load_tle_cached(tlefile.c_str(), cachefile.c_str(), SGP4Funcs::get_gravconsttype(whichcon), 'i',
+                                        snap, checksum, nthreads);
+    }
+    if (!ok) {
+        throw std::runtime_error("could not read " + tlefile);
+    }
+    std::vector<std::tuple<long, long, int>> errs;
+    for (int i = 0; i < snap.nerrors(); i++) {
+        errs.push_back(std::make_tuple(snap.errors()[i].line, snap.errors()[i].satnum, snap.errors()[i].code));
+    }
+    return std::make_tuple(std::vector<elsetrec>(snap.records(), snap.records() + snap.size()), errs);
+}
+
+std::tuple<py::array_t<double>, py::array_t<int>> catalog_propagate_py(SGP4Funcs::sgp4catalog& catalog, double jd,
+                                                                        double jdF, int nthreads){
+    /*
+    Propagates every satellite of the catalog to the julian date jd + jdF.
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], in the order the records were given
+    err - N array of SGP4 error codes, rows with a non-zero code are not meaningful
+    */
+    const int n = catalog.size();
+    py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+    py::array_t<int> err(n);
+    double* s = states.mutable_data();
+    int* e = err.mutable_data();
+    {
+        py::gil_scoped_release release;
+        catalog.propagate(jd, jdF, s, s + n, s + 2 * n, s + 3 * n, s + 4 * n, s + 5 * n, e, nthreads);
+    }
+    return std::make_tuple(states, err);
+}
+
+std::vector<std::tuple<int, int, double, double, double>> screen_conjunctions_py(const std::vector<elsetrec>& satrecs,
+                                                                                double jd, double jdF, double span,
+                                                                                double step, double threshold,
+                                                                                int primary, int nthreads){
+    /*
+    Screens the satellites for close approaches from julian date jd + jdF over span minutes.
+    Inputs:
+    step - coarse grid step [min]
+    threshold - report approaches closer than this [km]
+    primary - index of the satellite to screen against all others, -1 for all pairs
+    Outputs:
+    events - (i, j, tca [min past jd + jdF], miss distance [km], relative speed [km/s]), sorted by tca
+    */
+    std::vector<SGP4Funcs::conjunction> events;
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = SGP4Funcs::screen_conjunctions(satrecs.data(), (int) satrecs.size(), jd, jdF, span, step, threshold,
+                                            events, primary, nthreads);
+    }
+    if (!ok) {
+        throw std::invalid_argument("screen_conjunctions: span, step, threshold or primary out of range");
+    }
+    std::vector<std::tuple<int, int, double, double, double>> out;
+    for (size_t e = 0; e < events.size(); e++) {
+        out.push_back(std::make_tuple(events[e].i, events[e].j, events[e].tca, events[e].dmin, events[e].vrel));
+    }
+    return out;
+}
+
+std::vector<std::tuple<double, int, int, int, double, double, double>> predict_passes_py(
+        const std::vector<elsetrec>& satrecs, const std::vector<std::tuple<double, double, double, double>>& stations,
+        double jd, double jdF, double span, int nthreads){
+    /*
+    Predicts the passes of the satellites over the ground stations from julian date jd + jdF over span minutes.
+    Inputs:
+    stations - (latitude [rad], longitude [rad], altitude [km], elevation mask [rad]) of every station
+    Outputs:
+    events - (t [min past jd + jdF], satellite, station, type, elevation [rad], azimuth [rad], range [km]),
+             sorted by time. type is PASS_AOS, PASS_TCA (highest elevation) or PASS_LOS.
+    */
+    std::vector<SGP4Funcs::groundstation> gs(stations.size());
+    for (size_t k = 0; k < stations.size(); k++) {
+        gs[k].lat = std::get<0>(stations[k]);
+        gs[k].lon = std::get<1>(stations[k]);
+        gs[k].alt = std::get<2>(stations[k]);
+        gs[k].minel = std::get<3>(stations[k]);
+    }
+    std::vector<SGP4Funcs::passevent> events;
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = SGP4Funcs::predict_passes(satrecs.data(), (int) satrecs.size(), gs.data(), (int) gs.size(), jd, jdF,
+                                       span, events, nthreads);
+    }
+    if (!ok) {
+        throw std::invalid_argument("predict_passes: span out of range");
+    }
+    std::vector<std::tuple<double, int, int, int, double, double, double>> out;
+    for (size_t e = 0; e < events.size(); e++) {
+        out.push_back(std::make_tuple(events[e].t, events[e].sat, events[e].station, events[e].type, events[e].el,
+                                      events[e].az, events[e].range));
+    }
+    return out;
+}
+
+void ephemeris_build_py(SGP4Funcs::sgp4ephemeris& eph, const elsetrec& satrec, double tstart, double tstop, double tol,
+                        int degree){
+    /*
+    Fits the ephemeris to sgp4 from tstart to tstop (minutes since epoch) within tol [km] of position
+    */
+    bool ok;
+    {
+        py::gil_scoped_release release;
+        ok = eph.build(satrec, tstart, tstop, tol, degree);
+    }
+    if (!ok) {
+        throw std::runtime_error("sgp4ephemeris.build: bad arguments or sgp4 failed in the span");
+    }
+}
+
+py::array_t<double> ephemeris_evaluate_py(const SGP4Funcs::sgp4ephemeris& eph,
+                                          py::array_t<double, py::array::c_style | py::array::forcecast> tsince){
+    /*
+    Evaluates the ephemeris at every time in tsince (minutes since epoch).
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], NaN rows outside the span
+    */
+    const int n = (int) tsince.size();
+    py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+    double* s = states.mutable_data();
+    const double* t = tsince.data();
+    {
+        py::gil_scoped_release release;
+        double r[3], v[3];
+        for (int i = 0; i < n; i++) {
+            if (!eph.evaluate(t[i], r, v)) {
+                r[0] = r[1] = r[2] = v[0] = v[1] = v[2] = NAN;
+            }
+            for (int j = 0; j < 3; j++) {
+                s[i + j * n] = r[j];
+                s[i + (j + 3) * n] = v[j];
+            }
+        }
+    }
+    return states;
+}
+
+py::array_t<double> checkpoints_propagate_py(SGP4Funcs::sgp4checkpoints& table,
+                                             py::array_t<double, py::array::c_style | py::array::forcecast> tsince){
+    /*
+    Propagates to every time in tsince (minutes since epoch), in any order, through the checkpoint table.
+    The table grows as the times reach further from epoch, so the GIL stays held.
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], NaN rows where SGP4 reported an error
+    */
+    const int n = (int) tsince.size();
+    py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+    double* s = states.mutable_data();
+    const double* t = tsince.data();
+    double r[3], v[3];
+    for (int i = 0; i < n; i++) {
+        if (!table.propagate(t[i], r, v) || table.satrec().error != 0) {
+            r[0] = r[1] = r[2] = v[0] = v[1] = v[2] = NAN;
+        }
+        for (int j = 0; j < 3; j++) {
+            s[i + j * n] = r[j];
+            s[i + (j + 3) * n] = v[j];
+        }
+    }
+    return states;
+}
+
+py::array_t<double> history_propagate_py(SGP4Funcs::sgp4history& history, long satnum,
+                                         py::array_t<double, py::array::c_style | py::array::forcecast> jd,
+                                         py::array_t<double, py::array::c_style | py::array::forcecast> jdF){
+    /*
+    Propagates a satellite to every julian date jd + jdF, each time from its record with the nearest epoch.
+    The stored records carry the deep space integrator state from call to call, so the GIL stays held.
+    Outputs:
+    states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], NaN rows where the satellite has no
+             record or SGP4 reported an error
+    */
+    const int n = (int) jd.size();
+    if ((int) jdF.size() != n) {
+        throw std::invalid_argument("sgp4history.propagate: jd and jdF must have the same length");
+    }
+    py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+    double* s = states.mutable_data();
+    const double* a = jd.data();
+    const double* b = jdF.data();
+    double r[3], v[3];
+    for (int i = 0; i < n; i++) {
+        if (!history.propagate(satnum, a[i], b[i], r, v)) {
+            r[0] = r[1] = r[2] = v[0] = v[1] = v[2] = NAN;
+        }
+        for (int j = 0; j < 3; j++) {
+            s[i + j * n] = r[j];
+            s[i + (j + 3) * n] = v[j];
+        }
+    }
+    return states;
+}
+
+// A satellite built once from its TLE, so repeated propagation doesn't parse the lines and run sgp4init again.
+class Satellite {
+public:
+    Satellite(std::string line1, std::string line2, int whichcon){
+        satrec = twoline2rv_py(line1, line2, whichcon);
+        if (satrec.error != 0) {
+            throw std::runtime_error("sgp4init failed for satellite " + std::to_string(satrec.satnum) +
+                                     ", error " + std::to_string(satrec.error));
+        }
+    }
+
+    py::array_t<double> propagate(py::array_t<double, py::array::c_style | py::array::forcecast> minutes) const {
+        /*
+        Propagates the satellite to every time in minutes (minutes past the TLE epoch).
+        Outputs:
+        states - N x 6 array of [x, y, z, vx, vy, vz] in TEME [km, km/s], NaN rows where SGP4 reported an error
+        */
+        const int n = (int) minutes.size();
+        py::array_t<double> states({(size_t) n, (size_t) 6}, {sizeof(double), n * sizeof(double)});
+        std::vector<int> err(n);
+        double* s = states.mutable_data();
+        const double* t = minutes.data();
+        {
+            py::gil_scoped_release release;
+            // sgp4 updates the record (deep space integrator, error code), so work on a copy and
+            // leave this object safe to share between python threads
+            elsetrec rec = satrec;
+            SGP4Funcs::sgp4_batch(rec, t, n, s, s + n, s + 2 * n, s + 3 * n, s + 4 * n, s + 5 * n, err.data());
+            for (int i = 0; i < n; i++) {
+                if (err[i] != 0) {
+                    for (int j = 0; j < 6; j++) {
+                        s[i + j * n] = NAN;
+                    }
+                }
+            }
+        }
+        return states;
+    }
+
+    double minutes_since_epoch(int year, int mon, int day, int hr, int minute, double sec) const {
+        /*
+        Returns the minutes from the TLE epoch to the given UTC date, the time argument propagate expects
+        */
+        double jd, jdFrac;
+        SGP4Funcs::jday(year, mon, day, hr, minute, sec, jd, jdFrac);
+        return (jd - satrec.jdsatepoch) * 1440.0 + (jdFrac - satrec.jdsatepochF) * 1440.0;
+    }
+
+    elsetrec satrec;
+};
+
+std::tuple<double, double, double, double, double, double, double, double> getgravconst_py(int whichcon){
+    /*
+    Returns (tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2) for the requested constants (721, 72 or 84)
+    */
+    double tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2;
+    SGP4Funcs::getgravconst(SGP4Funcs::get_gravconsttype(whichcon), tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+    return std::make_tuple(tumin, mu, radiusearthkm, xke, j2, j3, j4, j3oj2);
+}
+
+// Bind functions to Python using Pybind
+// Paul DeTrempe, detrempe@stanford.edu
+PYBIND11_MODULE(SGP4_cpp, m) {
+    m.doc() = "SGP4 C++ implementation"; // optional module docstring
+
+    py::class_<elsetrec>(m, "elsetrec")
+        .def(py::init<>())
+        .def_readonly("satnum", &elsetrec::satnum)
+        .def_readonly("error", &elsetrec::error)
+        .def_readonly("method", &elsetrec::method)
+        .def_readonly("irez", &elsetrec::irez)
+        .def_readonly("operationmode", &elsetrec::operationmode)
+        .def_readonly("epochyr", &elsetrec::epochyr)
+        .def_readonly("epochdays", &elsetrec::epochdays)
+        .def_readonly("jdsatepoch", &elsetrec::jdsatepoch)
+        .def_readonly("jdsatepochF", &elsetrec::jdsatepochF)
+        .def_readonly("bstar", &elsetrec::bstar)
+        .def_readonly("inclo", &elsetrec::inclo)
+        .def_readonly("nodeo", &elsetrec::nodeo)
+        .def_readonly("ecco", &elsetrec::ecco)
+        .def_readonly("argpo", &elsetrec::argpo)
+        .def_readonly("mo", &elsetrec::mo)
+        .def_readonly("no_kozai", &elsetrec::no_kozai)
+        .def_readonly("no_unkozai", &elsetrec::no_unkozai)
+        .def_readonly("a", &elsetrec::a)
+        .def_readonly("t", &elsetrec::t);
+
+    py::class_<SGP4Funcs::sgp4catalog>(m, "sgp4catalog")
+        .def(py::init<const std::vector<elsetrec>&>())
+        .def("size", &SGP4Funcs::sgp4catalog::size)
+        .def("propagate", &catalog_propagate_py, "Propagates every satellite to julian date jd + jdF, returns (N x 6 states, N errors)",
+             py::arg("jd"), py::arg("jdF"), py::arg("nthreads") = 0);
+
+    py::class_<SGP4Funcs::sgp4ephemeris>(m, "sgp4ephemeris")
+        .def(py::init<>())
+        .def("build", &ephemeris_build_py, "Fits piecewise Chebyshev segments to sgp4 from tstart to tstop (minutes since epoch)",
+             py::arg("satrec"), py::arg("tstart"), py::arg("tstop"), py::arg("tol"), py::arg("degree") = 12)
+        .def("evaluate", &ephemeris_evaluate_py, "Evaluates at an array of times (minutes since epoch), returns N x 6 states",
+             py::arg("tsince"))
+        .def("save", [](const SGP4Funcs::sgp4ephemeris& eph, std::string filename) {
+                 if (!eph.save(filename.c_str())) {
+                     throw std::runtime_error("could not write " + filename);
+                 }
+             }, py::arg("filename"))
+        .def("load", [](SGP4Funcs::sgp4ephemeris& eph, std::string filename) {
+                 if (!eph.load(filename.c_str())) {
+                     throw std::runtime_error("could not read an ephemeris from " + filename);
+                 }
+             }, py::arg("filename"))
+        .def("segments", &SGP4Funcs::sgp4ephemeris::segments)
+        .def("degree", &SGP4Funcs::sgp4ephemeris::degree)
+        .def("start", &SGP4Funcs::sgp4ephemeris::start)
+        .def("stop", &SGP4Funcs::sgp4ephemeris::stop)
+        .def("tolerance", &SGP4Funcs::sgp4ephemeris::tolerance)
+        .def("satnum", &SGP4Funcs::sgp4ephemeris::satnum);
+
+    py::class_<SGP4Funcs::sgp4checkpoints>(m, "sgp4checkpoints")
+        .def(py::init<>())
+        .def("init", [](SGP4Funcs::sgp4checkpoints& table, const elsetrec& satrec, int interval) {
+                 if (!table.init(satrec, interval)) {
+                     throw std::invalid_argument("sgp4checkpoints.init: interval must be at least 1");
+                 }
+             }, "Starts an empty checkpoint table for satrec, one checkpoint every interval 720 minute steps",
+             py::arg("satrec"), py::arg("interval") = 1)
+        .def("propagate", &checkpoints_propagate_py, "Propagates to an array of times (minutes since epoch), returns N x 6 states",
+             py::arg("tsince"))
+        .def("checkpoints", &SGP4Funcs::sgp4checkpoints::checkpoints)
+        .def("interval", &SGP4Funcs::sgp4checkpoints::interval)
+        .def("satrec", &SGP4Funcs::sgp4checkpoints::satrec);
+
+    py::class_<SGP4Funcs::sgp4history>(m, "sgp4history")
+        .def(py::init<>())
+        .def("add", (bool (SGP4Funcs::sgp4history::*)(const elsetrec&)) &SGP4Funcs::sgp4history::add,
+             "Adds an initialized record, False if sgp4init failed for it or its satellite has one at the same epoch",
+             py::arg("satrec"))
+        .def("add_all", (int (SGP4Funcs::sgp4history::*)(const std::vector<elsetrec>&)) &SGP4Funcs::sgp4history::add,
+             "Adds a list of initialized records, returns how many were added", py::arg("satrecs"))
+        .def("find", [](const SGP4Funcs::sgp4history& history, long satnum, double jd, double jdF) -> py::object {
+                 const elsetrec* rec = history.find(satnum, jd, jdF);
+                 return (rec == NULL) ? py::object(py::none()) : py::cast(*rec);
+             }, "Returns a copy of the record with the epoch nearest jd + jdF, None if the satellite has none",
+             py::arg("satnum"), py::arg("jd"), py::arg("jdF"))
+        .def("propagate", &history_propagate_py,
+             "Propagates to arrays of julian dates jd + jdF from the nearest records, returns N x 6 states",
+             py::arg("satnum"), py::arg("jd"), py::arg("jdF"))
+        .def("size", &SGP4Funcs::sgp4history::size)
+        .def("records", &SGP4Funcs::sgp4history::records, py::arg("satnum"))
+        .def("satnums", &SGP4Funcs::sgp4history::satnums);
+
+    py::class_<Satellite>(m, "Satellite")
+        .def(py::init<std::string, std::string, int>(), py::arg("line1"), py::arg("line2"), py::arg("whichcon") = 72)
+        .def("propagate", &Satellite::propagate, "Propagates to an array of times (minutes past the TLE epoch), returns N x 6 states",
+             py::arg("minutes"))
+        .def("minutes_since_epoch", &Satellite::minutes_since_epoch, "Minutes from the TLE epoch to a UTC date",
+             py::arg("year"), py::arg("mon"), py::arg("day"), py::arg("hr"), py::arg("minute"), py::arg("sec"))
+        .def_readonly("satrec", &Satellite::satrec);
+
+    m.def("twoline2rv", &twoline2rv_py, "Function for converting TLE to SGP4 satellite struct");
+    m.def("load_tle_file", &load_tle_file_py, "Loads a 2LE/3LE file, returns (satrecs, [(line, satnum, error code)])",
+          py::arg("filename"), py::arg("whichcon") = 72, py::arg("checksum") = true, py::arg("nthreads") = 0);
+    m.def("load_tle_cached", &load_tle_cached_py, "load_tle_file through a binary snapshot of the initialized records",
+          py::arg("tlefile"), py::arg("cachefile"), py::arg("whichcon") = 72, py::arg("checksum") = true,
+          py::arg("nthreads") = 0);
+    m.def("screen_conjunctions", &screen_conjunctions_py,
+          "Screens for close approaches, returns [(i, j, tca [min], miss distance [km], relative speed [km/s])]",
+          py::arg("satrecs"), py::arg("jd"), py::arg("jdF"), py::arg("span"), py::arg("step"), py::arg("threshold"),
+          py::arg("primary") = -1, py::arg("nthreads") = 0);
+    m.def("predict_passes", &predict_passes_py,
+          "Predicts ground station passes, returns [(t [min], satellite, station, type, el, az, range)]",
+          py::arg("satrecs"), py::arg("stations"), py::arg("jd"), py::arg("jdF"), py::arg("span"),
+          py::arg("nthreads") = 0);
+    m.attr("PASS_AOS") = SGP4_PASS_AOS;
+    m.attr("PASS_TCA") = SGP4_PASS_TCA;
+    m.attr("PASS_LOS") = SGP4_PASS_LOS;
+    m.def("getgravconst", &getgravconst_py, "Returns the gravity constants used by SGP4");
+    m.def("sgp4", &sgp4_py, "Function for propagating satellite struct set time (minutes) into future");
+    m.def("sgp4_batch", &sgp4_batch_py, "Propagates satellite struct to an array of times (minutes), returns N x 6 states");
+    m.def("sgp4_batch_float", &sgp4_batch_float_py,
+          "Propagates in single precision to an array of times (minutes), returns N x 6 float32 states");
+    m.def("sgp4_jacobian", &sgp4_jacobian_py,
+          "Propagates to an array of times (minutes), returns (N x 6 states, N x 6 x 7 partials wrt the elements and bstar, "
+          "N x 6 partials wrt time)", py::arg("satrec"), py::arg("tsince"));
+    m.def("sgp4_fit", &sgp4_fit_py,
+          "Fits the elements of satrec to N x 3 TEME positions at tsince (minutes), returns (satrec, rms [km], passes)",
+          py::arg("satrec"), py::arg("tsince"), py::arg("positions"), py::arg("fit_bstar") = true,
+          py::arg("maxiter") = 20, py::arg("nthreads") = 0);
+}
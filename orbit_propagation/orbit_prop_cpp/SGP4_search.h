@@ -0,0 +1,170 @@
+#ifndef _SGP4_search_h_
+#define _SGP4_search_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_search.h
+*
+*    this file contains the one dimensional searches used on propagated
+*    quantities (range of a pair, elevation from a station). they are
+*    templates on the function so the propagation state can live in it.
+*
+*       ----------------------------------------------------------------      */
+
+#include <math.h>
+
+namespace SGP4Funcs
+{
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function brent_min
+	*
+	*  this function finds the minimum of f on [a, b] with brent's method,
+	*    golden section steps combined with parabolic interpolation. a range
+	*    squared or an elevation is close to a parabola around its extremum,
+	*    so the parabolic steps converge in a handful of evaluations.
+	*
+	*  inputs        :
+	*    f           - function of one variable
+	*    a, b        - bracket
+	*    tol         - absolute tolerance on the abscissa
+	*
+	*  outputs       :
+	*    fmin        - f at the minimum
+	*    return code - abscissa of the minimum
+	----------------------------------------------------------------------------*/
+
+	template <class F>
+	double brent_min(F& f, double a, double b, double tol, double& fmin)
+	{
+		const double cgold = 0.5 * (3.0 - sqrt(5.0));
+		const double eps = 1.0e-8;  // about the square root of the double precision epsilon
+		double d = 0.0, e = 0.0, u, fu;
+		double x = a + cgold * (b - a);
+		double w = x, v = x;
+		double fx = f(x), fw = fx, fv = fx;
+
+		for (int iter = 0; iter < 100; iter++)
+		{
+			const double xm = 0.5 * (a + b);
+			const double tol1 = eps * fabs(x) + tol / 3.0;
+			const double tol2 = 2.0 * tol1;
+			if (fabs(x - xm) <= tol2 - 0.5 * (b - a))
+				break;
+
+			bool golden = true;
+			if (fabs(e) > tol1)
+			{
+				// parabola through x, w and v
+				double r = (x - w) * (fx - fv);
+				double q = (x - v) * (fx - fw);
+				double p = (x - v) * q - (x - w) * r;
+				q = 2.0 * (q - r);
+				if (q > 0.0)
+					p = -p;
+				else
+					q = -q;
+				r = e;
+				e = d;
+				if ((fabs(p) < fabs(0.5 * q * r)) && (p > q * (a - x)) && (p < q * (b - x)))
+				{
+					d = p / q;
+					u = x + d;
+					if ((u - a < tol2) || (b - u < tol2))
+						d = (x < xm) ? tol1 : -tol1;
+					golden = false;
+				}
+			}
+			if (golden)
+			{
+				e = (x < xm) ? b - x : a - x;
+				d = cgold * e;
+			}
+
+			u = (fabs(d) >= tol1) ? x + d : x + ((d > 0.0) ? tol1 : -tol1);
+			fu = f(u);
+			if (fu <= fx)
+			{
+				if (u < x)
+					b = x;
+				else
+					a = x;
+				v = w; fv = fw;
+				w = x; fw = fx;
+				x = u; fx = fu;
+			}
+			else
+			{
+				if (u < x)
+					a = u;
+				else
+					b = u;
+				if ((fu <= fw) || (w == x))
+				{
+					v = w; fv = fw;
+					w = u; fw = fu;
+				}
+				else if ((fu <= fv) || (v == x) || (v == w))
+				{
+					v = u; fv = fu;
+				}
+			}
+		}
+		fmin = fx;
+		return x;
+	}  // brent_min
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function illinois_root
+	*
+	*  this function finds a zero of f in a bracket with the illinois variant
+	*    of regula falsi. the end point that has been kept twice in a row has
+	*    its function value halved, which keeps the convergence superlinear
+	*    where plain regula falsi would stall on one side.
+	*
+	*  inputs        :
+	*    f           - function of one variable
+	*    a, b        - bracket, f(a) and f(b) of opposite sign
+	*    fa, fb      - f(a) and f(b)
+	*    tol         - absolute tolerance on the abscissa
+	*
+	*  outputs       :
+	*    return code - abscissa of the zero
+	----------------------------------------------------------------------------*/
+
+	template <class F>
+	double illinois_root(F& f, double a, double b, double fa, double fb, double tol)
+	{
+		int side = 0;
+		double c = a;
+
+		for (int iter = 0; (iter < 100) && (fabs(b - a) > tol); iter++)
+		{
+			c = (fa * b - fb * a) / (fa - fb);
+			const double fc = f(c);
+			if (fc == 0.0)
+				return c;
+			if ((fc > 0.0) == (fb > 0.0))
+			{
+				b = c;
+				fb = fc;
+				if (side == -1)
+					fa *= 0.5;
+				side = -1;
+			}
+			else
+			{
+				a = c;
+				fa = fc;
+				if (side == 1)
+					fb *= 0.5;
+				side = 1;
+			}
+		}
+		return c;
+	}  // illinois_root
+
+}  // namespace
+
+#endif
@@ -0,0 +1,366 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_snapshot.cpp
+*
+*    this file contains the snapshot cache for initialized elsetrec records.
+*    see SGP4_snapshot.h for the file layout.
+*
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include "SGP4_snapshot.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// written as a native uint32, reads back differently on a machine of the other byte order
+#define SGP4_SNAPSHOT_ENDIAN 0x01020304u
+
+namespace SGP4Funcs
+{
+
+	struct snapshotheader
+	{
+		char magic[8];          // "SGP4SNAP"
+		uint32_t version;       // SGP4_SNAPSHOT_VERSION
+		uint32_t endian;        // SGP4_SNAPSHOT_ENDIAN
+		uint32_t recsize;       // sizeof(elsetrec)
+		uint32_t errsize;       // sizeof(tleerror)
+		uint32_t whichconst;    // gravconsttype
+		char opsmode;           // 'a' or 'i'
+		char checksum;          // 1 if records with a bad checksum were rejected
+		char pad[2];
+		uint64_t texthash;      // tle_text_hash of the tle file
+		uint64_t nrec, nerr;
+		char reserved[8];
+	};
+
+	static const char snapshotmagic[8] = { 'S', 'G', 'P', '4', 'S', 'N', 'A', 'P' };
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function map_file
+	*
+	*  this function maps a whole file into memory, copy on write so the caller
+	*    may change the pages without changing the file. on windows, and for
+	*    empty files, the file is read into a malloc'd buffer instead.
+	*
+	*  inputs        :
+	*    filename    - path of the file
+	*
+	*  outputs       :
+	*    len         - length of the file in bytes
+	*    mapped      - true if the memory has to go back through munmap
+	*    return      - start of the file, NULL if it could not be read
+	----------------------------------------------------------------------------*/
+
+	static void* map_file(const char* filename, size_t& len, bool& mapped)
+	{
+		len = 0;
+		mapped = false;
+#ifndef _WIN32
+		struct stat st;
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return NULL;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return NULL;
+		}
+		if (st.st_size == 0)
+		{
+			close(fd);
+			return malloc(1);
+		}
+		void* p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED)
+			return NULL;
+		len = (size_t)st.st_size;
+		mapped = true;
+		return p;
+#else
+		FILE* f = fopen(filename, "rb");
+		if (f == NULL)
+			return NULL;
+		fseek(f, 0, SEEK_END);
+		long n = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		void* p = malloc((n > 0) ? (size_t)n : 1);
+		if ((p != NULL) && (n > 0) && (fread(p, 1, (size_t)n, f) != (size_t)n))
+		{
+			free(p);
+			p = NULL;
+		}
+		fclose(f);
+		len = (n > 0) ? (size_t)n : 0;
+		return p;
+#endif
+	}  // map_file
+
+	static void unmap_file(void* p, size_t len, bool mapped)
+	{
+#ifndef _WIN32
+		if (mapped)
+		{
+			munmap(p, len);
+			return;
+		}
+#endif
+		free(p);
+	}  // unmap_file
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function tle_text_hash
+	*
+	*  this function returns a 64 bit hash of a block of text, used to tell
+	*    whether a snapshot was made from the same tle file. it works on 8 byte
+	*    words (fnv-1a style multiply with a fold of the high half), fast enough
+	*    to hash a full catalog well inside the cold start budget.
+	----------------------------------------------------------------------------*/
+
+	uint64_t tle_text_hash(const char* buf, size_t len)
+	{
+		const uint64_t prime = 0x100000001b3ULL;
+		uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t)len;
+		uint64_t w;
+		size_t i;
+
+		for (i = 0; i + 8 <= len; i += 8)
+		{
+			memcpy(&w, buf + i, 8);
+			h = (h ^ w) * prime;
+			h ^= h >> 32;
+		}
+		for (; i < len; i++)
+		{
+			h = (h ^ (unsigned char)buf[i]) * prime;
+			h ^= h >> 32;
+		}
+		return h;
+	}  // tle_text_hash
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function save_snapshot
+	*
+	*  this function writes a snapshot file. the file is written under a
+	*    temporary name and renamed, so a reader never maps a partial file.
+	*
+	*  inputs        :
+	*    filename    - path of the snapshot
+	*    satrecs     - records after sgp4init
+	*    errors      - rejected records from the loader
+	*    texthash    - tle_text_hash of the tle file the records came from
+	*    whichconst, opsmode, checksum - settings the records were made with
+	*
+	*  outputs       :
+	*    return code - false if the file could not be written
+	----------------------------------------------------------------------------*/
+
+	bool save_snapshot
+		(
+		const char* filename, const elsetrec* satrecs, int nrec,
+		const tleerror* errors, int nerr, uint64_t texthash,
+		gravconsttype whichconst, char opsmode, bool checksum
+		)
+	{
+		snapshotheader hdr;
+		std::string tmp = std::string(filename) + ".tmp";
+		bool ok;
+
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, snapshotmagic, 8);
+		hdr.version = SGP4_SNAPSHOT_VERSION;
+		hdr.endian = SGP4_SNAPSHOT_ENDIAN;
+		hdr.recsize = sizeof(elsetrec);
+		hdr.errsize = sizeof(tleerror);
+		hdr.whichconst = (uint32_t)whichconst;
+		hdr.opsmode = opsmode;
+		hdr.checksum = checksum ? 1 : 0;
+		hdr.texthash = texthash;
+		hdr.nrec = (uint64_t)nrec;
+		hdr.nerr = (uint64_t)nerr;
+
+		FILE* f = fopen(tmp.c_str(), "wb");
+		if (f == NULL)
+			return false;
+		ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1) &&
+			((nrec == 0) || (fwrite(satrecs, sizeof(elsetrec), (size_t)nrec, f) == (size_t)nrec)) &&
+			((nerr == 0) || (fwrite(errors, sizeof(tleerror), (size_t)nerr, f) == (size_t)nerr));
+		ok = (fclose(f) == 0) && ok;
+		if (ok)
+		{
+#ifdef _WIN32
+			remove(filename);
+#endif
+			ok = (rename(tmp.c_str(), filename) == 0);
+		}
+		if (!ok)
+			remove(tmp.c_str());
+		return ok;
+	}  // save_snapshot
+
+	sgp4snapshot::sgp4snapshot()
+		: map(NULL), maplen(0), mmapped(false), recs(NULL), errs(NULL), nrec(0), nerr(0)
+	{
+	}
+
+	sgp4snapshot::~sgp4snapshot()
+	{
+		close();
+	}
+
+	void sgp4snapshot::close()
+	{
+		if (map != NULL)
+			unmap_file(map, maplen, mmapped);
+		map = NULL;
+		maplen = 0;
+		mmapped = false;
+		recs = NULL;
+		errs = NULL;
+		nrec = nerr = 0;
+		ownrecs.clear();
+		ownerrs.clear();
+	}
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function sgp4snapshot::open
+	*
+	*  this function maps a snapshot file and points records() and errors()
+	*    into it. nothing is copied or initialized, so the cost is the mmap
+	*    call, independent of the catalog size.
+	*
+	*  inputs        :
+	*    filename    - path of the snapshot
+	*    texthash    - tle_text_hash of the tle file the caller wants
+	*    whichconst, opsmode, checksum - settings the caller wants
+	*
+	*  outputs       :
+	*    return code - false if the file is missing, truncated, from another
+	*                  version, byte order or build, or was made from other
+	*                  text or settings. the snapshot is left empty then.
+	----------------------------------------------------------------------------*/
+
+	bool sgp4snapshot::open
+		(
+		const char* filename, uint64_t texthash, gravconsttype whichconst,
+		char opsmode, bool checksum
+		)
+	{
+		size_t len;
+		bool mapped;
+		snapshotheader hdr;
+
+		close();
+		void* p = map_file(filename, len, mapped);
+		if (p == NULL)
+			return false;
+		if (len < sizeof(hdr))
+		{
+			unmap_file(p, len, mapped);
+			return false;
+		}
+
+		memcpy(&hdr, p, sizeof(hdr));
+		bool ok = (memcmp(hdr.magic, snapshotmagic, 8) == 0) &&
+			(hdr.version == SGP4_SNAPSHOT_VERSION) &&
+			(hdr.endian == SGP4_SNAPSHOT_ENDIAN) &&
+			(hdr.recsize == sizeof(elsetrec)) &&
+			(hdr.errsize == sizeof(tleerror)) &&
+			(hdr.whichconst == (uint32_t)whichconst) &&
+			(hdr.opsmode == opsmode) &&
+			(hdr.checksum == (checksum ? 1 : 0)) &&
+			(hdr.texthash == texthash) &&
+			(len == sizeof(hdr) + hdr.nrec * sizeof(elsetrec) + hdr.nerr * sizeof(tleerror));
+		if (!ok)
+		{
+			unmap_file(p, len, mapped);
+			return false;
+		}
+
+		map = p;
+		maplen = len;
+		mmapped = mapped;
+		nrec = (int)hdr.nrec;
+		nerr = (int)hdr.nerr;
+		recs = (elsetrec*)((char*)p + sizeof(hdr));
+		errs = (tleerror*)((char*)p + sizeof(hdr) + hdr.nrec * sizeof(elsetrec));
+		return true;
+	}  // sgp4snapshot::open
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function load_tle_cached
+	*
+	*  this function loads a tle file through a snapshot. the tle text is
+	*    hashed, and if cachefile holds a matching snapshot it is mapped as is.
+	*    otherwise the file goes through parse_tle_buffer, the snapshot is
+	*    (re)written and then mapped. if the snapshot cannot be written the
+	*    records are kept in memory, so the load still succeeds.
+	*
+	*  inputs        :
+	*    tlefile     - path of the 2le or 3le file
+	*    cachefile   - path of the snapshot
+	*    whichconst, opsmode, checksum, nthreads - see parse_tle_buffer
+	*
+	*  outputs       :
+	*    snap        - the records and rejected records
+	*    return code - false if the tle file could not be read
+	*
+	*  coupling      :
+	*    tle_text_hash, parse_tle_buffer, save_snapshot
+	----------------------------------------------------------------------------*/
+
+	bool load_tle_cached
+		(
+		const char* tlefile, const char* cachefile, gravconsttype whichconst, char opsmode,
+		sgp4snapshot& snap, bool checksum, int nthreads
+		)
+	{
+		size_t len;
+		bool mapped;
+		uint64_t hash;
+
+		snap.close();
+		void* text = map_file(tlefile, len, mapped);
+		if (text == NULL)
+			return false;
+		hash = tle_text_hash((const char*)text, len);
+		if (snap.open(cachefile, hash, whichconst, opsmode, checksum))
+		{
+			unmap_file(text, len, mapped);
+			return true;
+		}
+
+		std::vector<elsetrec> satrecs;
+		std::vector<tleerror> errors;
+		parse_tle_buffer((const char*)text, len, whichconst, opsmode, satrecs, errors, checksum, nthreads);
+		unmap_file(text, len, mapped);
+
+		if (save_snapshot(cachefile, satrecs.data(), (int)satrecs.size(), errors.data(), (int)errors.size(),
+			hash, whichconst, opsmode, checksum) &&
+			snap.open(cachefile, hash, whichconst, opsmode, checksum))
+			return true;
+
+		snap.ownrecs.swap(satrecs);
+		snap.ownerrs.swap(errors);
+		snap.recs = snap.ownrecs.data();
+		snap.errs = snap.ownerrs.data();
+		snap.nrec = (int)snap.ownrecs.size();
+		snap.nerr = (int)snap.ownerrs.size();
+		return true;
+	}  // load_tle_cached
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,95 @@
+#ifndef _SGP4_snapshot_h_
+#define _SGP4_snapshot_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_snapshot.h
+*
+*    this file contains the snapshot cache. the elsetrec records produced by
+*    sgp4init for a catalog are written to a binary file that the next run
+*    maps into memory and uses in place, so sgp4init (and for deep space
+*    objects dscom and dsinit) runs once per catalog instead of once per
+*    process.
+*
+*    file layout, all in the byte order of the machine that wrote it
+*      header      - 64 bytes, see snapshotheader in SGP4_snapshot.cpp
+*      records     - count elsetrec structures
+*      errors      - nerr tleerror structures
+*
+*    a snapshot is only used when the magic, version, byte order tag and
+*    structure sizes match this build, and when it was made from the same
+*    tle text (64 bit hash), gravity constants, opsmode and checksum setting.
+*
+*       ----------------------------------------------------------------      */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "SGP4.h"
+#include "SGP4_tlefile.h"
+
+#define SGP4_SNAPSHOT_VERSION 1
+
+namespace SGP4Funcs
+{
+
+	// the records of a snapshot file. the file is mapped copy on write, so
+	// the records can be handed to sgp4 (which updates them) without
+	// touching the file. when no file could be used the records are held in
+	// memory instead.
+	class sgp4snapshot
+	{
+	public:
+		sgp4snapshot();
+		~sgp4snapshot();
+
+		bool open
+			(
+			const char* filename, uint64_t texthash, gravconsttype whichconst,
+			char opsmode, bool checksum
+			);
+		void close();
+
+		elsetrec* records() { return recs; }
+		int size() const { return nrec; }
+		const tleerror* errors() const { return errs; }
+		int nerrors() const { return nerr; }
+		bool fromfile() const { return map != NULL; }
+
+	private:
+		sgp4snapshot(const sgp4snapshot&);
+		sgp4snapshot& operator=(const sgp4snapshot&);
+
+		void* map;
+		size_t maplen;
+		bool mmapped;
+		elsetrec* recs;
+		tleerror* errs;
+		int nrec, nerr;
+		std::vector<elsetrec> ownrecs;
+		std::vector<tleerror> ownerrs;
+
+		friend bool load_tle_cached
+			(
+			const char* tlefile, const char* cachefile, gravconsttype whichconst, char opsmode,
+			sgp4snapshot& snap, bool checksum, int nthreads
+			);
+	};
+
+	uint64_t tle_text_hash(const char* buf, size_t len);
+
+	bool save_snapshot
+		(
+		const char* filename, const elsetrec* satrecs, int nrec,
+		const tleerror* errors, int nerr, uint64_t texthash,
+		gravconsttype whichconst, char opsmode, bool checksum
+		);
+
+	bool load_tle_cached
+		(
+		const char* tlefile, const char* cachefile, gravconsttype whichconst, char opsmode,
+		sgp4snapshot& snap, bool checksum = true, int nthreads = 0
+		);
+
+}  // namespace
+
+#endif
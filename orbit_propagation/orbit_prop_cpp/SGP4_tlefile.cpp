@@ -0,0 +1,463 @@
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_tlefile.cpp
+*
+*    this file contains the catalog loader. twoline2rv (SGP4.cpp) patches a
+*    copy of each line and reads it with sscanf; here the fields are read
+*    straight out of the mapped file by column, so records are never copied.
+*    the numbers come out the same as twoline2rv, since every field is at
+*    most 15 digits and is formed with a single correctly rounded division.
+*
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "SGP4_tlefile.h"
+
+#ifdef _WIN32
+#include <string>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define pi 3.14159265358979323846
+
+// records a worker parses per visit to the shared counter
+#define SGP4_TLE_CHUNK 64
+
+namespace SGP4Funcs
+{
+
+	// one record, pointing into the file buffer
+	struct tlerecord
+	{
+		const char *line1, *line2;
+		int len1, len2;
+		long lineno;
+	};
+
+	// exact powers of ten for the fractional digits of a field
+	static const double pow10tab[16] =
+	{
+		1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7,
+		1.0e8, 1.0e9, 1.0e10, 1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15
+	};
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function tle_decimal
+	*
+	*  this function reads columns c0 to c1 of a tle line as a signed decimal
+	*    number. blanks are allowed before and after the number. when implied is
+	*    set the field has no decimal point and blanks inside it count as zeros,
+	*    and the value is scaled by 10^-implied (eccentricity, nddot, bstar).
+	*
+	*  inputs        :
+	*    s           - line
+	*    c0, c1      - first and last column, 0 based
+	*    implied     - number of implied decimals, 0 for a normal field
+	*
+	*  outputs       :
+	*    value       - the number
+	*    return code - false if the field holds anything else
+	----------------------------------------------------------------------------*/
+
+	static bool tle_decimal(const char* s, int c0, int c1, int implied, double& value)
+	{
+		long long m = 0;
+		int c = c0, nd = 0, frac = -1;
+		bool neg = false;
+
+		while ((c <= c1) && (s[c] == ' ') && (implied == 0))
+			c++;
+		if ((c <= c1) && ((s[c] == '-') || (s[c] == '+')))
+		{
+			neg = (s[c] == '-');
+			c++;
+		}
+		for (; c <= c1; c++)
+		{
+			if ((s[c] >= '0') && (s[c] <= '9'))
+			{
+				m = m * 10 + (s[c] - '0');
+				nd++;
+				if (frac >= 0)
+					frac++;
+			}
+			else if ((s[c] == ' ') && (implied > 0))
+			{
+				m = m * 10;
+				nd++;
+			}
+			else if ((s[c] == '.') && (frac < 0) && (implied == 0))
+				frac = 0;
+			else
+				break;
+		}
+		for (; c <= c1; c++)
+			if (s[c] != ' ')
+				return false;
+		if ((nd == 0) || (nd > 15))
+			return false;
+
+		value = (double)m / pow10tab[(implied > 0) ? implied : ((frac > 0) ? frac : 0)];
+		if (neg)
+			value = -value;
+		return true;
+	}  // tle_decimal
+
+	// reads columns c0 to c1 as a signed integer, an all blank field reads as 0
+	static bool tle_int(const char* s, int c0, int c1, long& value)
+	{
+		int c = c0;
+		bool neg = false;
+
+		value = 0;
+		while ((c <= c1) && (s[c] == ' '))
+			c++;
+		if ((c <= c1) && ((s[c] == '-') || (s[c] == '+')))
+		{
+			neg = (s[c] == '-');
+			c++;
+		}
+		for (; (c <= c1) && (s[c] >= '0') && (s[c] <= '9'); c++)
+			value = value * 10 + (s[c] - '0');
+		for (; c <= c1; c++)
+			if (s[c] != ' ')
+				return false;
+		if (neg)
+			value = -value;
+		return true;
+	}  // tle_int
+
+	// modulo 10 sum of the digits in columns 0-67, a minus sign counts as 1
+	static bool tle_checksum(const char* s)
+	{
+		int c, sum = 0;
+		for (c = 0; c < 68; c++)
+		{
+			if ((s[c] >= '0') && (s[c] <= '9'))
+				sum += s[c] - '0';
+			else if (s[c] == '-')
+				sum++;
+		}
+		return (s[68] >= '0') && (s[68] <= '9') && (sum % 10 == s[68] - '0');
+	}  // tle_checksum
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function tle_parse
+	*
+	*  this function converts one record to an initialized elsetrec. the unit
+	*    conversions and the sgp4init call are the ones in twoline2rv, in the
+	*    same order. element number and revolution number are read from their
+	*    own columns, where twoline2rv also picks up the checksum digit.
+	*
+	*  inputs        :
+	*    rec         - the two lines of the record
+	*    whichconst  - which set of constants to use
+	*    opsmode     - mode of operation afspc or improved 'a', 'i'
+	*    checksum    - check the checksum of both lines
+	*
+	*  outputs       :
+	*    satrec      - initialized structure
+	*    return code - 0 or an error code, see tleerror
+	*
+	*  coupling      :
+	*    days2mdhms, jday, sgp4init
+	----------------------------------------------------------------------------*/
+
+	static int tle_parse
+		(
+		const tlerecord& rec, gravconsttype whichconst, char opsmode, bool checksum,
+		elsetrec& satrec
+		)
+	{
+		const double deg2rad = pi / 180.0;         //   0.0174532925199433
+		const double xpdotp = 1440.0 / (2.0 *pi);  // 229.1831180523293
+		const char* l1 = rec.line1;
+		const char* l2 = rec.line2;
+		long satnum2, nexp, ibexp, epochyr, ephtype;
+		int year, mon, day, hr, minute, j;
+		double sec;
+		bool ok;
+
+		if ((rec.len1 < 68) || (rec.len2 < 68) || !tle_int(l1, 2, 6, satrec.satnum))
+			return 3;
+		if (checksum && ((rec.len1 < 69) || !tle_checksum(l1)))
+			return 1;
+		if (checksum && ((rec.len2 < 69) || !tle_checksum(l2)))
+			return 2;
+
+		// ---------------------------- line 1 ----------------------------
+		satrec.classification = (l1[7] == ' ') ? 'U' : l1[7];
+		// same text twoline2rv leaves in intldesg
+		satrec.intldesg[0] = (l1[9] == ' ') ? '.' : l1[9];
+		for (j = 10; j <= 15; j++)
+			satrec.intldesg[j - 9] = (l1[j] == ' ') ? '_' : l1[j];
+		satrec.intldesg[7] = (l1[16] == ' ') ? '\0' : l1[16];
+		satrec.intldesg[8] = '\0';
+		ok = tle_int(l1, 18, 19, epochyr) &&
+			tle_decimal(l1, 20, 31, 0, satrec.epochdays) &&
+			tle_decimal(l1, 33, 42, 0, satrec.ndot) &&
+			tle_decimal(l1, 44, 49, 5, satrec.nddot) &&
+			tle_int(l1, 50, 51, nexp) &&
+			tle_decimal(l1, 53, 58, 5, satrec.bstar) &&
+			tle_int(l1, 59, 60, ibexp) &&
+			tle_int(l1, 62, 62, ephtype) &&
+			tle_int(l1, 64, 67, satrec.elnum);
+		if (!ok)
+			return 3;
+		satrec.epochyr = (int)epochyr;
+		satrec.ephtype = (int)ephtype;
+
+		// ---------------------------- line 2 ----------------------------
+		ok = tle_int(l2, 2, 6, satnum2) &&
+			tle_decimal(l2, 8, 15, 0, satrec.inclo) &&
+			tle_decimal(l2, 17, 24, 0, satrec.nodeo) &&
+			tle_decimal(l2, 26, 32, 7, satrec.ecco) &&
+			tle_decimal(l2, 34, 41, 0, satrec.argpo) &&
+			tle_decimal(l2, 43, 50, 0, satrec.mo) &&
+			tle_decimal(l2, 52, 62, 0, satrec.no_kozai) &&
+			tle_int(l2, 63, 67, satrec.revnum);
+		if (!ok)
+			return 3;
+		if (satnum2 != satrec.satnum)
+			return 4;
+
+		// ---- find no, ndot, nddot ----
+		satrec.no_kozai = satrec.no_kozai / xpdotp; //* rad/min
+		satrec.nddot = satrec.nddot * pow(10.0, (int)nexp);
+		satrec.bstar = satrec.bstar * pow(10.0, (int)ibexp);
+
+		// ---- convert to sgp4 units ----
+		satrec.ndot = satrec.ndot / (xpdotp*1440.0);  //* ? * minperday
+		satrec.nddot = satrec.nddot / (xpdotp*1440.0 * 1440);
+
+		// ---- find standard orbital elements ----
+		satrec.inclo = satrec.inclo  * deg2rad;
+		satrec.nodeo = satrec.nodeo  * deg2rad;
+		satrec.argpo = satrec.argpo  * deg2rad;
+		satrec.mo = satrec.mo     * deg2rad;
+
+		// ---------------- temp fix for years from 1957-2056 -------------------
+		if (satrec.epochyr < 57)
+			year = satrec.epochyr + 2000;
+		else
+			year = satrec.epochyr + 1900;
+
+		days2mdhms(year, satrec.epochdays, mon, day, hr, minute, sec);
+		jday(year, mon, day, hr, minute, sec, satrec.jdsatepoch, satrec.jdsatepochF);
+
+		// ---------------- initialize the orbit at sgp4epoch -------------------
+		satrec.error = 0;
+		sgp4init(whichconst, opsmode, satrec.satnum, (satrec.jdsatepoch + satrec.jdsatepochF) - 2433281.5, satrec.bstar,
+			satrec.ndot, satrec.nddot, satrec.ecco, satrec.argpo, satrec.inclo, satrec.mo, satrec.no_kozai,
+			satrec.nodeo, satrec);
+		return (satrec.error != 0) ? 10 + satrec.error : 0;
+	}  // tle_parse
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           procedure parse_tle_buffer
+	*
+	*  this procedure loads every record of a 2le or 3le text held in memory.
+	*    lines that start with "1 " followed by a line that starts with "2 "
+	*    form a record, any other line (names, comments) is skipped. the split
+	*    is a single pass over the buffer, the parsing and sgp4init run on
+	*    nthreads workers.
+	*
+	*  inputs        :
+	*    buf, len    - text of the file
+	*    whichconst  - which set of constants to use
+	*    opsmode     - mode of operation afspc or improved 'a', 'i'
+	*    checksum    - reject records with a bad checksum
+	*    nthreads    - number of worker threads, <= 0 for one per core
+	*
+	*  outputs       :
+	*    satrecs     - initialized records in file order, replaces the contents
+	*    errors      - rejected records in file order, replaces the contents
+	*
+	*  coupling      :
+	*    tle_parse   - parse and initialize one record
+	----------------------------------------------------------------------------*/
+
+	void parse_tle_buffer
+		(
+		const char* buf, size_t len, gravconsttype whichconst, char opsmode,
+		std::vector<elsetrec>& satrecs, std::vector<tleerror>& errors,
+		bool checksum, int nthreads
+		)
+	{
+		std::vector<tlerecord> recs;
+		const char* end = buf + len;
+		const char* p = buf;
+		const char* pending = NULL;
+		int pendinglen = 0;
+		long lineno = 0, pendingline = 0;
+
+		satrecs.clear();
+		errors.clear();
+
+		/* ----------------------- split into records ----------------------- */
+		while (p < end)
+		{
+			const char* nl = (const char*)memchr(p, '\n', end - p);
+			const char* eol = (nl != NULL) ? nl : end;
+			int n = (int)(eol - p);
+			if ((n > 0) && (p[n - 1] == '\r'))
+				n--;
+			lineno++;
+
+			if ((n >= 2) && (p[0] == '2') && (p[1] == ' ') && (pending != NULL))
+			{
+				tlerecord r = { pending, p, pendinglen, n, pendingline };
+				recs.push_back(r);
+				pending = NULL;
+			}
+			else
+			{
+				if (pending != NULL)
+				{
+					tleerror e = { pendingline, 0, 5 };
+					errors.push_back(e);
+					pending = NULL;
+				}
+				if ((n >= 2) && (p[0] == '1') && (p[1] == ' '))
+				{
+					pending = p;
+					pendinglen = n;
+					pendingline = lineno;
+				}
+				else if ((n >= 2) && (p[0] == '2') && (p[1] == ' '))
+				{
+					tleerror e = { lineno, 0, 5 };
+					errors.push_back(e);
+				}
+			}
+			p = eol + 1;
+		}
+		if (pending != NULL)
+		{
+			tleerror e = { pendingline, 0, 5 };
+			errors.push_back(e);
+		}
+
+		/* --------------------- parse in parallel chunks --------------------- */
+		const int nrec = (int)recs.size();
+		std::vector<elsetrec> all(nrec);
+		std::vector<int> codes(nrec);
+		std::atomic<int> next(0);
+
+		auto worker = [&]()
+		{
+			int start, i;
+			while ((start = next.fetch_add(SGP4_TLE_CHUNK)) < nrec)
+			{
+				const int stop = (start + SGP4_TLE_CHUNK < nrec) ? start + SGP4_TLE_CHUNK : nrec;
+				for (i = start; i < stop; i++)
+					codes[i] = tle_parse(recs[i], whichconst, opsmode, checksum, all[i]);
+			}
+		};
+
+		if (nthreads <= 0)
+			nthreads = (int)std::thread::hardware_concurrency();
+		if (nthreads > (nrec + SGP4_TLE_CHUNK - 1) / SGP4_TLE_CHUNK)
+			nthreads = (nrec + SGP4_TLE_CHUNK - 1) / SGP4_TLE_CHUNK;
+		if (nthreads < 1)
+			nthreads = 1;
+
+		std::vector<std::thread> pool;
+		for (int t = 1; t < nthreads; t++)
+			pool.push_back(std::thread(worker));
+		worker();
+		for (size_t t = 0; t < pool.size(); t++)
+			pool[t].join();
+
+		/* ------------------------- collect results ------------------------- */
+		satrecs.reserve(nrec);
+		for (int i = 0; i < nrec; i++)
+		{
+			if (codes[i] == 0)
+				satrecs.push_back(all[i]);
+			else
+			{
+				tleerror e = { recs[i].lineno, (codes[i] == 3) ? 0 : all[i].satnum, codes[i] };
+				errors.push_back(e);
+			}
+		}
+		std::stable_sort(errors.begin(), errors.end(),
+			[](const tleerror& a, const tleerror& b) { return a.line < b.line; });
+	}  // parse_tle_buffer
+
+	/* -----------------------------------------------------------------------------
+	*
+	*                           function load_tle_file
+	*
+	*  this function maps a 2le or 3le file into memory and loads it with
+	*    parse_tle_buffer. on windows the file is read into a buffer instead.
+	*
+	*  inputs        :
+	*    filename    - path of the file
+	*    whichconst, opsmode, checksum, nthreads - see parse_tle_buffer
+	*
+	*  outputs       :
+	*    satrecs     - initialized records in file order
+	*    errors      - rejected records in file order
+	*    return code - false if the file could not be opened or read
+	----------------------------------------------------------------------------*/
+
+	bool load_tle_file
+		(
+		const char* filename, gravconsttype whichconst, char opsmode,
+		std::vector<elsetrec>& satrecs, std::vector<tleerror>& errors,
+		bool checksum, int nthreads
+		)
+	{
+		satrecs.clear();
+		errors.clear();
+
+#ifdef _WIN32
+		FILE* f = fopen(filename, "rb");
+		if (f == NULL)
+			return false;
+		std::string text;
+		char block[65536];
+		size_t n;
+		while ((n = fread(block, 1, sizeof(block), f)) > 0)
+			text.append(block, n);
+		fclose(f);
+		parse_tle_buffer(text.data(), text.size(), whichconst, opsmode, satrecs, errors, checksum, nthreads);
+		return true;
+#else
+		struct stat st;
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return false;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return false;
+		}
+		if (st.st_size == 0)
+		{
+			close(fd);
+			return true;
+		}
+		void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+			return false;
+		parse_tle_buffer((const char*)map, (size_t)st.st_size, whichconst, opsmode, satrecs, errors, checksum, nthreads);
+		munmap(map, (size_t)st.st_size);
+		return true;
+#endif
+	}  // load_tle_file
+
+}  // namespace SGP4Funcs
@@ -0,0 +1,52 @@
+#ifndef _SGP4_tlefile_h_
+#define _SGP4_tlefile_h_
+/*     ----------------------------------------------------------------
+*
+*                               SGP4_tlefile.h
+*
+*    this file contains the catalog loader. a 2le or 3le file is mapped into
+*    memory, split into records in place, and every record is parsed with a
+*    fixed column parser and initialized with sgp4init on a set of worker
+*    threads. records that fail are reported one by one instead of stopping
+*    the load.
+*
+*       ----------------------------------------------------------------      */
+
+#include <stddef.h>
+#include <vector>
+#include "SGP4.h"
+
+namespace SGP4Funcs
+{
+
+	// one rejected record
+	//   code  1 - line 1 checksum does not match
+	//         2 - line 2 checksum does not match
+	//         3 - a field is not a number, or a line is shorter than 69 columns
+	//         4 - line 2 is for a different satellite number than line 1
+	//         5 - line 1 is not followed by a line 2
+	//    10 + e - sgp4init returned error e (see sgp4)
+	struct tleerror
+	{
+		long line;     // line number of line 1 in the file, starting at 1
+		long satnum;   // from line 1, 0 if it could not be read
+		int code;
+	};
+
+	bool load_tle_file
+		(
+		const char* filename, gravconsttype whichconst, char opsmode,
+		std::vector<elsetrec>& satrecs, std::vector<tleerror>& errors,
+		bool checksum = true, int nthreads = 0
+		);
+
+	void parse_tle_buffer
+		(
+		const char* buf, size_t len, gravconsttype whichconst, char opsmode,
+		std::vector<elsetrec>& satrecs, std::vector<tleerror>& errors,
+		bool checksum = true, int nthreads = 0
+		);
+
+}  // namespace
+
+#endif
@@ -0,0 +1,75 @@
+/* ---------------------------------------------------------------------
+*
+*                          sgp4_batch_benchmark.cpp
+*
+*  this program times sgp4_batch against a loop of scalar sgp4 calls on a
+*  10 hz time grid and reports the throughput of both in points per second.
+*  it also reports the largest position difference between the two paths.
+*
+*  usage : sgp4_batch_benchmark [days]        (default 1 day)
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "SGP4.h"
+#include "SGP4_batch.h"
+
+int main(int argc, char* argv[])
+{
+	// orsted, the test satellite used in orbit_propagation/test
+	char longstr1[130] = "1 25635U 99008B   13348.59627062  .00000650  00000-0  16622-3 0  9860";
+	char longstr2[130] = "2 25635 096.4421 173.2395 0141189 010.0389 029.8678 14.46831495780970";
+	double startmfe, stopmfe, deltamin;
+	double days = (argc > 1) ? atof(argv[1]) : 1.0;
+	const double step = 0.1 / 60.0;  // 10 hz, in minutes
+	const int n = (int)(days * 1440.0 / step);
+	elsetrec satrec;
+
+	SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', 'i', wgs72, startmfe, stopmfe, deltamin, satrec);
+
+	std::vector<double> tsince(n), x(n), y(n), z(n), vx(n), vy(n), vz(n);
+	std::vector<double> xs(n), ys(n), zs(n);
+	std::vector<int> err(n);
+	for (int i = 0; i < n; i++)
+		tsince[i] = i * step;
+
+	// ----------------------------- scalar path -----------------------------
+	double r[3], v[3];
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+	{
+		SGP4Funcs::sgp4(satrec, tsince[i], r, v);
+		xs[i] = r[0]; ys[i] = r[1]; zs[i] = r[2];
+	}
+	auto t1 = std::chrono::steady_clock::now();
+
+	// ----------------------------- batch path ------------------------------
+	SGP4Funcs::sgp4_batch(satrec, tsince.data(), n, x.data(), y.data(), z.data(),
+		vx.data(), vy.data(), vz.data(), err.data());
+	auto t2 = std::chrono::steady_clock::now();
+
+	double scalar_s = std::chrono::duration<double>(t1 - t0).count();
+	double batch_s = std::chrono::duration<double>(t2 - t1).count();
+	double maxdiff = 0.0;
+	for (int i = 0; i < n; i++)
+	{
+		double d = sqrt((x[i] - xs[i]) * (x[i] - xs[i]) + (y[i] - ys[i]) * (y[i] - ys[i]) +
+			(z[i] - zs[i]) * (z[i] - zs[i]));
+		if (d > maxdiff)
+			maxdiff = d;
+	}
+
+	printf("%s\n", SGP4Version);
+	printf("points            : %d (%.2f days at 10 hz)\n", n, days);
+	printf("scalar sgp4       : %12.0f points/s\n", n / scalar_s);
+	printf("sgp4_batch        : %12.0f points/s\n", n / batch_s);
+	printf("speedup           : %12.2f\n", scalar_s / batch_s);
+	printf("max |dr| (km)     : %12.3e\n", maxdiff);
+
+	return 0;
+}  // end sgp4_batch_benchmark
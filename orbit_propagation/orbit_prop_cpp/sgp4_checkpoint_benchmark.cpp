@@ -0,0 +1,112 @@
+/* ---------------------------------------------------------------------
+*
+*                        sgp4_checkpoint_benchmark.cpp
+*
+*  this program times sgp4checkpoints against sgp4 on one record for two
+*  resonant deep space satellites, a 12 hour molniya orbit and a
+*  geostationary one. the query times are spread evenly over days on both
+*  sides of epoch and taken forward, backward and in random order. the table
+*  starts empty for every order, so filling it is part of the time. it
+*  reports the time per query and the largest position difference of each
+*  path from sgp4 on a record fresh from twoline2rv.
+*
+*  usage : sgp4_checkpoint_benchmark [days] [queries]   (default 365 days, 20000)
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "SGP4.h"
+#include "SGP4_checkpoint.h"
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static double distance(const double a[3], const double b[3])
+{
+	return sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+int main(int argc, char* argv[])
+{
+	// from the verification set (SGP4-VER.TLE)
+	const char* elements[2][3] =
+	{
+		{ "molniya 09880 (irez 2)",
+		  "1 09880U 77021A   06176.56157475  .00000421  00000-0  10000-3 0  9814",
+		  "2 09880  64.5968 349.3786 7069051 270.0229  16.3320  2.00813614112380" },
+		{ "geostationary 28626 (irez 1)",
+		  "1 28626U 05008A   06176.46683397 -.00000205  00000-0  10000-3 0  2190",
+		  "2 28626   0.0019 286.9433 0000335  13.7918  55.6504  1.00270176  4891" }
+	};
+	const char* orders[3] = { "forward", "backward", "random" };
+	const double days = (argc > 1) ? atof(argv[1]) : 365.0;
+	const int n = (argc > 2) ? std::max(1, atoi(argv[2])) : 20000;
+	double startmfe, stopmfe, deltamin, r[3], v[3];
+	int i, s, o;
+
+	printf("%s\n", SGP4Version);
+	printf("queries           : %d over +-%.0f days\n", n, days);
+
+	for (s = 0; s < 2; s++)
+	{
+		char longstr1[130], longstr2[130];
+		elsetrec satrec;
+		strcpy(longstr1, elements[s][1]);
+		strcpy(longstr2, elements[s][2]);
+		SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', 'i', wgs72, startmfe, stopmfe, deltamin, satrec);
+
+		// evenly spaced times and the positions of a fresh record at each
+		std::vector<double> tsince(n), ref(3 * n);
+		for (i = 0; i < n; i++)
+		{
+			elsetrec fresh = satrec;
+			tsince[i] = (n > 1) ? (-1.0 + 2.0 * i / (n - 1)) * days * 1440.0 : 0.0;
+			SGP4Funcs::sgp4(fresh, tsince[i], &ref[3 * i], v);
+		}
+
+		printf("\n%s\n", elements[s][0]);
+		printf("  order       sgp4 us/query   checkpoints us/query   speedup   sgp4 max|dr| km   checkpoints max|dr| km\n");
+		for (o = 0; o < 3; o++)
+		{
+			std::vector<int> index(n);
+			for (i = 0; i < n; i++)
+				index[i] = (o == 1) ? n - 1 - i : i;
+			if (o == 2)
+				std::shuffle(index.begin(), index.end(), std::mt19937(7));
+
+			elsetrec rec = satrec;
+			double drsgp4 = 0.0, drcheck = 0.0;
+			auto t0 = std::chrono::steady_clock::now();
+			for (i = 0; i < n; i++)
+			{
+				SGP4Funcs::sgp4(rec, tsince[index[i]], r, v);
+				drsgp4 = std::max(drsgp4, distance(r, &ref[3 * index[i]]));
+			}
+			const double tsgp4 = seconds_since(t0);
+
+			SGP4Funcs::sgp4checkpoints table;
+			table.init(satrec);
+			t0 = std::chrono::steady_clock::now();
+			for (i = 0; i < n; i++)
+			{
+				table.propagate(tsince[index[i]], r, v);
+				drcheck = std::max(drcheck, distance(r, &ref[3 * index[i]]));
+			}
+			const double tcheck = seconds_since(t0);
+
+			printf("  %-9s %15.2f %22.2f %9.1f %17.3e %24.3e\n", orders[o], 1e6 * tsgp4 / n, 1e6 * tcheck / n,
+				tsgp4 / tcheck, drsgp4, drcheck);
+		}
+	}
+
+	return 0;
+}  // end sgp4_checkpoint_benchmark
@@ -0,0 +1,164 @@
+/* ---------------------------------------------------------------------
+*
+*                          sgp4_jacobian_benchmark.cpp
+*
+*  this program checks sgp4_jacobian against central differences of sgp4
+*  (two sgp4init and propagations per element) on the verification set and
+*  times both. every case is propagated on a 10 minute grid over one day,
+*  the error of a column is the largest difference over the grid relative
+*  to the largest central difference in it, and the worst column is
+*  reported. epochs where sgp4 reports an error are left out, and so are
+*  columns where the steps move the position by less than RESOLUTION, the
+*  differences only hold roundoff there (bstar of most deep space cases).
+*
+*  usage : sgp4_jacobian_benchmark [tlefile]   (default orbit_propagation/SGP4-VER.TLE)
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "SGP4.h"
+#include "SGP4_core.h"
+#include "SGP4_jacobian.h"
+
+#define NX SGP4_JACOBIAN_NX
+
+// central difference steps, in the order of the jacobian columns
+static const double steps[NX] = { 1.0e-7, 1.0e-7, 1.0e-7, 1.0e-7, 1.0e-10, 1.0e-7, 1.0e-7 };
+
+// smallest position change over two steps for a column to be checked        km
+#define RESOLUTION 1.0e-6
+
+static double median(std::vector<double> x)
+{
+	if (x.empty())
+		return 0.0;
+	std::sort(x.begin(), x.end());
+	return x[x.size() / 2];
+}
+
+/* -----------------------------------------------------------------------------
+*
+*                           procedure central_differences
+*
+*  this procedure fills the n x 6 x 7 jacobian by central differences, with
+*    the record re-initialised at every perturbed element set.
+----------------------------------------------------------------------------*/
+
+static void central_differences(const elsetrec& satrec, gravconsttype whichconst, const double tsince[], int n,
+	double jac[], int err[])
+{
+	const double epoch = satrec.jdsatepoch + satrec.jdsatepochF - 2433281.5;
+	double r[3], v[3], rp[6];
+	int i, j, k, side;
+
+	for (i = 0; i < n; i++)
+		err[i] = 0;
+	for (k = 0; k < NX; k++)
+		for (side = -1; side <= 1; side += 2)
+		{
+			double x[NX] = { satrec.ecco, satrec.argpo, satrec.inclo, satrec.mo, satrec.no_kozai, satrec.nodeo, satrec.bstar };
+			elsetrec rec;
+			x[k] = x[k] + side * steps[k];
+			SGP4Funcs::sgp4init(whichconst, satrec.operationmode, (int)satrec.satnum, epoch, x[6], satrec.ndot,
+				satrec.nddot, x[0], x[1], x[2], x[3], x[4], x[5], rec);
+			for (i = 0; i < n; i++)
+			{
+				if (!SGP4Funcs::sgp4(rec, tsince[i], r, v))
+					err[i] = rec.error;
+				for (j = 0; j < 3; j++)
+				{
+					rp[j] = r[j];
+					rp[j + 3] = v[j];
+				}
+				for (j = 0; j < 6; j++)
+				{
+					double& d = jac[(6 * i + j) * NX + k];
+					d = (side < 0) ? -rp[j] : (d + rp[j]) / (2.0 * steps[k]);
+				}
+			}
+		}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* filename = (argc > 1) ? argv[1] : "orbit_propagation/SGP4-VER.TLE";
+	const int n = 145;
+	char longstr1[130], longstr2[130];
+	double startmfe, stopmfe, deltamin;
+	std::vector<double> tsince(n), rv(6 * n), jad(6 * NX * n), jfd(6 * NX * n);
+	std::vector<int> errad(n), errfd(n);
+	std::vector<double> errall, speedall;
+	double tad = 0.0, tfd = 0.0;
+	FILE* infile;
+	int i, j, k;
+
+	for (i = 0; i < n; i++)
+		tsince[i] = 10.0 * i;
+
+	infile = fopen(filename, "r");
+	if (infile == NULL)
+	{
+		fprintf(stderr, "could not open %s\n", filename);
+		return 1;
+	}
+
+	printf("%s, sgp4_jacobian vs central differences, %d epochs over 1 day\n", SGP4Version, n);
+	printf(" satnum  m   max rel err   ad (ms)   fd (ms)   fd / ad\n");
+	while (fgets(longstr1, 130, infile) != NULL)
+	{
+		if (strncmp(longstr1, "1 ", 2) != 0)
+			continue;
+		if (fgets(longstr2, 130, infile) == NULL)
+			break;
+
+		elsetrec satrec;
+		gravconsttype whichconst;
+		SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', 'i', wgs72, startmfe, stopmfe, deltamin, satrec);
+		if ((satrec.error != 0) || !SGP4Funcs::findgravconst(satrec, whichconst))
+			continue;
+
+		auto t0 = std::chrono::steady_clock::now();
+		SGP4Funcs::sgp4_jacobian(satrec, &tsince[0], n, &rv[0], &jad[0], NULL, &errad[0]);
+		auto t1 = std::chrono::steady_clock::now();
+		central_differences(satrec, whichconst, &tsince[0], n, &jfd[0], &errfd[0]);
+		auto t2 = std::chrono::steady_clock::now();
+		const double ad = std::chrono::duration<double>(t1 - t0).count();
+		const double fd = std::chrono::duration<double>(t2 - t1).count();
+
+		double worst = 0.0;
+		for (k = 0; k < NX; k++)
+		{
+			double scale = 0.0, rscale = 0.0, diff = 0.0;
+			for (i = 0; i < n; i++)
+				if ((errad[i] == 0) && (errfd[i] == 0))
+					for (j = 0; j < 6; j++)
+					{
+						const int m = (6 * i + j) * NX + k;
+						scale = std::max(scale, fabs(jfd[m]));
+						if (j < 3)
+							rscale = std::max(rscale, fabs(jfd[m]));
+						diff = std::max(diff, fabs(jad[m] - jfd[m]));
+					}
+			if (2.0 * steps[k] * rscale > RESOLUTION)
+				worst = std::max(worst, diff / scale);
+		}
+
+		printf("%7ld  %c  %12.3e  %8.3f  %8.3f  %8.2f\n", satrec.satnum, satrec.method, worst,
+			1000.0 * ad, 1000.0 * fd, fd / ad);
+		errall.push_back(worst);
+		speedall.push_back(fd / ad);
+		tad += ad;
+		tfd += fd;
+	}
+	fclose(infile);
+
+	printf(" median   %12.3e                      %8.2f\n", median(errall), median(speedall));
+	printf(" total              %8.3f  %8.3f  %8.2f\n", 1000.0 * tad, 1000.0 * tfd, tfd / tad);
+
+	return 0;
+}  // end sgp4_jacobian_benchmark
@@ -0,0 +1,104 @@
+/* ---------------------------------------------------------------------
+*
+*                          sgp4_precision_report.cpp
+*
+*  this program compares the float instantiation of sgp4 (sgp4init_from and
+*  sgp4_t on elsetrec_t<float>) with the double one on the verification set.
+*  every case is propagated on a 1 minute grid from epoch, and the largest
+*  position and velocity differences within 1, 3 and 7 days are reported per
+*  satellite, with the median over the set. epochs where either precision
+*  reports an error are left out.
+*
+*  usage : sgp4_precision_report [tlefile]   (default orbit_propagation/SGP4-VER.TLE)
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "SGP4.h"
+#include "SGP4_core.h"
+
+#define NDAYS 3
+
+static double median(std::vector<double> x)
+{
+	if (x.empty())
+		return 0.0;
+	std::sort(x.begin(), x.end());
+	return x[x.size() / 2];
+}
+
+int main(int argc, char* argv[])
+{
+	const char* filename = (argc > 1) ? argv[1] : "orbit_propagation/SGP4-VER.TLE";
+	const int days[NDAYS] = { 1, 3, 7 };
+	char longstr1[130], longstr2[130];
+	double startmfe, stopmfe, deltamin;
+	std::vector<double> drall[NDAYS], dvall[NDAYS];
+	FILE* infile;
+	int d;
+
+	infile = fopen(filename, "r");
+	if (infile == NULL)
+	{
+		fprintf(stderr, "could not open %s\n", filename);
+		return 1;
+	}
+
+	printf("%s, float vs double, max |dr| (km) and |dv| (m/s) from epoch to\n", SGP4Version);
+	printf(" satnum  m       1 day            3 days           7 days\n");
+	while (fgets(longstr1, 130, infile) != NULL)
+	{
+		if (strncmp(longstr1, "1 ", 2) != 0)
+			continue;
+		if (fgets(longstr2, 130, infile) == NULL)
+			break;
+
+		elsetrec satrec;
+		SGP4Funcs::elsetrec_t<float> satrecf;
+		SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', 'i', wgs72, startmfe, stopmfe, deltamin, satrec);
+		if ((satrec.error != 0) || !SGP4Funcs::sgp4init_from(satrec, satrecf))
+			continue;
+
+		double dr[NDAYS] = { 0.0 }, dv[NDAYS] = { 0.0 };
+		for (int k = 0; k <= days[NDAYS - 1] * 1440; k++)
+		{
+			double r[3], v[3];
+			float rf[3], vf[3];
+			const bool ok = SGP4Funcs::sgp4(satrec, (double)k, r, v);
+			const bool okf = SGP4Funcs::sgp4_t(satrecf, (float)k, rf, vf);
+			if (!ok || !okf)
+				continue;
+			const double er = sqrt((rf[0] - r[0]) * (rf[0] - r[0]) + (rf[1] - r[1]) * (rf[1] - r[1]) +
+				(rf[2] - r[2]) * (rf[2] - r[2]));
+			const double ev = 1000.0 * sqrt((vf[0] - v[0]) * (vf[0] - v[0]) + (vf[1] - v[1]) * (vf[1] - v[1]) +
+				(vf[2] - v[2]) * (vf[2] - v[2]));
+			for (d = 0; d < NDAYS; d++)
+				if (k <= days[d] * 1440)
+				{
+					dr[d] = std::max(dr[d], er);
+					dv[d] = std::max(dv[d], ev);
+				}
+		}
+
+		printf("%7ld  %c", satrec.satnum, satrec.method);
+		for (d = 0; d < NDAYS; d++)
+		{
+			printf("  %9.3f %6.2f", dr[d], dv[d]);
+			drall[d].push_back(dr[d]);
+			dvall[d].push_back(dv[d]);
+		}
+		printf("\n");
+	}
+	fclose(infile);
+
+	printf(" median   ");
+	for (d = 0; d < NDAYS; d++)
+		printf("  %9.3f %6.2f", median(drall[d]), median(dvall[d]));
+	printf("\n");
+
+	return 0;
+}  // end sgp4_precision_report
@@ -0,0 +1,406 @@
+/* ---------------------------------------------------------------------
+*
+*                        sgp4_verification_benchmark.cpp
+*
+*  this program runs the verification set (SGP4-VER.TLE) through twoline2rv
+*  and sgp4 at the verification time steps, the way testcpp does in 'v' mode
+*  but without prompts, and times every path over the whole set : sgp4init,
+*  scalar sgp4, sgp4_batch, the float sgp4_batch and sgp4catalog. the catalog
+*  holds every record once per time of its grid, with the epoch moved back by
+*  that time, so one propagate on a single thread puts each copy at its
+*  verification time. most of the points are deep space, which the catalog
+*  hands to sgp4, so its near earth copies are also timed on their own
+*  against scalar sgp4 on the same cases. it reports the largest position and
+*  velocity deviation of each path from scalar sgp4 and, when a reference
+*  file is given (tcppver.out as written by testcpp), of scalar sgp4 from the
+*  reference. unlike testcpp every path runs the whole grid of
+*  a case, also past an error, and deviations only count epochs where both
+*  sides propagated. the results are written as json.
+*
+*  usage : sgp4_verification_benchmark [options]
+*            --tle file       verification elements (default orbit_propagation/SGP4-VER.TLE)
+*            --ref file       reference output in the tcppver.out format
+*            --opsmode a|i    afspc or improved mode (default i)
+*            --repeat n       timing runs, the fastest is kept (default 5)
+*            --out file       json output (default stdout)
+*       ----------------------------------------------------------------      */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "SGP4.h"
+#include "SGP4_core.h"
+#include "SGP4_batch.h"
+#include "SGP4_catalog.h"
+
+// one element set of the verification file and its time grid
+struct vercase
+{
+	char line1[130], line2[130];
+	elsetrec satrec;
+	std::vector<double> tsince;
+};
+
+// largest position and velocity difference between two paths
+struct deviation
+{
+	double dr, dv;      // km, km/s
+	long points;
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void compare(deviation& dev, const double r[3], const double v[3], const double ro[3], const double vo[3])
+{
+	const double dr = sqrt((r[0] - ro[0]) * (r[0] - ro[0]) + (r[1] - ro[1]) * (r[1] - ro[1]) + (r[2] - ro[2]) * (r[2] - ro[2]));
+	const double dv = sqrt((v[0] - vo[0]) * (v[0] - vo[0]) + (v[1] - vo[1]) * (v[1] - vo[1]) + (v[2] - vo[2]) * (v[2] - vo[2]));
+	dev.dr = std::max(dev.dr, dr);
+	dev.dv = std::max(dev.dv, dv);
+	dev.points++;
+}
+
+/* -----------------------------------------------------------------------------
+*
+*                           function read_cases
+*
+*  this function reads the verification file. the time grid of a case is
+*    epoch, then startmfe to stopmfe in steps of deltamin with the last step
+*    cut at stopmfe, as testcpp writes it.
+----------------------------------------------------------------------------*/
+
+static bool read_cases(const char* filename, char opsmode, std::vector<vercase>& cases)
+{
+	FILE* infile = fopen(filename, "r");
+	double startmfe, stopmfe, deltamin, t;
+	vercase c;
+
+	if (infile == NULL)
+		return false;
+	while (fgets(c.line1, 130, infile) != NULL)
+	{
+		if (strncmp(c.line1, "1 ", 2) != 0)
+			continue;
+		if (fgets(c.line2, 130, infile) == NULL)
+			break;
+
+		char longstr1[130], longstr2[130];
+		memcpy(longstr1, c.line1, 130);
+		memcpy(longstr2, c.line2, 130);
+		SGP4Funcs::twoline2rv(longstr1, longstr2, 'v', 'e', opsmode, wgs72, startmfe, stopmfe, deltamin, c.satrec);
+
+		c.tsince.clear();
+		c.tsince.push_back(0.0);
+		t = startmfe;
+		if (fabs(t) > 1.0e-8)
+			t = t - deltamin;
+		while (t < stopmfe)
+		{
+			t = t + deltamin;
+			if (t > stopmfe)
+				t = stopmfe;
+			c.tsince.push_back(t);
+		}
+		cases.push_back(c);
+	}
+	fclose(infile);
+	return true;
+}
+
+/* -----------------------------------------------------------------------------
+*
+*                           function compare_reference
+*
+*  this function compares scalar sgp4 with a reference file in the format
+*    testcpp writes in 'v' mode : a line "satnum xx" before every case, then
+*    lines starting with tsince, x, y, z, xdot, ydot, zdot.
+----------------------------------------------------------------------------*/
+
+static bool compare_reference(const char* filename, const std::vector<vercase>& cases, deviation& dev, long& unmatched)
+{
+	FILE* infile = fopen(filename, "r");
+	char line[512];
+	long satnum = -1;
+	const vercase* c = NULL;
+	elsetrec satrec;
+
+	if (infile == NULL)
+		return false;
+	while (fgets(line, sizeof(line), infile) != NULL)
+	{
+		double ro[6], r[3], v[3], t;
+		long n;
+		char tag[8];
+		if ((sscanf(line, "%ld %7s", &n, tag) == 2) && (strcmp(tag, "xx") == 0))
+		{
+			// the same satellite can appear more than once, take its next case
+			const vercase* from = ((c != NULL) && (n == satnum)) ? c + 1 : &cases[0];
+			satnum = n;
+			c = NULL;
+			for (const vercase* k = from; k < &cases[0] + cases.size(); k++)
+				if (k->satrec.satnum == n)
+				{
+					c = k;
+					satrec = k->satrec;
+					break;
+				}
+			continue;
+		}
+		if (sscanf(line, "%lf %lf %lf %lf %lf %lf %lf", &t, &ro[0], &ro[1], &ro[2], &ro[3], &ro[4], &ro[5]) != 7)
+			continue;
+		if ((c == NULL) || !SGP4Funcs::sgp4(satrec, t, r, v))
+		{
+			unmatched++;
+			continue;
+		}
+		compare(dev, r, v, ro, ro + 3);
+	}
+	fclose(infile);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* tlefile = "orbit_propagation/SGP4-VER.TLE";
+	const char* reffile = NULL;
+	const char* outfile = NULL;
+	char opsmode = 'i';
+	int repeat = 5;
+	int i, k, rep;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--tle") == 0) && (i + 1 < argc))
+			tlefile = argv[++i];
+		else if ((strcmp(argv[i], "--ref") == 0) && (i + 1 < argc))
+			reffile = argv[++i];
+		else if ((strcmp(argv[i], "--out") == 0) && (i + 1 < argc))
+			outfile = argv[++i];
+		else if ((strcmp(argv[i], "--opsmode") == 0) && (i + 1 < argc))
+			opsmode = argv[++i][0];
+		else if ((strcmp(argv[i], "--repeat") == 0) && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else
+		{
+			fprintf(stderr, "usage : %s [--tle file] [--ref file] [--opsmode a|i] [--repeat n] [--out file]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<vercase> cases;
+	if (!read_cases(tlefile, opsmode, cases) || cases.empty())
+	{
+		fprintf(stderr, "could not read elements from %s\n", tlefile);
+		return 1;
+	}
+
+	long npoints = 0;
+	size_t maxn = 0;
+	for (k = 0; k < (int)cases.size(); k++)
+	{
+		npoints += (long)cases[k].tsince.size();
+		maxn = std::max(maxn, cases[k].tsince.size());
+	}
+
+	// ------------------------- reference states ----------------------------
+	// scalar sgp4 on a record fresh from twoline2rv, the path the others are held to
+	std::vector<std::vector<double> > states(cases.size());
+	std::vector<std::vector<int> > errors(cases.size());
+	for (k = 0; k < (int)cases.size(); k++)
+	{
+		elsetrec satrec = cases[k].satrec;
+		const int n = (int)cases[k].tsince.size();
+		states[k].resize(6 * n);
+		errors[k].resize(n);
+		for (i = 0; i < n; i++)
+		{
+			SGP4Funcs::sgp4(satrec, cases[k].tsince[i], &states[k][6 * i], &states[k][6 * i + 3]);
+			errors[k][i] = satrec.error;
+		}
+	}
+
+	// ------------------------------- catalog -------------------------------
+	// record k at time tsince[i] is copy first[k] + i, its epoch at -tsince[i] so
+	// julian date 0 is tsince[i] minutes after it. the near earth copies are also
+	// kept in a catalog of their own, the deep space ones go through sgp4 anyway
+	std::vector<elsetrec> copies, nearcopies;
+	std::vector<long> first(cases.size());
+	for (k = 0; k < (int)cases.size(); k++)
+	{
+		first[k] = (long)copies.size();
+		for (i = 0; i < (int)cases[k].tsince.size(); i++)
+		{
+			elsetrec satrec = cases[k].satrec;
+			satrec.jdsatepoch = -cases[k].tsince[i] / 1440.0;
+			satrec.jdsatepochF = 0.0;
+			copies.push_back(satrec);
+			if (satrec.method != 'd')
+				nearcopies.push_back(satrec);
+		}
+	}
+	const long nearpoints = (long)nearcopies.size();
+	SGP4Funcs::sgp4catalog catalog(copies), nearcatalog(nearcopies);
+	std::vector<double> cx(npoints), cy(npoints), cz(npoints), cvx(npoints), cvy(npoints), cvz(npoints);
+	std::vector<int> cerr(npoints);
+
+	// ------------------------------- timing --------------------------------
+	std::vector<double> tsince(maxn), x(maxn), y(maxn), z(maxn), vx(maxn), vy(maxn), vz(maxn);
+	std::vector<float> tsincef(maxn), xf(maxn), yf(maxn), zf(maxn), vxf(maxn), vyf(maxn), vzf(maxn);
+	std::vector<int> err(maxn);
+	std::vector<SGP4Funcs::elsetrec_t<float> > satrecf(cases.size());
+	double tinit = 1e30, tscalar = 1e30, tbatch = 1e30, tfloat = 1e30, tcatalog = 1e30;
+	double tscalarnear = 1e30, tcatalognear = 1e30;
+	deviation devbatch = { 0.0, 0.0, 0 }, devfloat = { 0.0, 0.0, 0 }, devcatalog = { 0.0, 0.0, 0 };
+	volatile double sink = 0.0;
+
+	for (rep = 0; rep < repeat; rep++)
+	{
+		double startmfe, stopmfe, deltamin;
+		auto t0 = std::chrono::steady_clock::now();
+		for (k = 0; k < (int)cases.size(); k++)
+		{
+			char longstr1[130], longstr2[130];
+			elsetrec satrec;
+			memcpy(longstr1, cases[k].line1, 130);
+			memcpy(longstr2, cases[k].line2, 130);
+			SGP4Funcs::twoline2rv(longstr1, longstr2, 'c', 'e', opsmode, wgs72, startmfe, stopmfe, deltamin, satrec);
+			sink = sink + satrec.a;
+		}
+		tinit = std::min(tinit, seconds_since(t0));
+
+		t0 = std::chrono::steady_clock::now();
+		for (k = 0; k < (int)cases.size(); k++)
+		{
+			elsetrec satrec = cases[k].satrec;
+			double r[3], v[3];
+			for (i = 0; i < (int)cases[k].tsince.size(); i++)
+			{
+				SGP4Funcs::sgp4(satrec, cases[k].tsince[i], r, v);
+				sink = sink + r[0];
+			}
+		}
+		tscalar = std::min(tscalar, seconds_since(t0));
+
+		t0 = std::chrono::steady_clock::now();
+		for (k = 0; k < (int)cases.size(); k++)
+		{
+			if (cases[k].satrec.method == 'd')
+				continue;
+			elsetrec satrec = cases[k].satrec;
+			double r[3], v[3];
+			for (i = 0; i < (int)cases[k].tsince.size(); i++)
+			{
+				SGP4Funcs::sgp4(satrec, cases[k].tsince[i], r, v);
+				sink = sink + r[0];
+			}
+		}
+		tscalarnear = std::min(tscalarnear, seconds_since(t0));
+
+		double tb = 0.0, tf = 0.0;
+		for (k = 0; k < (int)cases.size(); k++)
+		{
+			const int n = (int)cases[k].tsince.size();
+			elsetrec satrec = cases[k].satrec;
+			std::copy(cases[k].tsince.begin(), cases[k].tsince.end(), tsince.begin());
+			t0 = std::chrono::steady_clock::now();
+			SGP4Funcs::sgp4_batch(satrec, &tsince[0], n, &x[0], &y[0], &z[0], &vx[0], &vy[0], &vz[0], &err[0]);
+			tb += seconds_since(t0);
+			if (rep == 0)
+				for (i = 0; i < n; i++)
+					if ((err[i] == 0) && (errors[k][i] == 0))
+					{
+						const double r[3] = { x[i], y[i], z[i] }, v[3] = { vx[i], vy[i], vz[i] };
+						compare(devbatch, r, v, &states[k][6 * i], &states[k][6 * i + 3]);
+					}
+
+			if (rep == 0)
+				SGP4Funcs::sgp4init_from(cases[k].satrec, satrecf[k]);
+			SGP4Funcs::elsetrec_t<float> recf = satrecf[k];
+			for (i = 0; i < n; i++)
+				tsincef[i] = (float)cases[k].tsince[i];
+			t0 = std::chrono::steady_clock::now();
+			SGP4Funcs::sgp4_batch(recf, &tsincef[0], n, &xf[0], &yf[0], &zf[0], &vxf[0], &vyf[0], &vzf[0], &err[0]);
+			tf += seconds_since(t0);
+			if (rep == 0)
+				for (i = 0; i < n; i++)
+					if ((err[i] == 0) && (errors[k][i] == 0))
+					{
+						const double r[3] = { xf[i], yf[i], zf[i] }, v[3] = { vxf[i], vyf[i], vzf[i] };
+						compare(devfloat, r, v, &states[k][6 * i], &states[k][6 * i + 3]);
+					}
+		}
+		tbatch = std::min(tbatch, tb);
+		tfloat = std::min(tfloat, tf);
+
+		t0 = std::chrono::steady_clock::now();
+		catalog.propagate(0.0, 0.0, &cx[0], &cy[0], &cz[0], &cvx[0], &cvy[0], &cvz[0], &cerr[0], 1);
+		tcatalog = std::min(tcatalog, seconds_since(t0));
+		if (rep == 0)
+			for (k = 0; k < (int)cases.size(); k++)
+				for (i = 0; i < (int)cases[k].tsince.size(); i++)
+				{
+					const long p = first[k] + i;
+					if ((cerr[p] == 0) && (errors[k][i] == 0))
+					{
+						const double r[3] = { cx[p], cy[p], cz[p] }, v[3] = { cvx[p], cvy[p], cvz[p] };
+						compare(devcatalog, r, v, &states[k][6 * i], &states[k][6 * i + 3]);
+					}
+				}
+
+		t0 = std::chrono::steady_clock::now();
+		nearcatalog.propagate(0.0, 0.0, &cx[0], &cy[0], &cz[0], &cvx[0], &cvy[0], &cvz[0], &cerr[0], 1);
+		tcatalognear = std::min(tcatalognear, seconds_since(t0));
+	}
+
+	deviation devref = { 0.0, 0.0, 0 };
+	long unmatched = 0;
+	if ((reffile != NULL) && !compare_reference(reffile, cases, devref, unmatched))
+	{
+		fprintf(stderr, "could not read the reference %s\n", reffile);
+		return 1;
+	}
+
+	// -------------------------------- json ---------------------------------
+	FILE* out = (outfile != NULL) ? fopen(outfile, "w") : stdout;
+	if (out == NULL)
+	{
+		fprintf(stderr, "could not write %s\n", outfile);
+		return 1;
+	}
+	fprintf(out, "{\n");
+	fprintf(out, "  \"version\": \"%s\",\n", SGP4Version);
+	fprintf(out, "  \"tlefile\": \"%s\",\n", tlefile);
+	fprintf(out, "  \"opsmode\": \"%c\",\n", opsmode);
+	fprintf(out, "  \"cases\": %d,\n", (int)cases.size());
+	fprintf(out, "  \"points\": %ld,\n", npoints);
+	fprintf(out, "  \"repeat\": %d,\n", repeat);
+	fprintf(out, "  \"sgp4init_per_s\": %.6e,\n", cases.size() / tinit);
+	fprintf(out, "  \"paths\": {\n");
+	fprintf(out, "    \"scalar\": {\"props_per_s\": %.6e},\n", npoints / tscalar);
+	fprintf(out, "    \"batch\": {\"props_per_s\": %.6e, \"speedup\": %.4f, \"max_dr_km\": %.6e, \"max_dv_kms\": %.6e, \"points\": %ld},\n",
+		npoints / tbatch, tscalar / tbatch, devbatch.dr, devbatch.dv, devbatch.points);
+	fprintf(out, "    \"batch_float\": {\"props_per_s\": %.6e, \"speedup\": %.4f, \"max_dr_km\": %.6e, \"max_dv_kms\": %.6e, \"points\": %ld},\n",
+		npoints / tfloat, tscalar / tfloat, devfloat.dr, devfloat.dv, devfloat.points);
+	fprintf(out, "    \"catalog\": {\"props_per_s\": %.6e, \"speedup\": %.4f, \"max_dr_km\": %.6e, \"max_dv_kms\": %.6e, \"points\": %ld},\n",
+		npoints / tcatalog, tscalar / tcatalog, devcatalog.dr, devcatalog.dv, devcatalog.points);
+	fprintf(out, "    \"catalog_near_earth\": {\"props_per_s\": %.6e, \"speedup\": %.4f, \"scalar_props_per_s\": %.6e, \"propagated\": %ld}\n",
+		nearpoints / tcatalognear, tscalarnear / tcatalognear, nearpoints / tscalarnear, nearpoints);
+	fprintf(out, "  },\n");
+	if (reffile != NULL)
+		fprintf(out, "  \"reference\": {\"file\": \"%s\", \"max_dr_km\": %.6e, \"max_dv_kms\": %.6e, \"points\": %ld, \"unmatched\": %ld}\n",
+			reffile, devref.dr, devref.dv, devref.points, unmatched);
+	else
+		fprintf(out, "  \"reference\": null\n");
+	fprintf(out, "}\n");
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}  // end sgp4_verification_benchmark
@@ -20,17 +20,23 @@ from sgp4.earth_gravity import wgs72, wgs84
 from sgp4.io import twoline2rv
 import pyIGRF
 import math
+from functools import lru_cache
 # import pyproj
 
-def get_orbit_pos(TLE, epoch, sec_since_epoch, wgs=wgs84):
+@lru_cache(maxsize=32)
+def load_satellite(line1, line2, wgs=wgs84):
     '''
-    determine position in ECI from TLE, epoch (as a string), and seconds past epoch 
-    (as a float)
+    parse a TLE and initialize SGP4 for it. Cached, so calling the get_orbit_*
+    functions in a loop doesn't re-parse the same TLE every step
+    '''
+    return twoline2rv(line1, line2, wgs)
+
+@lru_cache(maxsize=32)
+def parse_epoch(epoch):
+    '''
+    split an epoch string 'YYYY-MM-DDTHH:MM:SS.ss' into year, month, day, hour,
+    minute, second (fractional seconds are dropped)
     '''
-    # parse TLE
-    line1 = TLE['line1']
-    line2 = TLE['line2']
-    # parse epoch
     epoch = epoch.split('-')
     year, month = int(epoch[0]), int(epoch[1])
     day_time = epoch[2].split('T')
@@ -38,8 +44,16 @@ def get_orbit_pos(TLE, epoch, sec_since_epoch, wgs=wgs84):
     time = day_time[1].split(':')
     hour, minute = int(time[0]), int(time[1])
     second = int(time[2].split('.')[0])
-    # load in spacecraft object
-    satellite = twoline2rv(line1, line2, wgs)
+    return year, month, day, hour, minute, second
+
+def get_orbit_pos(TLE, epoch, sec_since_epoch, wgs=wgs84):
+    '''
+    determine position in ECI from TLE, epoch (as a string), and seconds past epoch 
+    (as a float)
+    '''
+    # load in spacecraft object and epoch, parsed once per TLE/epoch string
+    satellite = load_satellite(TLE['line1'], TLE['line2'], wgs)
+    year, month, day, hour, minute, second = parse_epoch(epoch)
     # propagate epoch + time
     r, v = satellite.propagate(year, month, day, hour, minute, second + sec_since_epoch)
 
@@ -50,19 +64,9 @@ def get_orbit_state(TLE, epoch, sec_since_epoch, wgs=wgs84):
     determine state in ECI from TLE, epoch (as a string), and seconds past epoch 
     (as a float)
     '''
-    # parse TLE
-    line1 = TLE['line1']
-    line2 = TLE['line2']
-    # parse epoch
-    epoch = epoch.split('-')
-    year, month = int(epoch[0]), int(epoch[1])
-    day_time = epoch[2].split('T')
-    day = int(day_time[0])
-    time = day_time[1].split(':')
-    hour, minute = int(time[0]), int(time[1])
-    second = int(time[2].split('.')[0])
-    # load in spacecraft object
-    satellite = twoline2rv(line1, line2, wgs)
+    # load in spacecraft object and epoch, parsed once per TLE/epoch string
+    satellite = load_satellite(TLE['line1'], TLE['line2'], wgs)
+    year, month, day, hour, minute, second = parse_epoch(epoch)
     # propagate epoch + time
     r, v = satellite.propagate(year, month, day, hour, minute, second + sec_since_epoch)
     state = np.concatenate([np.array(r),np.array(v)])
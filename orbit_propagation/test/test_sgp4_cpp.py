@@ -0,0 +1,513 @@
+import os,sys,inspect
+currentdir = os.path.dirname(os.path.abspath(inspect.getfile(inspect.currentframe())))
+parentdir = os.path.dirname(currentdir)
+gncdir = os.path.dirname(parentdir)
+docdir = os.path.dirname(gncdir)
+sys.path.insert(0,parentdir)
+sys.path.insert(0, gncdir)
+sys.path.insert(0, docdir)
+
+import numpy as np
+import pytest
+
+SGP4_cpp = pytest.importorskip("SGP4_cpp")
+
+# Orsted, same TLE as test_orbit.py
+line1 = ('1 25635U 99008B   13348.59627062  .00000650  00000-0  16622-3 0  9860')
+line2 = ('2 25635 096.4421 173.2395 0141189 010.0389 029.8678 14.46831495780970')
+
+
+def load_verification_cases():
+	# SGP4-VER.TLE: line 2 of every case carries start, stop and step in minutes
+	cases = []
+	with open(os.path.join(parentdir, 'SGP4-VER.TLE')) as f:
+		lines = [l.rstrip('\n') for l in f if not l.startswith('#')]
+	for i in range(len(lines) - 1):
+		if lines[i].startswith('1 ') and lines[i + 1].startswith('2 '):
+			start, stop, step = [float(s) for s in lines[i + 1][69:].split()]
+			cases.append((lines[i], lines[i + 1][:69], start, stop, step))
+	return cases
+
+
+def scalar_states(satrec, times):
+	states = np.full((len(times), 6), np.nan)
+	for i, t in enumerate(times):
+		r, v = SGP4_cpp.sgp4(satrec, t)
+		if satrec.error == 0:
+			states[i] = r + v
+	return states
+
+
+def test_sgp4_batch_orsted():
+	satrec = SGP4_cpp.twoline2rv(line1, line2, 72)
+	times = np.arange(0.0, 1440.0, 0.1)
+	batch = SGP4_cpp.sgp4_batch(satrec, times)
+	assert batch.shape == (len(times), 6)
+	np.testing.assert_allclose(batch, scalar_states(satrec, times), rtol=0, atol=1e-8)
+
+
+@pytest.mark.parametrize("case", load_verification_cases(), ids=lambda c: c[0][2:7])
+def test_sgp4_batch_verification_set(case):
+	l1, l2, start, stop, step = case
+	satrec = SGP4_cpp.twoline2rv(l1, l2, 72)
+	if satrec.error != 0:
+		pytest.skip("sgp4init rejects this case")
+	times = np.arange(start, stop + step / 2, step)
+	batch = SGP4_cpp.sgp4_batch(satrec, times)
+	scalar = scalar_states(satrec, times)
+	# error rows are NaN on both paths
+	np.testing.assert_array_equal(np.isnan(batch), np.isnan(scalar))
+	np.testing.assert_allclose(batch, scalar, rtol=0, atol=1e-8)
+
+
+def test_sgp4_batch_float_orsted():
+	satrec = SGP4_cpp.twoline2rv(line1, line2, 72)
+	times = np.arange(0.0, 3.0 * 1440.0, 1.0)
+	double = SGP4_cpp.sgp4_batch(satrec, times)
+	single = SGP4_cpp.sgp4_batch_float(satrec, times)
+	assert single.dtype == np.float32 and single.shape == (len(times), 6)
+	dr = np.linalg.norm(single[:, 0:3] - double[:, 0:3], axis=1)
+	# single precision mean anomaly drifts by about a float ulp per step, a few hundred metres a day
+	assert dr[:1441].max() < 0.5 and dr.max() < 1.5
+	assert np.linalg.norm(single[:, 3:6] - double[:, 3:6], axis=1).max() < 2e-3
+
+
+def test_sgp4_batch_float_deep_space():
+	cases = {c[0][2:7]: c for c in load_verification_cases()}
+	for satnum in ['09880', '23599', '28626']:
+		satrec = SGP4_cpp.twoline2rv(cases[satnum][0], cases[satnum][1], 72)
+		times = np.arange(0.0, 1440.0, 10.0)
+		dr = np.linalg.norm(SGP4_cpp.sgp4_batch_float(satrec, times)[:, 0:3] - SGP4_cpp.sgp4_batch(satrec, times)[:, 0:3], axis=1)
+		assert dr.max() < 0.5
+
+
+@pytest.mark.parametrize("nthreads", [1, 4])
+def test_sgp4_catalog_matches_scalar(nthreads):
+	satrecs = [SGP4_cpp.twoline2rv(c[0], c[1], 72) for c in load_verification_cases()]
+	satrecs = [s for s in satrecs if s.error == 0]
+	assert any(s.method == 'd' for s in satrecs) and any(s.method == 'n' for s in satrecs)
+	catalog = SGP4_cpp.sgp4catalog(satrecs)
+	assert catalog.size() == len(satrecs)
+
+	# a common epoch a day after the first element set
+	jd, jdF = satrecs[0].jdsatepoch, satrecs[0].jdsatepochF + 1.0
+	states, err = catalog.propagate(jd, jdF, nthreads)
+	for i, s in enumerate(satrecs):
+		tsince = (jd - s.jdsatepoch) * 1440.0 + (jdF - s.jdsatepochF) * 1440.0
+		r, v = SGP4_cpp.sgp4(s, tsince)
+		assert err[i] == s.error
+		if s.error == 0:
+			# within 1 mm and 1 mm/s of the scalar propagator
+			np.testing.assert_allclose(states[i], r + v, rtol=0, atol=1e-6)
+
+
+def test_sgp4_catalog_reuses_threads():
+	satrecs = [SGP4_cpp.twoline2rv(c[0], c[1], 72) for c in load_verification_cases()]
+	satrecs = [s for s in satrecs if s.error == 0]
+	catalog = SGP4_cpp.sgp4catalog(satrecs * 20)
+
+	# the worker threads stay with the catalog, later calls with fewer or more of them agree
+	jd, jdF = satrecs[0].jdsatepoch, satrecs[0].jdsatepochF
+	for k, nthreads in enumerate([4, 2, 1, 6, 4]):
+		states, err = catalog.propagate(jd, jdF + 0.1 * k, nthreads)
+		expected, expected_err = SGP4_cpp.sgp4catalog(satrecs * 20).propagate(jd, jdF + 0.1 * k, 1)
+		np.testing.assert_array_equal(err, expected_err)
+		np.testing.assert_allclose(states[err == 0], expected[err == 0], rtol=0, atol=1e-9)
+
+
+def test_load_tle_file_matches_twoline2rv():
+	satrecs, errors = SGP4_cpp.load_tle_file(os.path.join(parentdir, 'SGP4-VER.TLE'), 72, False)
+	expected = [SGP4_cpp.twoline2rv(c[0], c[1], 72) for c in load_verification_cases()]
+	expected = [s for s in expected if s.error == 0]
+	assert [s.satnum for s in satrecs] == [s.satnum for s in expected]
+	for s, e in zip(satrecs, expected):
+		for field in ['epochyr', 'epochdays', 'jdsatepoch', 'jdsatepochF', 'bstar', 'inclo', 'nodeo',
+					  'ecco', 'argpo', 'mo', 'no_kozai', 'no_unkozai', 'a']:
+			assert getattr(s, field) == getattr(e, field)
+	# 33334 is rejected by sgp4init (error 3)
+	assert errors == [(103, 33334, 13)]
+
+
+def test_load_tle_file_reports_bad_records(tmp_path):
+	lines = ['ORSTED', line1, line2,
+			 'BAD CHECKSUM', line1[:68] + '1', line2,
+			 'NOT A NUMBER', line1, line2[:20] + 'x' + line2[21:],
+			 'NO LINE 2', line1,
+			 'ORSTED AGAIN', line1, line2]
+	tle = tmp_path / 'catalog.tle'
+	tle.write_text('\r\n'.join(lines) + '\r\n')
+	satrecs, errors = SGP4_cpp.load_tle_file(str(tle))
+	assert len(satrecs) == 2
+	assert errors == [(5, 25635, 1), (8, 0, 3), (11, 0, 5)]
+	r, v = SGP4_cpp.sgp4(satrecs[1], 0.0)
+	r_ref, v_ref = SGP4_cpp.sgp4(SGP4_cpp.twoline2rv(line1, line2, 72), 0.0)
+	assert r == r_ref and v == v_ref
+
+
+def test_load_tle_file_missing():
+	with pytest.raises(RuntimeError):
+		SGP4_cpp.load_tle_file('no_such_file.tle')
+
+
+def test_load_tle_cached(tmp_path):
+	tle = tmp_path / 'catalog.tle'
+	cache = tmp_path / 'catalog.snap'
+	tle.write_text('\n'.join(['ORSTED', line1, line2]) + '\n')
+
+	def first_state(satrecs):
+		r, v = SGP4_cpp.sgp4(satrecs[0], 100.0)
+		return r + v
+
+	satrecs, errors = SGP4_cpp.load_tle_cached(str(tle), str(cache))
+	assert cache.exists() and len(satrecs) == 1 and errors == []
+	fresh = first_state(SGP4_cpp.load_tle_file(str(tle))[0])
+	assert first_state(satrecs) == fresh
+
+	# second load maps the snapshot, same records
+	snapshot = cache.read_bytes()
+	satrecs, errors = SGP4_cpp.load_tle_cached(str(tle), str(cache))
+	assert first_state(satrecs) == fresh
+	assert cache.read_bytes() == snapshot
+
+	# other gravity constants invalidate the snapshot
+	satrecs, errors = SGP4_cpp.load_tle_cached(str(tle), str(cache), 84)
+	assert satrecs[0].a != SGP4_cpp.load_tle_file(str(tle))[0][0].a
+	assert cache.read_bytes() != snapshot
+
+	# so does a different tle text
+	tle.write_text('\n'.join(['ORSTED', line1, line2, 'ORSTED', line1, line2]) + '\n')
+	satrecs, errors = SGP4_cpp.load_tle_cached(str(tle), str(cache))
+	assert len(satrecs) == 2
+
+	# and a damaged file is rebuilt instead of used
+	cache.write_bytes(b'SGP4SNAP' + bytes(100))
+	satrecs, errors = SGP4_cpp.load_tle_cached(str(tle), str(cache))
+	assert len(satrecs) == 2 and first_state(satrecs) == fresh
+
+
+def test_satellite_propagate():
+	sat = SGP4_cpp.Satellite(line1, line2)
+	assert sat.satrec.satnum == 25635
+	times = np.arange(0.0, 600.0, 0.5)
+	states = sat.propagate(times)
+	assert states.shape == (len(times), 6)
+	np.testing.assert_allclose(states, scalar_states(SGP4_cpp.twoline2rv(line1, line2, 72), times), rtol=0, atol=1e-8)
+	# the stored record is not advanced by propagating
+	np.testing.assert_array_equal(sat.propagate(times[::-1]), states[::-1])
+
+
+def test_satellite_minutes_since_epoch():
+	sat = SGP4_cpp.Satellite(line1, line2)
+	# epoch 13348.59627062 is 2013-12-14 14:18:37.781568 UTC
+	assert abs(sat.minutes_since_epoch(2013, 12, 14, 14, 18, 37.781568)) < 1e-6
+	assert abs(sat.minutes_since_epoch(2013, 12, 15, 14, 18, 37.781568) - 1440.0) < 1e-6
+
+
+def test_satellite_bad_tle():
+	# eccentricity past 1 makes sgp4init fail
+	with pytest.raises(RuntimeError):
+		SGP4_cpp.Satellite(line1, line2[:26] + '9999999' + line2[33:])
+
+
+def screening_set():
+	# verification cases that propagate without errors over the first day after the latest epoch
+	satrecs = [SGP4_cpp.twoline2rv(l1, l2, 72) for l1, l2, start, stop, step in load_verification_cases()]
+	satrecs = [s for s in satrecs if s.error == 0]
+	jd = max(s.jdsatepoch + s.jdsatepochF for s in satrecs)
+	jd0, jd0F = np.floor(jd), jd - np.floor(jd)
+	times = np.arange(0.0, 1440.0 + 1e-9, 0.05)
+	keep, positions = [], []
+	for s in satrecs:
+		offset = (jd0 - s.jdsatepoch) * 1440.0 + (jd0F - s.jdsatepochF) * 1440.0
+		r = SGP4_cpp.sgp4_batch(s, times + offset)[:, 0:3]
+		if not np.isnan(r).any():
+			keep.append(s)
+			positions.append(r)
+	return keep, jd0, jd0F, times, positions
+
+
+@pytest.mark.parametrize("nthreads", [1, 3])
+def test_screen_conjunctions_matches_brute_force(nthreads):
+	satrecs, jd0, jd0F, times, positions = screening_set()
+	threshold = 3000.0
+	events = SGP4_cpp.screen_conjunctions(satrecs, jd0, jd0F, 1440.0, 1.0, threshold, nthreads=nthreads)
+	assert [e[2] for e in events] == sorted(e[2] for e in events)
+
+	# every local minimum of the sampled range below the threshold is found, no farther than sampled
+	nfound = 0
+	for i in range(len(satrecs)):
+		for j in range(i + 1, len(satrecs)):
+			d = np.linalg.norm(positions[i] - positions[j], axis=1)
+			for k in np.where((d[1:-1] < d[:-2]) & (d[1:-1] <= d[2:]) & (d[1:-1] < 0.9 * threshold))[0] + 1:
+				match = [e for e in events if e[0] == i and e[1] == j and abs(e[2] - times[k]) < 0.1]
+				assert len(match) == 1
+				assert match[0][3] <= d[k] + 1e-6
+				nfound += 1
+	assert nfound > 10
+
+	# reported miss distances are the range at the reported time
+	for i, j, tca, dmin, vrel in events:
+		assert dmin <= threshold
+		ri, vi = SGP4_cpp.sgp4(satrecs[i], (jd0 - satrecs[i].jdsatepoch) * 1440.0 + (jd0F - satrecs[i].jdsatepochF) * 1440.0 + tca)
+		rj, vj = SGP4_cpp.sgp4(satrecs[j], (jd0 - satrecs[j].jdsatepoch) * 1440.0 + (jd0F - satrecs[j].jdsatepochF) * 1440.0 + tca)
+		assert abs(np.linalg.norm(np.subtract(rj, ri)) - dmin) < 1e-6
+		assert abs(np.linalg.norm(np.subtract(vj, vi)) - vrel) < 1e-9
+
+
+def test_screen_conjunctions_primary():
+	satrecs, jd0, jd0F, times, positions = screening_set()
+	events = SGP4_cpp.screen_conjunctions(satrecs, jd0, jd0F, 1440.0, 1.0, 3000.0)
+	primary = events[0][0]
+	against = SGP4_cpp.screen_conjunctions(satrecs, jd0, jd0F, 1440.0, 1.0, 3000.0, primary=primary)
+	expected = [e for e in events if primary in (e[0], e[1])]
+	assert len(against) == len(expected)
+	for a, e in zip(against, expected):
+		assert a[0] == primary and a[1] == (e[1] if e[0] == primary else e[0])
+		np.testing.assert_allclose(a[2:], e[2:], rtol=0, atol=1e-6)
+	with pytest.raises(ValueError):
+		SGP4_cpp.screen_conjunctions(satrecs, jd0, jd0F, 1440.0, 0.0, 3000.0)
+
+
+def brute_force_elevation(satrec, station, jd0, jd0F, times):
+	# same look angle chain as predict_passes: TEME as ECI, MJD2GMST, spherical station, ENU
+	lat, lon, alt, minel = station
+	offset = (jd0 - satrec.jdsatepoch) * 1440.0 + (jd0F - satrec.jdsatepochF) * 1440.0
+	r = SGP4_cpp.sgp4_batch(satrec, times + offset)[:, 0:3]
+	T = ((jd0 - 2400000.5) + jd0F + times / 1440.0 - 51544.5) / 36525.0
+	gmst = np.mod(67310.54841 + (876600.0 * 3600.0 + 8640184.812866) * T + 0.093104 * T ** 2 - 6.2e-6 * T ** 3, 86400.0)
+	gmst = gmst * np.pi / 180.0 / 240.0
+	ecef = np.stack([np.cos(gmst) * r[:, 0] + np.sin(gmst) * r[:, 1], -np.sin(gmst) * r[:, 0] + np.cos(gmst) * r[:, 1], r[:, 2]], axis=1)
+	rs = 6378.1 + alt
+	rho = ecef - rs * np.array([np.cos(lat) * np.cos(lon), np.cos(lat) * np.sin(lon), np.sin(lat)])
+	up = np.array([np.cos(lat) * np.cos(lon), np.cos(lat) * np.sin(lon), np.sin(lat)])
+	return np.arcsin(rho @ up / np.linalg.norm(rho, axis=1))
+
+
+@pytest.mark.parametrize("nthreads", [1, 2])
+def test_predict_passes_matches_brute_force(nthreads):
+	satrecs = [SGP4_cpp.twoline2rv(line1, line2, 72)]
+	satrecs += [SGP4_cpp.twoline2rv(l1, l2, 72) for l1, l2, start, stop, step in load_verification_cases()
+				if l1[2:7] in ('06251', '28057', '28350')]
+	stations = [(np.radians(37.43), np.radians(-122.17), 0.03, np.radians(10.0)),
+				(np.radians(78.23), np.radians(15.41), 0.5, np.radians(5.0)),
+				(np.radians(-0.5), np.radians(100.0), 0.0, 0.0)]
+	# mid 2006, near the epochs of the verification cases (28350 has decayed by then)
+	jd0, jd0F = 2453918.0, 0.25
+	events = SGP4_cpp.predict_passes(satrecs, stations, jd0, jd0F, 1440.0, nthreads=nthreads)
+	assert [e[0] for e in events] == sorted(e[0] for e in events)
+
+	times = np.arange(0.0, 1440.0 + 1e-9, 1.0 / 60.0)
+	npass = 0
+	for s, satrec in enumerate(satrecs):
+		for k, station in enumerate(stations):
+			el = brute_force_elevation(satrec, station, jd0, jd0F, times)
+			above = el >= station[3]
+			crossings = np.where(above[1:] != above[:-1])[0]
+			mine = [e for e in events if e[1] == s and e[2] == k]
+			edges = [e for e in mine if e[3] != SGP4_cpp.PASS_TCA]
+			# every sign change of the 1 s samples is an AOS or LOS within that second
+			assert len(edges) == len(crossings)
+			for c, e in zip(crossings, edges):
+				assert e[3] == (SGP4_cpp.PASS_AOS if above[c + 1] else SGP4_cpp.PASS_LOS)
+				assert times[c] - 1e-6 <= e[0] <= times[c + 1] + 1e-6
+				assert abs(e[4] - station[3]) < 1e-6
+			# the TCA is at least as high as every sample of its pass
+			for e in mine:
+				if e[3] == SGP4_cpp.PASS_TCA:
+					window = (times > e[0] - 30.0) & (times < e[0] + 30.0) & above
+					assert e[4] >= el[window].max() - 1e-9
+					npass += 1
+	assert npass > 10
+
+
+@pytest.mark.parametrize("satnum", ['25635', '09880', '23599'])
+def test_ephemeris_within_tolerance(satnum):
+	cases = {c[0][2:7]: c for c in load_verification_cases()}
+	l1, l2 = (line1, line2) if satnum == '25635' else cases[satnum][0:2]
+	satrec = SGP4_cpp.twoline2rv(l1, l2, 72)
+	eph = SGP4_cpp.sgp4ephemeris()
+	eph.build(satrec, -60.0, 1440.0, 1e-4)
+	assert eph.segments() > 1 and eph.start() == -60.0 and eph.stop() == 1440.0
+	times = np.arange(-60.0, 1440.0, 0.1 / 60.0)
+	states = eph.evaluate(times)
+	reference = SGP4_cpp.sgp4_batch(satrec, times)
+	assert np.linalg.norm(states[:, 0:3] - reference[:, 0:3], axis=1).max() <= 1e-4
+	assert np.linalg.norm(states[:, 3:6] - reference[:, 3:6], axis=1).max() <= 1e-5
+	assert np.isnan(eph.evaluate(np.array([-61.0, 1441.0]))).all()
+
+
+def test_ephemeris_save_load(tmp_path):
+	satrec = SGP4_cpp.twoline2rv(line1, line2, 72)
+	eph = SGP4_cpp.sgp4ephemeris()
+	eph.build(satrec, 0.0, 600.0, 1e-3, degree=10)
+	eph.save(str(tmp_path / 'orsted.eph'))
+	loaded = SGP4_cpp.sgp4ephemeris()
+	loaded.load(str(tmp_path / 'orsted.eph'))
+	assert (loaded.segments(), loaded.degree(), loaded.satnum(), loaded.tolerance()) == (eph.segments(), 10, 25635, 1e-3)
+	times = np.linspace(0.0, 600.0, 1001)
+	np.testing.assert_array_equal(loaded.evaluate(times), eph.evaluate(times))
+	with pytest.raises(RuntimeError):
+		loaded.load(str(tmp_path / 'missing.eph'))
+	with pytest.raises(RuntimeError):
+		eph.build(satrec, 0.0, 600.0, 1e-3, degree=2)
+
+
+@pytest.mark.parametrize("interval", [1, 3])
+def test_checkpoints_bit_identical(interval):
+	rng = np.random.default_rng(9)
+	resonant = [c for c in load_verification_cases() if SGP4_cpp.twoline2rv(c[0], c[1], 72).irez != 0]
+	assert len(resonant) > 5
+	for l1, l2, start, stop, step in resonant:
+		table = SGP4_cpp.sgp4checkpoints()
+		table.init(SGP4_cpp.twoline2rv(l1, l2, 72), interval)
+		# random order on both sides of epoch, with checkpoint times and their neighbours
+		times = np.concatenate([rng.uniform(-14400.0, 14400.0, 40), np.arange(-4320.0, 4321.0, 720.0),
+		                        np.arange(-4320.0, 4321.0, 720.0) * (1.0 - 1e-16), [0.0, -0.0]])
+		rng.shuffle(times)
+		states = table.propagate(times)
+		for i, t in enumerate(times):
+			# a record fresh from sgp4init integrates from epoch
+			satrec = SGP4_cpp.twoline2rv(l1, l2, 72)
+			r, v = SGP4_cpp.sgp4(satrec, t)
+			expected = np.array(r + v) if satrec.error == 0 else np.full(6, np.nan)
+			np.testing.assert_array_equal(states[i], expected)
+		assert table.checkpoints() > 0
+	with pytest.raises(ValueError):
+		SGP4_cpp.sgp4checkpoints().init(SGP4_cpp.twoline2rv(line1, line2, 72), 0)
+
+
+# fields of the jacobian columns: (line, first column, last column, to elsetrec units)
+jacobian_fields = [(2, 26, 33, 1e-7), (2, 34, 42, np.pi / 180.0), (2, 8, 16, np.pi / 180.0),
+                   (2, 43, 51, np.pi / 180.0), (2, 52, 63, 2.0 * np.pi / 1440.0), (2, 17, 25, np.pi / 180.0),
+                   (1, 53, 61, None)]
+
+
+def perturb_tle(l1, l2, column, steps):
+	# moves one field of the TLE by a number of steps of its last printed digit,
+	# returns the lines and the change in elsetrec units
+	line, a, b, scale = jacobian_fields[column]
+	s = l1 if line == 1 else l2
+	field = s[a:b]
+	if scale is None:
+		# bstar, sign, five digit mantissa and exponent
+		mant = int(field[1:6]) * (-1 if field[0] == '-' else 1) + steps
+		field = ('-' if mant < 0 else ' ') + '%05d' % abs(mant) + field[6:]
+		delta = steps * 1e-5 * 10.0 ** int(field[6:])
+	elif column == 0:
+		field = '%07d' % (int(field) + steps)
+		delta = steps * scale
+	else:
+		decimals = len(field) - field.index('.') - 1
+		field = '%0*.*f' % (len(field), decimals, float(field) + steps * 10.0 ** -decimals)
+		delta = steps * 10.0 ** -decimals * scale
+	s = s[:a] + field + s[b:]
+	return (s, l2, delta) if line == 1 else (l1, s, delta)
+
+
+@pytest.mark.parametrize("satnum", ['25635', '23599', '09880'])
+def test_sgp4_jacobian_central_differences(satnum):
+	cases = {c[0][2:7]: c for c in load_verification_cases()}
+	l1, l2 = (line1, line2) if satnum == '25635' else cases[satnum][:2]
+	satrec = SGP4_cpp.twoline2rv(l1, l2, 72)
+	times = np.arange(0.0, 1441.0, 60.0)
+	states, jac, rates = SGP4_cpp.sgp4_jacobian(satrec, times)
+	assert jac.shape == (len(times), 6, 7)
+	np.testing.assert_allclose(states, scalar_states(SGP4_cpp.twoline2rv(l1, l2, 72), times), rtol=0, atol=1e-8)
+	for k in range(7):
+		lp1, lp2, delta = perturb_tle(l1, l2, k, 1)
+		lm1, lm2, _ = perturb_tle(l1, l2, k, -1)
+		plus = scalar_states(SGP4_cpp.twoline2rv(lp1, lp2, 72), times)
+		minus = scalar_states(SGP4_cpp.twoline2rv(lm1, lm2, 72), times)
+		fd = (plus - minus) / (2.0 * delta)
+		# bstar hardly moves a deep space orbit in a day, the differences are roundoff there
+		if np.abs(plus - minus)[:, :3].max() < 1e-6:
+			continue
+		np.testing.assert_allclose(jac[:, :, k], fd, rtol=0, atol=1e-5 * np.abs(fd).max())
+	h = 1e-3
+	fd = (SGP4_cpp.sgp4_batch(satrec, times + h) - SGP4_cpp.sgp4_batch(satrec, times - h)) / (2.0 * h)
+	np.testing.assert_allclose(rates, fd, rtol=0, atol=1e-6 * np.abs(fd).max())
+
+
+@pytest.mark.parametrize("satnum", ['25635', '23599'])
+def test_sgp4_fit_recovers_elements(satnum):
+	cases = {c[0][2:7]: c for c in load_verification_cases()}
+	l1, l2 = (line1, line2) if satnum == '25635' else cases[satnum][:2]
+	truth = SGP4_cpp.twoline2rv(l1, l2, 72)
+	# a day of 10 s fixes
+	times = np.arange(0.0, 1440.0, 10.0 / 60.0)
+	fixes = SGP4_cpp.sgp4_batch(truth, times)[:, :3]
+	# first guess a few hundred steps of the last digit off in every element
+	for column, steps in [(0, 300), (1, -200), (2, 100), (3, 500), (4, 300), (5, -100)]:
+		l1, l2, _ = perturb_tle(l1, l2, column, steps)
+	guess = SGP4_cpp.twoline2rv(l1, l2, 72)
+	fit, rms, passes = SGP4_cpp.sgp4_fit(guess, times, fixes, fit_bstar=False)
+	assert rms < 1e-6
+	assert passes < 20
+	for name in ['ecco', 'argpo', 'inclo', 'mo', 'no_kozai', 'nodeo', 'bstar']:
+		np.testing.assert_allclose(getattr(fit, name), getattr(truth, name), rtol=1e-8, atol=1e-10)
+	np.testing.assert_allclose(SGP4_cpp.sgp4_batch(fit, times)[:, :3], fixes, rtol=0, atol=1e-5)
+
+
+def test_sgp4_fit_noisy_fixes():
+	truth = SGP4_cpp.twoline2rv(line1, line2, 72)
+	times = np.arange(0.0, 1440.0, 10.0 / 60.0)
+	rng = np.random.default_rng(13)
+	fixes = SGP4_cpp.sgp4_batch(truth, times)[:, :3] + rng.normal(0.0, 0.01, (len(times), 3))
+	l1, l2, _ = perturb_tle(line1, line2, 3, 500)
+	l1, l2, _ = perturb_tle(l1, l2, 6, 2000)
+	fit, rms, passes = SGP4_cpp.sgp4_fit(SGP4_cpp.twoline2rv(l1, l2, 72), times, fixes, nthreads=2)
+	# 10 m per axis
+	assert abs(rms - 0.01 * np.sqrt(3.0)) < 1e-3
+	assert np.abs(SGP4_cpp.sgp4_batch(fit, times)[:, :3] - SGP4_cpp.sgp4_batch(truth, times)[:, :3]).max() < 0.01
+	with pytest.raises(ValueError):
+		SGP4_cpp.sgp4_fit(truth, times, fixes[:-1])
+	with pytest.raises(RuntimeError):
+		SGP4_cpp.sgp4_fit(truth, times[:2], fixes[:2])
+
+
+def test_sgp4_fit_stops_without_convergence():
+	# no orbit passes through one fixed point, the steps fail until the halvings run out well before maxiter
+	truth = SGP4_cpp.twoline2rv(line1, line2, 72)
+	times = np.arange(0.0, 1440.0, 7.2)
+	fixes = np.tile([7000.0, 0.0, 0.0], (len(times), 1))
+	with pytest.raises(RuntimeError):
+		SGP4_cpp.sgp4_fit(truth, times, fixes, maxiter=200, nthreads=1)
+
+
+def shift_epoch(l1, days):
+	# moves the epoch of a TLE (line 1, columns 19-32) by whole days
+	return l1[:18] + '%014.8f' % (float(l1[18:32]) + days) + l1[32:]
+
+
+def test_history_nearest_record():
+	deep = [c for c in load_verification_cases() if c[0][2:7] == '09880'][0]
+	tles = {25635: [(shift_epoch(line1, d), line2) for d in [5.0, 0.0, 2.0, 2.5]],
+	        9880: [(shift_epoch(deep[0], d), deep[1]) for d in [0.0, 3.0]]}
+	history = SGP4_cpp.sgp4history()
+	for satnum, lines in tles.items():
+		for l1, l2 in lines:
+			assert history.add(SGP4_cpp.twoline2rv(l1, l2, 72))
+	# a record already stored is not added again
+	assert not history.add(SGP4_cpp.twoline2rv(*tles[25635][1], 72))
+	assert history.size() == 6 and history.records(25635) == 4 and history.satnums() == [9880, 25635]
+	assert history.find(11111, 2456640.0, 0.0) is None
+
+	rng = np.random.default_rng(4)
+	for satnum, lines in tles.items():
+		recs = [SGP4_cpp.twoline2rv(l1, l2, 72) for l1, l2 in lines]
+		epochs = np.array([rec.jdsatepoch + rec.jdsatepochF for rec in recs])
+		# a replay out and back again, so deep space records switch both ways
+		jd = np.concatenate([np.linspace(epochs.min() - 1.0, epochs.max() + 1.0, 200),
+		                     rng.uniform(epochs.min(), epochs.max(), 50)])
+		jdF = jd - np.floor(jd)
+		jd = np.floor(jd)
+		states = history.propagate(satnum, jd, jdF)
+		for i in range(len(jd)):
+			k = np.argmin(np.abs(epochs - (jd[i] + jdF[i])))
+			rec = history.find(satnum, jd[i], jdF[i])
+			assert rec.jdsatepoch + rec.jdsatepochF == epochs[k]
+			fresh = SGP4_cpp.twoline2rv(*lines[k], 72)
+			tsince = ((jd[i] - fresh.jdsatepoch) + (jdF[i] - fresh.jdsatepochF)) * 1440.0
+			r, v = SGP4_cpp.sgp4(fresh, tsince)
+			np.testing.assert_allclose(states[i], r + v, rtol=0, atol=1e-8)
+	assert np.isnan(history.propagate(11111, np.array([2456640.0]), np.array([0.0]))).all()
@@ -4,9 +4,11 @@
 
 #include "frame_conversions.h"
 #include "../../eigen-git-mirror/Eigen/Dense"
+#ifndef UTIL_FUNCS_LIBRARY
 #include <../../pybind11/include/pybind11/pybind11.h>
 #include <../../pybind11/include/pybind11/eigen.h>
 namespace py = pybind11;
+#endif
 using namespace Eigen;
 using namespace std;
 
@@ -15,9 +17,12 @@ MatrixXd eci2ecef(double GMST);
 std::tuple<double, double, double> ecef2lla(Vector3d);
 MatrixXd ecef2enu(double lat, double lon);
 
+// the util_funcs library (CMakeLists.txt) links these functions into C++ code, without main or the python module
+#ifndef UTIL_FUNCS_LIBRARY
 int main(){
     return 0;
 }
+#endif
 
 MatrixXd eci2ecef(double GMST){
     /*
@@ -76,10 +81,12 @@ std::tuple<double, double, double> ecef2lla(Vector3d r){
 
 
 
+#ifndef UTIL_FUNCS_LIBRARY
 PYBIND11_MODULE(frame_conversions_cpp, m) {
     m.doc() = "Frame Conversions"; // optional module docstring
 
     m.def("eci2ecef", &eci2ecef, "Gives rotation matrix from ECI2ECEF");
     m.def("ecef2lla", &ecef2lla, "Converts position in ECEF to lat, long, alt");
     m.def("ecef2enu", &ecef2enu,  "Gives rotation matrix from ECEF2enu using long and lat");
-}
\ No newline at end of file
+}
+#endif
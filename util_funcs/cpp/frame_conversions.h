@@ -5,4 +5,11 @@
 #ifndef GNC_FRAME_CONVERSIONS_H
 #define GNC_FRAME_CONVERSIONS_H
 
+#include <tuple>
+#include "../../eigen-git-mirror/Eigen/Dense"
+
+Eigen::MatrixXd eci2ecef(double GMST);
+Eigen::MatrixXd ecef2enu(double lat, double lon);
+std::tuple<double, double, double> ecef2lla(Eigen::Vector3d r);
+
 #endif //GNC_FRAME_CONVERSIONS_H
@@ -7,16 +7,20 @@
 #include <iostream>
 #include <math.h>
 #include <cassert>
+#ifndef UTIL_FUNCS_LIBRARY
 #include <../../pybind11/include/pybind11/pybind11.h>
+namespace py = pybind11;
+#endif
 
 using namespace std;
-namespace py = pybind11;
 
 // function declaration
 double MJD2GMST(double MJD);
 double date2MJD(int M, int D, int Y, int HH, int MM, double SS);
 bool valid_date(int M, int D, int Y, int HH, int MM, double SS);
 
+// the util_funcs library (CMakeLists.txt) links these functions into C++ code, without main or the python module
+#ifndef UTIL_FUNCS_LIBRARY
 int main() {
     // local variable declaration:
     double MJD = 58827.53750000009;
@@ -37,6 +41,7 @@ int main() {
     cout << "MJD is : " << ret2 << endl;
     return 0;
 }
+#endif
 
 
 double MJD2GMST(double MJD) {
@@ -143,9 +148,11 @@ bool valid_date(int M, int D, int Y, int HH, int MM, double SS) {
     return check;
 }
 
+#ifndef UTIL_FUNCS_LIBRARY
 PYBIND11_MODULE(time_functions_cpp, m) {
     m.doc() = "Time Functions"; // optional module docstring
     m.def("valid_date", &valid_date, "Returns whether the date is valid or not");
     m.def("date2MJD", &date2MJD, "Converts the date to MJD");
     m.def("MJD2GMST", &MJD2GMST, "Converts MJD to GMST");
 }
+#endif
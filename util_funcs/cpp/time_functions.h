@@ -5,4 +5,8 @@
 #ifndef GNC_TIME_FUNCTIONS_H
 #define GNC_TIME_FUNCTIONS_H
 
+double MJD2GMST(double MJD);
+double date2MJD(int M, int D, int Y, int HH, int MM, double SS);
+bool valid_date(int M, int D, int Y, int HH, int MM, double SS);
+
 #endif //GNC_TIME_FUNCTIONS_H